@@ -0,0 +1,86 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+#include "protocol.h"
+
+// E/S de datagramas por lotes (servidor)
+// En Linux usa recvmmsg()/sendmmsg(): una syscall recibe hasta `size`
+// PDUs y otra envía todas las respuestas generadas al procesarlas.
+// En otros sistemas cae a recvfrom()/sendto() de a una PDU.
+// Con UDP_GRO cada buffer de recepción puede traer varios datagramas del
+// mismo cliente coalescidos por el kernel; rx_seg_sizes indica el tamaño
+// de segmento para separarlos.
+// Una PDU encolada con batch_queue_send_iov lleva solo su header en el lote
+// y el payload sale de memoria ajena (el mapeo de una descarga) como un
+// segundo iovec, sin copiarlo: esa memoria tiene que seguir válida hasta el
+// próximo batch_flush.
+
+#define BATCH_DEFAULT 32            // PDUs por syscall por defecto
+#define BATCH_MAX 256               // Máximo configurable
+#define GRO_BUFFER_SIZE 65535       // Buffer de recepción con UDP_GRO
+
+typedef struct BatchIO {
+    int size;                       // Tamaño de lote configurado
+    
+    // Lote de recepción
+    uint8_t *rx_bufs;               // `size` buffers de rx_buf_size bytes
+    size_t rx_buf_size;             // PDU más grande aceptada, o GRO_BUFFER_SIZE con GRO
+    int rx_gro;                     // 1 si el socket entrega segmentos GRO
+    uint8_t rx_ctrl[BATCH_MAX][64]; // Mensajes de control (cmsg UDP_GRO)
+    struct sockaddr_in rx_addrs[BATCH_MAX];
+    int rx_lens[BATCH_MAX];
+    int rx_seg_sizes[BATCH_MAX];    // Tamaño de segmento GRO (0 = un datagrama)
+    
+    // Lote de envío (respuestas pendientes)
+    PDU tx_pdus[BATCH_MAX];
+    struct sockaddr_in tx_addrs[BATCH_MAX];
+    int tx_lens[BATCH_MAX];
+    const void *tx_payloads[BATCH_MAX]; // Payload fuera del lote (NULL = no hay)
+    int tx_payload_lens[BATCH_MAX];
+    int tx_count;
+    
+    // Estadísticas
+    uint64_t rx_calls;              // Syscalls de recepción
+    uint64_t rx_packets;            // PDUs recibidas
+    uint64_t tx_calls;              // Syscalls de envío
+    uint64_t tx_packets;            // PDUs enviadas
+    uint64_t rx_gro_buffers;        // Buffers que llegaron coalescidos
+    uint64_t rx_gro_segments;       // Datagramas contenidos en esos buffers
+    int rx_max_batch;               // Lote de recepción más grande visto
+} BatchIO;
+
+// Reserva e inicializa un BatchIO con el tamaño de lote dado
+// max_pdu = datagrama más grande a recibir (según el blksize máximo)
+// gro = 1 si el socket tiene UDP_GRO activo (buffers de 64 kB)
+BatchIO* batch_create(int size, size_t max_pdu, int gro);
+
+// Buffer de recepción i del lote
+#define batch_rx_buf(batch, i) ((batch)->rx_bufs + (size_t)(i) * (batch)->rx_buf_size)
+
+// Libera un BatchIO
+void batch_destroy(BatchIO *batch);
+
+// Recibe hasta `size` PDUs (bloquea hasta la primera o hasta SO_RCVTIMEO)
+// Retorna la cantidad recibida (0 si timeout) o -1 si error (errno indica
+// la causa; el que llama decide cómo informarlo)
+int batch_recv(int sockfd, BatchIO *batch);
+
+// Encola una PDU para enviar; si el lote está lleno lo envía antes
+// Retorna el tamaño de la PDU o -1 si error
+int batch_queue_send(int sockfd, BatchIO *batch, struct sockaddr_in *dest_addr,
+                     PDU *pdu, int data_len);
+
+// Encola una PDU de header (hdr_len bytes, Type incluido) + payload sin
+// copiar el payload
+// Retorna el tamaño de la PDU o -1 si error
+int batch_queue_send_iov(int sockfd, BatchIO *batch, struct sockaddr_in *dest_addr,
+                         const void *hdr, int hdr_len, const void *payload, int payload_len);
+
+// Envía todas las PDUs encoladas
+// Retorna la cantidad enviada o -1 si error
+int batch_flush(int sockfd, BatchIO *batch);
+
+// Registra las estadísticas de PDUs por syscall
+void batch_print_stats(BatchIO *batch);
+
+#endif
@@ -0,0 +1,27 @@
+#ifndef CHECKSUM_H
+#define CHECKSUM_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// CRC32C (Castagnoli, polinomio 0x1EDC6F41 reflejado 0x82F63B78)
+// Se usa para verificar el prefijo ya recibido de una subida que se retoma
+// y, si se negocia, cada DATA y el archivo completo (protocol.h).
+// Es encadenable: crc32c_update(crc32c_update(0, a, n), b, m) es el CRC de
+// a seguido de b; el CRC de cero bytes es 0. Con crc32c_combine se obtiene
+// el mismo resultado a partir de los CRC de a y de b por separado, sin
+// volver a leer los datos.
+// Usa la instrucción CRC32 de la CPU (SSE4.2 en x86-64, extensión CRC de
+// ARMv8) si está disponible y una tabla si no.
+
+#define CRC32C_INIT 0
+
+uint32_t crc32c_update(uint32_t crc, const void *data, size_t len);
+
+// CRC de a seguido de b a partir de crc1 = CRC(a), crc2 = CRC(b) y len2 = |b|
+uint32_t crc32c_combine(uint32_t crc1, uint32_t crc2, size_t len2);
+
+// Implementación en uso ("sse4.2", "armv8-crc" o "tabla")
+const char* crc32c_impl(void);
+
+#endif
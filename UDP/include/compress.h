@@ -0,0 +1,33 @@
+#ifndef COMPRESS_H
+#define COMPRESS_H
+
+#include <stdint.h>
+
+// Compresión LZ77 de los DATA (opción "compress", protocol.h)
+// Códec propio, sin dependencias, pensado para ser rápido más que para
+// comprimir al máximo (estilo LZ4). Cada bloque es independiente: se puede
+// descomprimir en cualquier orden y retransmitir sin estado compartido.
+// Formato: una secuencia de tokens
+//   0LLLLLLL                 literales: L + 1 bytes (1-128) a continuación
+//   1MMMMMMM Off(2) [Ext]    copia de M + 4 bytes desde Off bytes atrás
+//                            (uint16 little endian, 1-65535); con M = 127
+//                            siguen bytes que se suman al largo hasta uno
+//                            distinto de 255
+// La copia puede solaparse con lo que escribe (Off < largo: repeticiones).
+
+#define LZ_MAX_BLOCK (256 * 1024)   // Máximo de bytes descomprimidos por bloque
+#define LZ_MIN_MATCH 4
+#define LZ_MAX_OFFSET 65535
+
+// Comprime el mayor prefijo de src cuya salida entra en dst_cap bytes
+// (como LZ4_compress_destSize): así un DATA de tamaño fijo lleva todo el
+// archivo que le entre. src_len no puede superar LZ_MAX_BLOCK.
+// Retorna los bytes escritos en dst; en *consumed los bytes de src que
+// representan
+int lz_compress(const uint8_t *src, int src_len, uint8_t *dst, int dst_cap, int *consumed);
+
+// Descomprime src en dst (de dst_cap bytes)
+// Retorna los bytes escritos o -1 si los datos son inválidos o no entran
+int lz_decompress(const uint8_t *src, int src_len, uint8_t *dst, int dst_cap);
+
+#endif
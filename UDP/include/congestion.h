@@ -0,0 +1,96 @@
+#ifndef CONGESTION_H
+#define CONGESTION_H
+
+#include <stdint.h>
+
+// Control de congestión y pacing del emisor en modo ventana (cliente)
+// La ventana negociada limita los chunks en vuelo por el buffer del
+// servidor; cwnd limita los bytes en vuelo por la red. Cada algoritmo es
+// una tabla de operaciones (CongestionOps) elegida por nombre con -c:
+//   newreno  AIMD: slow start, +1 MSS por RTT, cwnd / 2 por pérdida
+//   vegas    Por delay: compara el RTT mínimo de cada ronda con el RTT base
+//            y ajusta cwnd en 1 MSS para tener entre alpha y beta chunks
+//            encolados en la red; ante pérdida se comporta como newreno
+//   none     Sin control: solo la ventana negociada y sin pacing
+// La reducción por pérdida se aplica una vez por ventana (recuperación
+// estilo NewReno hasta que se reconoce lo enviado al detectarla).
+// Pacing: las salidas se espacian a cwnd / SRTT, con ganancia 2 en slow
+// start y 1.2 después (como Linux), para no mandar la ventana en ráfaga.
+
+#define CC_DEFAULT "newreno"
+#define CC_INITIAL_WINDOW 10        // cwnd inicial en MSS (RFC 6928)
+#define CC_MIN_WINDOW 2             // cwnd mínima tras una pérdida (MSS)
+#define CC_DUPACK_THRESHOLD 3       // ACKs posteriores para dar un chunk por perdido
+#define CC_PACING_GAIN_SS 2.0       // Ganancia de pacing en slow start
+#define CC_PACING_GAIN_CA 1.2       // Ganancia de pacing en congestion avoidance
+#define CC_PACING_SLACK_US 1000     // Crédito máximo acumulado (granularidad del timer)
+#define CC_VEGAS_ALPHA 2            // Chunks encolados mínimos (vegas)
+#define CC_VEGAS_BETA 4             // Chunks encolados máximos (vegas)
+#define CC_VEGAS_GAMMA 1            // Umbral para salir de slow start (vegas)
+
+struct CongestionControl;
+
+typedef struct {
+    const char *name;
+    // ACK nuevo fuera de recuperación (rtt_us = 0 si no hay muestra)
+    void (*on_ack)(struct CongestionControl *cc, int acked_bytes, uint64_t rtt_us);
+    // Pérdida detectada: fija ssthresh y cwnd
+    void (*on_loss)(struct CongestionControl *cc);
+} CongestionOps;
+
+typedef struct CongestionControl {
+    const CongestionOps *ops;       // Algoritmo (NULL = sin control)
+    int mss;                        // Bytes por chunk (blksize)
+    double cwnd;                    // Ventana de congestión (bytes)
+    double ssthresh;                // Umbral de slow start (bytes)
+    double cwnd_limit;              // Tope de cwnd: la ventana negociada (bytes)
+    int in_recovery;                // 1 mientras se recupera (cwnd no crece)
+    uint32_t recover;               // Pérdidas de seq menores no reducen de nuevo
+    
+    // Estado del algoritmo por delay
+    uint64_t base_rtt_us;           // RTT mínimo visto (sin cola)
+    uint64_t round_min_rtt_us;      // RTT mínimo de la ronda actual
+    uint64_t round_start_us;        // Inicio de la ronda actual
+    
+    // Pacing
+    uint64_t srtt_us;               // SRTT usado para la tasa
+    double pacing_rate;             // Bytes por segundo (0 = sin pacing)
+    uint64_t next_send_us;          // Instante de la próxima salida permitida
+    
+    // Estadísticas de la transferencia
+    double max_cwnd;                // Mayor cwnd alcanzada
+    long losses;                    // Chunks detectados como perdidos por ACKs
+    long timeouts;                  // Rondas de timeout (RTO)
+    long recoveries;                // Reducciones de cwnd por pérdida
+} CongestionControl;
+
+// Inicializa el control con el algoritmo de nombre dado
+// window = ventana negociada en chunks (cwnd no crece más allá)
+// srtt_us = RTT ya medido en HELLO/WRQ (0 si no hay) para el pacing inicial
+// Retorna 0 si OK, -1 si el nombre no existe
+int cc_init(CongestionControl *cc, const char *name, int mss, int window,
+            uint64_t srtt_us);
+
+// Nombre del algoritmo activo
+const char* cc_name(const CongestionControl *cc);
+
+// 1 si cwnd admite len bytes más con in_flight bytes en vuelo
+int cc_can_send(const CongestionControl *cc, long in_flight, int len);
+
+// Microsegundos a esperar para la próxima salida (0 = puede salir ya)
+uint64_t cc_pacing_delay_us(CongestionControl *cc, uint64_t now);
+
+// Registra la salida de len bytes (avanza el reloj de pacing)
+void cc_on_send(CongestionControl *cc, int len, uint64_t now);
+
+// ACK de un chunk nuevo; base = primer seq sin ACK tras procesarlo
+void cc_on_ack(CongestionControl *cc, int acked_bytes, uint64_t rtt_us,
+               uint64_t srtt_us, uint32_t base);
+
+// Chunk seq dado por perdido (next = próximo seq sin enviar)
+void cc_on_loss(CongestionControl *cc, uint32_t seq, uint32_t next);
+
+// Timeout de retransmisión: ssthresh = en vuelo / 2 y slow start desde 1 MSS
+void cc_on_timeout(CongestionControl *cc, long in_flight, uint32_t next);
+
+#endif
@@ -0,0 +1,114 @@
+#ifndef DELTA_H
+#define DELTA_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Transferencia delta estilo rsync (opción "delta", protocol.h)
+// El servidor divide su copia anterior del archivo en bloques de
+// block_size bytes y manda la firma de cada uno: un hash débil rodante
+// (sumas estilo Adler-32, se actualiza en O(1) al correr la ventana un
+// byte) y uno fuerte de 64 bits. El cliente recorre el archivo nuevo con
+// la ventana rodante y, donde el débil y después el fuerte coinciden con un
+// bloque, manda una referencia en vez de los datos. Lo que viaja en los
+// DATA es un stream de instrucciones:
+//   Literal: Op(1) = DELTA_OP_LITERAL + Len(4) + Len bytes del archivo
+//   Copia:   Op(1) = DELTA_OP_COPY + Block(4) + Count(4)
+//            (Count bloques consecutivos de la copia anterior desde Block)
+// con los enteros en network order. Solo se firman bloques completos: la
+// cola de la copia anterior nunca se referencia. Un falso positivo del
+// hash fuerte lo detecta el digest CRC32C del FIN (delta requiere checksum).
+
+#define DELTA_MIN_BLOCK 1024
+#define DELTA_MAX_BLOCK 65536
+#define DELTA_MAX_BLOCKS (1 << 20)  // Firmas por archivo (más allá no se reusa)
+#define DELTA_MAX_LITERAL 65536     // Bytes por instrucción literal
+#define DELTA_OP_LITERAL 0x01
+#define DELTA_OP_COPY 0x02
+#define DELTA_LITERAL_HDR 5         // Op + Len
+#define DELTA_COPY_SIZE 9           // Op + Block + Count
+#define DELTA_SIG_SIZE 12           // Weak(4) + Strong(8) por bloque en los SIG
+
+typedef struct {
+    uint32_t weak;
+    uint64_t strong;
+} DeltaSig;
+
+// Tamaño de bloque para una copia anterior de size bytes: potencia de 2
+// cercana a la raíz (como rsync), entre DELTA_MIN_BLOCK y DELTA_MAX_BLOCK
+int delta_block_size(uint64_t size);
+
+// Hash débil (rodante) y fuerte de un bloque
+uint32_t delta_weak(const uint8_t *data, size_t len);
+uint64_t delta_strong(const uint8_t *data, size_t len);
+
+// Generador del stream de instrucciones (cliente)
+// Lee el archivo nuevo del mapeo (map != NULL) o con pread(2) sobre fd
+typedef struct {
+    const DeltaSig *sigs;
+    uint32_t blocks;
+    int block_size;
+    uint32_t *heads;                // Hash del débil -> primer bloque + 1 (0 = vacío)
+    uint32_t *chain;                // Siguiente bloque + 1 con el mismo hash
+    uint32_t mask;
+    int fd;
+    const uint8_t *map;
+    uint64_t size;                  // Largo del archivo nuevo
+    uint8_t *buf;                   // Ventana de lectura (sin mapeo)
+    size_t buf_size;
+    uint64_t buf_off;               // Offset en el archivo de buf[0]
+    size_t buf_len;
+    uint64_t pos;                   // Inicio de la ventana rodante
+    uint64_t lit;                   // Inicio del literal pendiente (<= pos)
+    int rolling;                    // 1 = a y b valen para [pos, pos + block_size)
+    uint32_t a, b;
+    uint64_t match_pos;             // Última búsqueda con coincidencia (o UINT64_MAX)
+    uint32_t match_block;
+    uint32_t copy_block;            // Corrida de copias pendiente (termina en lit)
+    uint32_t copy_count;
+    uint8_t op[DELTA_COPY_SIZE];    // Instrucción a entregar
+    int op_len;
+    int op_pos;
+    const uint8_t *lit_data;        // Bytes de literal a entregar tras op
+    size_t lit_left;
+    int done;
+    uint32_t crc;                   // CRC32C del archivo nuevo (para el FIN)
+    uint64_t literal_bytes;
+    uint64_t copied_bytes;
+} DeltaEncoder;
+
+// Prepara el generador para las firmas de la copia anterior
+// Retorna 0 si OK, -1 si no hay memoria
+int delta_encoder_init(DeltaEncoder *enc, const DeltaSig *sigs, uint32_t blocks,
+                       int block_size, int fd, const uint8_t *map, uint64_t size);
+
+// Entrega hasta len bytes del stream de instrucciones (lector de
+// source_reader). Retorna los bytes escritos, 0 al terminar o -1 si error
+int delta_encoder_read(void *encoder, uint8_t *buf, size_t len);
+
+void delta_encoder_free(DeltaEncoder *enc);
+
+// Aplicación del stream sobre la copia anterior (servidor)
+// Los datos reconstruidos se entregan a output en orden
+typedef int (*DeltaOutput)(void *ctx, const uint8_t *data, size_t len);
+
+typedef struct {
+    int basis_fd;                   // Copia anterior (-1 = sin delta)
+    int block_size;
+    uint32_t blocks;
+    uint8_t op[DELTA_COPY_SIZE];    // Instrucción parcial (cortada entre DATA)
+    int op_len;
+    uint32_t literal_left;          // Bytes de literal que faltan
+    uint64_t output_bytes;          // Bytes reconstruidos
+    uint64_t copied_bytes;          // De esos, copiados de la copia anterior
+} DeltaDecoder;
+
+// Aplica len bytes del stream; scratch se usa para leer los bloques copiados
+// Retorna 0 si OK, -1 si el stream es inválido o falla la lectura/escritura
+int delta_decode(DeltaDecoder *dec, const uint8_t *data, size_t len,
+                 uint8_t *scratch, size_t scratch_size, DeltaOutput output, void *ctx);
+
+// 1 si el stream terminó en el límite de una instrucción
+int delta_decode_complete(const DeltaDecoder *dec);
+
+#endif
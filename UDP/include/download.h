@@ -0,0 +1,72 @@
+#ifndef DOWNLOAD_H
+#define DOWNLOAD_H
+
+#include <stdint.h>
+#include "rtt.h"
+#include "congestion.h"
+
+// Envío de un archivo al cliente (RRQ, servidor)
+// El archivo se mapea entero y solo para lectura: cada DATA sale como un
+// header propio más un iovec que apunta al mapeo (batch_queue_send_iov), así
+// que el proceso no copia el archivo y las descargas simultáneas del mismo
+// archivo comparten el page cache. El emisor es el del modo ventana del
+// cliente: hasta `window` chunks en vuelo con un timer cada uno, RTO
+// adaptativo (rtt.h), cwnd y pacing (congestion.h), y ACKs acumulativos con
+// SACK. Lo mueve el loop del servidor: download_on_ack con cada ACK y
+// download_poll en cada vuelta (timers vencidos y lo que entre en cwnd).
+// Mientras está abierto se tiene un flock compartido sobre el archivo: una
+// subida que lo truncaría lo pide exclusivo y es rechazada.
+
+#define DOWNLOAD_POLL_MS 1          // Espera del loop con descargas activas
+
+typedef struct {
+    uint64_t sent_us;               // Último envío
+    uint64_t deadline;              // Vencimiento del timer (ms)
+    uint8_t acked;
+    uint8_t lost;                   // Dado por perdido, espera retransmisión
+    uint8_t dupacks;                // Chunks posteriores reconocidos antes que éste
+    uint8_t retries;
+} DownloadSlot;
+
+typedef struct Download {
+    int fd;                         // Descriptor (con el flock compartido)
+    const uint8_t *map;             // Archivo mapeado (NULL si está vacío)
+    uint64_t size;
+    int blksize;
+    int window;
+    int checksum;                   // 1 = DATA con CRC32C
+    uint32_t chunks;                // Total de DATA del archivo
+    uint32_t base;                  // Primer seq sin ACK
+    uint32_t next;                  // Próximo seq a enviar por primera vez
+    long in_flight;                 // Bytes enviados sin ACK ni dados por perdidos
+    DownloadSlot *slots;            // Un slot por seq de la ventana (seq % window)
+    RttEstimator rtt;
+    CongestionControl cc;
+    uint64_t retransmits;
+} Download;
+
+// Envía un DATA: header (Type + Flags + Seq (+ CRC)) y payload en el mapeo
+// Retorna el tamaño enviado/encolado o -1 si error
+typedef int (*DownloadSendFn)(void *ctx, uint8_t *hdr, int hdr_len,
+                              const uint8_t *data, int len);
+
+// Abre y mapea path para enviarlo en chunks de blksize con la ventana dada
+// Retorna 0 si OK, -1 si error (errno: ENOENT, EBUSY si se está subiendo,
+// EFBIG si no entra en seq de 32 bits, ...)
+int download_open(Download *dl, const char *path, int blksize, int window, int checksum);
+
+// Libera el mapeo (los DATA encolados que apuntan a él tienen que haber salido)
+void download_close(Download *dl);
+
+// Procesa un ACK (data = Seq (+ bitmap con ACK_FLAG_SACK))
+// Retorna los bytes de archivo reconocidos por primera vez
+uint64_t download_on_ack(Download *dl, const uint8_t *data, int len, uint8_t flags);
+
+// Vence los timers y envía retransmisiones y chunks nuevos que admita cwnd
+// Retorna los DATA enviados o -1 si un chunk agotó los reintentos
+int download_poll(Download *dl, DownloadSendFn send, void *ctx);
+
+// 1 si el cliente reconoció todo el archivo
+int download_complete(const Download *dl);
+
+#endif
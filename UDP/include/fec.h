@@ -0,0 +1,51 @@
+#ifndef FEC_H
+#define FEC_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Corrección de errores hacia adelante (opción "fec", protocol.h)
+// Paridad XOR por grupo de k DATA consecutivos: el FEC de un grupo lleva el
+// XOR de sus payloads (rellenados con ceros hasta el más largo), de sus
+// largos y de sus flags de compresión. Con el FEC y todos los DATA del
+// grupo menos uno, el XOR de todo es exactamente el que falta: el servidor
+// lo reconstruye sin esperar a que venza su timer en el cliente. Un XOR
+// solo repara una pérdida por grupo (Reed-Solomon repararía varias, a costa
+// de aritmética en GF(2^8) por byte); con pérdidas aisladas, que son las
+// que más cuestan en un camino largo, alcanza.
+
+#define FEC_MIN_K 2
+#define FEC_MAX_K 32                // DATA por grupo (entra en el bitmap)
+#define FEC_EXT_SIZE 3              // Count(1) + LenXor(2) del FEC
+
+// Acumulador de un grupo (cliente: arma el FEC; servidor: junta los DATA
+// recibidos y el FEC para reconstruir el que falta)
+typedef struct {
+    uint32_t first;                 // Primer seq del grupo (múltiplo de k)
+    uint32_t members;               // Bitmap de DATA acumulados (bit i = first + i)
+    int count;                      // DATA del grupo según su FEC (0 = sin FEC)
+    uint16_t len_xor;               // XOR de los largos
+    uint8_t flags_xor;              // XOR de los flags de compresión
+    int max_len;                    // Bytes de xor en uso (el resto en cero)
+    uint8_t *xor;                   // XOR de los payloads (blksize bytes)
+} FecGroup;
+
+// XOR de src sobre dst
+void fec_xor(uint8_t *dst, const uint8_t *src, size_t len);
+
+// Vacía el acumulador para el grupo que empieza en first
+void fec_group_reset(FecGroup *group, uint32_t first);
+
+// Suma el DATA index del grupo (seq first + index) con sus flags
+void fec_group_add(FecGroup *group, int index, const uint8_t *data, int len, uint8_t flags);
+
+// Suma el FEC de un grupo de count DATA
+void fec_group_add_parity(FecGroup *group, int count, uint16_t len_xor, uint8_t flags,
+                          const uint8_t *data, int len);
+
+// Índice del único DATA que falta si ya se puede reconstruir (está el FEC
+// y todos los demás), -1 si no. Reconstruido, sus bytes son
+// xor[0, len_xor) y sus flags flags_xor
+int fec_group_missing(const FecGroup *group);
+
+#endif
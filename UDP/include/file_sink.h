@@ -0,0 +1,107 @@
+#ifndef FILE_SINK_H
+#define FILE_SINK_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Escritura diferida (write-behind) de los archivos recibidos
+// Los DATA se acumulan en un buffer por sesión y se escriben con un solo
+// write(2) cuando el buffer se llena, cuando la sesión queda inactiva
+// SINK_IDLE_FLUSH_MS o al recibir el FIN.
+// En modo durable se escribe en "<path>.tmp" y al cerrar se hace un fsync
+// y un rename atómico al nombre final: nunca queda un .received a medias.
+// Checkpoints: un sink propio registra en "<path>.ckpt" cuántos bytes del
+// archivo están escritos en orden y el CRC32C de ese prefijo, cada
+// SINK_CHECKPOINT_BYTES, al vaciar por inactividad y al abortar. Una
+// transferencia abortada conserva el archivo parcial (o el .tmp) y su
+// checkpoint, y sink_open con resume = 1 la retoma desde ahí. En modo
+// durable los datos se sincronizan (fdatasync) antes de cada checkpoint.
+// El sink tiene un flock exclusivo sobre el checkpoint mientras está
+// abierto: otro sink_open del mismo archivo (otra sesión, en cualquier
+// worker) falla con EBUSY sin tocar el parcial. Un archivo multi-stream
+// toma el mismo lock (shared_file.h).
+// Un sink también puede escribir por offset (sink_attach + sink_write_at)
+// sobre un descriptor ajeno, el de un archivo multi-stream (shared_file.h):
+// el buffer acumula corridas contiguas y se vacía con pwrite(2).
+
+#define SINK_BUFFER_DEFAULT (256 * 1024) // Tamaño de buffer por defecto
+#define SINK_BUFFER_MIN 4096
+#define SINK_IDLE_FLUSH_MS 200      // Inactividad tras la cual se vacía el buffer
+#define SINK_CHECKPOINT_BYTES (4 * 1024 * 1024) // Bytes escritos entre checkpoints
+
+typedef struct {
+    int open;                       // 1 si hay un archivo abierto
+    int fd;                         // Descriptor del archivo (o del .tmp)
+    int durable;                    // 1 = fsync + rename atómico al cerrar
+    int attached;                   // 1 = fd ajeno (no se cierra), escritura por offset
+    uint64_t buf_offset;            // Offset en el archivo del inicio del buffer
+    uint8_t *buf;                   // Buffer de escritura diferida
+    size_t buf_size;                // Capacidad del buffer
+    size_t buf_len;                 // Bytes pendientes de escribir
+    char path[256];                 // Nombre final del archivo
+    char tmp_path[260];             // Nombre temporal (modo durable)
+    char ckpt_path[264];            // Checkpoint del prefijo escrito
+    int ckpt_fd;                    // Descriptor del checkpoint (-1 = sin checkpoints)
+    uint64_t committed;             // Bytes del archivo ya escritos (prefijo)
+    uint32_t crc;                   // CRC32C del prefijo escrito
+    uint64_t last_ckpt;             // committed del último checkpoint
+    uint32_t buf_crc;               // CRC32C del buffer, si se conoce
+    int buf_crc_known;              // 1 = todo el buffer llegó con su CRC32C
+    uint64_t last_write_ms;         // Último dato agregado al buffer
+    uint64_t bytes;                 // Bytes recibidos en total
+    uint64_t writes;                // Llamadas a write(2)
+} FileSink;
+
+// Toma el flock del checkpoint de path sin abrir el sink, para decidir
+// antes de tocar el archivo (ej: desvincular la base delta)
+// Retorna el descriptor con el lock o -1 si error (EBUSY si otro sink
+// tiene el archivo abierto)
+int sink_lock(const char *path);
+
+// Abre el archivo destino (truncándolo) y reserva el buffer
+// Con resume = 1 y un checkpoint válido retoma el archivo parcial: lo
+// recorta al prefijo registrado y sigue escribiendo desde ahí
+// (sink->committed y sink->crc quedan con el prefijo)
+// Retorna 0 si OK, -1 si error (errno indica la causa; EBUSY si otro sink
+// tiene el archivo abierto)
+// lock_fd: el de sink_lock (sink_open se hace cargo de él, también si
+// falla) o -1 para tomar el lock acá
+int sink_open(FileSink *sink, const char *path, size_t buf_size, int durable, int resume,
+              int lock_fd);
+
+// Bytes que retomaría sink_open con resume = 1 (0 si no hay un parcial
+// con checkpoint válido)
+uint64_t sink_resumable(const char *path, int durable);
+
+// Usa un descriptor ya abierto (de otro dueño) para escribir por offset
+// Retorna 0 si OK, -1 si no hay memoria
+int sink_attach(FileSink *sink, int fd, const char *path, size_t buf_size);
+
+// Agrega datos al buffer; lo escribe a disco si se llena
+// Retorna 0 si OK, -1 si error de escritura
+int sink_write(FileSink *sink, const void *data, size_t len);
+
+// Como sink_write con el CRC32C de los datos ya calculado (ej: el que
+// verificó el servidor): el CRC del checkpoint se obtiene combinándolo
+// (crc32c_combine) sin volver a recorrer los datos
+int sink_write_crc(FileSink *sink, const void *data, size_t len, uint32_t crc);
+
+// Como sink_write pero en un offset del archivo (solo con sink_attach);
+// si no continúa la corrida del buffer, este se vacía antes
+int sink_write_at(FileSink *sink, const void *data, size_t len, uint64_t offset);
+
+// Escribe a disco lo que haya pendiente en el buffer
+int sink_flush(FileSink *sink);
+
+// Vacía el buffer si no recibió datos en los últimos SINK_IDLE_FLUSH_MS
+int sink_flush_if_idle(FileSink *sink, uint64_t now);
+
+// Cierra el archivo. Con commit = 1 vacía el buffer, en modo durable hace
+// fsync y rename al nombre final, y borra el checkpoint. Con commit = 0
+// (transferencia abortada) vacía el buffer y deja el archivo parcial con
+// su checkpoint para retomarlo. Un sink con fd ajeno solo vacía el
+// buffer: el cierre queda a cargo del dueño.
+// Retorna 0 si OK, -1 si error
+int sink_close(FileSink *sink, int commit);
+
+#endif
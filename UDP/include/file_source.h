@@ -0,0 +1,75 @@
+#ifndef FILE_SOURCE_H
+#define FILE_SOURCE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Lectura del archivo a enviar (cliente)
+// Si el archivo es regular y entra en memoria se mapea con mmap() y los
+// chunks se envían directo desde el mapeo (sin fread ni copias a la PDU).
+// Si no se puede mapear (archivo más grande que SOURCE_MMAP_RAM_FRACTION de
+// la RAM, vacío, o que no es un archivo regular) se lee de a bloques con
+// read(2) sobre un buffer del llamador.
+// Para multi-stream cada stream lee un rango [offset, offset + length) del
+// mismo FileSource (source_range): comparte el mapeo o usa pread(2).
+// Un FileSource también puede leer de un generador (source_reader), como el
+// stream de instrucciones de una transferencia delta (delta.h).
+
+#define SOURCE_MMAP_RAM_FRACTION 2  // Mapear solo si size <= RAM / 2
+
+typedef struct {
+    int fd;                         // Descriptor del archivo
+    int64_t size;                   // Tamaño (-1 si no se conoce)
+    uint64_t pos;                   // Offset del próximo chunk
+    const uint8_t *map;             // Mapeo del archivo (NULL = modo streaming)
+    size_t map_len;                 // Largo del mapeo
+    uint64_t end;                   // Fin del rango a leer (UINT64_MAX = hasta EOF)
+    int is_range;                   // 1 = vista de otro FileSource (no cierra nada)
+    size_t peek_start;              // Streaming: bytes leídos por source_peek y
+    size_t peek_len;                // todavía no consumidos (en el scratch)
+    int (*reader)(void *ctx, uint8_t *buf, size_t len); // Generador (NULL = archivo)
+    void *reader_ctx;
+} FileSource;
+
+// Abre el archivo ("-" = entrada estándar) y decide entre mmap y streaming
+// Retorna 0 si OK, -1 si error (errno indica la causa)
+int source_open(FileSource *source, const char *path);
+
+// Devuelve el próximo chunk de hasta max_len bytes en *data
+// En modo mmap *data apunta al mapeo (válido hasta source_close);
+// en modo streaming se lee en scratch y *data = scratch.
+// Retorna el largo del chunk, 0 en EOF o -1 si error
+int source_next(FileSource *source, size_t max_len, const uint8_t **data, uint8_t *scratch);
+
+// Como source_next pero sin consumir: los mismos bytes vuelven a aparecer
+// hasta que source_skip los consuma (el compresor toma lo que le entra en
+// un DATA). En streaming quedan en scratch, de scratch_size >= 2 * max_len
+// bytes, que no se puede cambiar entre llamadas; no mezclar con source_next.
+// Retorna cuántos bytes hay desde *data, 0 en EOF o -1 si error
+int source_peek(FileSource *source, size_t max_len, const uint8_t **data,
+                uint8_t *scratch, size_t scratch_size);
+
+// Consume len bytes (a lo sumo los devueltos por el último source_peek)
+void source_skip(FileSource *source, size_t len);
+
+// Arma en range una vista de [offset, offset + length) de source, que debe
+// ser un archivo regular y seguir abierto mientras se use el rango
+void source_range(const FileSource *source, FileSource *range,
+                  uint64_t offset, uint64_t length);
+
+// Arma un FileSource en modo streaming que lee de read(ctx, buf, len), que
+// retorna los bytes generados, 0 al terminar o -1 si error
+void source_reader(FileSource *source, int (*read)(void *ctx, uint8_t *buf, size_t len),
+                   void *ctx);
+
+// Salta a offset (solo archivos regulares): el próximo chunk empieza ahí
+// Retorna 0 si OK, -1 si error
+int source_seek(FileSource *source, uint64_t offset);
+
+// 1 si los chunks se leen del mapeo (los punteros siguen siendo válidos)
+int source_is_mapped(const FileSource *source);
+
+// Libera el mapeo y cierra el archivo
+void source_close(FileSource *source);
+
+#endif
@@ -0,0 +1,78 @@
+#ifndef IMPAIR_H
+#define IMPAIR_H
+
+#include <stdint.h>
+
+// Modelo de red degradada del proxy (bin/proxy)
+// Cada sentido (cliente->servidor y servidor->cliente) es un enlace
+// independiente con la misma configuración: descarte por tamaño (MTU del
+// camino), pérdida Bernoulli y/o Gilbert-Elliott, duplicación, cola de
+// salida con ancho de banda limitado, demora con jitter y reordenamiento.
+// Es determinístico: cada enlace tiene su propio generador con semilla y
+// consume siempre la misma cantidad de números por datagrama, así que con la
+// misma semilla y la misma secuencia de datagramas los descartes, duplicados
+// y demoras son los mismos, y cambiar un parámetro no altera la realización
+// de los demás (ej: las mismas pérdidas con otra demora).
+// Jitter sin reordenar: un datagrama nunca sale antes que el anterior del
+// mismo sentido, salvo los elegidos para reordenar, que se demoran
+// reorder_gap_us extra y los pasan los siguientes.
+
+#define IMPAIR_QUEUE_DEFAULT 262144     // Cola de salida con ancho de banda limitado (bytes)
+#define IMPAIR_REORDER_GAP_MS 10        // Demora extra de un datagrama reordenado
+
+typedef struct {
+    const char *name;               // Preset de origen ("custom" si no hay)
+    uint64_t delay_us;              // Demora de un sentido
+    uint64_t jitter_us;             // Variación uniforme en [-jitter, +jitter]
+    double loss;                    // Pérdida Bernoulli (0-1)
+    double ge_p;                    // Gilbert-Elliott: P(bueno -> malo); 0 = desactivado
+    double ge_r;                    // P(malo -> bueno)
+    double ge_loss_bad;             // Pérdida en el estado malo (default 1)
+    double ge_loss_good;            // Pérdida en el estado bueno (default 0)
+    double duplicate;               // Probabilidad de duplicar un datagrama
+    double reorder;                 // Probabilidad de reordenar un datagrama
+    uint64_t reorder_gap_us;
+    double rate_mbps;               // Ancho de banda del enlace; 0 = sin límite
+    uint64_t queue_bytes;           // Cola antes del enlace (descarte al final)
+    int mtu;                        // Datagrama UDP máximo (payload); 0 = sin límite
+} ImpairConfig;
+
+typedef struct {
+    uint64_t received;
+    uint64_t forwarded;             // Copias programadas (incluye duplicados)
+    uint64_t dropped_mtu;
+    uint64_t dropped_loss;          // Bernoulli + Gilbert-Elliott
+    uint64_t dropped_queue;
+    uint64_t duplicated;
+    uint64_t reordered;
+} ImpairStats;
+
+typedef struct {
+    const ImpairConfig *config;
+    uint64_t rng;                   // Estado del generador (xorshift64*)
+    int ge_bad;                     // 1 si Gilbert-Elliott está en el estado malo
+    uint64_t link_free_us;          // Fin de la transmisión en curso (con rate_mbps)
+    uint64_t last_deliver_us;       // Entrega del último datagrama en orden
+    ImpairStats stats;
+} ImpairLink;
+
+// Configuración sin degradación (reenvío directo)
+void impair_defaults(ImpairConfig *config);
+
+// Aplica un preset: lan, internacional o lunar (escenarios de las capturas)
+// Retorna 0 si OK, -1 si no existe
+int impair_preset(ImpairConfig *config, const char *name);
+
+// Lista de presets para el uso del programa
+const char* impair_preset_names(void);
+
+// Inicializa un sentido; link_id distingue los generadores de cada sentido
+void impair_link_init(ImpairLink *link, const ImpairConfig *config,
+                      uint64_t seed, int link_id);
+
+// Decide qué pasa con un datagrama de len bytes que llega en now_us
+// Retorna cuántas copias salen (0 = descartado, 1 o 2 si se duplicó) y en
+// deliver_us el instante de entrega de cada una
+int impair_process(ImpairLink *link, int len, uint64_t now_us, uint64_t deliver_us[2]);
+
+#endif
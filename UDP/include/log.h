@@ -0,0 +1,80 @@
+#ifndef LOG_H
+#define LOG_H
+
+#include <stdint.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+// Logging asíncrono con niveles (cliente y servidor)
+// Un mensaje no se formatea ni se escribe en el hilo que lo genera: se
+// copian el formato (un literal, se guarda el puntero) y los argumentos a
+// un registro de tamaño fijo de un ring lock-free con varios productores
+// (workers o streams) y un solo consumidor, y un thread de fondo lo
+// formatea y lo escribe en stdout en el orden en que se reservó.
+// Los mensajes por encima de LOG_COMPILE_LEVEL no se compilan y los que
+// están por encima del nivel de ejecución (-v / -q) cuestan una comparación.
+// Antes de log_start y después de log_stop se escriben en el momento.
+// Con el ring lleno los mensajes de debug/trace se descartan (se informa
+// cuántos) y los de error/warning esperan lugar.
+// Los %s se copian al registro hasta LOG_STRING_SPACE bytes en total (el
+// resto se trunca); no se admiten %n ni long double.
+
+#define LOG_LEVEL_ERROR 0
+#define LOG_LEVEL_WARN 1
+#define LOG_LEVEL_INFO 2            // Eventos de sesión y resúmenes (default)
+#define LOG_LEVEL_DEBUG 3           // Progreso y descartes de PDUs
+#define LOG_LEVEL_TRACE 4           // Cada PDU recibida y enviada
+
+#ifndef LOG_COMPILE_LEVEL
+#define LOG_COMPILE_LEVEL LOG_LEVEL_TRACE
+#endif
+
+#define LOG_RING_SIZE 8192          // Registros en el ring (potencia de 2)
+#define LOG_MAX_ARGS 16             // Argumentos por mensaje
+#define LOG_STRING_SPACE 192        // Bytes para copiar los %s de un mensaje
+#define LOG_LINE_SIZE 1024          // Largo máximo de un mensaje formateado
+#define LOG_IDLE_SLEEP_US 1000      // Espera del thread de fondo con el ring vacío
+
+// Nivel de ejecución (se fija antes de log_start)
+extern int log_level;
+
+#define LOG_AT(level, ...) \
+    do { \
+        if ((level) <= LOG_COMPILE_LEVEL && (level) <= log_level) { \
+            log_write((level), __VA_ARGS__); \
+        } \
+    } while (0)
+
+#define LOG_ERROR(...) LOG_AT(LOG_LEVEL_ERROR, __VA_ARGS__)
+#define LOG_WARN(...)  LOG_AT(LOG_LEVEL_WARN, __VA_ARGS__)
+#define LOG_INFO(...)  LOG_AT(LOG_LEVEL_INFO, __VA_ARGS__)
+#define LOG_DEBUG(...) LOG_AT(LOG_LEVEL_DEBUG, __VA_ARGS__)
+#define LOG_TRACE(...) LOG_AT(LOG_LEVEL_TRACE, __VA_ARGS__)
+
+// Dirección IPv4:puerto como argumentos numéricos (sin inet_ntop en el
+// hot path): LOG_INFO("Cliente " LOG_ADDR_FMT "\n", LOG_ADDR_ARGS(&addr))
+#define LOG_ADDR_FMT "%u.%u.%u.%u:%u"
+#define LOG_ADDR_ARGS(addr) \
+    (unsigned)((const uint8_t*)&(addr)->sin_addr.s_addr)[0], \
+    (unsigned)((const uint8_t*)&(addr)->sin_addr.s_addr)[1], \
+    (unsigned)((const uint8_t*)&(addr)->sin_addr.s_addr)[2], \
+    (unsigned)((const uint8_t*)&(addr)->sin_addr.s_addr)[3], \
+    (unsigned)ntohs((addr)->sin_port)
+
+// Fija el nivel de ejecución (acotado a ERROR..TRACE)
+void log_set_level(int level);
+
+// Nombre de un nivel ("info", "debug", ...)
+const char* log_level_name(int level);
+
+// Encola un mensaje (usar las macros LOG_*, que filtran por nivel)
+void log_write(int level, const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+
+// Arranca el thread de fondo (log_stop se registra con atexit)
+// Retorna 0 si OK, -1 si no se pudo crear (se sigue escribiendo en el momento)
+int log_start(void);
+
+// Escribe lo pendiente y detiene el thread de fondo
+void log_stop(void);
+
+#endif
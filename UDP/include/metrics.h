@@ -0,0 +1,95 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <stdint.h>
+#include <stdatomic.h>
+
+// Métricas en proceso (cliente y servidor)
+// Cada thread que procesa PDUs (worker del servidor, stream del cliente)
+// actualiza su propio bloque Metrics: contadores e histogramas de tamaño
+// fijo, sin locks ni memoria dinámica. Como cada bloque tiene un solo
+// escritor, un update es un load y un store relajados (sin instrucciones
+// atómicas con lock); otro thread puede leerlos en cualquier momento.
+// Los bloques se registran al arrancar y el thread de métricas los suma
+// para exportarlos:
+//   - en un snapshot de texto que se reescribe cada METRICS_INTERVAL_MS
+//     (archivo temporal + rename: nunca se lee a medias) y al terminar
+//   - en un socket UNIX local: cada conexión recibe el snapshot del momento
+//     y se cierra (ej: socat - UNIX-CONNECT:/tmp/server.sock)
+// El formato es el de texto de Prometheus: "nombre valor" por contador y,
+// por histograma, buckets acumulados nombre_bucket{le="N"}, nombre_sum y
+// nombre_count, más una línea de comentario con percentiles estimados.
+
+#define METRICS_INTERVAL_MS 1000    // Período del snapshot
+#define METRICS_MAX_BLOCKS 128      // Bloques registrados (workers o streams)
+#define METRICS_BUCKETS 40          // Buckets log2: [2^(i-1), 2^i), el 0 es el valor 0
+#define METRICS_SNAPSHOT_SIZE 32768 // Texto máximo de un snapshot
+
+// Contadores
+enum {
+    METRIC_RX_PACKETS,              // Datagramas recibidos
+    METRIC_RX_BYTES,
+    METRIC_TX_PACKETS,              // Datagramas enviados
+    METRIC_TX_BYTES,
+    METRIC_DATA_BYTES,              // Bytes de archivo aceptados (servidor) o reconocidos (cliente)
+    METRIC_DATA_DUPLICATE,          // DATA repetidos (ya escritos o en buffer)
+    METRIC_DATA_OUT_OF_ORDER,       // DATA descartados por seq fuera de ventana / secuencia
+    METRIC_CHECKSUM_ERRORS,         // DATA y FIN con CRC32C que no coincide (servidor)
+    METRIC_RETRANSMITS,             // DATA retransmitidos
+    METRIC_TIMEOUTS,                // Rondas de timeout de retransmisión
+    METRIC_FEC_RECOVERED,           // DATA reconstruidos con FEC
+    METRIC_ACKS_COALESCED,          // DATA reconocidos sin un ACK propio (SACK)
+    METRIC_SESSIONS_OPENED,
+    METRIC_SESSIONS_CLOSED,
+    METRIC_SESSIONS_REAPED,         // Cerradas por inactividad
+    METRIC_SESSIONS_ACTIVE,         // Gauge
+    METRIC_FILES_COMPLETED,
+    METRIC_COUNTERS
+};
+
+// Histogramas
+enum {
+    METRIC_ACK_RTT_US,              // RTT de cada ACK con muestra válida (cliente)
+    METRIC_HANDLER_NS,              // Tiempo de procesamiento de cada PDU (servidor)
+    METRIC_GOODPUT_KBPS,            // Goodput de cada sesión terminada (kB/s)
+    METRIC_HISTOGRAMS
+};
+
+typedef struct {
+    _Atomic uint64_t buckets[METRICS_BUCKETS];
+    _Atomic uint64_t count;
+    _Atomic uint64_t sum;
+    _Atomic uint64_t max;
+} MetricHistogram;
+
+typedef struct {
+    _Atomic uint64_t counters[METRIC_COUNTERS];
+    MetricHistogram histograms[METRIC_HISTOGRAMS];
+} Metrics;
+
+// Deja el bloque en cero (antes de registrarlo)
+void metrics_init(Metrics *metrics);
+
+// Suma value a un contador (solo el thread dueño del bloque)
+void metric_add(Metrics *metrics, int counter, uint64_t value);
+
+// Fija el valor de un gauge
+void metric_set(Metrics *metrics, int counter, uint64_t value);
+
+// Registra una muestra en un histograma
+void metric_observe(Metrics *metrics, int histogram, uint64_t value);
+
+// Agrega un bloque al snapshot (antes de metrics_start o desde un solo thread)
+// Retorna 0 si OK, -1 si no hay lugar
+int metrics_register(Metrics *metrics);
+
+// Arranca el thread que exporta los bloques registrados
+// snapshot_file / socket_file pueden ser NULL (no se exporta por esa vía;
+// sin ninguno no se arranca nada); role encabeza el snapshot ("servidor")
+// Retorna 0 si OK, -1 si no se pudo crear el socket o el thread
+int metrics_start(const char *role, const char *snapshot_file, const char *socket_file);
+
+// Escribe el snapshot final, cierra el socket y detiene el thread
+void metrics_stop(void);
+
+#endif
@@ -0,0 +1,52 @@
+#ifndef MUX_H
+#define MUX_H
+
+#include <pthread.h>
+#include <netinet/in.h>
+#include "protocol.h"
+
+// Demultiplexor de respuestas por lane (cliente con varios archivos)
+// Los lanes de una sesión comparten el socket (protocol.h): un hilo recibe
+// todo lo que manda el servidor y lo reparte en una cola por lane según el
+// nibble alto del Type, que se quita antes de encolar. Cada hilo de lane
+// lee solo de su cola, con la misma semántica que recv_pdu_with_timeout.
+// Lo que no entra en una cola llena se descarta como si se hubiera perdido
+// en la red (el lane lo recupera con su timer).
+
+#define MUX_QUEUE 64                // Respuestas encoladas por lane
+#define MUX_POLL_MS 100             // Cada cuánto el receptor mira si terminar
+
+typedef struct {
+    PDU pdu;
+    int len;
+    struct sockaddr_in from;
+} MuxEntry;
+
+typedef struct {
+    MuxEntry entries[MUX_QUEUE];
+    int head;                       // Próxima a entregar
+    int count;
+    pthread_cond_t ready;           // Señalada al encolar
+} MuxQueue;
+
+typedef struct Mux {
+    int sockfd;
+    _Atomic int running;            // 0 = el receptor debe terminar
+    int error;                      // 1 si falló la recepción (se entrega -1)
+    pthread_t thread;
+    pthread_mutex_t lock;           // Protege las colas y error
+    MuxQueue queues[MAX_LANES + 1];
+} Mux;
+
+// Crea el demultiplexor y arranca el hilo receptor sobre sockfd
+// Retorna el demultiplexor o NULL si error
+Mux* mux_create(int sockfd);
+
+// Detiene el receptor y libera el demultiplexor (no cierra el socket)
+void mux_destroy(Mux *mux);
+
+// Próxima respuesta del lane, esperando a lo sumo timeout_ms
+// Retorna: número de bytes recibidos, 0 si timeout, -1 si error
+int mux_recv(Mux *mux, int lane, PDU *pdu, struct sockaddr_in *from_addr, int timeout_ms);
+
+#endif
@@ -13,6 +13,18 @@
 #include <netinet/in.h>
 #include <time.h>
 #include <errno.h>
+#include <sys/uio.h>
+
+#include "rtt.h"
+#include "congestion.h"
+#include "file_sink.h"
+#include "timer_wheel.h"
+#include "log.h"
+#include "metrics.h"
+#include "delta.h"
+#include "fec.h"
+#include "ticket.h"
+#include "download.h"
 
 // Constantes del protocolo 
 
@@ -22,13 +34,17 @@
 // Tamaños
 #define MAX_DATA_SIZE 1470          // Tamaño máximo de datos 
 #define MAX_PDU_SIZE 1472           // Type(1) + SeqNum(1) + Data(1470)
+#define MAX_DATAGRAM_SIZE 65507     // Payload UDP máximo sobre IPv4
+#define IP_UDP_HEADER_SIZE 28       // IPv4 (20) + UDP (8)
 #define MAX_CREDENTIALS_SIZE 256
 #define MAX_CREDENTIALS_LEN 10      
 #define MIN_FILENAME_LEN 4
 #define MAX_FILENAME_LEN 10
 
 // Timeouts y reintentos
-#define TIMEOUT_MS 3000             // 3 segundos
+#define TIMEOUT_MS 3000             // RTO inicial, antes de medir el RTT
+#define RTO_MIN_MS 100              // Cota inferior del RTO adaptativo
+#define RTO_MAX_MS 16000            // Cota superior del backoff exponencial
 #define MAX_RETRIES 5
 
 // Tipos de PDU
@@ -37,6 +53,27 @@
 #define TYPE_DATA 3
 #define TYPE_ACK 4
 #define TYPE_FIN 5
+#define TYPE_OACK 6                 // ACK de WRQ con opciones aceptadas
+#define TYPE_PROBE 7                // Sondeo de MTU del camino (tras el OACK)
+#define TYPE_SIG 8                  // Firmas de bloques para delta (tras el OACK)
+#define TYPE_FEC 9                  // Paridad de un grupo de DATA (modo ventana)
+#define TYPE_RRQ 10                 // Pedido de descarga de un archivo
+
+// Varios archivos en una sesión (lanes)
+// Tras un solo HELLO el cliente sube varios archivos en paralelo, cada uno
+// en su lane: el nibble alto del Type de cada PDU (y de sus respuestas)
+// lleva el lane y el bajo el tipo. El lane 0 es la sesión autenticada, y en
+// él va la subida de un solo archivo de siempre. El primer WRQ de un lane
+// lo abre (si la sesión está autenticada) y el lane encadena archivos
+// (WRQ, DATA, FIN, WRQ...); entre uno y otro sigue reconociendo el FIN del
+// anterior. Un FIN en el lane 0 sin subida en curso cierra la sesión con
+// todos sus lanes. Dos lanes no pueden subir el mismo archivo a la vez.
+#define LANE_SHIFT 4
+#define MAX_LANES 15
+#define PDU_LANE(type) ((type) >> LANE_SHIFT)
+#define PDU_TYPE(type) ((type) & ((1 << LANE_SHIFT) - 1))
+#define LANE_TYPE(type, lane) ((uint8_t)((type) | (lane) << LANE_SHIFT))
+#define PIPELINE_DEFAULT 4          // Lanes que usa el cliente con varios archivos
 
 // Fases del protocolo
 #define PHASE_NONE 0
@@ -45,45 +82,350 @@
 #define PHASE_TRANSFERRING 3
 #define PHASE_COMPLETED 4
 
-// Número máximo de clientes concurrentes (servidor)
-#define MAX_CLIENTS 10
+// Número máximo de sesiones concurrentes (servidor, por worker)
+#define MAX_SESSIONS 131072
+
+// Sesiones sin actividad durante este tiempo se cierran (el archivo queda
+// parcial con su checkpoint); ver timer_wheel.h
+#define SESSION_IDLE_TIMEOUT_S 30
+
+// Máximo de workers del servidor (un thread y un socket SO_REUSEPORT cada uno)
+#define MAX_WORKERS 64
+
+// Modo ventana (Selective Repeat)
+// Se negocia en el WRQ con la opción "window" (estilo TFTP, RFC 2347):
+//   WRQ:  filename\0 window\0 <n>\0
+//   OACK: window\0 <n>\0
+// Si el servidor responde con un ACK común se usa Stop & Wait (1 bit).
+// El cliente solo agrega opciones al WRQ cuando pide algo distinto del
+// default del protocolo original (ventana, blksize, retomar, ...): en Stop &
+// Wait sin -B el WRQ es filename\0 solo, que entienden también los
+// servidores sin soporte de opciones.
+// En modo ventana DATA, ACK y FIN llevan un seq de 32 bits al inicio de data:
+//   Type(1) + Flags(1) + Seq(4) + Data(1466)
+#define OPT_WINDOW "window"
+#define WINDOW_DEFAULT 32           // Ventana pedida por defecto por el cliente
+#define WINDOW_MAX 256              // Ventana máxima aceptada por el servidor
+#define EXT_SEQ_SIZE 4              // Seq extendido (uint32, network order)
+#define MAX_EXT_DATA_SIZE (MAX_DATA_SIZE - EXT_SEQ_SIZE)
+#define MAX_OPTIONS_SIZE 192        // Espacio para opciones en WRQ/OACK
+
+// Tamaño de bloque negociable (opción "blksize", estilo RFC 2348)
+// Es el máximo de bytes de archivo por DATA. Sin la opción se usan
+// MAX_DATA_SIZE (Stop & Wait) o MAX_EXT_DATA_SIZE (modo ventana).
+// Tras el OACK el cliente puede mandar PROBE de distintos tamaños (con DF)
+// y el servidor responde un PROBE con el largo recibido como seq extendido;
+// el cliente usa el mayor bloque que llegó, sin pasar del negociado.
+#define OPT_BLKSIZE "blksize"
+#define MIN_BLKSIZE 512
+#define MAX_BLKSIZE (MAX_DATAGRAM_SIZE - 2 - EXT_SEQ_SIZE)
+#define RX_WINDOW_MAX_BYTES (8 * 1024 * 1024) // Tope de window * blksize por sesión
+#define RX_SOCKET_BUFFER (4 * 1024 * 1024)    // SO_RCVBUF pedido (acotado por rmem_max)
+#define PROBE_RETRIES 2             // Intentos por tamaño antes de bajar al siguiente
+
+// Multi-stream: un archivo subido en rangos por varias sesiones en paralelo
+// (shared_file.h). Se pide en el WRQ (solo modo ventana) con
+//   streams\0 <n>\0 tsize\0 <bytes totales>\0
+// y el OACK devuelve "streams". Los DATA de esas sesiones llevan el flag
+// DATA_FLAG_OFFSET y el offset en el archivo (uint64, network order):
+//   Type(1) + Flags(1) + Seq(4) + Offset(8) + Data
+#define OPT_STREAMS "streams"
+#define OPT_TSIZE "tsize"
+#define DATA_FLAG_OFFSET 0x01
+#define EXT_OFFSET_SIZE 8
+#define MAX_OFFSET_BLKSIZE (MAX_BLKSIZE - EXT_OFFSET_SIZE)
+#define MAX_STREAMS 16              // Streams por archivo
+
+// Subidas retomables: el servidor guarda cuántos bytes del archivo tiene
+// escritos en orden y su CRC32C (file_sink.h). Un cliente que puede saltar
+// a un offset pide en el WRQ
+//   resume\0 1\0
+// y el OACK devuelve dónde seguir y el CRC32C de ese prefijo:
+//   resume\0 <offset>\0 prefixcrc\0 <crc en hex>\0
+// El cliente verifica el prefijo contra su archivo y envía solo el resto
+// (los seq empiezan de 0 igual). Si no coincide empieza de nuevo sin pedirlo.
+#define OPT_RESUME "resume"
+#define OPT_PREFIX_CRC "prefixcrc"
+
+// Integridad de punta a punta (solo modo ventana): con
+//   checksum\0 crc32c\0
+// en el WRQ y el OACK cada DATA lleva el flag DATA_FLAG_CRC y el CRC32C
+// (uint32, network order) de los campos que siguen a Type/Flags y del
+// payload, antes de los datos:
+//   Type(1) + Flags(1) + Seq(4) [+ Offset(8)] + Crc(4) + Data
+// y el FIN lleva además el CRC32C de todos los bytes enviados en la sesión
+// (del archivo completo, o del rango del stream en multi-stream):
+//   Type(1) + Seq(1) + Chunks(4) + Digest(4)
+// El servidor descarta sin ACK los DATA que no coinciden (el cliente los
+// retransmite) y responde al FIN con un ACK con mensaje de error si el
+// digest no coincide.
+#define OPT_CHECKSUM "checksum"
+#define CHECKSUM_CRC32C "crc32c"
+#define DATA_FLAG_CRC 0x02
+#define EXT_CRC_SIZE 4
+
+// Largo final: el FIN de una subida termina con los bytes del archivo que
+// quedan escritos al completarla (uint64, network order), después de
+// Chunks y Digest en modo ventana y como único payload en Stop & Wait:
+//   Type(1) + Seq(1) [+ Chunks(4) [+ Digest(4)]] + Length(8)
+// Es el archivo entero (con el prefijo de una subida retomada, o
+// reconstruido en delta), o el rango del stream en multi-stream. El
+// servidor lo compara con lo que escribió y, si no coincide, responde con
+// un error y deja el parcial. Sin el campo (clientes anteriores) no se
+// verifica. Un archivo vacío (o ya completo al retomar) pasa del WRQ al
+// FIN sin DATA.
+#define EXT_LENGTH_SIZE 8
+
+// Compresión (solo modo ventana): con
+//   compress\0 lz\0
+// en el WRQ y el OACK el cliente puede mandar DATA con el flag DATA_FLAG_LZ,
+// cuyo payload es RawLen(4, network order) + un bloque LZ (compress.h) de
+// hasta LZ_MAX_BLOCK bytes del archivo: cada DATA lleva todo lo que
+// comprimido entra en el blksize. Los chunks que no se achican van como
+// siempre, sin el flag. Offsets, digest y checkpoints son del archivo sin
+// comprimir; el CRC de cada DATA cubre el payload tal como viaja.
+#define OPT_COMPRESS "compress"
+#define COMPRESS_LZ "lz"
+#define DATA_FLAG_LZ 0x04
+#define LZ_RAW_LEN_SIZE 4
+
+// Delta estilo rsync (solo modo ventana con checksum y un stream): con
+//   delta\0 1\0
+// en el WRQ, si el servidor tiene una copia anterior del archivo (y no un
+// parcial para retomar) el OACK devuelve el tamaño de bloque y cuántos
+// bloques tiene firmados:
+//   delta\0 <block>\0 dblocks\0 <n>\0
+// Antes del primer DATA el cliente pide las firmas de a páginas: manda SIG
+// con el número de página como seq extendido y el servidor responde otro
+// SIG con las de DELTA_SIGS_PER_PAGE bloques (la última puede tener menos):
+//   Type(1) + Flags(1) + Page(4) + n * (Weak(4) + Strong(8))
+// Los DATA llevan entonces el stream de instrucciones de delta.h en vez del
+// archivo; el servidor lo aplica sobre la copia anterior al escribir en
+// orden, y el digest del FIN es el del archivo reconstruido.
+#define OPT_DELTA "delta"
+#define OPT_DBLOCKS "dblocks"
+#define DELTA_SIGS_PER_PAGE 100     // 1206 bytes de SIG: entra en un MTU de 1280
+
+// Corrección de errores (solo modo ventana con un stream): con
+//   fec\0 <k>\0
+// en el WRQ y el OACK, los DATA se agrupan de a k por seq (el grupo g son
+// los seq [g*k, g*k + k); el último puede ser más corto) y tras cada grupo
+// el cliente manda un FEC con su paridad XOR (fec.h):
+//   Type(1) + Flags(1) + First(4) [+ Crc(4)] + Count(1) + LenXor(2) + Xor
+// First es el primer seq del grupo y Count cuántos DATA tiene; Flags lleva
+// DATA_FLAG_CRC si hay checksum (mismo cálculo que en los DATA) y el XOR de
+// los DATA_FLAG_LZ del grupo. Xor es el de los payloads tal como viajan.
+// Como el FEC tiene FEC_EXT_SIZE bytes más que un DATA, con fec esos bytes
+// salen del blksize igual que el offset y el CRC. Si de un grupo falta un
+// solo DATA el servidor lo reconstruye al llegar el último de los demás o
+// el FEC, y lo reconoce con un ACK con ACK_FLAG_FEC en el byte de flags.
+#define OPT_FEC "fec"
+#define ACK_FLAG_FEC 0x01
+
+// ACKs acumulativos con SACK (solo modo ventana): con
+//   sack\0 1\0
+// en el WRQ y el OACK, el ACK de los DATA deja de reconocer un solo seq y
+// pasa a describir toda la ventana de recepción:
+//   Type(1) + Flags(1) = ACK_FLAG_SACK + Cum(4) + Bitmap
+// Cum es el primer seq que falta (todos los anteriores llegaron) y el bit
+// i del Bitmap (bit i % 8 del byte i / 8) dice si llegó el seq Cum + 1 + i;
+// los bytes en cero del final no se mandan. El servidor coalesce: reconoce
+// al terminar cada lote recibido si hay ack_every DATA sin reconocer, y si
+// no demora el ACK hasta SACK_DELAY_MS; un hueco, un DATA que llena uno o un
+// duplicado se reconocen sin demora. El cliente retransmite solo los seq
+// que faltan. El ACK de un DATA reconstruido con FEC y el del FIN siguen
+// siendo de un solo seq.
+#define OPT_SACK "sack"
+#define ACK_FLAG_SACK 0x02
+#define SACK_ACK_EVERY 2            // DATA en orden por ACK (default del servidor)
+#define SACK_DELAY_MS 5             // Demora máxima de un ACK
+
+// 0-RTT (solo modo ventana, un stream, sin FEC ni delta): el cliente no
+// espera el HELLO ni el OACK. El WRQ va primero, sin sesión previa, y
+// lleva la autenticación:
+//   ticket\0 <ticket>\0   o   auth\0 <credenciales>\0
+// y además early\0 1\0. Atrás salen los primeros DATA (a lo sumo
+// EARLY_CHUNKS) con DATA_FLAG_EARLY, armados con lo pedido en el WRQ. El
+// servidor autentica, responde el WRQ y procesa esos DATA si aceptó todo lo
+// que cambia su formato (blksize, checksum y compresión como se pidieron) y
+// no hay un parcial que retomar: lo confirma con early\0 1\0 en el OACK. Si
+// no, descarta los DATA con el flag y el cliente sigue como si hubiera
+// hecho un WRQ común. Un WRQ con ticket\0 1\0 (o con un ticket válido)
+// pide uno nuevo, que llega en el OACK (ticket.h); solo en el lane 0.
+#define OPT_TICKET "ticket"
+#define OPT_AUTH "auth"
+#define OPT_EARLY "early"
+#define DATA_FLAG_EARLY 0x08
+#define EARLY_CHUNKS 10             // DATA antes del OACK (ventana inicial de TCP)
+
+// Descargas: tras el HELLO, en el lane 0, el cliente pide un archivo con
+//   RRQ:  filename\0 [window\0 <n>\0] [blksize\0 <n>\0] [checksum\0 crc32c\0]
+// con seq 1 y el servidor responde
+//   OACK: window\0 <n>\0 blksize\0 <n>\0 tsize\0 <bytes>\0 [checksum\0 crc32c\0]
+// o un ACK seq 1 con el mensaje de error. Sirve los archivos que recibió
+// (los mismos nombres que en el WRQ). Los roles del modo ventana se
+// invierten: el servidor empieza a mandar los DATA (con CRC si se pidió
+// checksum) apenas envía el OACK y el cliente los reconoce con ACKs con
+// SACK; el cliente descarta los DATA que lleguen antes del OACK. Con todo
+// recibido el cliente manda un FIN con Chunks(4) = total de DATA y el
+// servidor lo reconoce (ACK del FIN) y cierra la sesión. Los DATA salen del
+// archivo mapeado sin copiarlo (download.h).
+
+// GSO (UDP_SEGMENT): el cliente pasa varios DATA del modo ventana en un solo
+// sendmsg y el kernel los separa en datagramas de igual tamaño
+#define GSO_MAX_SEGMENTS 44         // 44 * 1472 = 64768 bytes (< 65507)
 
 // Estructuras de datos
 
+// PDU de control armada o recibida en memoria propia (HELLO, WRQ, ACK, OACK,
+// FIN...): el payload entra en MAX_DATA_SIZE. Los DATA con el blksize
+// negociado pueden ser más grandes, así que no se leen con este tipo.
 typedef struct {
     uint8_t type;                   // Tipo de PDU (HELLO, WRQ, DATA, ACK, FIN)
     uint8_t seq_num;                // Número de secuencia (0 o 1)
     uint8_t data[MAX_DATA_SIZE];    // Datos variables
 } PDU;
 
+// Vista de un datagrama recibido en un buffer de recepción: el header ya
+// separado (Type sin el lane) y el payload donde llegó, de data_len bytes
+// (el largo va aparte, como en los handlers)
+typedef struct {
+    uint8_t type;                   // Tipo de PDU (sin el lane)
+    uint8_t seq_num;                // Seq de 1 bit o flags (modo ventana)
+    const uint8_t *data;            // Payload en el buffer de recepción
+} PduView;
+
 // Estado del cliente
 
 typedef struct {
     int sockfd;                     // Socket descriptor
     struct sockaddr_in server_addr; // Dirección del servidor
     uint8_t current_seq;            // Número de secuencia actual ( 0 o 1)
+    int window;                     // Ventana negociada (1 = Stop & Wait)
+    uint32_t next_seq;              // Próximo seq extendido (modo ventana)
+    RttEstimator rtt;               // Estimador de RTT / RTO de la sesión
+    CongestionControl cc;           // Control de congestión y pacing (modo ventana)
+    int gso;                        // 1 = enviar ráfagas con UDP_SEGMENT
+    int blksize;                    // Bytes de archivo por DATA (negociado)
+    int streams;                    // Streams del archivo (1 = una sola sesión)
+    int64_t file_size;              // Tamaño total anunciado (tsize)
+    int resume;                     // 1 = pedir retomar una subida anterior
+    uint64_t resume_offset;         // Bytes que el servidor ya tiene
+    uint32_t resume_crc;            // CRC32C de esos bytes según el servidor
+    int checksum;                   // 1 = DATA con CRC32C y digest en el FIN
+    uint32_t digest;                // CRC32C de lo enviado (desde el byte 0)
+    int64_t file_length;            // Largo final para el FIN (-1 = no se envía)
+    int compress;                   // 1 = DATA comprimidos cuando se achican
+    int delta;                      // 1 = DATA con el stream delta (delta.h)
+    int delta_block;                // Tamaño de bloque de la copia del servidor
+    uint32_t delta_blocks;          // Bloques firmados de esa copia
+    int fec;                        // DATA por FEC (0 = sin FEC)
+    int sack;                       // 1 = ACKs acumulativos con SACK
+    int early;                      // 1 = 0-RTT (WRQ y primeros DATA sin esperar)
+    const char *ticket_file;        // Cache del ticket de reanudación (NULL = no)
+    char ticket[TICKET_HEX_LEN + 1]; // Ticket a presentar ("" = no hay)
+    int lane;                       // Lane de la subida (0 = un solo archivo)
+    struct Mux *mux;                // Demultiplexor de respuestas por lane (NULL = socket)
+    Metrics *metrics;               // Bloque de métricas del stream
     char credentials[MAX_CREDENTIALS_SIZE]; // Credenciales de autenticación
     char filename[MAX_FILENAME_LEN + 1];    // Nombre del archivo 
 } ClientState;
 
 // Sesión de un cliente en el servidor
 
-typedef struct {
+typedef struct ClientSession {
     struct sockaddr_in addr;        // Dirección del cliente
     int active;                     // 1 si está activa, 0 si está libre
+    int lane;                       // Lane (0 = la sesión autenticada)
+    struct ClientSession *parent;   // Sesión del lane 0 (NULL en el lane 0)
+    int lanes_open;                 // Lanes abiertos de la sesión (en el lane 0)
     int phase;                      // Fase actual del protocolo
     uint8_t expected_seq;           // Próximo seq_num esperado
-    FILE *file;                     // Archivo siendo escrito
+    int window;                     // Ventana negociada (1 = Stop & Wait)
+    int blksize;                    // Máximo de bytes de archivo por DATA
+    int offsets;                    // 1 = DATA con offset (stream de un multi-stream)
+    struct SharedFile *shared;      // Archivo multi-stream (NULL = sink propio)
+    int resume;                     // 1 = el cliente pidió retomar (OACK con offset)
+    int checksum;                   // 1 = DATA con CRC32C y digest en el FIN
+    uint32_t digest;                // CRC32C de lo recibido en orden
+    uint64_t file_base;             // Bytes que ya estaban (prefijo retomado)
+    int compress;                   // 1 = acepta DATA comprimidos (DATA_FLAG_LZ)
+    int early;                      // 1 = valen los DATA del 0-RTT (DATA_FLAG_EARLY)
+    int ticket;                     // 1 = el cliente pidió un ticket
+    uint32_t rcv_base;              // Próximo seq extendido a escribir
+    uint8_t *rx_buf;                // Buffer de recepción fuera de orden
+    int *rx_len;                    // Largo de cada slot (-1 = vacío)
+    uint32_t *rx_crc;               // CRC32C de los datos de cada slot (con checksum)
+    uint8_t *rx_lz;                 // 1 si el slot guarda un bloque comprimido
+    int delta;                      // 1 = los DATA son un stream delta
+    DeltaDecoder delta_dec;         // Copia anterior y estado del stream
+    int fec;                        // DATA por FEC (0 = sin FEC)
+    int fec_groups;                 // Grupos que pueden cruzar la ventana
+    FecGroup *fec_group;            // Acumuladores (grupo g en g % fec_groups)
+    uint8_t *fec_buf;               // XOR de cada acumulador (blksize bytes)
+    uint64_t fec_recovered;         // DATA reconstruidos en la sesión
+    int sack;                       // 1 = ACKs acumulativos con SACK (coalescidos)
+    int ack_every;                  // DATA en orden por ACK
+    uint32_t rcv_high;              // Mayor seq recibido + 1
+    int ack_unsent;                 // DATA nuevos que ningún ACK reconoció todavía
+    int ack_now;                    // 1 = el próximo ACK no se demora
+    uint64_t ack_deadline;          // Salida del ACK demorado (ms)
+    struct ClientSession *prev_ack; // Lista de sesiones que deben un ACK
+    struct ClientSession *next_ack;
+    FileSink sink;                  // Archivo siendo escrito (write-behind)
+    struct ClientSession *prev_open; // Lista de sesiones con archivo abierto
+    struct ClientSession *next_open;
+    struct Download *download;      // Descarga en curso (NULL = no hay)
+    struct ClientSession *prev_dl;  // Lista de sesiones con descarga en curso
+    struct ClientSession *next_dl;
     char filename[MAX_FILENAME_LEN + 1]; // Nombre del archivo
     time_t last_activity;           // Timestamp de última actividad
+    uint64_t data_bytes;            // Bytes de archivo aceptados (goodput)
+    uint64_t first_data_us;         // Llegada del primer y del último DATA nuevo
+    uint64_t last_data_us;
+    TimerNode idle_timer;           // Timer de inactividad (rueda del worker)
+    struct ClientSession *next_free; // Siguiente registro libre del pool
 } ClientSession;
 
+// Configuración del servidor (opciones de línea de comandos)
+
+typedef struct {
+    int batch_size;                 // PDUs por syscall recvmmsg/sendmmsg
+    int num_workers;                // Workers SO_REUSEPORT
+    int pin_cpus;                   // 1 = fijar cada worker a una CPU
+    size_t write_buffer;            // Buffer write-behind por sesión (bytes)
+    int durable;                    // 1 = fsync + rename atómico al FIN
+    int gro;                        // 1 = pedir UDP_GRO (recepción coalescida)
+    int max_blksize;                // Mayor blksize aceptado en el WRQ
+    int idle_timeout;               // Segundos sin actividad hasta cerrar una sesión
+    int ack_every;                  // DATA en orden por ACK con SACK
+    const char *metrics_file;       // Snapshot de métricas (NULL = no)
+    const char *metrics_socket;     // Socket UNIX de consultas de métricas (NULL = no)
+} ServerConfig;
+
 // Estado del servidor
 
 typedef struct {
     int sockfd;                     // Socket descriptor
-    ClientSession clients[MAX_CLIENTS]; // Array de sesiones de clientes
+    struct SessionTable *sessions;  // Tabla hash de sesiones (session_table.h)
     char credentials[MAX_CREDENTIALS_SIZE]; // Credenciales válidas
+    struct BatchIO *batch;          // Lotes de recvmmsg/sendmmsg (batch.h)
+    int worker_id;                  // Worker dueño de este estado
+    const ServerConfig *config;     // Configuración compartida (solo lectura)
+    ClientSession *open_files;      // Sesiones con archivo abierto
+    ClientSession *pending_acks;    // Sesiones que deben un ACK (SACK)
+    ClientSession *downloads;       // Sesiones con descarga en curso
+    int rx_timeout_ms;              // SO_RCVTIMEO actual del socket
+    int rx_failing;                 // 1 mientras el recv del socket falla
+    uint64_t last_idle_flush;       // Última pasada de flush por inactividad (ms)
+    int rcvbuf;                     // SO_RCVBUF efectivo del socket (bytes)
+    TimerWheel idle_timers;         // Timers de inactividad de las sesiones
+    uint64_t reaped;                // Sesiones cerradas por inactividad
+    uint64_t rx_time_us;            // Llegada de la PDU en proceso
+    int lane;                       // Lane de las respuestas que se envían
+    Metrics metrics;                // Métricas del worker (metrics.h)
+    uint8_t *lz_buf;                // Bloque descomprimido (LZ_MAX_BLOCK bytes)
+    uint8_t *delta_buf;             // Lecturas de la copia anterior (DELTA_MAX_BLOCK bytes)
 } ServerState;
 
 // Funciones auxiliares
@@ -94,12 +436,9 @@ const char* pdu_type_to_string(uint8_t type);
 // Convierte la fase a string para logging
 const char* phase_to_string(int phase);
 
-// Imprime una PDU 
+// Registra una PDU en el log (nivel trace)
 void print_pdu(PDU *pdu, int data_len, const char *prefix);
 
-// Imprime dirección IP:Puerto
-void print_address(struct sockaddr_in *addr);
-
 // Crea y configura un socket UDP
 int create_udp_socket(void);
 
@@ -111,6 +450,22 @@ void build_pdu(PDU *pdu, uint8_t type, uint8_t seq_num,
 int send_pdu(int sockfd, struct sockaddr_in *dest_addr, 
              PDU *pdu, int data_len);
 
+// Envía header + payload con sendmsg (sin copiar el payload)
+int send_pdu_iov(int sockfd, struct sockaddr_in *dest_addr,
+                 const void *header, int header_len,
+                 const void *data, int data_len);
+
+// Envía varias PDUs de seg_size bytes en un solo sendmsg con UDP_SEGMENT
+// Retorna los bytes enviados o -1 si error (errno indica si no hay soporte)
+int send_gso(int sockfd, struct sockaddr_in *dest_addr,
+             struct iovec *iov, int iovcnt, int seg_size);
+
+// Indica si el socket acepta UDP_SEGMENT (1 = sí)
+int gso_supported(int sockfd);
+
+// Blksize por defecto (sin opción) para una ventana dada
+int default_blksize(int window);
+
 // Recibe una PDU con timeout usando select()
 int recv_pdu_with_timeout(int sockfd, PDU *pdu, struct sockaddr_in *src_addr,
                           int timeout_ms);
@@ -121,7 +476,35 @@ int validate_filename(const char *filename);
 // Valida que las credenciales sean válidas (máx 10 caracteres ASCII)
 int validate_credentials(const char *credentials);
 
-// Obtiene el tamaño de un archivo
-long get_file_size(const char *filepath);
+// Obtiene el tamaño de un archivo (-1 si no existe o no es regular)
+int64_t get_file_size(const char *filepath);
+
+// Tiempo monotónico en milisegundos / microsegundos / nanosegundos
+uint64_t now_ms(void);
+uint64_t now_us(void);
+uint64_t now_ns(void);
+
+// Lee/escribe el seq extendido (modo ventana) al inicio de pdu->data
+uint32_t pdu_get_seq32(const PDU *pdu);
+void pdu_set_seq32(PDU *pdu, uint32_t seq);
+
+// Vista del datagrama en buf (al menos 2 bytes: Type y SeqNum)
+PduView pdu_view(const uint8_t *buf);
+
+// Lee/escribe un uint32 / uint64 en network order
+uint32_t get_be32(const uint8_t *buf);
+void put_be32(uint8_t *buf, uint32_t value);
+uint64_t get_be64(const uint8_t *buf);
+void put_be64(uint8_t *buf, uint64_t value);
+
+// Agrega una opción "nombre\0valor\0" a buf
+// Retorna el nuevo largo o -1 si no hay espacio; con len = -1 retorna -1
+// sin tocar buf, así que alcanza con verificar el largo final
+int append_option(uint8_t *buf, int len, int max_len,
+                  const char *name, const char *value);
+
+// Busca una opción en una lista "nombre\0valor\0..."
+// Retorna el valor o NULL si no está
+const char* find_option(const uint8_t *buf, int len, const char *name);
 
 #endif 
\ No newline at end of file
@@ -0,0 +1,34 @@
+#ifndef RTT_H
+#define RTT_H
+
+#include <stdint.h>
+
+// Estimador de RTT y timer de retransmisión (RFC 6298)
+//   SRTT   = 7/8 SRTT + 1/8 R
+//   RTTVAR = 3/4 RTTVAR + 1/4 |SRTT - R|
+//   RTO    = SRTT + max(RTO_MIN_MS, 4 RTTVAR), acotado a RTO_MAX_MS
+// Regla de Karn: solo se toman muestras de PDUs que no fueron retransmitidas.
+// Cada timeout duplica el RTO (backoff exponencial) hasta RTO_MAX_MS.
+
+typedef struct {
+    uint64_t srtt_us;               // RTT suavizado (microsegundos)
+    uint64_t rttvar_us;             // Variación del RTT (microsegundos)
+    uint64_t last_rtt_us;           // Última muestra tomada
+    int rto_ms;                     // Timeout de retransmisión actual
+    int has_sample;                 // 1 si ya hubo al menos una muestra
+    int backoffs;                   // Backoffs consecutivos sin muestra nueva
+} RttEstimator;
+
+// Inicializa el estimador con el RTO inicial (TIMEOUT_MS)
+void rtt_init(RttEstimator *rtt);
+
+// Incorpora una muestra de RTT (de una PDU no retransmitida)
+void rtt_sample(RttEstimator *rtt, uint64_t rtt_us);
+
+// Duplica el RTO tras un timeout
+void rtt_backoff(RttEstimator *rtt);
+
+// Timeout a usar en la próxima espera (ms)
+int rtt_timeout_ms(const RttEstimator *rtt);
+
+#endif
@@ -0,0 +1,53 @@
+#ifndef SESSION_TABLE_H
+#define SESSION_TABLE_H
+
+#include "protocol.h"
+
+// Tabla de sesiones del servidor
+// Hash de direccionamiento abierto (linear probing) con clave (IP, puerto,
+// lane): cada lane de una sesión es un registro propio (ver protocol.h).
+// Las entradas apuntan a registros ClientSession que salen de un pool de
+// bloques preasignados: buscar, crear y liberar sesiones no llama a malloc
+// salvo cuando el pool o la tabla tienen que crecer.
+// Al borrar se usa backward-shift deletion, así no quedan tombstones.
+
+#define SESSION_TABLE_INITIAL 64    // Capacidad inicial de la tabla (potencia de 2)
+#define SESSION_POOL_BLOCK 1024     // Sesiones por bloque del pool
+
+typedef struct {
+    uint64_t key;                   // (lane << 48) | (IP << 16) | puerto
+    ClientSession *session;         // NULL = entrada vacía
+} SessionEntry;
+
+typedef struct SessionTable {
+    SessionEntry *entries;          // Tabla hash (capacity entradas)
+    uint32_t capacity;              // Siempre potencia de 2
+    uint32_t count;                 // Sesiones activas
+    uint32_t max_sessions;          // Límite de sesiones simultáneas
+    uint64_t seed;                  // Semilla del hash
+    
+    ClientSession *free_list;       // Registros libres del pool
+    ClientSession **blocks;         // Bloques reservados del pool
+    int num_blocks;
+} SessionTable;
+
+// Inicializa la tabla con el límite de sesiones dado
+// Retorna 0 si OK, -1 si no hay memoria
+int session_table_init(SessionTable *table, uint32_t max_sessions);
+
+// Libera la tabla y el pool (no cierra archivos de las sesiones)
+void session_table_destroy(SessionTable *table);
+
+// Busca la sesión de una dirección en un lane
+// Retorna: puntero a la sesión o NULL si no existe
+ClientSession* session_table_find(SessionTable *table, const struct sockaddr_in *addr, int lane);
+
+// Crea una sesión (en cero, con addr y lane cargados) que no existe
+// Retorna: puntero a la sesión o NULL si se alcanzó el límite o no hay memoria
+ClientSession* session_table_insert(SessionTable *table, const struct sockaddr_in *addr,
+                                    int lane);
+
+// Quita una sesión de la tabla y devuelve su registro al pool
+void session_table_remove(SessionTable *table, ClientSession *session);
+
+#endif
@@ -0,0 +1,47 @@
+#ifndef SHARED_FILE_H
+#define SHARED_FILE_H
+
+#include <stdint.h>
+
+// Archivo recibido por varias sesiones en paralelo (multi-stream)
+// El cliente parte el archivo en rangos de bytes y sube cada uno por una
+// sesión propia; los DATA llevan el offset y todas las sesiones escriben
+// con pwrite(2) sobre un único descriptor, preasignado con el tamaño total.
+// El registro es global (compartido entre workers, protegido con un mutex)
+// porque el kernel reparte los sockets de un mismo cliente entre workers
+// distintos; solo se usa en el WRQ y el FIN, nunca por DATA.
+// El archivo queda completo cuando llegó el FIN de los `streams` rangos;
+// en modo durable recién ahí se hace fsync y rename del .tmp. Si un stream
+// se abandona el archivo se marca fallido y se descarta al soltarlo el
+// último.
+// El primer stream toma el flock del checkpoint (sink_lock, file_sink.h) y
+// el archivo lo conserva hasta completarse o descartarse: mientras tanto
+// un sink propio del mismo archivo falla con EBUSY, y al revés.
+
+typedef struct SharedFile {
+    char path[256];                 // Nombre final del archivo
+    char tmp_path[260];             // Nombre temporal (modo durable)
+    char ckpt_path[264];            // Checkpoint con el flock del archivo
+    int ckpt_fd;                    // Descriptor con el flock
+    int fd;                         // Descriptor compartido por los streams
+    int durable;                    // 1 = fsync + rename al completarse
+    int64_t size;                   // Tamaño total anunciado (-1 = desconocido)
+    int streams;                    // Streams esperados
+    int refs;                       // Sesiones que lo tienen abierto
+    int completed;                  // Streams que terminaron con FIN
+    int failed;                     // 1 si algún stream se abandonó
+    struct SharedFile *next;        // Siguiente en el registro
+} SharedFile;
+
+// Abre el archivo (primer stream) o se une a uno en curso con el mismo path
+// Retorna el archivo o NULL si hay error, si el archivo en curso falló o si
+// fue anunciado con otro tamaño / cantidad de streams (errno = EBUSY si un
+// sink propio tiene el archivo abierto)
+SharedFile* shared_file_open(const char *path, int64_t size, int streams, int durable);
+
+// Suelta el archivo al cerrar una sesión (completed = 1 si llegó su FIN)
+// Retorna 1 si con este stream el archivo quedó completo, 0 si faltan
+// streams y -1 si el archivo falló
+int shared_file_release(SharedFile *file, int completed);
+
+#endif
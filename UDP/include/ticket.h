@@ -0,0 +1,31 @@
+#ifndef TICKET_H
+#define TICKET_H
+
+#include <stdint.h>
+#include <time.h>
+
+// Tickets de reanudación para el 0-RTT (opción "ticket", protocol.h)
+// El servidor no guarda nada: el ticket es
+//   Expiry(4) + Mac(8)
+// en hexadecimal, con Mac = SipHash-2-4 de (Expiry, IP del cliente,
+// credenciales) con una clave al azar que se elige al arrancar. Vale
+// TICKET_LIFETIME segundos, solo desde la misma IP y mientras el servidor
+// tenga las mismas credenciales y no se reinicie (clave nueva); un ticket
+// inválido solo cuesta volver al HELLO.
+
+#define TICKET_SIZE 12
+#define TICKET_HEX_LEN (2 * TICKET_SIZE)
+#define TICKET_LIFETIME (12 * 3600)
+
+// Elige la clave (una vez, antes de arrancar los workers)
+// Retorna 0 si OK, -1 si no hay fuente de azar
+int ticket_init(void);
+
+// Escribe en out (TICKET_HEX_LEN + 1 bytes) un ticket para la IP (network
+// order) y las credenciales, válido desde now
+void ticket_issue(char *out, uint32_t ip, const char *credentials, time_t now);
+
+// 1 si el ticket es de esta clave, la IP y las credenciales y no venció
+int ticket_check(const char *ticket, uint32_t ip, const char *credentials, time_t now);
+
+#endif
@@ -0,0 +1,58 @@
+#ifndef TIMER_WHEEL_H
+#define TIMER_WHEEL_H
+
+#include <stdint.h>
+
+// Rueda de timers jerárquica (servidor)
+// WHEEL_LEVELS niveles de WHEEL_SLOTS listas; el nivel 0 tiene un slot por
+// tick y cada nivel siguiente cubre WHEEL_SLOTS veces más. Un timer va al
+// nivel más bajo que alcanza su vencimiento y, cuando el nivel 0 da la
+// vuelta, los timers del slot actual del nivel siguiente bajan (cascada).
+// Agregar y quitar un timer es O(1) (listas dobles intrusivas) y avanzar un
+// tick también, salvo las cascadas, que mueven cada timer a lo sumo una
+// vez por nivel. Con ticks de 100 ms: nivel 0 = 6.4 s, 1 = 6.8 min,
+// 2 = 7.3 h, 3 = 19 días (vencimientos más lejanos se acotan a ese rango).
+
+#define WHEEL_TICK_MS 100           // Resolución de la rueda
+#define WHEEL_BITS 6
+#define WHEEL_SLOTS (1 << WHEEL_BITS)
+#define WHEEL_MASK (WHEEL_SLOTS - 1)
+#define WHEEL_LEVELS 4
+
+// Nodo de un timer, embebido en el registro que lo usa
+typedef struct TimerNode {
+    struct TimerNode *next;         // NULL = no está en la rueda
+    struct TimerNode *prev;
+    uint64_t expires;               // Tick de vencimiento
+} TimerNode;
+
+typedef struct {
+    TimerNode slots[WHEEL_LEVELS][WHEEL_SLOTS]; // Cabezas de listas circulares
+    uint64_t start_ms;              // Instante del tick 0
+    uint64_t tick;                  // Próximo tick a procesar
+    uint32_t count;                 // Timers en la rueda
+} TimerWheel;
+
+// Callback de un timer vencido (ya fuera de la rueda: puede volver a agregarlo)
+typedef void (*TimerExpireFn)(TimerNode *node, void *arg);
+
+// Inicializa la rueda vacía con el tick 0 en now_ms
+void wheel_init(TimerWheel *wheel, uint64_t now_ms);
+
+// Deja un nodo fuera de la rueda (antes del primer uso)
+void timer_init(TimerNode *node);
+
+// 1 si el timer está en la rueda
+int timer_pending(const TimerNode *node);
+
+// Programa el timer para dentro de delay_ms (lo mueve si ya estaba)
+void wheel_add(TimerWheel *wheel, TimerNode *node, uint64_t delay_ms);
+
+// Saca el timer de la rueda (no hace nada si no estaba)
+void wheel_remove(TimerWheel *wheel, TimerNode *node);
+
+// Procesa los ticks hasta now_ms y llama a expire por cada timer vencido
+// Retorna la cantidad de timers vencidos
+int wheel_advance(TimerWheel *wheel, uint64_t now_ms, TimerExpireFn expire, void *arg);
+
+#endif
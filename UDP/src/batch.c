@@ -0,0 +1,261 @@
+#define _GNU_SOURCE                 // recvmmsg / sendmmsg
+#include <netinet/udp.h>
+#include "../include/protocol.h"
+#include "../include/batch.h"
+
+// E/S de datagramas por lotes
+
+// Reserva un BatchIO
+BatchIO* batch_create(int size, size_t max_pdu, int gro) {
+    BatchIO *batch = calloc(1, sizeof(BatchIO));
+    if (!batch) {
+        perror("Error reservando lote");
+        return NULL;
+    }
+    
+    if (size < 1) size = 1;
+    if (size > BATCH_MAX) size = BATCH_MAX;
+    batch->size = size;
+    batch->rx_gro = gro;
+    batch->rx_buf_size = sizeof(PDU);
+    if (max_pdu > batch->rx_buf_size) {
+        batch->rx_buf_size = max_pdu;
+    }
+    if (gro) {
+        batch->rx_buf_size = GRO_BUFFER_SIZE;
+    }
+    
+    batch->rx_bufs = malloc((size_t)size * batch->rx_buf_size);
+    if (!batch->rx_bufs) {
+        perror("Error reservando lote");
+        free(batch);
+        return NULL;
+    }
+    
+    return batch;
+}
+
+// Libera un BatchIO
+void batch_destroy(BatchIO *batch) {
+    if (batch) {
+        free(batch->rx_bufs);
+    }
+    free(batch);
+}
+
+// Tamaño de segmento GRO informado en los mensajes de control (0 si no hay)
+static int gro_segment_size(struct msghdr *msg) {
+#ifdef UDP_GRO
+    for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(msg); cmsg; cmsg = CMSG_NXTHDR(msg, cmsg)) {
+        if (cmsg->cmsg_level == SOL_UDP && cmsg->cmsg_type == UDP_GRO) {
+            int seg_size;
+            memcpy(&seg_size, CMSG_DATA(cmsg), sizeof(int));
+            return seg_size;
+        }
+    }
+#else
+    (void)msg;
+#endif
+    return 0;
+}
+
+#ifdef __linux__
+
+// Recibe un lote con recvmmsg()
+// MSG_WAITFORONE: bloquea hasta la primera PDU y luego toma solo lo disponible
+int batch_recv(int sockfd, BatchIO *batch) {
+    struct mmsghdr msgs[BATCH_MAX];
+    struct iovec iovecs[BATCH_MAX];
+    
+    memset(msgs, 0, sizeof(struct mmsghdr) * batch->size);
+    for (int i = 0; i < batch->size; i++) {
+        iovecs[i].iov_base = batch_rx_buf(batch, i);
+        iovecs[i].iov_len = batch->rx_buf_size;
+        msgs[i].msg_hdr.msg_iov = &iovecs[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+        msgs[i].msg_hdr.msg_name = &batch->rx_addrs[i];
+        msgs[i].msg_hdr.msg_namelen = sizeof(struct sockaddr_in);
+        if (batch->rx_gro) {
+            msgs[i].msg_hdr.msg_control = batch->rx_ctrl[i];
+            msgs[i].msg_hdr.msg_controllen = sizeof(batch->rx_ctrl[i]);
+        }
+    }
+    
+    int count = recvmmsg(sockfd, msgs, batch->size, MSG_WAITFORONE, NULL);
+    if (count < 0) {
+        // Timeout de recepción (SO_RCVTIMEO) o señal: lote vacío
+        if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) {
+            return 0;
+        }
+        return -1;
+    }
+    
+    uint64_t packets = 0;
+    for (int i = 0; i < count; i++) {
+        batch->rx_lens[i] = msgs[i].msg_len;
+        batch->rx_seg_sizes[i] = batch->rx_gro ? gro_segment_size(&msgs[i].msg_hdr) : 0;
+        
+        // Buffer coalescido: contar cada datagrama que trae
+        int seg_size = batch->rx_seg_sizes[i];
+        if (seg_size > 0 && batch->rx_lens[i] > seg_size) {
+            int segments = (batch->rx_lens[i] + seg_size - 1) / seg_size;
+            batch->rx_gro_buffers++;
+            batch->rx_gro_segments += segments;
+            packets += segments;
+        } else {
+            packets++;
+        }
+    }
+    
+    batch->rx_calls++;
+    batch->rx_packets += packets;
+    if (count > batch->rx_max_batch) {
+        batch->rx_max_batch = count;
+    }
+    
+    return count;
+}
+
+// Envía el lote pendiente con sendmmsg()
+int batch_flush(int sockfd, BatchIO *batch) {
+    struct mmsghdr msgs[BATCH_MAX];
+    struct iovec iovecs[BATCH_MAX][2];
+    
+    if (batch->tx_count == 0) {
+        return 0;
+    }
+    
+    memset(msgs, 0, sizeof(struct mmsghdr) * batch->tx_count);
+    for (int i = 0; i < batch->tx_count; i++) {
+        iovecs[i][0].iov_base = &batch->tx_pdus[i];
+        iovecs[i][0].iov_len = 2 + batch->tx_lens[i];
+        iovecs[i][1].iov_base = (void*)batch->tx_payloads[i];
+        iovecs[i][1].iov_len = batch->tx_payload_lens[i];
+        msgs[i].msg_hdr.msg_iov = iovecs[i];
+        msgs[i].msg_hdr.msg_iovlen = batch->tx_payloads[i] ? 2 : 1;
+        msgs[i].msg_hdr.msg_name = &batch->tx_addrs[i];
+        msgs[i].msg_hdr.msg_namelen = sizeof(struct sockaddr_in);
+    }
+    
+    // sendmmsg puede enviar solo una parte: continuar con el resto
+    int sent_total = 0;
+    while (sent_total < batch->tx_count) {
+        int sent = sendmmsg(sockfd, msgs + sent_total, batch->tx_count - sent_total, 0);
+        if (sent < 0) {
+            if (errno == EINTR) continue;
+            perror("Error en sendmmsg");
+            break;
+        }
+        
+        batch->tx_calls++;
+        batch->tx_packets += sent;
+        sent_total += sent;
+    }
+    
+    batch->tx_count = 0;
+    return sent_total;
+}
+
+#else
+
+// Recibe un lote con recvfrom(): la primera bloqueante, el resto sin bloquear
+int batch_recv(int sockfd, BatchIO *batch) {
+    int count = 0;
+    
+    while (count < batch->size) {
+        socklen_t addr_len = sizeof(struct sockaddr_in);
+        int flags = count == 0 ? 0 : MSG_DONTWAIT;
+        int recv_len = recvfrom(sockfd, batch_rx_buf(batch, count), batch->rx_buf_size, flags,
+                                (struct sockaddr*)&batch->rx_addrs[count], &addr_len);
+        if (recv_len < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) break;
+            return count > 0 ? count : -1;
+        }
+        
+        batch->rx_seg_sizes[count] = 0;
+        batch->rx_lens[count++] = recv_len;
+        batch->rx_calls++;
+    }
+    
+    batch->rx_packets += count;
+    if (count > batch->rx_max_batch) {
+        batch->rx_max_batch = count;
+    }
+    
+    return count;
+}
+
+// Envía el lote pendiente con un sendto() por PDU
+int batch_flush(int sockfd, BatchIO *batch) {
+    int sent_total = 0;
+    
+    for (int i = 0; i < batch->tx_count; i++) {
+        int sent = batch->tx_payloads[i]
+            ? send_pdu_iov(sockfd, &batch->tx_addrs[i], &batch->tx_pdus[i], 2 + batch->tx_lens[i],
+                           batch->tx_payloads[i], batch->tx_payload_lens[i])
+            : send_pdu(sockfd, &batch->tx_addrs[i], &batch->tx_pdus[i], batch->tx_lens[i]);
+        if (sent >= 0) {
+            sent_total++;
+        }
+        batch->tx_calls++;
+    }
+    
+    batch->tx_packets += sent_total;
+    batch->tx_count = 0;
+    return sent_total;
+}
+
+#endif
+
+// Encola una PDU en el lote de envío
+int batch_queue_send(int sockfd, BatchIO *batch, struct sockaddr_in *dest_addr,
+                     PDU *pdu, int data_len) {
+    if (batch->tx_count >= batch->size) {
+        batch_flush(sockfd, batch);
+    }
+    
+    int i = batch->tx_count++;
+    memcpy(&batch->tx_pdus[i], pdu, 2 + data_len);
+    memcpy(&batch->tx_addrs[i], dest_addr, sizeof(struct sockaddr_in));
+    batch->tx_lens[i] = data_len;
+    batch->tx_payloads[i] = NULL;
+    batch->tx_payload_lens[i] = 0;
+    
+    return 2 + data_len;
+}
+
+// Encola header + payload: el header se copia al lote, el payload no
+int batch_queue_send_iov(int sockfd, BatchIO *batch, struct sockaddr_in *dest_addr,
+                         const void *hdr, int hdr_len, const void *payload, int payload_len) {
+    if (batch->tx_count >= batch->size) {
+        batch_flush(sockfd, batch);
+    }
+    
+    int i = batch->tx_count++;
+    memcpy(&batch->tx_pdus[i], hdr, hdr_len);
+    memcpy(&batch->tx_addrs[i], dest_addr, sizeof(struct sockaddr_in));
+    batch->tx_lens[i] = hdr_len - 2;
+    batch->tx_payloads[i] = payload_len > 0 ? payload : NULL;
+    batch->tx_payload_lens[i] = payload_len;
+    
+    return hdr_len + payload_len;
+}
+
+// Registra las estadísticas de PDUs por syscall
+void batch_print_stats(BatchIO *batch) {
+    LOG_INFO("[BATCH] lote=%d | RX: %llu PDUs en %llu syscalls (%.2f PDUs/syscall, max %d) | "
+             "TX: %llu PDUs en %llu syscalls (%.2f PDUs/syscall)\n",
+             batch->size,
+             (unsigned long long)batch->rx_packets, (unsigned long long)batch->rx_calls,
+             batch->rx_calls ? (double)batch->rx_packets / batch->rx_calls : 0.0,
+             batch->rx_max_batch,
+             (unsigned long long)batch->tx_packets, (unsigned long long)batch->tx_calls,
+             batch->tx_calls ? (double)batch->tx_packets / batch->tx_calls : 0.0);
+    
+    if (batch->rx_gro) {
+        LOG_INFO("[GRO] %llu buffers coalescidos con %llu datagramas (%.2f por buffer)\n",
+                 (unsigned long long)batch->rx_gro_buffers,
+                 (unsigned long long)batch->rx_gro_segments,
+                 batch->rx_gro_buffers ? (double)batch->rx_gro_segments / batch->rx_gro_buffers : 0.0);
+    }
+}
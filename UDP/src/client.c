@@ -1,10 +1,210 @@
+#include <pthread.h>
+#include <dirent.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <sys/stat.h>
 #include "../include/protocol.h"
+#include "../include/file_source.h"
+#include "../include/checksum.h"
+#include "../include/compress.h"
+#include "../include/fec.h"
+#include "../include/mux.h"
 
 // Funciones del cliente UDP
 
+// MTUs típicos de enlaces (RFC 1191), de mayor a menor, para el sondeo
+static const int mtu_plateaus[] = { 65535, 32000, 17914, 8166, 4352, 2002, 1500, 1492, 1280, 576 };
+
+// Header de un DATA según el modo: Type + Seq (+ seq extendido en ventana)
+// (+ offset si el archivo va en varios streams) (+ CRC con checksum)
+static int data_header_size(int window, int streams, int checksum) {
+    if (window <= 1) {
+        return 2;
+    }
+    return 2 + EXT_SEQ_SIZE + (streams > 1 ? EXT_OFFSET_SIZE : 0) +
+           (checksum ? EXT_CRC_SIZE : 0);
+}
+
+// Bytes que el FEC de un grupo tiene de más respecto de un DATA
+static int fec_extra(const ClientState *state) {
+    return state->fec ? FEC_EXT_SIZE : 0;
+}
+
+// Blksize que usa el servidor si no se negocia (offset, CRC y el largo
+// extra de los FEC salen del mismo datagrama)
+static int plain_blksize(const ClientState *state) {
+    return default_blksize(state->window) - (state->streams > 1 ? EXT_OFFSET_SIZE : 0) -
+           (state->checksum ? EXT_CRC_SIZE : 0) - fec_extra(state);
+}
+
+// Socket UDP del cliente con DF y sin fragmentar: un datagrama más grande
+// que el camino se pierde (o falla con EMSGSIZE) en vez de fragmentarse, y
+// el sondeo posterior al WRQ lo detecta
+static int open_client_socket(void) {
+    int sockfd = create_udp_socket();
+    if (sockfd < 0) {
+        return -1;
+    }
+#if defined(IP_MTU_DISCOVER) && defined(IP_PMTUDISC_PROBE)
+    int pmtudisc = IP_PMTUDISC_PROBE;
+    if (setsockopt(sockfd, IPPROTO_IP, IP_MTU_DISCOVER, &pmtudisc, sizeof(pmtudisc)) < 0) {
+        perror("IP_MTU_DISCOVER no disponible");
+    }
+#endif
+    return sockfd;
+}
+
+// Métricas del stream: datagramas enviados al servidor
+static void count_tx(ClientState *state, int packets, int bytes) {
+    metric_add(state->metrics, METRIC_TX_PACKETS, packets);
+    metric_add(state->metrics, METRIC_TX_BYTES, bytes);
+}
+
+// recv_pdu_with_timeout contando lo recibido en las métricas del stream
+// Con varios lanes en el socket la respuesta sale de la cola del lane
+static int recv_from_server(ClientState *state, PDU *pdu, struct sockaddr_in *from_addr,
+                            int timeout_ms) {
+    int recv_len = state->mux ? mux_recv(state->mux, state->lane, pdu, from_addr, timeout_ms)
+                              : recv_pdu_with_timeout(state->sockfd, pdu, from_addr, timeout_ms);
+    if (recv_len > 0) {
+        metric_add(state->metrics, METRIC_RX_PACKETS, 1);
+        metric_add(state->metrics, METRIC_RX_BYTES, recv_len);
+    }
+    return recv_len;
+}
+
+// Muestra de RTT para el estimador del RTO y el histograma de métricas
+static void sample_rtt(ClientState *state, uint64_t rtt_us) {
+    rtt_sample(&state->rtt, rtt_us);
+    metric_observe(state->metrics, METRIC_ACK_RTT_US, rtt_us);
+}
+
+// Goodput de una transferencia terminada (kB/s), registrado en las métricas
+static uint64_t observe_goodput(ClientState *state, uint64_t bytes, uint64_t start_us) {
+    uint64_t elapsed_us = now_us() - start_us;
+    uint64_t goodput_kbps = elapsed_us > 0 ? bytes * 1000000ULL / elapsed_us / 1024 : 0;
+    metric_observe(state->metrics, METRIC_GOODPUT_KBPS, goodput_kbps);
+    return goodput_kbps;
+}
+
+// Progreso para el log: "hecho / total bytes (%)", o solo lo hecho si no se
+// conoce el total (streaming); un archivo vacío está completo
+static const char* format_progress(char *out, size_t len, uint64_t done, int64_t total) {
+    if (total < 0) {
+        snprintf(out, len, "%llu bytes", (unsigned long long)done);
+    } else {
+        snprintf(out, len, "%llu / %lld bytes (%.1f%%)", (unsigned long long)done,
+                 (long long)total, total > 0 ? done * 100.0 / total : 100.0);
+    }
+    return out;
+}
+
+// MTU del camino hacia el servidor según el kernel (interfaz de salida o
+// PMTU ya conocido); 1500 si no se puede consultar
+int estimate_path_mtu(struct sockaddr_in *server_addr) {
+    int mtu = 1500;
+#ifdef IP_MTU
+    // IP_MTU solo responde en sockets conectados: usar uno temporal
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (fd >= 0) {
+        int value;
+        socklen_t len = sizeof(value);
+        if (connect(fd, (struct sockaddr*)server_addr, sizeof(*server_addr)) == 0 &&
+            getsockopt(fd, IPPROTO_IP, IP_MTU, &value, &len) == 0 && value > 0) {
+            mtu = value;
+        }
+        close(fd);
+    }
+#else
+    (void)server_addr;
+#endif
+    return mtu;
+}
+
+// Guarda el ticket en el cache, reemplazando la línea "ip:puerto ticket" del
+// servidor (el resto de las líneas son de otros servidores)
+static void save_ticket(ClientState *state) {
+    char key[INET_ADDRSTRLEN + 8];
+    char ip[INET_ADDRSTRLEN];
+    char tmp_path[PATH_MAX];
+    char line[128];
+    
+    inet_ntop(AF_INET, &state->server_addr.sin_addr, ip, sizeof(ip));
+    snprintf(key, sizeof(key), "%s:%d ", ip, ntohs(state->server_addr.sin_port));
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", state->ticket_file);
+    
+    // El ticket es una credencial: solo para el usuario
+    int fd = open(tmp_path, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+    FILE *out = fd >= 0 ? fdopen(fd, "w") : NULL;
+    if (!out) {
+        LOG_WARN("No se pudo guardar el ticket en %s\n", state->ticket_file);
+        if (fd >= 0) {
+            close(fd);
+        }
+        return;
+    }
+    
+    FILE *in = fopen(state->ticket_file, "r");
+    if (in) {
+        while (fgets(line, sizeof(line), in)) {
+            if (strncmp(line, key, strlen(key)) != 0) {
+                fputs(line, out);
+            }
+        }
+        fclose(in);
+    }
+    fprintf(out, "%s%s\n", key, state->ticket);
+    
+    if (fclose(out) != 0 || rename(tmp_path, state->ticket_file) < 0) {
+        LOG_WARN("No se pudo guardar el ticket en %s\n", state->ticket_file);
+        unlink(tmp_path);
+    }
+}
+
+// Ticket del servidor guardado en el cache ("" si no hay)
+static void load_ticket(ClientState *state) {
+    char key[INET_ADDRSTRLEN + 8];
+    char ip[INET_ADDRSTRLEN];
+    char line[128];
+    
+    state->ticket[0] = '\0';
+    FILE *in = fopen(state->ticket_file, "r");
+    if (!in) {
+        return;
+    }
+    
+    inet_ntop(AF_INET, &state->server_addr.sin_addr, ip, sizeof(ip));
+    snprintf(key, sizeof(key), "%s:%d ", ip, ntohs(state->server_addr.sin_port));
+    while (fgets(line, sizeof(line), in)) {
+        size_t key_len = strlen(key);
+        if (strncmp(line, key, key_len) == 0 &&
+            strspn(line + key_len, "0123456789abcdef") == TICKET_HEX_LEN) {
+            memcpy(state->ticket, line + key_len, TICKET_HEX_LEN);
+            state->ticket[TICKET_HEX_LEN] = '\0';
+        }
+    }
+    fclose(in);
+}
+
 // Inicializa el estado del cliente
-int init_client(ClientState *state, const char *server_ip, 
-                const char *credentials, const char *filename) {
+// blksize: bytes por DATA a pedir (-1 = según el MTU, 0 = no negociar)
+// congestion: algoritmo de control de congestión (congestion.h)
+// streams: sesiones en paralelo para el archivo de file_size bytes (1 = una)
+// resume: pedir retomar una subida anterior (solo con un stream y tamaño conocido)
+// checksum: pedir CRC32C por DATA y digest en el FIN (solo modo ventana)
+// compress: pedir DATA comprimidos (solo modo ventana)
+// delta: enviar solo las diferencias con la copia del servidor (con
+// checksum, un stream y tamaño conocido)
+// fec: DATA por FEC a pedir (0 = sin FEC; modo ventana con un stream)
+// sack: pedir ACKs acumulativos con SACK (solo modo ventana)
+// early: 0-RTT, sin HELLO ni esperar el OACK (modo ventana con un stream,
+// sin FEC ni delta y tamaño conocido)
+// ticket_file: cache de tickets para el 0-RTT (NULL = no pedir tickets)
+int init_client(ClientState *state, const char *server_ip, int server_port,
+                const char *credentials, const char *filename, int window, int gso,
+                int blksize, const char *congestion, int streams, int64_t file_size,
+                int resume, int checksum, int compress, int delta, int fec, int sack,
+                int early, const char *ticket_file) {
     // Validar credenciales ANTES de inicializar
     if (!validate_credentials(credentials)) {
         return -1;
@@ -15,8 +215,14 @@ int init_client(ClientState *state, const char *server_ip,
         return -1;
     }
     
+    // Validar el algoritmo (se reinicia con el blksize negociado)
+    if (cc_init(&state->cc, congestion, MAX_DATA_SIZE, window, 0) < 0) {
+        LOG_ERROR("Control de congestion desconocido: %s\n", congestion);
+        return -1;
+    }
+    
     // Crear socket
-    state->sockfd = create_udp_socket();
+    state->sockfd = open_client_socket();
     if (state->sockfd < 0) {
         return -1;
     }
@@ -24,7 +230,7 @@ int init_client(ClientState *state, const char *server_ip,
     // Configurar dirección del servidor
     memset(&state->server_addr, 0, sizeof(state->server_addr));
     state->server_addr.sin_family = AF_INET;
-    state->server_addr.sin_port = htons(SERVER_PORT);
+    state->server_addr.sin_port = htons(server_port);
     
     if (inet_pton(AF_INET, server_ip, &state->server_addr.sin_addr) <= 0) {
         perror("Error en dirección IP del servidor");
@@ -39,11 +245,91 @@ int init_client(ClientState *state, const char *server_ip,
     
     // Inicializar seq_num
     state->current_seq = 0;
+    state->window = window;
+    state->next_seq = 0;
+    state->streams = streams;
+    state->file_size = file_size;
+    state->resume = resume && window > 1 && streams == 1 && file_size >= 0;
+    state->resume_offset = 0;
+    state->resume_crc = 0;
+    state->file_length = -1;
+    state->checksum = checksum && window > 1;
+    state->digest = CRC32C_INIT;
+    state->compress = compress && window > 1;
+    state->delta = delta && state->checksum && streams == 1 && file_size >= 0;
+    state->delta_block = 0;
+    state->delta_blocks = 0;
+    state->fec = window > 1 && streams == 1 ? fec : 0;
+    state->sack = sack && window > 1;
+    state->early = early && window > 1 && streams == 1 && !state->fec && !state->delta &&
+                   file_size >= 0;
+    state->ticket_file = ticket_file;
+    state->ticket[0] = '\0';
+    if (ticket_file) {
+        load_ticket(state);
+    }
+    state->lane = 0;
+    state->mux = NULL;
+    rtt_init(&state->rtt);
+    
+    // Blksize a pedir: con 0-RTT no hay sondeo y los primeros DATA salen
+    // antes de saber nada del camino, así que va el que entra en 1500
+    // bytes; en Stop & Wait solo el de -B (sin opciones el WRQ es el
+    // original); si no, el que entra en un datagrama del MTU local
+    if (state->early && blksize <= 0) {
+        blksize = plain_blksize(state);
+    } else if (blksize < 0 && window == 1) {
+        blksize = 0;
+    } else if (blksize < 0) {
+        int max_blksize = (streams > 1 ? MAX_OFFSET_BLKSIZE : MAX_BLKSIZE) -
+                          (state->checksum ? EXT_CRC_SIZE : 0) - fec_extra(state);
+        blksize = estimate_path_mtu(&state->server_addr) - IP_UDP_HEADER_SIZE -
+                  data_header_size(window, streams, state->checksum) - fec_extra(state);
+        if (blksize > max_blksize) {
+            blksize = max_blksize;
+        }
+        if (blksize < MIN_BLKSIZE) {
+            blksize = MIN_BLKSIZE;
+        }
+    }
+    state->blksize = blksize;
     
-    printf("Cliente inicializado\n");
-    printf("  Servidor: %s:%d\n", server_ip, SERVER_PORT);
-    printf("  Credenciales: %s\n", credentials);
-    printf("  Archivo: %s\n", filename);
+    // GSO: solo si el kernel acepta UDP_SEGMENT
+    state->gso = 0;
+    if (gso) {
+        if (gso_supported(state->sockfd)) {
+            state->gso = 1;
+        } else {
+            LOG_WARN("UDP_SEGMENT no disponible, enviando de a un datagrama\n");
+        }
+    }
+    
+    LOG_INFO("Cliente inicializado\n");
+    LOG_INFO("  Servidor: %s:%d\n", server_ip, server_port);
+    LOG_INFO("  Credenciales: %s\n", credentials);
+    LOG_INFO("  Archivo: %s\n", filename);
+    LOG_INFO("  Ventana pedida: %d\n", window);
+    if (blksize > 0) {
+        LOG_INFO("  Blksize pedido: %d bytes\n", blksize);
+    } else {
+        LOG_INFO("  Blksize: %d bytes (sin negociar)\n", plain_blksize(state));
+    }
+    if (streams > 1) {
+        LOG_INFO("  Streams: %d en paralelo (%lld bytes)\n", streams, (long long)file_size);
+    }
+    LOG_INFO("  Retomar subida anterior: %s\n", state->resume ? "si" : "no");
+    LOG_INFO("  Checksum: %s\n", state->checksum ? CHECKSUM_CRC32C : "no");
+    LOG_INFO("  Compresion: %s\n", state->compress ? COMPRESS_LZ : "no");
+    LOG_INFO("  Delta: %s\n", state->delta ? "si" : "no");
+    if (state->fec) {
+        LOG_INFO("  FEC: un XOR cada %d DATA\n", state->fec);
+    } else {
+        LOG_INFO("  FEC: no\n");
+    }
+    LOG_INFO("  SACK: %s\n", state->sack ? "si" : "no");
+    LOG_INFO("  0-RTT: %s\n", !state->early ? "no" : state->ticket[0] ? "si (con ticket)" : "si");
+    LOG_INFO("  GSO: %s\n", state->gso ? "activo" : "no");
+    LOG_INFO("  Control de congestion: %s\n", cc_name(&state->cc));
     
     return 0;
 }
@@ -54,26 +340,27 @@ int send_hello(ClientState *state) {
     int retries = 0;
     int cred_len = strlen(state->credentials);
     
-    printf("\n=== FASE 1: AUTENTICACION (HELLO) ===\n");
+    LOG_INFO("\n=== FASE 1: AUTENTICACION (HELLO) ===\n");
     
     // Construir HELLO PDU con seq_num = 0
     build_pdu(&pdu, TYPE_HELLO, 0, state->credentials, cred_len);
     
     while (retries < MAX_RETRIES) {
-        printf("Enviando HELLO (intento %d/%d)...\n", retries + 1, MAX_RETRIES);
+        LOG_INFO("Enviando HELLO (intento %d/%d)...\n", retries + 1, MAX_RETRIES);
         
         // Enviar HELLO
         int sent = send_pdu(state->sockfd, &state->server_addr, &pdu, cred_len);
         if (sent < 0) {
             return -1;
         }
+        count_tx(state, 1, sent);
         
         print_pdu(&pdu, cred_len, "  TX:");
         
-        // Esperar ACK con timeout
+        // Esperar ACK con el RTO actual
         struct sockaddr_in from_addr;
-        int recv_len = recv_pdu_with_timeout(state->sockfd, &ack, 
-                                            &from_addr, TIMEOUT_MS);
+        uint64_t sent_us = now_us();
+        int recv_len = recv_from_server(state, &ack, &from_addr, rtt_timeout_ms(&state->rtt));
         
         if (recv_len > 0) {
             print_pdu(&ack, recv_len - 2, "  RX:");
@@ -82,56 +369,229 @@ int send_hello(ClientState *state) {
             if (ack.type == TYPE_ACK && ack.seq_num == 0) {
                 // Verificar si hay mensaje de error en el payload
                 if (recv_len > 2) {
-                    printf("Error del servidor: %s\n", ack.data);
+                    LOG_ERROR("Error del servidor: %.*s\n", recv_len - 2, (const char*)ack.data);
                     return -1;
                 }
                 
-                printf("Autenticacion exitosa\n");
+                // Muestra de RTT solo si no hubo retransmisión (Karn)
+                if (retries == 0) {
+                    sample_rtt(state, now_us() - sent_us);
+                }
+                
+                LOG_INFO("Autenticacion exitosa (RTT=%.2fms, RTO=%dms)\n",
+                         state->rtt.last_rtt_us / 1000.0, rtt_timeout_ms(&state->rtt));
                 return 0;
             } else {
-                printf("  Respuesta incorrecta, ignorando...\n");
+                LOG_INFO("  Respuesta incorrecta, ignorando...\n");
             }
         } else if (recv_len == 0) {
-            printf("  Timeout, reintentando...\n");
+            rtt_backoff(&state->rtt);
+            LOG_INFO("  Timeout, reintentando (RTO=%dms)...\n", rtt_timeout_ms(&state->rtt));
         } else {
-            printf("  Error en recepcion\n");
+            LOG_ERROR("  Error en recepcion\n");
             return -1;
         }
         
         retries++;
     }
     
-    printf("Fallo autenticacion despues de %d intentos\n", MAX_RETRIES);
+    LOG_ERROR("Fallo autenticacion despues de %d intentos\n", MAX_RETRIES);
     return -1;
 }
 
+// Payload del WRQ: filename\0 seguido de las opciones pedidas
+// Retorna el largo o -1 si las opciones no entran en max_len
+static int build_wrq(ClientState *state, uint8_t *payload, int max_len) {
+    int filename_len = strlen(state->filename) + 1; 
+    
+    memcpy(payload, state->filename, filename_len);
+    int payload_len = filename_len;
+    
+    if (state->window > 1) {
+        char value[16];
+        snprintf(value, sizeof(value), "%d", state->window);
+        payload_len = append_option(payload, payload_len, max_len, OPT_WINDOW, value);
+    }
+    
+    // Multi-stream: cantidad de streams y tamaño total del archivo
+    if (state->streams > 1) {
+        char value[24];
+        snprintf(value, sizeof(value), "%d", state->streams);
+        payload_len = append_option(payload, payload_len, max_len, OPT_STREAMS, value);
+        snprintf(value, sizeof(value), "%lld", (long long)state->file_size);
+        payload_len = append_option(payload, payload_len, max_len, OPT_TSIZE, value);
+    }
+    
+    if (state->blksize > 0) {
+        char value[16];
+        snprintf(value, sizeof(value), "%d", state->blksize);
+        payload_len = append_option(payload, payload_len, max_len, OPT_BLKSIZE, value);
+    }
+    
+    if (state->resume) {
+        payload_len = append_option(payload, payload_len, max_len, OPT_RESUME, "1");
+    }
+    
+    if (state->checksum) {
+        payload_len = append_option(payload, payload_len, max_len, OPT_CHECKSUM,
+                                    CHECKSUM_CRC32C);
+    }
+    
+    if (state->compress) {
+        payload_len = append_option(payload, payload_len, max_len, OPT_COMPRESS, COMPRESS_LZ);
+    }
+    
+    if (state->delta) {
+        payload_len = append_option(payload, payload_len, max_len, OPT_DELTA, "1");
+    }
+    
+    if (state->fec) {
+        char value[16];
+        snprintf(value, sizeof(value), "%d", state->fec);
+        payload_len = append_option(payload, payload_len, max_len, OPT_FEC, value);
+    }
+    
+    if (state->sack) {
+        payload_len = append_option(payload, payload_len, max_len, OPT_SACK, "1");
+    }
+    
+    // Ticket para el próximo 0-RTT: el guardado, o "1" para pedir uno
+    if (state->ticket_file && state->lane == 0) {
+        payload_len = append_option(payload, payload_len, max_len, OPT_TICKET,
+                                    state->ticket[0] ? state->ticket : "1");
+    }
+    
+    // 0-RTT: sin HELLO, la autenticación va en el WRQ
+    if (state->early) {
+        if (!state->ticket[0]) {
+            payload_len = append_option(payload, payload_len, max_len, OPT_AUTH,
+                                        state->credentials);
+        }
+        payload_len = append_option(payload, payload_len, max_len, OPT_EARLY, "1");
+    }
+    
+    return payload_len;
+}
+
+// Aplica las opciones que el servidor aceptó en el OACK
+// requested_blksize: el blksize pedido en el WRQ (0 = no se pidió)
+// Retorna 0 si OK, -1 si el OACK no es válido para lo pedido
+static int apply_oack(ClientState *state, const uint8_t *options, int options_len,
+                      int requested_blksize) {
+    const char *window_opt = find_option(options, options_len, OPT_WINDOW);
+    const char *blksize_opt = find_option(options, options_len, OPT_BLKSIZE);
+    const char *streams_opt = find_option(options, options_len, OPT_STREAMS);
+    const char *resume_opt = find_option(options, options_len, OPT_RESUME);
+    const char *crc_opt = find_option(options, options_len, OPT_PREFIX_CRC);
+    const char *checksum_opt = find_option(options, options_len, OPT_CHECKSUM);
+    const char *compress_opt = find_option(options, options_len, OPT_COMPRESS);
+    const char *delta_opt = find_option(options, options_len, OPT_DELTA);
+    const char *dblocks_opt = find_option(options, options_len, OPT_DBLOCKS);
+    const char *fec_opt = find_option(options, options_len, OPT_FEC);
+    const char *sack_opt = find_option(options, options_len, OPT_SACK);
+    const char *ticket_opt = find_option(options, options_len, OPT_TICKET);
+    int window = window_opt ? atoi(window_opt) : 1;
+    
+    if (window < 1 || window > state->window) {
+        LOG_ERROR("Ventana invalida en OACK (%d)\n", window);
+        return -1;
+    }
+    
+    // Los DATA con offset solo valen si el servidor aceptó los streams
+    if (state->streams > 1 &&
+        (window < 2 || !streams_opt || atoi(streams_opt) != state->streams)) {
+        LOG_ERROR("Multi-stream no aceptado en OACK\n");
+        return -1;
+    }
+    
+    // Sin la opción en el OACK los DATA van sin CRC / sin comprimir
+    state->window = window;
+    state->checksum = state->checksum && window > 1 && checksum_opt &&
+                      strcmp(checksum_opt, CHECKSUM_CRC32C) == 0;
+    state->compress = state->compress && window > 1 && compress_opt &&
+                      strcmp(compress_opt, COMPRESS_LZ) == 0;
+    
+    // Delta: solo si el servidor tiene una copia (y con checksum)
+    state->delta_block = delta_opt ? atoi(delta_opt) : 0;
+    state->delta_blocks = dblocks_opt ? (uint32_t)strtoul(dblocks_opt, NULL, 10) : 0;
+    state->delta = state->delta && state->checksum &&
+                   state->delta_block >= DELTA_MIN_BLOCK &&
+                   state->delta_block <= DELTA_MAX_BLOCK &&
+                   state->delta_blocks >= 1 && state->delta_blocks <= DELTA_MAX_BLOCKS;
+    
+    // FEC: el servidor puede achicar el grupo (nunca agrandarlo)
+    int fec = fec_opt ? atoi(fec_opt) : 0;
+    state->fec = window > 1 && fec >= FEC_MIN_K && fec <= state->fec ? fec : 0;
+    
+    // Sin la opción en el OACK el servidor reconoce cada DATA por separado
+    state->sack = state->sack && window > 1 && sack_opt && atoi(sack_opt) == 1;
+    
+    int blksize = blksize_opt ? atoi(blksize_opt) : plain_blksize(state);
+    
+    // Sin la opción pedida el servidor no puede devolver otro tamaño
+    int max_blksize = requested_blksize > 0 ? requested_blksize : plain_blksize(state);
+    if (blksize < MIN_BLKSIZE || blksize > max_blksize) {
+        LOG_ERROR("Blksize invalido en OACK (%d)\n", blksize);
+        return -1;
+    }
+    
+    // Prefijo que el servidor ya tiene de una subida anterior
+    if (state->resume && resume_opt && crc_opt) {
+        state->resume_offset = strtoull(resume_opt, NULL, 10);
+        state->resume_crc = (uint32_t)strtoul(crc_opt, NULL, 16);
+    }
+    
+    // Ticket nuevo para el próximo 0-RTT
+    if (state->ticket_file && ticket_opt && strlen(ticket_opt) == TICKET_HEX_LEN) {
+        strcpy(state->ticket, ticket_opt);
+        save_ticket(state);
+    }
+    
+    state->blksize = blksize;
+    state->next_seq = 0;
+    LOG_INFO("WRQ aceptado (window=%d, blksize=%d, checksum: %s, compresion: %s, delta: %s, fec: %d, sack: %s)\n",
+             state->window, state->blksize,
+             state->checksum ? CHECKSUM_CRC32C : "no",
+             state->compress ? COMPRESS_LZ : "no",
+             state->delta ? "si" : "no", state->fec, state->sack ? "si" : "no");
+    return 0;
+}
+
 // FASE 2: Parametrización (WRQ)
 int send_wrq(ClientState *state) {
     PDU pdu, ack;
     int retries = 0;
-    int filename_len = strlen(state->filename) + 1; 
+    uint8_t payload[MAX_FILENAME_LEN + 1 + MAX_OPTIONS_SIZE];
     
-    printf("\n=== FASE 2: PARAMETRIZACION (WRQ) ===\n");
+    LOG_INFO("\n=== FASE 2: PARAMETRIZACION (WRQ) ===\n");
+    
+    int requested_blksize = state->blksize;
+    int payload_len = build_wrq(state, payload, sizeof(payload));
+    if (payload_len < 0) {
+        LOG_ERROR("Opciones del WRQ demasiado largas\n");
+        return -1;
+    }
     
     // Construir WRQ PDU con seq_num = 1
-    build_pdu(&pdu, TYPE_WRQ, 1, state->filename, filename_len);
+    build_pdu(&pdu, LANE_TYPE(TYPE_WRQ, state->lane), 1, payload, payload_len);
     
     while (retries < MAX_RETRIES) {
-        printf("Enviando WRQ para '%s' (intento %d/%d)...\n", 
-               state->filename, retries + 1, MAX_RETRIES);
+        LOG_INFO("Enviando WRQ para '%s' (intento %d/%d)...\n", 
+                 state->filename, retries + 1, MAX_RETRIES);
         
         // Enviar WRQ
-        int sent = send_pdu(state->sockfd, &state->server_addr, &pdu, filename_len);
+        int sent = send_pdu(state->sockfd, &state->server_addr, &pdu, payload_len);
         if (sent < 0) {
             return -1;
         }
+        count_tx(state, 1, sent);
         
-        print_pdu(&pdu, filename_len, "  TX:");
+        print_pdu(&pdu, payload_len, "  TX:");
         
-        // Esperar ACK con timeout
+        // Esperar ACK con el RTO actual
         struct sockaddr_in from_addr;
-        int recv_len = recv_pdu_with_timeout(state->sockfd, &ack, 
-                                            &from_addr, TIMEOUT_MS);
+        uint64_t sent_us = now_us();
+        int recv_len = recv_from_server(state, &ack, &from_addr, rtt_timeout_ms(&state->rtt));
         
         if (recv_len > 0) {
             print_pdu(&ack, recv_len - 2, "  RX:");
@@ -140,21 +600,51 @@ int send_wrq(ClientState *state) {
             if (ack.type == TYPE_ACK && ack.seq_num == 1) {
                 // Verificar si hay mensaje de error
                 if (recv_len > 2) {
-                    printf("Error del servidor: %s\n", ack.data);
+                    LOG_ERROR("Error del servidor: %.*s\n", recv_len - 2, (const char*)ack.data);
                     return -1;
                 }
                 
-                printf("WRQ aceptado\n");
+                LOG_INFO("WRQ aceptado\n");
+                
+                if (retries == 0) {
+                    sample_rtt(state, now_us() - sent_us);
+                }
+                
+                // Servidor sin soporte de opciones: Stop & Wait con PDU original
+                if (state->streams > 1) {
+                    LOG_INFO("Servidor sin multi-stream\n");
+                    return -1;
+                }
+                if (state->window > 1) {
+                    LOG_INFO("Servidor sin modo ventana, usando Stop & Wait\n");
+                    state->window = 1;
+                }
+                state->checksum = 0;
+                state->compress = 0;
+                state->delta = 0;
+                state->fec = 0;
+                state->sack = 0;
+                state->blksize = default_blksize(1);
                 
                 // Preparar para fase DATA (empezará con seq_num = 0)
                 state->current_seq = 0;
                 
+                return 0;
+            } else if (ack.type == TYPE_OACK && ack.seq_num == 1) {
+                if (apply_oack(state, ack.data, recv_len - 2, requested_blksize) < 0) {
+                    return -1;
+                }
+                
+                if (retries == 0) {
+                    sample_rtt(state, now_us() - sent_us);
+                }
                 return 0;
             } else {
-                printf("  Respuesta incorrecta, ignorando...\n");
+                LOG_INFO("  Respuesta incorrecta, ignorando...\n");
             }
         } else if (recv_len == 0) {
-            printf("  Timeout, reintentando...\n");
+            rtt_backoff(&state->rtt);
+            LOG_INFO("  Timeout, reintentando (RTO=%dms)...\n", rtt_timeout_ms(&state->rtt));
         } else {
             return -1;
         }
@@ -162,212 +652,2308 @@ int send_wrq(ClientState *state) {
         retries++;
     }
     
-    printf("Fallo WRQ despues de %d intentos\n", MAX_RETRIES);
+    LOG_ERROR("Fallo WRQ despues de %d intentos\n", MAX_RETRIES);
     return -1;
 }
 
-// FASE 3: Transferencia de Datos (DATA)
-int send_file_data(ClientState *state, const char *filepath) {
-    FILE *file;
-    PDU pdu, ack;
-    uint8_t buffer[MAX_DATA_SIZE];
-    int bytes_read;
-    int chunk_num = 0;
-    int total_sent = 0;
-    
-    printf("\n=== FASE 3: TRANSFERENCIA DE DATOS ===\n");
-    
-    // Abrir archivo
-    file = fopen(filepath, "rb");
-    if (!file) {
-        perror("Error abriendo archivo");
+// Sondeo de MTU del camino (entre el OACK y el primer DATA)
+// Manda PROBE del tamaño de un DATA completo y, si no llega, baja por los
+// MTU típicos hasta encontrar uno que pase; el blksize queda en ese valor.
+// Las pérdidas acá se esperan (DF): no se toca el RTO.
+// Retorna 0 si OK, -1 si ningún tamaño llegó o hubo error
+int probe_path_mtu(ClientState *state) {
+    int header = data_header_size(state->window, state->streams, state->checksum) +
+                 fec_extra(state);
+    int candidate = state->blksize;
+    int plateau = 0;
+    int num_plateaus = sizeof(mtu_plateaus) / sizeof(mtu_plateaus[0]);
+    uint8_t hdr[2] = { LANE_TYPE(TYPE_PROBE, state->lane), 0 };
+    uint8_t *padding = calloc(1, header + candidate);
+    if (!padding) {
+        perror("Error reservando PROBE");
         return -1;
     }
     
-    // Obtener tamaño del archivo
-    long file_size = get_file_size(filepath);
-    printf("Tamanio del archivo: %ld bytes\n", file_size);
-    printf("Chunks estimados: %ld\n", (file_size + MAX_DATA_SIZE - 1) / MAX_DATA_SIZE);
+    LOG_INFO("\n=== SONDEO DE MTU (PROBE) ===\n");
     
-    // Leer y enviar el archivo por chunks
-    while ((bytes_read = fread(buffer, 1, MAX_DATA_SIZE, file)) > 0) {
-        int retries = 0;
-        int ack_received = 0;
-        
-        chunk_num++;
+    while (1) {
+        int datagram = header + candidate;
         
-        // Construir DATA PDU con seq_num alternado (0, 1, 0, 1, ...)
-        build_pdu(&pdu, TYPE_DATA, state->current_seq, buffer, bytes_read);
-        
-        printf("\nChunk #%d [%d bytes, seq=%d]\n", 
-               chunk_num, bytes_read, state->current_seq);
-        
-        while (retries < MAX_RETRIES && !ack_received) {
-            // Enviar DATA
-            int sent = send_pdu(state->sockfd, &state->server_addr, 
-                               &pdu, bytes_read);
+        for (int attempt = 0; attempt < PROBE_RETRIES; attempt++) {
+            LOG_INFO("Enviando PROBE de %d bytes (blksize=%d, intento %d/%d)...\n",
+                     datagram, candidate, attempt + 1, PROBE_RETRIES);
+            
+            int sent = send_pdu_iov(state->sockfd, &state->server_addr, hdr, sizeof(hdr),
+                                    padding, datagram - (int)sizeof(hdr));
             if (sent < 0) {
-                fclose(file);
+                // Más grande que el MTU de la interfaz: el kernel lo rechaza
+                if (errno == EMSGSIZE) {
+                    break;
+                }
+                free(padding);
                 return -1;
             }
+            count_tx(state, 1, sent);
             
-            if (retries == 0) {
-                printf("  TX: DATA seq=%d\n", state->current_seq);
-            } else {
-                printf("  TX: DATA seq=%d (retransmision %d)\n", 
-                       state->current_seq, retries);
-            }
-            
-            // Esperar ACK
-            struct sockaddr_in from_addr;
-            int recv_len = recv_pdu_with_timeout(state->sockfd, &ack, 
-                                                &from_addr, TIMEOUT_MS);
-            
-            if (recv_len > 0) {
-                // Verificar ACK correcto
-                if (ack.type == TYPE_ACK && ack.seq_num == state->current_seq) {
-                    printf("  RX: ACK seq=%d OK\n", ack.seq_num);
-                    ack_received = 1;
-                    total_sent += bytes_read;
-                    
-                    // Alternar seq_num: 0 -> 1, 1 -> 0
-                    state->current_seq = 1 - state->current_seq;
-                } else {
-                    printf("  RX: ACK incorrecto (esperaba seq=%d, recibio type=%d seq=%d), ignorando...\n",
-                           state->current_seq, ack.type, ack.seq_num);
+            // Esperar el eco; respuestas a PROBE anteriores se descartan
+            uint64_t deadline = now_ms() + rtt_timeout_ms(&state->rtt);
+            uint64_t now;
+            while ((now = now_ms()) < deadline) {
+                PDU reply;
+                struct sockaddr_in from_addr;
+                int recv_len = recv_from_server(state, &reply, &from_addr, (int)(deadline - now));
+                if (recv_len < 0) {
+                    free(padding);
+                    return -1;
+                }
+                if (recv_len >= 2 + EXT_SEQ_SIZE && reply.type == TYPE_PROBE &&
+                    pdu_get_seq32(&reply) == (uint32_t)datagram) {
+                    state->blksize = candidate;
+                    LOG_INFO("MTU del camino: %d bytes, blksize=%d\n",
+                             datagram + IP_UDP_HEADER_SIZE, state->blksize);
+                    free(padding);
+                    return 0;
                 }
-            } else if (recv_len == 0) {
-                printf("  Timeout esperando ACK...\n");
-            }
-            
-            if (!ack_received) {
-                retries++;
             }
+            LOG_INFO("  Sin respuesta\n");
         }
         
-        if (!ack_received) {
-            printf("Fallo envio del chunk #%d despues de %d intentos\n", 
-                   chunk_num, MAX_RETRIES);
-            fclose(file);
-            return -1;
+        // Siguiente MTU típico que deje un bloque menor al actual
+        while (plateau < num_plateaus &&
+               mtu_plateaus[plateau] - IP_UDP_HEADER_SIZE - header >= candidate) {
+            plateau++;
         }
-        
-        // Mostrar progreso
-        printf("  Progreso: %d / %ld bytes (%.1f%%)\n", 
-               total_sent, file_size, 
-               (total_sent * 100.0) / file_size);
+        if (plateau == num_plateaus) {
+            break;
+        }
+        candidate = mtu_plateaus[plateau] - IP_UDP_HEADER_SIZE - header;
     }
     
-    fclose(file);
-    printf("\nTransferencia completa: %d bytes en %d chunks\n", 
-           total_sent, chunk_num);
-    
-    return 0;
+    LOG_ERROR("Fallo sondeo de MTU: ningun PROBE llego al servidor\n");
+    free(padding);
+    return -1;
 }
 
-// FASE 4: Finalización (FIN)
-int send_fin(ClientState *state) {
-    PDU pdu, ack;
-    int retries = 0;
-    
-    printf("\n=== FASE 4: FINALIZACION (FIN) ===\n");
-    
-    // Construir FIN PDU con el seq_num actual
-    build_pdu(&pdu, TYPE_FIN, state->current_seq, NULL, 0);
-    
-    while (retries < MAX_RETRIES) {
-        printf("Enviando FIN con seq=%d (intento %d/%d)...\n", 
-               state->current_seq, retries + 1, MAX_RETRIES);
+// Chunk en vuelo del modo ventana
+// El payload no se copia: apunta al mapeo del archivo (o a buf en streaming)
+typedef struct {
+    uint8_t hdr[2 + EXT_SEQ_SIZE + EXT_OFFSET_SIZE + EXT_CRC_SIZE]; // Type + Flags + Seq (+ Offset) (+ Crc)
+    int hdr_len;                    // Largo del header según el modo
+    const uint8_t *data;            // Payload del chunk
+    uint8_t *buf;                   // Buffer propio (en streaming o con compresión)
+    int len;                        // Largo del payload (sin seq)
+    int raw_len;                    // Bytes de archivo que representa (> len si comprimido)
+    int acked;                      // 1 si ya fue reconocido
+    int lost;                       // 1 si se dio por perdido (espera retransmisión)
+    int dupacks;                    // ACKs de chunks enviados después de este
+    int retries;                    // Retransmisiones hechas
+    uint64_t sent_us;               // Instante del último envío
+    uint64_t deadline;              // Instante de retransmisión (ms)
+} TxSlot;
+
+// Arma el header de una PDU del modo ventana
+void build_ext_header(uint8_t *hdr, uint8_t type, uint32_t seq) {
+    uint32_t net_seq = htonl(seq);
+    hdr[0] = type;
+    hdr[1] = 0;
+    memcpy(hdr + 2, &net_seq, EXT_SEQ_SIZE);
+}
+
+// Envía (o reenvía) el chunk de un slot y arma su timer con el RTO actual
+int send_slot(ClientState *state, TxSlot *slot) {
+    int sent = send_pdu_iov(state->sockfd, &state->server_addr, 
+                            slot->hdr, slot->hdr_len, slot->data, slot->len);
+    if (sent > 0) {
+        count_tx(state, 1, sent);
+    }
+    slot->sent_us = now_us();
+    slot->deadline = slot->sent_us / 1000 + rtt_timeout_ms(&state->rtt);
+    return sent;
+}
+
+// Envía un grupo de chunks nuevos consecutivos
+// Con GSO van todos en un solo sendmsg (iovecs header/payload alternados)
+// y el kernel los separa en datagramas; si falla se desactiva GSO y se
+// envían de a uno. Todos salvo el último deben ser chunks completos.
+// Retorna 0 si OK, -1 si error
+int send_slots(ClientState *state, TxSlot **group, int count,
+               long *gso_sends, long *gso_segments) {
+    if (state->gso && count > 1) {
+        struct iovec iov[2 * GSO_MAX_SEGMENTS];
         
-        // Enviar FIN con payload vacío (data_len = 0)
-        int sent = send_pdu(state->sockfd, &state->server_addr, &pdu, 0);
-        if (sent < 0) {
-            return -1;
+        for (int i = 0; i < count; i++) {
+            iov[2 * i].iov_base = group[i]->hdr;
+            iov[2 * i].iov_len = group[i]->hdr_len;
+            iov[2 * i + 1].iov_base = (void*)group[i]->data;
+            iov[2 * i + 1].iov_len = group[i]->len;
         }
         
-        print_pdu(&pdu, 0, "  TX:");
-        
-        // Esperar ACK
-        struct sockaddr_in from_addr;
-        int recv_len = recv_pdu_with_timeout(state->sockfd, &ack, 
-                                            &from_addr, TIMEOUT_MS);
-        
-        if (recv_len > 0) {
-            print_pdu(&ack, recv_len - 2, "  RX:");
-            
-            // Verificar ACK con seq_num correcto
-            if (ack.type == TYPE_ACK && ack.seq_num == state->current_seq) {
-                printf("Sesion finalizada correctamente\n");
-                return 0;
-            } else {
-                printf("  Respuesta incorrecta, ignorando...\n");
+        int sent = send_gso(state->sockfd, &state->server_addr, iov, 2 * count,
+                            group[0]->hdr_len + state->blksize);
+        if (sent >= 0) {
+            uint64_t sent_us = now_us();
+            count_tx(state, count, sent);
+            for (int i = 0; i < count; i++) {
+                group[i]->sent_us = sent_us;
+                group[i]->deadline = sent_us / 1000 + rtt_timeout_ms(&state->rtt);
             }
-        } else if (recv_len == 0) {
-            printf("  Timeout, reintentando...\n");
+            (*gso_sends)++;
+            (*gso_segments) += count;
+            return 0;
         }
         
-        retries++;
+        perror("UDP_SEGMENT rechazado, desactivando GSO");
+        state->gso = 0;
     }
     
-    printf("Fallo finalizacion despues de %d intentos\n", MAX_RETRIES);
-    return -1;
+    for (int i = 0; i < count; i++) {
+        if (send_slot(state, group[i]) < 0) {
+            return -1;
+        }
+    }
+    return 0;
 }
 
-// Programa principal del cliente UDP
-int main(int argc, char *argv[]) {
-    ClientState state;
+// Compresión de los DATA (modo ventana con compress negociado)
+// Cada DATA lleva el mayor prefijo de lo pendiente que comprimido entra en
+// el blksize. Un chunk que no se achica va sin comprimir y los siguientes
+// intentos se saltean (el doble de chunks cada vez, hasta LZ_BACKOFF_MAX):
+// con datos ya comprimidos o aleatorios el costo es casi nulo.
+#define LZ_BACKOFF_MAX 64
+
+typedef struct {
+    uint8_t *scratch;               // Lectura anticipada en streaming (2 * LZ_MAX_BLOCK)
+    int skip;                       // Chunks a enviar sin intentar comprimir
+    int backoff;                    // Chunks a saltear tras el próximo intento fallido
+    long chunks;                    // DATA comprimidos
+    uint64_t raw_bytes;             // Bytes de archivo en esos DATA
+    uint64_t wire_bytes;            // Payload de esos DATA
+} LzStage;
+
+// Próximo chunk con compresión: en slot->data / retorno lo que viaja, en
+// slot->raw_len los bytes de archivo y en *raw esos bytes (válidos hasta
+// la próxima lectura)
+// Retorna el largo del payload, 0 en EOF o -1 si error
+static int next_lz_chunk(ClientState *state, FileSource *source, TxSlot *slot,
+                         LzStage *lz, const uint8_t **raw) {
+    int avail = source_peek(source, LZ_MAX_BLOCK, raw, lz->scratch, 2 * LZ_MAX_BLOCK);
+    if (avail <= 0) {
+        return avail;
+    }
     
-    // Verificar argumentos
-    if (argc != 5) {
-        printf("Uso: %s <server_ip> <credentials> <filepath> <filename>\n", argv[0]);
-        printf("Ejemplo: %s 127.0.0.1 g14-978e ./test_files/archivo_20kB testfile\n", argv[0]);
-        return 1;
+    int plain_len = avail < state->blksize ? avail : state->blksize;
+    if (lz->skip > 0) {
+        lz->skip--;
+    } else {
+        // Comprimido vale si lleva al menos lo mismo que sin comprimir en
+        // menos bytes (en un chunk completo: más archivo en el mismo DATA)
+        int consumed;
+        int packed = lz_compress(*raw, avail, slot->buf + LZ_RAW_LEN_SIZE,
+                                 state->blksize - LZ_RAW_LEN_SIZE, &consumed);
+        if (consumed >= plain_len && LZ_RAW_LEN_SIZE + packed < consumed) {
+            put_be32(slot->buf, consumed);
+            slot->data = slot->buf;
+            slot->raw_len = consumed;
+            lz->backoff = 1;
+            lz->chunks++;
+            lz->raw_bytes += consumed;
+            lz->wire_bytes += LZ_RAW_LEN_SIZE + packed;
+            source_skip(source, consumed);
+            return LZ_RAW_LEN_SIZE + packed;
+        }
+        lz->skip = lz->backoff;
+        if (lz->backoff < LZ_BACKOFF_MAX) {
+            lz->backoff *= 2;
+        }
     }
     
-    const char *server_ip = argv[1];
-    const char *credentials = argv[2];
-    const char *filepath = argv[3];   
-    const char *filename = argv[4];    
+    if (source_is_mapped(source)) {
+        slot->data = *raw;
+    } else {
+        memcpy(slot->buf, *raw, plain_len);
+        slot->data = slot->buf;
+    }
+    slot->raw_len = plain_len;
+    source_skip(source, plain_len);
+    return plain_len;
+}
+
+// Envía el FEC de un grupo de count DATA (paridad XOR, protocol.h)
+// No se reconoce ni se retransmite: solo cuenta para el pacing
+// Retorna los bytes enviados o -1 si error
+static int send_fec(ClientState *state, const FecGroup *fec, int count) {
+    uint8_t hdr[2 + EXT_SEQ_SIZE + EXT_CRC_SIZE + FEC_EXT_SIZE];
+    uint8_t *ext = hdr + 2 + EXT_SEQ_SIZE + (state->checksum ? EXT_CRC_SIZE : 0);
+    int hdr_len = ext + FEC_EXT_SIZE - hdr;
     
-    printf("========================================\n");
-    printf("  CLIENTE UDP FILE TRANSFER\n");
-    printf("========================================\n");
+    build_ext_header(hdr, LANE_TYPE(TYPE_FEC, state->lane), fec->first);
+    hdr[1] = fec->flags_xor;
+    ext[0] = (uint8_t)count;
+    ext[1] = fec->len_xor >> 8;
+    ext[2] = fec->len_xor & 0xff;
     
-    // Inicializar cliente
-    if (init_client(&state, server_ip, credentials, filename) < 0) {
-        return 1;
+    // Mismo CRC que un DATA: First y después Count, LenXor y el XOR
+    if (state->checksum) {
+        uint32_t fields_crc = crc32c_update(CRC32C_INIT, hdr + 2, EXT_SEQ_SIZE);
+        uint32_t crc = crc32c_update(CRC32C_INIT, ext, FEC_EXT_SIZE);
+        crc = crc32c_update(crc, fec->xor, fec->max_len);
+        hdr[1] |= DATA_FLAG_CRC;
+        put_be32(hdr + 2 + EXT_SEQ_SIZE,
+                 crc32c_combine(fields_crc, crc, FEC_EXT_SIZE + fec->max_len));
     }
     
-    // FASE 1: HELLO
-    if (send_hello(&state) < 0) {
-        close(state.sockfd);
-        return 1;
+    int sent = send_pdu_iov(state->sockfd, &state->server_addr, hdr, hdr_len,
+                            fec->xor, fec->max_len);
+    if (sent < 0) {
+        return -1;
     }
+    count_tx(state, 1, sent);
+    LOG_TRACE("  TX: FEC grupo %u (%d DATA, %d bytes)\n", fec->first, count, fec->max_len);
+    return sent;
+}
+
+// Chunks de [base, next) todavía sin ACK que reconoce un ACK con SACK: los
+// anteriores a cum y los marcados en el bitmap (bit i = cum + 1 + i). Un
+// ACK atrasado (cum antes de base) no puede traer nada nuevo y uno con cum
+// más allá de next es inválido: se ignoran.
+// Retorna cuántos dejó en acked (en orden de seq)
+static int sack_acked(uint32_t cum, const uint8_t *bitmap, int bitmap_len, uint32_t base,
+                      uint32_t next, const TxSlot *slots, int window, uint32_t *acked) {
+    int count = 0;
     
-    // FASE 2: WRQ
-    if (send_wrq(&state) < 0) {
-        close(state.sockfd);
-        return 1;
+    if (cum - base > next - base) {
+        return 0;
+    }
+    for (uint32_t seq = base; seq != cum; seq++) {
+        if (!slots[seq % window].acked) {
+            acked[count++] = seq;
+        }
+    }
+    for (int i = 0; i < bitmap_len * 8 && cum + 1 + i - base < next - base; i++) {
+        if ((bitmap[i / 8] & (1 << (i % 8))) && !slots[(cum + 1 + i) % window].acked) {
+            acked[count++] = cum + 1 + i;
+        }
+    }
+    return count;
+}
+
+// FASE 3 en modo ventana (Selective Repeat)
+// Mantiene hasta `window` chunks en vuelo, cada uno con su propio timer.
+// cwnd limita los bytes en vuelo y el pacing espacia las salidas de chunks
+// nuevos. Un chunk se da por perdido si vence su timer o si llegan
+// CC_DUPACK_THRESHOLD ACKs de chunks enviados después; los perdidos se
+// retransmiten antes que los nuevos, también dentro de cwnd. Con FEC, tras
+// cada grupo de chunks nuevos sale su paridad. Con state->early también
+// manda el WRQ (0-RTT).
+// Retorna 0 si OK, -1 si error; en 0-RTT 1 si el servidor no aceptó los
+// DATA tempranos (el OACK ya está aplicado) y 2 si rechazó el ticket
+int send_file_data_window(ClientState *state, FileSource *source, int64_t file_size) {
+    int window = state->window;
+    int hdr_len = data_header_size(window, state->streams, state->checksum);
+    CongestionControl *cc = &state->cc;
+    TxSlot *slots = calloc(window, sizeof(TxSlot));
+    uint8_t *stream_buf = NULL;
+    LzStage lz = { NULL, 0, 1, 0, 0, 0 };
+    char progress[64];
+    FecGroup fec = { 0 };               // Grupo FEC en armado
+    if (!slots) {
+        perror("Error reservando ventana");
+        return -1;
     }
     
-    // FASE 3: DATA
-    if (send_file_data(&state, filepath) < 0) {
-        close(state.sockfd);
-        return 1;
+    if (state->fec) {
+        fec.xor = calloc(1, state->blksize);
+        if (!fec.xor) {
+            perror("Error reservando paridad FEC");
+            free(slots);
+            return -1;
+        }
     }
     
-    // FASE 4: FIN
-    if (send_fin(&state) < 0) {
-        close(state.sockfd);
-        return 1;
+    // En streaming cada slot necesita su copia para poder retransmitir, y
+    // con compresión su bloque comprimido
+    if (!source_is_mapped(source) || state->compress) {
+        stream_buf = malloc((size_t)window * state->blksize);
+        if (!stream_buf) {
+            perror("Error reservando ventana");
+            free(fec.xor);
+            free(slots);
+            return -1;
+        }
+        for (int i = 0; i < window; i++) {
+            slots[i].buf = stream_buf + (size_t)i * state->blksize;
+        }
     }
     
-    // Cerrar socket
-    close(state.sockfd);
+    // Con compresión en streaming se lee por adelantado hasta un bloque
+    if (state->compress && !source_is_mapped(source)) {
+        lz.scratch = malloc(2 * LZ_MAX_BLOCK);
+        if (!lz.scratch) {
+            perror("Error reservando buffer de compresion");
+            free(fec.xor);
+            free(stream_buf);
+            free(slots);
+            return -1;
+        }
+    }
     
-    printf("\n========================================\n");
-    printf("  TRANSFERENCIA EXITOSA\n");
-    printf("========================================\n");
+    cc_init(cc, cc_name(cc), state->blksize, window, state->rtt.srtt_us);
     
-    return 0;
-}
\ No newline at end of file
+    uint32_t base = state->next_seq;    // Primer seq sin ACK
+    uint32_t next = state->next_seq;    // Próximo seq a enviar
+    long in_flight = 0;                 // Bytes enviados sin ACK ni dados por perdidos
+    uint64_t total_acked = 0;            // Bytes del archivo reconocidos
+    long total_retx = 0;
+    long gso_sends = 0;
+    long gso_segments = 0;
+    long fec_sent = 0;                  // FEC enviados
+    long fec_recovered = 0;             // Chunks que el servidor reconstruyó
+    long acks_received = 0;             // ACKs que reconocieron algún chunk
+    int eof = 0;
+    int result = -1;
+    uint64_t start_us = now_us();
+    
+    // 0-RTT: el WRQ sale primero y, hasta su OACK, a lo sumo EARLY_CHUNKS
+    // DATA con DATA_FLAG_EARLY. El WRQ se retransmite con su propio timer
+    PDU wrq;
+    int wrq_len = 0;
+    int wrq_retries = 0;
+    uint64_t wrq_sent_us = 0;
+    uint64_t wrq_deadline = 0;          // En ms
+    int requested_blksize = state->blksize;
+    int awaiting = state->early;        // 1 = todavía sin OACK
+    int limit = awaiting && window > EARLY_CHUNKS ? EARLY_CHUNKS : window;
+    if (awaiting) {
+        LOG_INFO("\n=== FASE 2: PARAMETRIZACION (WRQ 0-RTT) ===\n");
+        uint8_t payload[MAX_FILENAME_LEN + 1 + MAX_OPTIONS_SIZE];
+        wrq_len = build_wrq(state, payload, sizeof(payload));
+        if (wrq_len < 0) {
+            LOG_ERROR("Opciones del WRQ demasiado largas\n");
+            goto out;
+        }
+        build_pdu(&wrq, LANE_TYPE(TYPE_WRQ, state->lane), 1, payload, wrq_len);
+    }
+    
+    // Una ráfaga GSO no puede superar el datagrama UDP máximo
+    int gso_max = MAX_DATAGRAM_SIZE / (hdr_len + state->blksize);
+    if (gso_max > GSO_MAX_SEGMENTS) {
+        gso_max = GSO_MAX_SEGMENTS;
+    }
+    
+    LOG_INFO("Modo ventana: %d chunks de %d bytes en vuelo (control de congestion: %s)\n",
+             window, state->blksize, cc_name(cc));
+    fec.first = next;
+    
+    while (1) {
+        // WRQ del 0-RTT: primer envío o timer vencido
+        if (awaiting && wrq_deadline <= now_ms()) {
+            if (wrq_retries >= MAX_RETRIES) {
+                LOG_ERROR("Fallo WRQ despues de %d intentos\n", MAX_RETRIES);
+                goto out;
+            }
+            if (wrq_deadline != 0) {
+                wrq_retries++;
+                rtt_backoff(&state->rtt);
+                LOG_INFO("  Timeout del WRQ, reintentando (RTO=%dms)...\n",
+                         rtt_timeout_ms(&state->rtt));
+            }
+            LOG_INFO("Enviando WRQ para '%s' con hasta %d DATA (intento %d/%d)...\n",
+                     state->filename, limit, wrq_retries + 1, MAX_RETRIES);
+            int sent = send_pdu(state->sockfd, &state->server_addr, &wrq, wrq_len);
+            if (sent < 0) {
+                goto out;
+            }
+            count_tx(state, 1, sent);
+            print_pdu(&wrq, wrq_len, "  TX:");
+            wrq_sent_us = now_us();
+            wrq_deadline = now_ms() + rtt_timeout_ms(&state->rtt);
+        }
+        
+        
+        // Retransmitir los chunks perdidos que entren en cwnd (sin pacing)
+        for (uint32_t seq = base; seq != next; seq++) {
+            TxSlot *slot = &slots[seq % window];
+            if (slot->acked || !slot->lost) {
+                continue;
+            }
+            if (!cc_can_send(cc, in_flight, slot->len)) {
+                break;
+            }
+            
+            slot->retries++;
+            total_retx++;
+            metric_add(state->metrics, METRIC_RETRANSMITS, 1);
+            LOG_DEBUG("  TX: DATA seq=%u (retransmision %d)\n", seq, slot->retries);
+            if (send_slot(state, slot) < 0) {
+                goto out;
+            }
+            slot->lost = 0;
+            slot->dupacks = 0;
+            in_flight += slot->len;
+            cc_on_send(cc, slot->len, slot->sent_us);
+        }
+        
+        // Llenar la ventana con chunks nuevos mientras cwnd y el pacing lo
+        // permitan, en grupos de hasta gso_max si GSO está activo
+        while (!eof && next - base < (uint32_t)limit &&
+               cc_pacing_delay_us(cc, now_us()) == 0) {
+            TxSlot *group[GSO_MAX_SEGMENTS];
+            int group_len = 0;
+            long group_bytes = 0;
+            int max_group = state->gso ? gso_max : 1;
+            
+            while (group_len < max_group && next - base < (uint32_t)limit &&
+                   cc_can_send(cc, in_flight + group_bytes, state->blksize)) {
+                TxSlot *slot = &slots[next % window];
+                uint64_t offset = source->pos;
+                const uint8_t *raw;
+                int bytes_read = state->compress
+                    ? next_lz_chunk(state, source, slot, &lz, &raw)
+                    : source_next(source, state->blksize, &slot->data, slot->buf);
+                if (bytes_read < 0) {
+                    perror("Error leyendo archivo");
+                    goto out;
+                }
+                if (bytes_read == 0) {
+                    eof = 1;
+                    break;
+                }
+                
+                build_ext_header(slot->hdr, LANE_TYPE(TYPE_DATA, state->lane), next);
+                slot->hdr_len = hdr_len;
+                if (state->streams > 1) {
+                    slot->hdr[1] = DATA_FLAG_OFFSET;
+                    put_be64(slot->hdr + 2 + EXT_SEQ_SIZE, offset);
+                }
+                if (awaiting) {
+                    slot->hdr[1] |= DATA_FLAG_EARLY;
+                }
+                if (!state->compress) {
+                    slot->raw_len = bytes_read;
+                    raw = slot->data;
+                }
+                int compressed = slot->raw_len != bytes_read;
+                if (compressed) {
+                    slot->hdr[1] |= DATA_FLAG_LZ;
+                }
+                
+                // CRC de los campos del header y del payload: el del payload
+                // se calcula una sola vez y también suma al digest del FIN
+                // (comprimido, el digest es del archivo y no de lo que viaja)
+                if (state->checksum) {
+                    int fields_len = hdr_len - 2 - EXT_CRC_SIZE;
+                    uint32_t data_crc = crc32c_update(CRC32C_INIT, slot->data, bytes_read);
+                    uint32_t crc = crc32c_update(CRC32C_INIT, slot->hdr + 2, fields_len);
+                    slot->hdr[1] |= DATA_FLAG_CRC;
+                    put_be32(slot->hdr + 2 + fields_len,
+                             crc32c_combine(crc, data_crc, bytes_read));
+                    if (compressed) {
+                        data_crc = crc32c_update(CRC32C_INIT, raw, slot->raw_len);
+                    }
+                    state->digest = crc32c_combine(state->digest, data_crc, slot->raw_len);
+                }
+                
+                // FEC: el payload tal como viaja se suma a la paridad del grupo
+                if (state->fec) {
+                    fec_group_add(&fec, next - fec.first, slot->data, bytes_read,
+                                  slot->hdr[1] & DATA_FLAG_LZ);
+                }
+                slot->len = bytes_read;
+                slot->acked = 0;
+                slot->lost = 0;
+                slot->dupacks = 0;
+                slot->retries = 0;
+                group[group_len++] = slot;
+                group_bytes += bytes_read;
+                next++;
+                
+                // Un chunk incompleto solo puede ir al final de una ráfaga GSO
+                // (también uno comprimido, que rara vez llena el blksize), y
+                // el último de un grupo FEC también: después sale la paridad
+                if (bytes_read < state->blksize || (state->fec && next % state->fec == 0)) {
+                    break;
+                }
+            }
+            
+            if (group_len > 0) {
+                if (send_slots(state, group, group_len, &gso_sends, &gso_segments) < 0) {
+                    goto out;
+                }
+                in_flight += group_bytes;
+                cc_on_send(cc, group_bytes, group[0]->sent_us);
+            }
+            
+            // Paridad del grupo completo (o del último, al terminar el archivo)
+            if (state->fec && fec.members != 0 && (next % state->fec == 0 || eof)) {
+                int sent = send_fec(state, &fec, next - fec.first);
+                if (sent < 0) {
+                    goto out;
+                }
+                cc_on_send(cc, sent, now_us());
+                fec_sent++;
+                fec_group_reset(&fec, next);
+            }
+            
+            if (group_len == 0) {
+                break;                  // cwnd llena o fin del archivo
+            }
+        }
+        
+        // Todo enviado y reconocido (y el WRQ respondido)
+        if (eof && base == next && !awaiting) {
+            break;
+        }
+        
+        // Esperar hasta el timer más próximo o, si hay chunks nuevos
+        // esperando solo al pacing, hasta su salida
+        uint64_t now = now_us();
+        uint64_t earliest = UINT64_MAX;
+        for (uint32_t seq = base; seq != next; seq++) {
+            TxSlot *slot = &slots[seq % window];
+            if (!slot->acked && !slot->lost && slot->deadline * 1000 < earliest) {
+                earliest = slot->deadline * 1000;
+            }
+        }
+        if (awaiting && wrq_deadline * 1000 < earliest) {
+            earliest = wrq_deadline * 1000;
+        }
+        if (!eof && next - base < (uint32_t)limit &&
+            cc_can_send(cc, in_flight, state->blksize)) {
+            uint64_t paced = now + cc_pacing_delay_us(cc, now);
+            if (paced < earliest) {
+                earliest = paced;
+            }
+        }
+        int wait_ms = rtt_timeout_ms(&state->rtt);
+        if (earliest != UINT64_MAX) {
+            wait_ms = earliest > now ? (int)((earliest - now + 999) / 1000) : 0;
+        }
+        
+        PDU ack;
+        struct sockaddr_in from_addr;
+        int recv_len = recv_from_server(state, &ack, &from_addr, wait_ms);
+        
+        if (recv_len < 0) {
+            goto out;
+        }
+        
+        // Respuesta al WRQ del 0-RTT (sin FEC un ACK de DATA nunca tiene
+        // seq_num 1)
+        if (awaiting && recv_len >= 2 && ack.seq_num == 1 &&
+            (ack.type == TYPE_OACK || ack.type == TYPE_ACK)) {
+            print_pdu(&ack, recv_len - 2, "  RX:");
+            if (ack.type == TYPE_ACK) {
+                // Rechazado: con ticket se reintenta con HELLO
+                LOG_ERROR("Error del servidor: %.*s\n", recv_len - 2, (const char*)ack.data);
+                result = state->ticket[0] ? 2 : -1;
+                goto out;
+            }
+            if (apply_oack(state, ack.data, recv_len - 2, requested_blksize) < 0) {
+                goto out;
+            }
+            if (wrq_retries == 0) {
+                sample_rtt(state, now_us() - wrq_sent_us);
+            }
+            if (!find_option(ack.data, recv_len - 2, OPT_EARLY)) {
+                LOG_INFO("0-RTT no aceptado: los DATA se envian de nuevo\n");
+                result = 1;
+                goto out;
+            }
+            LOG_INFO("0-RTT aceptado (%u DATA enviados antes del OACK)\n", next);
+            awaiting = 0;
+            limit = state->window;
+            continue;
+        }
+        
+        if (recv_len >= 2 + EXT_SEQ_SIZE && ack.type == TYPE_ACK) {
+            uint32_t seq = pdu_get_seq32(&ack);
+            uint32_t acked[WINDOW_MAX];
+            int count = 0;
+            
+            // Chunks que el ACK reconoce por primera vez: con SACK todos los
+            // que describe, si no el suyo (si está dentro de la ventana)
+            if (ack.seq_num & ACK_FLAG_SACK) {
+                count = sack_acked(seq, ack.data + EXT_SEQ_SIZE, recv_len - 2 - EXT_SEQ_SIZE,
+                                   base, next, slots, window, acked);
+            } else if (seq - base < next - base && !slots[seq % window].acked) {
+                acked[count++] = seq;
+            }
+            
+            if (count > 0) {
+                TxSlot *newest = NULL;          // Último enviado sin retransmitir
+                long acked_bytes = 0;
+                uint64_t rtt_us = 0;
+                
+                acks_received++;
+                for (int i = 0; i < count; i++) {
+                    TxSlot *slot = &slots[acked[i] % window];
+                    slot->acked = 1;
+                    total_acked += slot->raw_len;
+                    acked_bytes += slot->len;
+                    metric_add(state->metrics, METRIC_DATA_BYTES, slot->raw_len);
+                    if (!slot->lost) {
+                        in_flight -= slot->len;
+                    }
+                    if (slot->retries == 0 && (!newest || slot->sent_us > newest->sent_us)) {
+                        newest = slot;
+                    }
+                }
+                if (count > 1) {
+                    metric_add(state->metrics, METRIC_ACKS_COALESCED, count - 1);
+                }
+                
+                // Reconstruido por el servidor con el FEC del grupo: el ACK
+                // salió al llegar la paridad o el último DATA, no es muestra
+                // de RTT. Si no, muestra del último chunk enviado entre los
+                // reconocidos que no fueron retransmitidos (Karn)
+                if (ack.seq_num & ACK_FLAG_FEC) {
+                    fec_recovered++;
+                    metric_add(state->metrics, METRIC_FEC_RECOVERED, 1);
+                } else if (newest) {
+                    rtt_us = now_us() - newest->sent_us;
+                    sample_rtt(state, rtt_us);
+                }
+                
+                // Chunks anteriores enviados antes que uno reconocido y
+                // todavía sin ACK: con CC_DUPACK_THRESHOLD reconocidos así se
+                // dan por perdidos (con SACK, exactamente los huecos). Con FEC
+                // solo cuentan los de grupos posteriores: los del mismo grupo
+                // llegan antes que su paridad y el servidor todavía puede
+                // reconstruirlo
+                for (int i = 0; i < count; i++) {
+                    TxSlot *slot = &slots[acked[i] % window];
+                    for (uint32_t prev = base; prev != acked[i]; prev++) {
+                        TxSlot *older = &slots[prev % window];
+                        if (older->acked || older->lost || older->sent_us >= slot->sent_us ||
+                            (state->fec && prev / state->fec == acked[i] / state->fec)) {
+                            continue;
+                        }
+                        if (++older->dupacks >= CC_DUPACK_THRESHOLD) {
+                            older->lost = 1;
+                            in_flight -= older->len;
+                            cc_on_loss(cc, prev, next);
+                        }
+                    }
+                }
+                
+                // Deslizar la ventana
+                uint32_t old_base = base;
+                while (base != next && slots[base % window].acked) {
+                    base++;
+                }
+                
+                cc_on_ack(cc, acked_bytes, rtt_us, state->rtt.srtt_us, base);
+                
+                if (base / window != old_base / window || (eof && base == next)) {
+                    LOG_INFO("  Progreso: %s [base=%u, en vuelo=%u, RTT=%.2fms, RTO=%dms, cwnd=%.0f kB, pacing=%.1f Mbit/s]\n",
+                             format_progress(progress, sizeof(progress), total_acked, file_size),
+                             base, next - base,
+                             state->rtt.srtt_us / 1000.0, rtt_timeout_ms(&state->rtt),
+                             cc->cwnd / 1024, cc->pacing_rate * 8 / 1e6);
+                }
+            }
+        }
+        
+        // Chunks con timer vencido: se dan por perdidos y se retransmiten
+        // en la próxima vuelta. El RTO se duplica (y cwnd vuelve a 1 MSS)
+        // una vez por ronda de timeouts, no por chunk
+        uint64_t now_msec = now_ms();
+        int backed_off = 0;
+        for (uint32_t seq = base; seq != next; seq++) {
+            TxSlot *slot = &slots[seq % window];
+            if (slot->acked || slot->lost || slot->deadline > now_msec) {
+                continue;
+            }
+            
+            if (slot->retries >= MAX_RETRIES) {
+                LOG_ERROR("Fallo envio del chunk seq=%u despues de %d intentos\n", 
+                          seq, MAX_RETRIES);
+                goto out;
+            }
+            
+            if (!backed_off) {
+                rtt_backoff(&state->rtt);
+                cc_on_timeout(cc, in_flight, next);
+                metric_add(state->metrics, METRIC_TIMEOUTS, 1);
+                backed_off = 1;
+            }
+            
+            slot->lost = 1;
+            in_flight -= slot->len;
+        }
+    }
+    
+    state->next_seq = next;
+    state->file_length = state->resume_offset + total_acked;
+    LOG_INFO("\nTransferencia completa: %llu bytes en %u chunks (%ld retransmisiones, %llu kB/s)\n", 
+             (unsigned long long)total_acked, next, total_retx,
+             (unsigned long long)observe_goodput(state, total_acked, start_us));
+    LOG_INFO("RTT suavizado: %.2fms, RTTVAR: %.2fms, RTO final: %dms\n",
+             state->rtt.srtt_us / 1000.0, state->rtt.rttvar_us / 1000.0,
+             rtt_timeout_ms(&state->rtt));
+    if (cc->ops) {
+        LOG_INFO("Congestion (%s): cwnd final %.0f kB, maxima %.0f kB, pacing %.1f Mbit/s\n",
+                 cc_name(cc), cc->cwnd / 1024, cc->max_cwnd / 1024, cc->pacing_rate * 8 / 1e6);
+    }
+    LOG_INFO("Perdidas: %ld por ACKs posteriores, %ld rondas de timeout, %ld reducciones de cwnd\n",
+             cc->losses, cc->timeouts, cc->recoveries);
+    if (gso_sends > 0) {
+        LOG_INFO("GSO: %ld chunks en %ld rafagas (%.1f chunks por sendmsg)\n",
+                 gso_segments, gso_sends, (double)gso_segments / gso_sends);
+    }
+    if (state->compress) {
+        LOG_INFO("Compresion: %ld chunks comprimidos, %llu -> %llu bytes (%.1f%%)\n",
+                 lz.chunks, (unsigned long long)lz.raw_bytes,
+                 (unsigned long long)lz.wire_bytes,
+                 lz.raw_bytes > 0 ? lz.wire_bytes * 100.0 / lz.raw_bytes : 100.0);
+    }
+    if (acks_received > 0) {
+        LOG_INFO("ACKs: %ld para %u chunks (%.1f chunks por ACK%s)\n", acks_received,
+                 next, (double)next / acks_received, state->sack ? ", acumulativos con SACK" : "");
+    }
+    if (state->fec) {
+        LOG_INFO("FEC: %ld grupos de hasta %d chunks, %ld chunks reconstruidos por el servidor, "
+                 "%ld retransmitidos\n", fec_sent, state->fec, fec_recovered, total_retx);
+    }
+    result = 0;
+
+out:
+    free(fec.xor);
+    free(lz.scratch);
+    free(stream_buf);
+    free(slots);
+    return result;
+}
+
+// FASE 3: Transferencia de Datos (DATA)
+// source: archivo ya abierto (o el rango de un stream) de file_size bytes
+// (-1 si no se conoce); el llamador lo cierra
+int send_file_data(ClientState *state, FileSource *source, int64_t file_size) {
+    PDU ack;
+    uint8_t header[2];
+    uint8_t *buffer;
+    const uint8_t *chunk;
+    char progress[64];
+    int bytes_read;
+    uint64_t chunk_num = 0;
+    uint64_t total_sent = 0;
+    uint64_t start_us = now_us();
+    
+    LOG_INFO("\n=== FASE 3: TRANSFERENCIA DE DATOS ===\n");
+    
+    if (file_size >= 0) {
+        uint64_t chunks = ((uint64_t)file_size + state->blksize - 1) / state->blksize;
+        LOG_INFO("Tamanio del archivo: %lld bytes (%s), %llu chunks\n", (long long)file_size,
+                 source_is_mapped(source) ? "mmap" : "streaming", (unsigned long long)chunks);
+        
+        // El seq extendido es de 32 bits: con el blksize negociado el
+        // archivo no puede tener más chunks
+        if (state->window > 1 && chunks > UINT32_MAX) {
+            LOG_ERROR("Archivo demasiado grande para blksize %d (max %llu bytes)\n",
+                      state->blksize, (unsigned long long)UINT32_MAX * state->blksize);
+            return -1;
+        }
+    } else {
+        LOG_INFO("Tamanio del archivo: desconocido (streaming)\n");
+    }
+    
+    if (state->window > 1) {
+        return send_file_data_window(state, source, file_size);
+    }
+    
+    // Copia del chunk actual (solo se usa en streaming)
+    buffer = malloc(state->blksize);
+    if (!buffer) {
+        perror("Error reservando buffer");
+        return -1;
+    }
+    
+    // Leer y enviar el archivo por chunks
+    while ((bytes_read = source_next(source, state->blksize, &chunk, buffer)) > 0) {
+        int retries = 0;
+        int ack_received = 0;
+        
+        chunk_num++;
+        
+        // Header DATA con seq_num alternado (0, 1, 0, 1, ...); el payload
+        // se envía desde el mapeo sin copiarlo
+        header[0] = LANE_TYPE(TYPE_DATA, state->lane);
+        header[1] = state->current_seq;
+        
+        LOG_TRACE("\nChunk #%llu [%d bytes, seq=%d]\n", 
+                  (unsigned long long)chunk_num, bytes_read, state->current_seq);
+        
+        while (retries < MAX_RETRIES && !ack_received) {
+            // Enviar DATA
+            int sent = send_pdu_iov(state->sockfd, &state->server_addr, 
+                                    header, sizeof(header), chunk, bytes_read);
+            if (sent < 0) {
+                free(buffer);
+                return -1;
+            }
+            count_tx(state, 1, sent);
+            
+            if (retries == 0) {
+                LOG_TRACE("  TX: DATA seq=%d\n", state->current_seq);
+            } else {
+                LOG_DEBUG("  TX: DATA seq=%d (retransmision %d)\n", 
+                          state->current_seq, retries);
+                metric_add(state->metrics, METRIC_RETRANSMITS, 1);
+            }
+            
+            // Esperar ACK con el RTO actual
+            struct sockaddr_in from_addr;
+            uint64_t sent_us = now_us();
+            int recv_len = recv_from_server(state, &ack, &from_addr,
+                                            rtt_timeout_ms(&state->rtt));
+            
+            if (recv_len > 0) {
+                // Verificar ACK correcto
+                if (ack.type == TYPE_ACK && ack.seq_num == state->current_seq) {
+                    LOG_TRACE("  RX: ACK seq=%d OK\n", ack.seq_num);
+                    if (retries == 0) {
+                        sample_rtt(state, now_us() - sent_us);
+                    }
+                    ack_received = 1;
+                    total_sent += bytes_read;
+                    metric_add(state->metrics, METRIC_DATA_BYTES, bytes_read);
+                    
+                    // Alternar seq_num: 0 -> 1, 1 -> 0
+                    state->current_seq = 1 - state->current_seq;
+                } else {
+                    LOG_DEBUG("  RX: ACK incorrecto (esperaba seq=%d, recibio type=%d seq=%d), ignorando...\n",
+                              state->current_seq, ack.type, ack.seq_num);
+                }
+            } else if (recv_len == 0) {
+                rtt_backoff(&state->rtt);
+                metric_add(state->metrics, METRIC_TIMEOUTS, 1);
+                LOG_DEBUG("  Timeout esperando ACK (RTO=%dms)...\n", rtt_timeout_ms(&state->rtt));
+            }
+            
+            if (!ack_received) {
+                retries++;
+            }
+        }
+        
+        if (!ack_received) {
+            LOG_ERROR("Fallo envio del chunk #%llu despues de %d intentos\n", 
+                      (unsigned long long)chunk_num, MAX_RETRIES);
+            free(buffer);
+            return -1;
+        }
+        
+        // Mostrar progreso
+        LOG_DEBUG("  Progreso: %s [RTT=%.2fms, RTO=%dms]\n",
+                  format_progress(progress, sizeof(progress), total_sent, file_size),
+                  state->rtt.srtt_us / 1000.0, rtt_timeout_ms(&state->rtt));
+    }
+    
+    free(buffer);
+    
+    if (bytes_read < 0) {
+        perror("Error leyendo archivo");
+        return -1;
+    }
+    
+    state->file_length = state->resume_offset + total_sent;
+    LOG_INFO("\nTransferencia completa: %llu bytes en %llu chunks (%llu kB/s)\n", 
+             (unsigned long long)total_sent, (unsigned long long)chunk_num,
+             (unsigned long long)observe_goodput(state, total_sent, start_us));
+    
+    return 0;
+}
+
+// FASE 4: Finalización (FIN)
+int send_fin(ClientState *state) {
+    PDU pdu, ack;
+    int retries = 0;
+    
+    LOG_INFO("\n=== FASE 4: FINALIZACION (FIN) ===\n");
+    
+    // Construir FIN PDU con el seq_num actual
+    // En modo ventana lleva el total de chunks como seq extendido (y el
+    // digest de lo enviado con checksum); tras una subida, el largo final
+    // del archivo para que el servidor lo verifique
+    int fin_len = 0;
+    build_pdu(&pdu, LANE_TYPE(TYPE_FIN, state->lane), state->current_seq, NULL, 0);
+    if (state->window > 1) {
+        pdu_set_seq32(&pdu, state->next_seq);
+        fin_len = EXT_SEQ_SIZE;
+    }
+    if (state->checksum) {
+        put_be32(pdu.data + EXT_SEQ_SIZE, state->digest);
+        fin_len += EXT_CRC_SIZE;
+        LOG_INFO("Digest CRC32C: %08x\n", state->digest);
+    }
+    if (state->file_length >= 0) {
+        put_be64(pdu.data + fin_len, (uint64_t)state->file_length);
+        fin_len += EXT_LENGTH_SIZE;
+        LOG_INFO("Largo del archivo: %lld bytes\n", (long long)state->file_length);
+    }
+    
+    while (retries < MAX_RETRIES) {
+        LOG_INFO("Enviando FIN con seq=%d (intento %d/%d)...\n", 
+                 state->window > 1 ? (int)state->next_seq : state->current_seq,
+                 retries + 1, MAX_RETRIES);
+        
+        // Enviar FIN (payload vacío en Stop & Wait)
+        int sent = send_pdu(state->sockfd, &state->server_addr, &pdu, fin_len);
+        if (sent < 0) {
+            return -1;
+        }
+        count_tx(state, 1, sent);
+        
+        print_pdu(&pdu, fin_len, "  TX:");
+        
+        // Esperar ACK con el RTO actual
+        struct sockaddr_in from_addr;
+        uint64_t sent_us = now_us();
+        int recv_len = recv_from_server(state, &ack, &from_addr, rtt_timeout_ms(&state->rtt));
+        
+        if (recv_len > 0) {
+            print_pdu(&ack, recv_len - 2, "  RX:");
+            
+            // Verificar ACK con seq_num correcto (un SACK atrasado de los
+            // DATA puede tener el mismo seq: no reconoce el FIN)
+            int fin_acked;
+            if (state->window > 1) {
+                fin_acked = ack.type == TYPE_ACK && recv_len >= 2 + EXT_SEQ_SIZE &&
+                            pdu_get_seq32(&ack) == state->next_seq &&
+                            !(ack.seq_num & ACK_FLAG_SACK);
+            } else {
+                fin_acked = ack.type == TYPE_ACK && ack.seq_num == state->current_seq;
+            }
+            
+            // Con mensaje (después del seq en modo ventana): el servidor
+            // rechazó el archivo
+            int ack_header = state->window > 1 ? EXT_SEQ_SIZE : 0;
+            if (fin_acked && recv_len > 2 + ack_header) {
+                LOG_ERROR("Error del servidor: %.*s\n", recv_len - 2 - ack_header,
+                          (const char*)ack.data + ack_header);
+                return -1;
+            }
+            
+            if (fin_acked) {
+                if (retries == 0) {
+                    sample_rtt(state, now_us() - sent_us);
+                }
+                
+                LOG_INFO("Sesion finalizada correctamente\n");
+                return 0;
+            } else {
+                LOG_INFO("  Respuesta incorrecta, ignorando...\n");
+            }
+        } else if (recv_len == 0) {
+            rtt_backoff(&state->rtt);
+            LOG_INFO("  Timeout, reintentando (RTO=%dms)...\n", rtt_timeout_ms(&state->rtt));
+        }
+        
+        retries++;
+    }
+    
+    LOG_ERROR("Fallo finalizacion despues de %d intentos\n", MAX_RETRIES);
+    return -1;
+}
+
+// CRC32C de los primeros length bytes del archivo
+// Retorna 0 si OK, -1 si error de lectura o el archivo es más corto
+static int prefix_crc(FileSource *source, uint64_t length, uint32_t *crc) {
+    *crc = CRC32C_INIT;
+    if (source_is_mapped(source)) {
+        *crc = crc32c_update(*crc, source->map, length);
+        return 0;
+    }
+    
+    uint8_t buf[64 * 1024];
+    uint64_t offset = 0;
+    while (offset < length) {
+        size_t want = length - offset < sizeof(buf) ? length - offset : sizeof(buf);
+        ssize_t got = pread(source->fd, buf, want, (off_t)offset);
+        if (got < 0 && errno == EINTR) {
+            continue;
+        }
+        if (got <= 0) {
+            return -1;
+        }
+        *crc = crc32c_update(*crc, buf, got);
+        offset += got;
+    }
+    return 0;
+}
+
+// Retoma la subida desde donde la dejó el servidor si su prefijo coincide
+// con el archivo local: la fuente salta al offset y quedan por enviar
+// length - offset bytes
+// Retorna 0 si OK (o no hay nada que retomar), 1 si el prefijo no coincide
+static int resume_upload(ClientState *state, FileSource *source, int64_t *length) {
+    uint64_t offset = state->resume_offset;
+    uint32_t crc;
+    
+    if (offset == 0) {
+        return 0;
+    }
+    
+    if (*length < 0 || offset > (uint64_t)*length || prefix_crc(source, offset, &crc) < 0 ||
+        crc != state->resume_crc) {
+        LOG_INFO("El servidor tiene %llu bytes (CRC32C %08x) que no coinciden con el archivo local\n",
+                 (unsigned long long)offset, state->resume_crc);
+        return 1;
+    }
+    
+    if (source_seek(source, offset) < 0) {
+        perror("Error posicionando archivo");
+        return 1;
+    }
+    
+    LOG_INFO("Retomando subida desde el byte %llu (prefijo verificado, CRC32C %08x)\n",
+             (unsigned long long)offset, crc);
+    *length -= (int64_t)offset;
+    state->digest = crc;
+    return 0;
+}
+
+// Página de firmas pedida al servidor
+typedef struct {
+    uint64_t sent_us;               // Último pedido
+    uint64_t deadline;              // Instante de reenvío (ms)
+    int tries;                      // Pedidos enviados
+    int done;                       // 1 si ya llegó
+} SigPage;
+
+// Pide (o vuelve a pedir) una página de firmas y arma su timer
+static int send_sig_request(ClientState *state, uint32_t page, SigPage *sig_page) {
+    uint8_t hdr[2 + EXT_SEQ_SIZE];
+    build_ext_header(hdr, LANE_TYPE(TYPE_SIG, state->lane), page);
+    
+    int sent = send_pdu_iov(state->sockfd, &state->server_addr, hdr, sizeof(hdr), NULL, 0);
+    if (sent < 0) {
+        return -1;
+    }
+    count_tx(state, 1, sent);
+    sig_page->sent_us = now_us();
+    sig_page->deadline = sig_page->sent_us / 1000 + rtt_timeout_ms(&state->rtt);
+    sig_page->tries++;
+    return 0;
+}
+
+// Firmas de la copia del servidor (antes del primer DATA)
+// Hasta `window` páginas pedidas a la vez, cada una con su timer; el RTO
+// se duplica una vez por ronda de vencidos, como con los DATA
+// Retorna 0 si OK, -1 si error
+static int fetch_signatures(ClientState *state, DeltaSig *sigs) {
+    uint32_t blocks = state->delta_blocks;
+    uint32_t pages = (blocks + DELTA_SIGS_PER_PAGE - 1) / DELTA_SIGS_PER_PAGE;
+    SigPage *page = calloc(pages, sizeof(SigPage));
+    uint32_t base = 0;                  // Primera página sin recibir
+    uint32_t next = 0;                  // Próxima página a pedir
+    int result = -1;
+    
+    if (!page) {
+        perror("Error reservando firmas");
+        return -1;
+    }
+    
+    LOG_INFO("Pidiendo firmas de %u bloques de %d bytes (%u paginas)\n",
+             blocks, state->delta_block, pages);
+    
+    while (base < pages) {
+        // Reenviar las vencidas y pedir nuevas hasta llenar la ventana
+        uint64_t now = now_ms();
+        int backed_off = 0;
+        for (uint32_t p = base; p < next; p++) {
+            if (page[p].done || page[p].deadline > now) {
+                continue;
+            }
+            if (page[p].tries >= MAX_RETRIES) {
+                LOG_ERROR("Fallo pidiendo firmas (pagina %u) despues de %d intentos\n",
+                          p, MAX_RETRIES);
+                goto out;
+            }
+            if (!backed_off) {
+                rtt_backoff(&state->rtt);
+                backed_off = 1;
+            }
+            if (send_sig_request(state, p, &page[p]) < 0) {
+                goto out;
+            }
+        }
+        while (next < pages && next - base < (uint32_t)state->window) {
+            if (send_sig_request(state, next, &page[next]) < 0) {
+                goto out;
+            }
+            next++;
+        }
+        
+        // Esperar hasta el timer más próximo
+        uint64_t earliest = UINT64_MAX;
+        for (uint32_t p = base; p < next; p++) {
+            if (!page[p].done && page[p].deadline < earliest) {
+                earliest = page[p].deadline;
+            }
+        }
+        now = now_ms();
+        int wait_ms = earliest > now ? (int)(earliest - now) : 0;
+        
+        PDU reply;
+        struct sockaddr_in from_addr;
+        int recv_len = recv_from_server(state, &reply, &from_addr, wait_ms);
+        if (recv_len < 0) {
+            goto out;
+        }
+        if (recv_len < 2 + EXT_SEQ_SIZE || reply.type != TYPE_SIG) {
+            continue;
+        }
+        
+        uint32_t p = pdu_get_seq32(&reply);
+        if (p < base || p >= next || page[p].done) {
+            continue;
+        }
+        uint32_t first = p * DELTA_SIGS_PER_PAGE;
+        int count = blocks - first < DELTA_SIGS_PER_PAGE ? (int)(blocks - first)
+                                                         : DELTA_SIGS_PER_PAGE;
+        if (recv_len != 2 + EXT_SEQ_SIZE + count * DELTA_SIG_SIZE) {
+            continue;
+        }
+        
+        // Muestra de RTT solo de páginas pedidas una vez (Karn)
+        if (page[p].tries == 1) {
+            sample_rtt(state, now_us() - page[p].sent_us);
+        }
+        
+        const uint8_t *entry = reply.data + EXT_SEQ_SIZE;
+        for (int i = 0; i < count; i++) {
+            sigs[first + i].weak = get_be32(entry);
+            sigs[first + i].strong = get_be64(entry + 4);
+            entry += DELTA_SIG_SIZE;
+        }
+        page[p].done = 1;
+        while (base < next && page[base].done) {
+            base++;
+        }
+    }
+    result = 0;
+
+out:
+    free(page);
+    return result;
+}
+
+// FASE 3 con delta: en vez del archivo se envía el stream de instrucciones
+// contra la copia del servidor (delta.h), generado a medida que se envía.
+// El FIN lleva el digest del archivo y no el del stream.
+static int send_file_delta(ClientState *state, FileSource *source) {
+    DeltaSig *sigs = malloc((size_t)state->delta_blocks * sizeof(DeltaSig));
+    DeltaEncoder enc;
+    FileSource stream;
+    uint64_t start_us = now_us();
+    
+    if (!sigs) {
+        perror("Error reservando firmas");
+        return -1;
+    }
+    if (fetch_signatures(state, sigs) < 0) {
+        free(sigs);
+        return -1;
+    }
+    LOG_INFO("Firmas recibidas en %.1f ms\n", (now_us() - start_us) / 1000.0);
+    
+    if (delta_encoder_init(&enc, sigs, state->delta_blocks, state->delta_block,
+                           source->fd, source->map, (uint64_t)source->size) < 0) {
+        perror("Error preparando delta");
+        free(sigs);
+        return -1;
+    }
+    source_reader(&stream, delta_encoder_read, &enc);
+    
+    int result = send_file_data(state, &stream, -1);
+    if (result == 0) {
+        state->digest = enc.crc;
+        state->file_length = (uint64_t)source->size;
+        LOG_INFO("Delta: %lld bytes del archivo, %llu copiados de la copia del servidor, "
+                 "%llu literales (%llu bytes enviados, %.1f%%)\n",
+                 (long long)source->size, (unsigned long long)enc.copied_bytes,
+                 (unsigned long long)enc.literal_bytes, (unsigned long long)stream.pos,
+                 source->size > 0 ? stream.pos * 100.0 / source->size : 100.0);
+    }
+    
+    delta_encoder_free(&enc);
+    free(sigs);
+    return result;
+}
+
+// Subida de un archivo en una sesión ya autenticada: WRQ, sondeo, DATA y
+// FIN (probe = 0 omite el sondeo de MTU: el lane ya lo hizo con otro archivo)
+// Con 0-RTT el WRQ sale junto con los primeros DATA, sin sondeo
+// Retorna 0 si OK, 1 si el archivo parcial del servidor no coincide con
+// el local (no se envió ningún DATA), -1 si error
+static int run_upload(ClientState *state, FileSource *source, int64_t length, int probe) {
+    if (state->early) {
+        // FASES 2 y 3 juntas
+        int early = send_file_data_window(state, source, length);
+        if (early < 0) {
+            return -1;
+        }
+        if (early == 0) {
+            return send_fin(state);
+        }
+        
+        // Los DATA tempranos no valieron: el archivo va de nuevo desde el
+        // principio con lo negociado (o tras autenticarse con HELLO)
+        state->early = 0;
+        state->digest = CRC32C_INIT;
+        state->next_seq = 0;
+        if (source_seek(source, 0) < 0) {
+            return -1;
+        }
+        if (early == 2) {
+            state->ticket[0] = '\0';
+            if (send_hello(state) < 0 || send_wrq(state) < 0) {
+                return -1;
+            }
+        }
+    } else if (send_wrq(state) < 0) {
+        // FASE 2: WRQ
+        return -1;
+    }
+    
+    // Subida anterior: verificar el prefijo del servidor
+    if (resume_upload(state, source, &length) != 0) {
+        return 1;
+    }
+    
+    // Sondeo de MTU: solo si el servidor aceptó un blksize propio
+    if (probe && state->blksize != plain_blksize(state) && probe_path_mtu(state) < 0) {
+        return -1;
+    }
+    
+    // FASE 3: DATA (el archivo, o las diferencias con la copia del servidor)
+    if (state->delta ? send_file_delta(state, source) < 0
+                     : send_file_data(state, source, length) < 0) {
+        return -1;
+    }
+    
+    // FASE 4: FIN
+    return send_fin(state);
+}
+
+// Sesión completa sobre un socket: HELLO, WRQ, sondeo, DATA y FIN
+// Retorna lo mismo que run_upload
+static int run_session(ClientState *state, FileSource *source, int64_t length) {
+    // FASE 1: HELLO (con 0-RTT la autenticación va en el WRQ)
+    if (!state->early && send_hello(state) < 0) {
+        return -1;
+    }
+    
+    return run_upload(state, source, length, 1);
+}
+
+// Descarga (RRQ): los roles del modo ventana invertidos (protocol.h)
+
+// Espera un datagrama del servidor hasta deadline (ms, monotónico) en buf
+// (los DATA de una descarga pueden ser más grandes que una PDU)
+// Retorna: número de bytes recibidos, 0 si venció, -1 si error
+static int recv_until(ClientState *state, uint8_t *buf, int size, uint64_t deadline) {
+    struct sockaddr_in from_addr;
+    socklen_t addr_len = sizeof(from_addr);
+    uint64_t now = now_ms();
+    fd_set readfds;
+    
+    int timeout_ms = deadline > now ? (int)(deadline - now) : 0;
+    struct timeval tv = { timeout_ms / 1000, (timeout_ms % 1000) * 1000 };
+    FD_ZERO(&readfds);
+    FD_SET(state->sockfd, &readfds);
+    
+    int ready = select(state->sockfd + 1, &readfds, NULL, NULL, &tv);
+    if (ready <= 0) {
+        if (ready < 0) {
+            perror("Error en select");
+        }
+        return ready;
+    }
+    
+    int recv_len = recvfrom(state->sockfd, buf, size, 0, (struct sockaddr*)&from_addr, &addr_len);
+    if (recv_len < 0) {
+        perror("Error en recvfrom");
+        return -1;
+    }
+    metric_add(state->metrics, METRIC_RX_PACKETS, 1);
+    metric_add(state->metrics, METRIC_RX_BYTES, recv_len);
+    return recv_len;
+}
+
+// FASE 2 de una descarga: RRQ y OACK con el tamaño del archivo
+// La ventana pedida se acota para que entre en la mitad del buffer del socket
+// Retorna 0 si OK, -1 si error o el servidor rechazó el pedido
+static int send_rrq(ClientState *state, uint64_t *size) {
+    uint8_t payload[MAX_FILENAME_LEN + 1 + MAX_OPTIONS_SIZE];
+    char value[16];
+    PDU pdu, reply;
+    int retries = 0;
+    
+    LOG_INFO("\n=== FASE 2: PEDIDO DE DESCARGA (RRQ) ===\n");
+    
+    int rcvbuf = RX_SOCKET_BUFFER;
+    socklen_t optlen = sizeof(rcvbuf);
+    setsockopt(state->sockfd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+    if (getsockopt(state->sockfd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, &optlen) < 0) {
+        rcvbuf = RX_SOCKET_BUFFER;
+    }
+    int datagram = (state->blksize > 0 ? state->blksize : plain_blksize(state)) +
+                   data_header_size(2, 1, state->checksum);
+    if ((long)state->window * datagram > rcvbuf / 2) {
+        state->window = rcvbuf / 2 / datagram > 1 ? rcvbuf / 2 / datagram : 1;
+    }
+    
+    int payload_len = strlen(state->filename) + 1;
+    memcpy(payload, state->filename, payload_len);
+    snprintf(value, sizeof(value), "%d", state->window);
+    payload_len = append_option(payload, payload_len, sizeof(payload), OPT_WINDOW, value);
+    if (state->blksize > 0) {
+        snprintf(value, sizeof(value), "%d", state->blksize);
+        payload_len = append_option(payload, payload_len, sizeof(payload), OPT_BLKSIZE, value);
+    }
+    if (state->checksum) {
+        payload_len = append_option(payload, payload_len, sizeof(payload), OPT_CHECKSUM,
+                                    CHECKSUM_CRC32C);
+    }
+    if (payload_len < 0) {
+        LOG_ERROR("Opciones del RRQ demasiado largas\n");
+        return -1;
+    }
+    build_pdu(&pdu, TYPE_RRQ, 1, payload, payload_len);
+    
+    while (retries < MAX_RETRIES) {
+        LOG_INFO("Enviando RRQ para '%s' (intento %d/%d)...\n",
+                 state->filename, retries + 1, MAX_RETRIES);
+        
+        int sent = send_pdu(state->sockfd, &state->server_addr, &pdu, payload_len);
+        if (sent < 0) {
+            return -1;
+        }
+        count_tx(state, 1, sent);
+        print_pdu(&pdu, payload_len, "  TX:");
+        
+        // Los DATA que se adelantan a un OACK perdido se descartan (el
+        // servidor los retransmite)
+        uint64_t sent_us = now_us();
+        uint64_t deadline = now_ms() + rtt_timeout_ms(&state->rtt);
+        int recv_len;
+        while ((recv_len = recv_until(state, (uint8_t*)&reply, sizeof(reply), deadline)) > 0) {
+            if (recv_len < 2 || reply.seq_num != 1 ||
+                (reply.type != TYPE_ACK && reply.type != TYPE_OACK)) {
+                continue;
+            }
+            
+            if (reply.type == TYPE_ACK) {
+                LOG_ERROR("Error del servidor: %.*s\n", recv_len - 2, (const char*)reply.data);
+                return -1;
+            }
+            
+            const char *window_opt = find_option(reply.data, recv_len - 2, OPT_WINDOW);
+            const char *blksize_opt = find_option(reply.data, recv_len - 2, OPT_BLKSIZE);
+            const char *tsize_opt = find_option(reply.data, recv_len - 2, OPT_TSIZE);
+            const char *checksum_opt = find_option(reply.data, recv_len - 2, OPT_CHECKSUM);
+            int window = window_opt ? atoi(window_opt) : 0;
+            int blksize = blksize_opt ? atoi(blksize_opt) : 0;
+            int max_blksize = state->blksize > 0 ? state->blksize : plain_blksize(state);
+            if (window < 1 || window > state->window || blksize < MIN_BLKSIZE ||
+                blksize > max_blksize || !tsize_opt) {
+                LOG_ERROR("OACK de descarga invalido\n");
+                return -1;
+            }
+            
+            if (retries == 0) {
+                sample_rtt(state, now_us() - sent_us);
+            }
+            state->window = window;
+            state->blksize = blksize;
+            state->checksum = state->checksum && checksum_opt &&
+                              strcmp(checksum_opt, CHECKSUM_CRC32C) == 0;
+            *size = strtoull(tsize_opt, NULL, 10);
+            LOG_INFO("RRQ aceptado (%llu bytes, window=%d, blksize=%d, checksum: %s)\n",
+                     (unsigned long long)*size, state->window, state->blksize,
+                     state->checksum ? CHECKSUM_CRC32C : "no");
+            return 0;
+        }
+        if (recv_len < 0) {
+            return -1;
+        }
+        
+        rtt_backoff(&state->rtt);
+        LOG_INFO("  Timeout, reintentando (RTO=%dms)...\n", rtt_timeout_ms(&state->rtt));
+        retries++;
+    }
+    
+    LOG_ERROR("Fallo RRQ despues de %d intentos\n", MAX_RETRIES);
+    return -1;
+}
+
+// Envía el ACK acumulativo de la descarga: Cum = base y el bitmap de lo
+// que llegó hasta high (igual que el del servidor en las subidas)
+static int send_download_ack(ClientState *state, const uint8_t *got, uint32_t base,
+                             uint32_t high) {
+    PDU ack;
+    uint8_t *bitmap = ack.data + EXT_SEQ_SIZE;
+    int bitmap_len = 0;
+    
+    build_pdu(&ack, TYPE_ACK, ACK_FLAG_SACK, NULL, 0);
+    pdu_set_seq32(&ack, base);
+    for (uint32_t i = 0; base + 1 + i < high; i++) {
+        if (i % 8 == 0) {
+            bitmap[i / 8] = 0;
+        }
+        if (got[(base + 1 + i) % state->window]) {
+            bitmap[i / 8] |= 1 << (i % 8);
+            bitmap_len = i / 8 + 1;
+        }
+    }
+    
+    LOG_TRACE("  TX: ACK cum=%u (%d bytes de SACK)\n", base, bitmap_len);
+    int sent = send_pdu(state->sockfd, &state->server_addr, &ack, EXT_SEQ_SIZE + bitmap_len);
+    if (sent > 0) {
+        count_tx(state, 1, sent);
+    }
+    return sent;
+}
+
+// FASE 3 de una descarga: recibe los size bytes del archivo y los escribe
+// en fd por posición (los DATA fuera de orden van directo a su lugar)
+// Retorna 0 si OK, -1 si error
+static int recv_file_window(ClientState *state, int fd, uint64_t size, uint8_t *buf, int buf_size) {
+    uint64_t chunks = (size + state->blksize - 1) / state->blksize;
+    uint32_t window = (uint32_t)state->window;
+    uint32_t base = 0;
+    uint32_t high = 0;
+    uint64_t received = 0;
+    uint64_t start_us = now_us();
+    long duplicates = 0;
+    long acks_sent = 0;
+    int unacked = 0;
+    int ack_now = 0;
+    int retries = 0;
+    uint64_t ack_deadline = 0;
+    char progress[64];
+    int result = -1;
+    
+    LOG_INFO("\n=== FASE 3: RECEPCION DE DATOS ===\n");
+    
+    uint8_t *got = calloc(window, 1);
+    if (!got) {
+        perror("Error reservando ventana de recepcion");
+        return -1;
+    }
+    
+    while (base < chunks) {
+        uint64_t deadline = unacked > 0 ? ack_deadline : now_ms() + rtt_timeout_ms(&state->rtt);
+        int recv_len = recv_until(state, buf, buf_size, deadline);
+        if (recv_len < 0) {
+            goto out;
+        }
+        
+        int header = data_header_size(2, 1, state->checksum);
+        PduView pdu = pdu_view(buf);
+        if (recv_len >= header && pdu.type == TYPE_DATA) {
+            uint32_t seq = get_be32(pdu.data);
+            const uint8_t *data = buf + header;
+            int len = recv_len - header;
+            uint64_t offset = (uint64_t)seq * state->blksize;
+            
+            // Largo esperado (el último chunk puede ser menor) y CRC del seq y el payload
+            int valid = seq < chunks &&
+                        (uint64_t)len == (size - offset < (uint64_t)state->blksize
+                                          ? size - offset : (uint64_t)state->blksize);
+            if (valid && state->checksum) {
+                uint32_t crc = crc32c_update(CRC32C_INIT, pdu.data, EXT_SEQ_SIZE);
+                valid = (pdu.seq_num & DATA_FLAG_CRC) &&
+                        crc32c_update(crc, data, len) == get_be32(pdu.data + EXT_SEQ_SIZE);
+                if (!valid) {
+                    metric_add(state->metrics, METRIC_CHECKSUM_ERRORS, 1);
+                }
+            }
+            if (!valid) {
+                LOG_DEBUG("  RX: DATA seq=%u invalido, descartando\n", seq);
+                continue;
+            }
+            
+            // Ya recibido (se perdió el ACK): reconocerlo sin demora
+            if (seq - base >= window || got[seq % window]) {
+                duplicates++;
+                ack_now = 1;
+            } else {
+                if (pwrite(fd, data, len, (off_t)offset) != len) {
+                    perror("Error escribiendo archivo");
+                    goto out;
+                }
+                got[seq % window] = 1;
+                received += len;
+                metric_add(state->metrics, METRIC_DATA_BYTES, len);
+                retries = 0;
+                
+                // Un hueco se reconoce sin demora para que el servidor retransmita
+                if (seq != base || high > seq + 1) {
+                    ack_now = 1;
+                }
+                if (seq + 1 > high) {
+                    high = seq + 1;
+                }
+                
+                uint32_t old_base = base;
+                while (base != high && got[base % window]) {
+                    got[base % window] = 0;
+                    base++;
+                }
+                if (unacked++ == 0) {
+                    ack_deadline = now_ms() + SACK_DELAY_MS;
+                }
+                
+                if (base / window != old_base / window || base == chunks) {
+                    LOG_INFO("  Progreso: %s [base=%u, fuera de orden=%u]\n",
+                             format_progress(progress, sizeof(progress), received, (int64_t)size),
+                             base, high - base);
+                }
+            }
+        } else if (recv_len == 0 && unacked == 0) {
+            // Nada del servidor en un RTO: el último ACK pudo perderse
+            if (++retries >= MAX_RETRIES) {
+                LOG_ERROR("Fallo descarga: sin DATA despues de %d intentos\n", MAX_RETRIES);
+                goto out;
+            }
+            rtt_backoff(&state->rtt);
+            metric_add(state->metrics, METRIC_TIMEOUTS, 1);
+            LOG_DEBUG("  Timeout esperando DATA (RTO=%dms)...\n", rtt_timeout_ms(&state->rtt));
+            ack_now = 1;
+        }
+        
+        // ACK: de a SACK_ACK_EVERY DATA, sin demora con un hueco o un
+        // duplicado, y si no al vencer la demora
+        if (ack_now || unacked >= SACK_ACK_EVERY || base == chunks ||
+            (unacked > 0 && now_ms() >= ack_deadline)) {
+            if (send_download_ack(state, got, base, high) < 0) {
+                goto out;
+            }
+            acks_sent++;
+            unacked = 0;
+            ack_now = 0;
+        }
+    }
+    
+    state->next_seq = (uint32_t)chunks;
+    LOG_INFO("\nDescarga completa: %llu bytes en %llu chunks (%ld duplicados, %llu kB/s)\n",
+             (unsigned long long)received, (unsigned long long)chunks, duplicates,
+             (unsigned long long)observe_goodput(state, received, start_us));
+    if (acks_sent > 0) {
+        LOG_INFO("ACKs: %ld para %llu chunks (%.1f chunks por ACK)\n", acks_sent,
+                 (unsigned long long)chunks, (double)chunks / acks_sent);
+    }
+    result = 0;
+
+out:
+    free(got);
+    return result;
+}
+
+// FASE 4 de una descarga: FIN con el total de DATA
+// El archivo ya está completo: si el ACK no llega solo se avisa (el
+// servidor cierra la sesión por inactividad)
+static int finish_download(ClientState *state, uint8_t *buf, int buf_size) {
+    PDU pdu;
+    
+    LOG_INFO("\n=== FASE 4: FINALIZACION (FIN) ===\n");
+    
+    build_pdu(&pdu, TYPE_FIN, 0, NULL, 0);
+    pdu_set_seq32(&pdu, state->next_seq);
+    
+    for (int retries = 0; retries < MAX_RETRIES; retries++) {
+        LOG_INFO("Enviando FIN con seq=%u (intento %d/%d)...\n",
+                 state->next_seq, retries + 1, MAX_RETRIES);
+        int sent = send_pdu(state->sockfd, &state->server_addr, &pdu, EXT_SEQ_SIZE);
+        if (sent < 0) {
+            return -1;
+        }
+        count_tx(state, 1, sent);
+        
+        // Los DATA retransmitidos que todavía lleguen no cuentan como respuesta
+        uint64_t deadline = now_ms() + rtt_timeout_ms(&state->rtt);
+        int recv_len;
+        while ((recv_len = recv_until(state, buf, buf_size, deadline)) > 0) {
+            PduView ack = pdu_view(buf);
+            if (ack.type == TYPE_ACK && recv_len >= 2 + EXT_SEQ_SIZE &&
+                !(ack.seq_num & ACK_FLAG_SACK) && get_be32(ack.data) == state->next_seq) {
+                LOG_INFO("Sesion finalizada correctamente\n");
+                return 0;
+            }
+        }
+        if (recv_len < 0) {
+            return -1;
+        }
+        rtt_backoff(&state->rtt);
+    }
+    
+    LOG_WARN("Sin ACK del FIN despues de %d intentos (el archivo esta completo)\n", MAX_RETRIES);
+    return 0;
+}
+
+// Descarga completa: HELLO, RRQ, DATA y FIN, escribiendo en path
+// Se descarga en "<path>.part", que reemplaza a path recién cuando el
+// archivo está completo: un error (RRQ rechazado, servidor caído) no toca
+// el archivo que hubiera y no deja uno a medias
+static int run_download(ClientState *state, const char *path) {
+    uint64_t size = 0;
+    uint8_t *buf = NULL;
+    int result = -1;
+    char part_path[PATH_MAX];
+    
+    if (snprintf(part_path, sizeof(part_path), "%s.part", path) >= (int)sizeof(part_path)) {
+        LOG_ERROR("Ruta destino demasiado larga: %s\n", path);
+        return -1;
+    }
+    int fd = open(part_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        perror("Error abriendo archivo destino");
+        return -1;
+    }
+    
+    // El buffer de recepción es de un DATA con el blksize negociado, y el
+    // tamaño final se fija antes de escribir: los chunks fuera de orden van
+    // a su posición
+    if (send_hello(state) == 0 && send_rrq(state, &size) == 0) {
+        int buf_size = data_header_size(2, 1, state->checksum) + state->blksize;
+        buf = malloc(buf_size);
+        if (!buf) {
+            perror("Error reservando buffer de recepcion");
+        } else if (ftruncate(fd, (off_t)size) < 0) {
+            perror("Error dimensionando archivo destino");
+        } else if (recv_file_window(state, fd, size, buf, buf_size) == 0) {
+            result = finish_download(state, buf, buf_size);
+        }
+    }
+    
+    if (close(fd) < 0) {
+        perror("Error cerrando archivo destino");
+        result = -1;
+    }
+    if (result == 0 && rename(part_path, path) < 0) {
+        perror("Error renombrando archivo destino");
+        result = -1;
+    }
+    if (result != 0) {
+        unlink(part_path);
+    }
+    free(buf);
+    return result;
+}
+
+// Bloque de métricas de cada stream o lane (el 0 es el de la sesión principal)
+static Metrics stream_metrics[MAX_STREAMS];
+
+// Stream de un archivo subido en paralelo: sesión propia (socket, RTT,
+// cwnd) que envía el rango [offset, offset + length)
+typedef struct {
+    ClientState state;
+    FileSource range;
+    uint64_t offset;
+    uint64_t length;
+    int result;                     // 0 si el stream terminó bien
+} StreamTask;
+
+static void* stream_thread(void *arg) {
+    StreamTask *task = arg;
+    task->result = run_session(&task->state, &task->range, (int64_t)task->length);
+    return NULL;
+}
+
+// Envía el archivo en state->streams rangos contiguos, uno por hilo
+// El primer stream usa el socket de state; los demás abren el suyo
+// Retorna 0 si todos terminaron bien, -1 si alguno falló
+static int run_streams(ClientState *state, FileSource *source) {
+    int streams = state->streams;
+    uint64_t size = (uint64_t)state->file_size;
+    StreamTask *tasks = calloc(streams, sizeof(StreamTask));
+    pthread_t *threads = calloc(streams, sizeof(pthread_t));
+    int result = 0;
+    int started = 0;
+    
+    if (!tasks || !threads) {
+        perror("Error reservando streams");
+        free(tasks);
+        free(threads);
+        return -1;
+    }
+    
+    for (int i = 0; i < streams; i++) {
+        StreamTask *task = &tasks[i];
+        task->state = *state;
+        task->state.metrics = &stream_metrics[i];
+        task->offset = size * i / streams;
+        task->length = size * (i + 1) / streams - task->offset;
+        source_range(source, &task->range, task->offset, task->length);
+        
+        if (i > 0) {
+            task->state.sockfd = open_client_socket();
+            if (task->state.sockfd < 0) {
+                result = -1;
+                break;
+            }
+        }
+        
+        if (pthread_create(&threads[i], NULL, stream_thread, task) != 0) {
+            perror("Error creando hilo");
+            if (i > 0) {
+                close(task->state.sockfd);
+            }
+            result = -1;
+            break;
+        }
+        started++;
+    }
+    
+    for (int i = 0; i < started; i++) {
+        pthread_join(threads[i], NULL);
+        if (i > 0) {
+            close(tasks[i].state.sockfd);
+        }
+    }
+    
+    LOG_INFO("\n");
+    for (int i = 0; i < started; i++) {
+        LOG_INFO("Stream %d: bytes [%llu, %llu) %s\n", i,
+                 (unsigned long long)tasks[i].offset,
+                 (unsigned long long)(tasks[i].offset + tasks[i].length),
+                 tasks[i].result == 0 ? "OK" : "FALLO");
+        if (tasks[i].result != 0) {
+            result = -1;
+        }
+    }
+    
+    free(threads);
+    free(tasks);
+    return result;
+}
+
+// Archivo de una subida con varios archivos
+typedef struct {
+    char *path;
+    char name[MAX_FILENAME_LEN + 1];
+    int result;                     // 0 si se subió bien
+} UploadFile;
+
+// Archivos repartidos entre los lanes: cada hilo toma el próximo sin subir
+typedef struct {
+    const ClientState *session;     // Sesión autenticada (lane 0) que copia cada archivo
+    UploadFile *files;
+    int count;
+    int next;                       // Próximo archivo sin tomar
+    pthread_mutex_t lock;
+} Pipeline;
+
+// Hilo de un lane: lo que pasa de un archivo al siguiente
+typedef struct {
+    Pipeline *pipeline;
+    int lane;
+    RttEstimator rtt;               // RTT del último archivo subido
+    int blksize;                    // Blksize a pedir (el sondeado, si hubo sondeo)
+    int probe;                      // 1 = todavía no se sondeó el MTU
+} LaneTask;
+
+// Sube un archivo por el lane: parte del estado de la sesión con el RTT y
+// el blksize que el lane ya conoce de archivos anteriores
+// Retorna lo mismo que run_upload
+static int upload_on_lane(LaneTask *task, UploadFile *file, FileSource *source,
+                          ClientState *state, int resume) {
+    *state = *task->pipeline->session;
+    state->lane = task->lane;
+    state->metrics = &stream_metrics[task->lane];
+    state->rtt = task->rtt;
+    state->blksize = task->blksize;
+    state->file_size = source->size;
+    state->resume = resume;
+    state->delta = state->delta && source->size >= 0;
+    strcpy(state->filename, file->name);
+    return run_upload(state, source, source->size, task->probe);
+}
+
+// Hilo de un lane: sube archivos de la lista de a uno hasta que no quedan
+// El RTT y el blksize sondeado pasan de un archivo al siguiente: solo el
+// primero del lane arranca de cero y sondea el MTU
+static void* lane_thread(void *arg) {
+    LaneTask *task = arg;
+    Pipeline *pipeline = task->pipeline;
+    task->rtt = pipeline->session->rtt;
+    task->blksize = pipeline->session->blksize;
+    task->probe = 1;
+    
+    for (;;) {
+        pthread_mutex_lock(&pipeline->lock);
+        int index = pipeline->next < pipeline->count ? pipeline->next++ : -1;
+        pthread_mutex_unlock(&pipeline->lock);
+        if (index < 0) {
+            break;
+        }
+        
+        UploadFile *file = &pipeline->files[index];
+        FileSource source;
+        if (source_open(&source, file->path) < 0) {
+            LOG_ERROR("Error abriendo %s: %s\n", file->path, strerror(errno));
+            continue;
+        }
+        
+        LOG_INFO("\n[LANE %d] %s -> %s (%lld bytes)\n", task->lane, file->path, file->name,
+                 (long long)source.size);
+        ClientState state;
+        int resume = pipeline->session->resume && source.size >= 0;
+        int result = upload_on_lane(task, file, &source, &state, resume);
+        
+        // El parcial del servidor es de otro contenido: desde cero en el
+        // mismo lane (el servidor descarta el WRQ anterior)
+        if (result == 1) {
+            LOG_INFO("\n[LANE %d] Subiendo %s desde cero\n", task->lane, file->name);
+            result = upload_on_lane(task, file, &source, &state, 0);
+        }
+        source_close(&source);
+        
+        file->result = result;
+        if (result == 0) {
+            metric_add(&stream_metrics[task->lane], METRIC_FILES_COMPLETED, 1);
+            task->rtt = state.rtt;
+            if (pipeline->session->blksize > 0 && state.window > 1) {
+                task->blksize = state.blksize;
+            }
+            task->probe = 0;
+        }
+    }
+    return NULL;
+}
+
+// Sube varios archivos en una sesión: HELLO en el lane 0, después hasta
+// lanes hilos que encadenan archivos, cada uno por su lane sobre el mismo
+// socket, y al final un FIN en el lane 0 que cierra la sesión
+// Retorna 0 si se subieron todos, -1 si alguno falló
+static int run_pipeline(ClientState *state, UploadFile *files, int count, int lanes) {
+    LaneTask tasks[MAX_LANES];
+    pthread_t threads[MAX_LANES];
+    int started = 0;
+    int result = 0;
+    
+    // FASE 1: HELLO (una vez para todos los archivos)
+    if (send_hello(state) < 0) {
+        return -1;
+    }
+    
+    state->mux = mux_create(state->sockfd);
+    if (!state->mux) {
+        perror("Error creando el receptor de lanes");
+        return -1;
+    }
+    
+    Pipeline pipeline = { state, files, count, 0, PTHREAD_MUTEX_INITIALIZER };
+    if (lanes > count) {
+        lanes = count;
+    }
+    LOG_INFO("\n=== %d ARCHIVOS EN %d LANES ===\n", count, lanes);
+    
+    for (int i = 0; i < lanes; i++) {
+        tasks[i].pipeline = &pipeline;
+        tasks[i].lane = i + 1;
+        if (pthread_create(&threads[i], NULL, lane_thread, &tasks[i]) != 0) {
+            perror("Error creando hilo");
+            break;
+        }
+        started++;
+    }
+    for (int i = 0; i < started; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    
+    // Cierre de la sesión: los archivos ya quedaron completos con su FIN,
+    // así que si no llega la confirmación solo se avisa (el servidor la
+    // cierra igual por inactividad)
+    state->window = 1;
+    state->checksum = 0;
+    state->current_seq = 0;
+    state->file_length = -1;
+    if (send_fin(state) < 0) {
+        LOG_WARN("El servidor no confirmo el cierre de la sesion\n");
+    }
+    mux_destroy(state->mux);
+    state->mux = NULL;
+    
+    LOG_INFO("\n");
+    for (int i = 0; i < count; i++) {
+        LOG_INFO("%s -> %s: %s\n", files[i].path, files[i].name,
+                 files[i].result == 0 ? "OK" : "FALLO");
+        if (files[i].result != 0) {
+            result = -1;
+        }
+    }
+    return result;
+}
+
+// Agrega un archivo a la lista de la subida
+// Retorna 0 si OK, -1 si no hay memoria
+static int add_file(UploadFile **files, int *count, const char *path, const char *name) {
+    UploadFile *grown = realloc(*files, (size_t)(*count + 1) * sizeof(UploadFile));
+    if (!grown) {
+        return -1;
+    }
+    *files = grown;
+    
+    UploadFile *file = &grown[*count];
+    file->path = strdup(path);
+    if (!file->path) {
+        return -1;
+    }
+    strncpy(file->name, name, MAX_FILENAME_LEN);
+    file->name[MAX_FILENAME_LEN] = '\0';
+    file->result = -1;
+    (*count)++;
+    return 0;
+}
+
+// Libera la lista de archivos de la subida
+static void free_files(UploadFile *files, int count) {
+    for (int i = 0; i < count; i++) {
+        free(files[i].path);
+    }
+    free(files);
+}
+
+// Agrega los archivos de un par <ruta> <nombre>: el archivo con ese
+// nombre, o si la ruta es un directorio sus archivos regulares en orden,
+// cada uno con su propio nombre (el del par se ignora; los que no son un
+// filename válido se omiten)
+// Retorna 0 si OK, -1 si error
+static int collect_files(UploadFile **files, int *count, const char *path, const char *name) {
+    struct stat st;
+    if (stat(path, &st) < 0 || !S_ISDIR(st.st_mode)) {
+        if (!validate_filename(name)) {
+            return -1;
+        }
+        return add_file(files, count, path, name);
+    }
+    
+    struct dirent **entries;
+    int entry_count = scandir(path, &entries, NULL, alphasort);
+    if (entry_count < 0) {
+        perror("Error leyendo directorio");
+        return -1;
+    }
+    
+    int result = 0;
+    for (int i = 0; i < entry_count; i++) {
+        char entry_path[PATH_MAX];
+        const char *entry_name = entries[i]->d_name;
+        snprintf(entry_path, sizeof(entry_path), "%s/%s", path, entry_name);
+        
+        if (result == 0 && stat(entry_path, &st) == 0 && S_ISREG(st.st_mode)) {
+            if (!validate_filename(entry_name)) {
+                LOG_WARN("Omitiendo %s: el nombre no es un filename valido\n", entry_path);
+            } else if (add_file(files, count, entry_path, entry_name) < 0) {
+                perror("Error armando la lista de archivos");
+                result = -1;
+            }
+        }
+        free(entries[i]);
+    }
+    free(entries);
+    return result;
+}
+
+// Programa principal del cliente UDP
+int main(int argc, char *argv[]) {
+    ClientState state;
+    FileSource source;
+    
+    int window = WINDOW_DEFAULT;
+    int gso = 0;
+    int blksize = -1;
+    int streams = 1;
+    int resume = 1;
+    int checksum = 1;
+    int compress = 0;
+    int delta = 0;
+    int fec = 0;
+    int sack = 1;
+    int lanes = PIPELINE_DEFAULT;
+    int early = 0;
+    const char *ticket_file = NULL;
+    int download = 0;
+    int server_port = SERVER_PORT;
+    const char *congestion = CC_DEFAULT;
+    const char *metrics_file = NULL;
+    const char *metrics_socket = NULL;
+    const char **positional = calloc(argc, sizeof(char*));
+    int npositional = 0;
+    
+    if (!positional) {
+        perror("Error reservando argumentos");
+        return 1;
+    }
+    
+    // Parseo de argumentos: opciones, servidor, credenciales y uno o más
+    // pares <ruta> <nombre>
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-w") == 0 && i + 1 < argc) {
+            window = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-s") == 0) {
+            window = 1;
+        } else if (strcmp(argv[i], "-g") == 0) {
+            gso = 1;
+        } else if (strcmp(argv[i], "-B") == 0 && i + 1 < argc) {
+            blksize = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-c") == 0 && i + 1 < argc) {
+            congestion = argv[++i];
+        } else if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            streams = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-R") == 0) {
+            resume = 0;
+        } else if (strcmp(argv[i], "-k") == 0) {
+            checksum = 0;
+        } else if (strcmp(argv[i], "-z") == 0) {
+            compress = 1;
+        } else if (strcmp(argv[i], "-d") == 0) {
+            delta = 1;
+        } else if (strcmp(argv[i], "-f") == 0 && i + 1 < argc) {
+            fec = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-a") == 0) {
+            sack = 0;
+        } else if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+            lanes = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-0") == 0) {
+            early = 1;
+        } else if (strcmp(argv[i], "-T") == 0 && i + 1 < argc) {
+            ticket_file = argv[++i];
+        } else if (strcmp(argv[i], "-r") == 0) {
+            download = 1;
+        } else if (strcmp(argv[i], "-P") == 0 && i + 1 < argc) {
+            server_port = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-m") == 0 && i + 1 < argc) {
+            metrics_file = argv[++i];
+        } else if (strcmp(argv[i], "-u") == 0 && i + 1 < argc) {
+            metrics_socket = argv[++i];
+        } else if (strcmp(argv[i], "-v") == 0) {
+            log_set_level(log_level + 1);
+        } else if (strcmp(argv[i], "-q") == 0) {
+            log_set_level(LOG_LEVEL_WARN);
+        } else {
+            positional[npositional++] = argv[i];
+        }
+    }
+    
+    // Verificar argumentos
+    int max_blksize = streams > 1 ? MAX_OFFSET_BLKSIZE : MAX_BLKSIZE;
+    int blksize_ok = blksize <= 0 || (blksize >= MIN_BLKSIZE && blksize <= max_blksize);
+    int streams_ok = streams >= 1 && streams <= MAX_STREAMS && (streams == 1 || window > 1);
+    int fec_ok = fec == 0 || (fec >= FEC_MIN_K && fec <= FEC_MAX_K);
+    int lanes_ok = lanes >= 1 && lanes <= MAX_LANES;
+    int download_ok = !download || (npositional == 4 && streams == 1 && !early);
+    if (npositional < 4 || npositional % 2 != 0 || window < 1 || window > WINDOW_MAX ||
+        !blksize_ok || !streams_ok || !fec_ok || !lanes_ok || !download_ok) {
+        printf("Uso: %s [-w ventana | -s] [-g] [-B bytes] [-c algoritmo] [-n streams] [-R] [-k] [-z] [-d] [-f k] [-a] [-j lanes] [-0] [-T archivo] [-r] [-P puerto] [-m archivo] [-u socket] [-v] [-q] <server_ip> <credentials> <filepath> <filename> [<filepath> <filename>]...\n", argv[0]);
+        printf("  -w N  Ventana de Selective Repeat (1-%d, default %d)\n", WINDOW_MAX, WINDOW_DEFAULT);
+        printf("  -s    Stop & Wait con el WRQ original, sin opciones salvo -B (equivale a -w 1)\n");
+        printf("  -g    Enviar rafagas de DATA con UDP_SEGMENT (GSO, modo ventana)\n");
+        printf("  -B N  Blksize a pedir (%d-%d; default segun el MTU, 0 = no negociar)\n",
+               MIN_BLKSIZE, MAX_BLKSIZE);
+        printf("  -c A  Control de congestion en modo ventana: newreno, vegas o none (default %s)\n",
+               CC_DEFAULT);
+        printf("  -n N  Enviar el archivo en N streams paralelos (1-%d, modo ventana)\n",
+               MAX_STREAMS);
+        printf("  -R    No retomar una subida anterior: enviar el archivo desde cero\n");
+        printf("  -k    Sin CRC32C por DATA ni digest en el FIN (modo ventana)\n");
+        printf("  -z    Comprimir los DATA que se achican (LZ, modo ventana)\n");
+        printf("  -d    Enviar solo las diferencias con la copia del servidor (delta, modo ventana)\n");
+        printf("  -f K  Paridad XOR cada K DATA (FEC, %d-%d, modo ventana con un stream)\n",
+               FEC_MIN_K, FEC_MAX_K);
+        printf("  -a    Un ACK por DATA en vez de ACKs acumulativos con SACK (modo ventana)\n");
+        printf("  -j N  Con varios archivos, subir hasta N a la vez (1-%d, default %d)\n",
+               MAX_LANES, PIPELINE_DEFAULT);
+        printf("  -0    0-RTT: WRQ sin HELLO y los primeros %d DATA sin esperar el OACK (un archivo)\n",
+               EARLY_CHUNKS);
+        printf("  -T F  Guardar en F el ticket del servidor y usarlo en el 0-RTT\n");
+        printf("  -r    Descargar <filename> del servidor en <filepath> (un archivo, sin -n ni -0)\n");
+        printf("  -P N  Puerto del servidor (default %d; ej: el de bin/proxy)\n", SERVER_PORT);
+        printf("  -m F  Snapshot de metricas en el archivo F (cada %dms y al terminar)\n",
+               METRICS_INTERVAL_MS);
+        printf("  -u F  Servir las metricas en el socket UNIX F durante la subida\n");
+        printf("  -v    Mas detalle: retransmisiones y progreso por chunk (-v), cada PDU (-v -v)\n");
+        printf("  -q    Solo errores y warnings\n");
+        printf("Un <filepath> directorio sube sus archivos con su propio nombre (<filename> se ignora, ej: .)\n");
+        printf("Un <filepath> \"-\" sube la entrada estandar (tamano desconocido: sin retomar, delta ni -n)\n");
+        printf("Ejemplo: %s 127.0.0.1 g14-978e ./test_files/archivo_20kB testfile\n", argv[0]);
+        return 1;
+    }
+    
+    const char *server_ip = positional[0];
+    const char *credentials = positional[1];
+    
+    // Descarga: <filepath> es el destino, no hay archivos que recorrer
+    if (download) {
+        const char *filepath = positional[2];
+        const char *filename = positional[3];
+        free(positional);
+        
+        LOG_INFO("========================================\n");
+        LOG_INFO("  CLIENTE UDP FILE TRANSFER (DESCARGA)\n");
+        LOG_INFO("========================================\n");
+        log_start();
+        
+        if (init_client(&state, server_ip, server_port, credentials, filename, window, 0,
+                        blksize, congestion, 1, -1, 0, checksum, 0, 0, 0, 1, 0, NULL) < 0) {
+            return 1;
+        }
+        metrics_init(&stream_metrics[0]);
+        metrics_register(&stream_metrics[0]);
+        state.metrics = &stream_metrics[0];
+        if (metrics_start("cliente", metrics_file, metrics_socket) < 0) {
+            close(state.sockfd);
+            return 1;
+        }
+        
+        int result = run_download(&state, filepath);
+        close(state.sockfd);
+        if (result != 0) {
+            return 1;
+        }
+        metric_add(&stream_metrics[0], METRIC_FILES_COMPLETED, 1);
+        
+        LOG_INFO("\n========================================\n");
+        LOG_INFO("  DESCARGA EXITOSA\n");
+        LOG_INFO("========================================\n");
+        return 0;
+    }
+    
+    // Lista de archivos a subir
+    UploadFile *files = NULL;
+    int file_count = 0;
+    for (int i = 2; i < npositional; i += 2) {
+        if (collect_files(&files, &file_count, positional[i], positional[i + 1]) < 0) {
+            free_files(files, file_count);
+            free(positional);
+            return 1;
+        }
+    }
+    free(positional);
+    if (file_count == 0) {
+        LOG_ERROR("No hay archivos para subir\n");
+        free_files(files, file_count);
+        return 1;
+    }
+    if (file_count > 1 && streams > 1) {
+        LOG_ERROR("Multi-stream es para un solo archivo\n");
+        free_files(files, file_count);
+        return 1;
+    }
+    
+    const char *filepath = files[0].path;
+    const char *filename = files[0].name;
+    
+    LOG_INFO("========================================\n");
+    LOG_INFO("  CLIENTE UDP FILE TRANSFER\n");
+    LOG_INFO("========================================\n");
+    
+    // Desde acá los mensajes se formatean y escriben en el thread de log
+    log_start();
+    
+    int result;
+    if (file_count > 1) {
+        // Varios archivos: una sesión, un lane por archivo en curso
+        if (init_client(&state, server_ip, server_port, credentials, filename, window, gso,
+                        blksize, congestion, 1, 0, resume, checksum, compress, delta, fec,
+                        sack, 0, NULL) < 0) {
+            free_files(files, file_count);
+            return 1;
+        }
+        
+        // Un bloque de métricas para la sesión y uno por lane
+        for (int i = 0; i <= lanes && i <= file_count; i++) {
+            metrics_init(&stream_metrics[i]);
+            metrics_register(&stream_metrics[i]);
+        }
+        state.metrics = &stream_metrics[0];
+        if (metrics_start("cliente", metrics_file, metrics_socket) < 0) {
+            close(state.sockfd);
+            free_files(files, file_count);
+            return 1;
+        }
+        
+        result = run_pipeline(&state, files, file_count, lanes);
+        close(state.sockfd);
+    } else {
+        // Abrir archivo (mmap si es posible, streaming si no)
+        if (source_open(&source, filepath) < 0) {
+            perror("Error abriendo archivo");
+            free_files(files, file_count);
+            return 1;
+        }
+        
+        // Los rangos necesitan el tamaño total y al menos un byte cada uno
+        if (streams > 1 && source.size < 0) {
+            LOG_ERROR("Multi-stream requiere un archivo regular\n");
+            source_close(&source);
+            free_files(files, file_count);
+            return 1;
+        }
+        if (streams > 1 && source.size < streams) {
+            streams = source.size > 1 ? (int)source.size : 1;
+        }
+        
+        // Inicializar cliente
+        if (init_client(&state, server_ip, server_port, credentials, filename, window, gso,
+                        blksize, congestion, streams, source.size, resume, checksum,
+                        compress, delta, fec, sack, early, ticket_file) < 0) {
+            source_close(&source);
+            free_files(files, file_count);
+            return 1;
+        }
+        
+        // Un bloque de métricas por stream; el snapshot final se escribe al salir
+        for (int i = 0; i < streams; i++) {
+            metrics_init(&stream_metrics[i]);
+            metrics_register(&stream_metrics[i]);
+        }
+        state.metrics = &stream_metrics[0];
+        if (metrics_start("cliente", metrics_file, metrics_socket) < 0) {
+            close(state.sockfd);
+            source_close(&source);
+            free_files(files, file_count);
+            return 1;
+        }
+        
+        if (streams > 1) {
+            result = run_streams(&state, &source);
+        } else {
+            ClientState initial = state;
+            result = run_session(&state, &source, source.size);
+            
+            // El parcial del servidor es de otro contenido: subir desde cero
+            // en una sesión nueva, sin pedir retomar
+            if (result == 1) {
+                LOG_INFO("\nSubiendo el archivo desde cero\n");
+                close(state.sockfd);
+                state = initial;
+                state.resume = 0;
+                state.sockfd = open_client_socket();
+                result = state.sockfd < 0 ? -1 : run_session(&state, &source, source.size);
+            }
+        }
+        
+        // Cerrar socket
+        close(state.sockfd);
+        source_close(&source);
+    }
+    
+    free_files(files, file_count);
+    if (result != 0) {
+        return 1;
+    }
+    
+    if (file_count == 1) {
+        metric_add(&stream_metrics[0], METRIC_FILES_COMPLETED, 1);
+    }
+    
+    LOG_INFO("\n========================================\n");
+    LOG_INFO("  TRANSFERENCIA EXITOSA\n");
+    LOG_INFO("========================================\n");
+    
+    return 0;
+}
@@ -0,0 +1,203 @@
+#include <string.h>
+#include "../include/compress.h"
+
+// Compresión LZ77 por bloques (formato en compress.h)
+
+#define LZ_HASH_BITS 14
+#define LZ_HASH_SIZE (1 << LZ_HASH_BITS)
+#define LZ_SKIP_SHIFT 5             // Sin coincidencias el paso crece 1 cada 32 intentos
+#define LZ_LITERAL_RUN 128          // Literales por token
+#define LZ_MATCH_CODE 127           // M que indica largo extendido
+
+// Tabla hash de 4 bytes -> posición, por thread. En vez de limpiarla en cada
+// bloque se guarda la posición más un desplazamiento que crece con cada
+// llamada: las entradas menores al desplazamiento actual son de bloques
+// anteriores y se ignoran
+static _Thread_local uint32_t hash_table[LZ_HASH_SIZE];
+static _Thread_local uint32_t hash_base = 0;
+
+static inline uint32_t read32(const uint8_t *p) {
+    uint32_t value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+static inline uint64_t read64(const uint8_t *p) {
+    uint64_t value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+static inline uint32_t hash32(uint32_t value) {
+    return (value * 2654435761U) >> (32 - LZ_HASH_BITS);
+}
+
+// Bytes que ocupan n literales / una copia de len bytes
+static int literal_cost(int n) {
+    return n + (n + LZ_LITERAL_RUN - 1) / LZ_LITERAL_RUN;
+}
+
+static int match_cost(int len) {
+    int m = len - LZ_MIN_MATCH;
+    return m < LZ_MATCH_CODE ? 3 : 3 + (m - LZ_MATCH_CODE) / 255 + 1;
+}
+
+// Escribe hasta n literales que entren en dst; en *emitted cuántos
+// Retorna el nuevo largo de dst
+static int emit_literals(uint8_t *dst, int op, int cap, const uint8_t *src, int n, int *emitted) {
+    *emitted = 0;
+    while (n > 0 && cap - op >= 2) {
+        int run = n < LZ_LITERAL_RUN ? n : LZ_LITERAL_RUN;
+        if (run > cap - op - 1) {
+            run = cap - op - 1;
+        }
+        dst[op++] = (uint8_t)(run - 1);
+        memcpy(dst + op, src, run);
+        op += run;
+        src += run;
+        n -= run;
+        *emitted += run;
+    }
+    return op;
+}
+
+static int emit_match(uint8_t *dst, int op, int offset, int len) {
+    int m = len - LZ_MIN_MATCH;
+    
+    dst[op] = 0x80 | (m < LZ_MATCH_CODE ? m : LZ_MATCH_CODE);
+    dst[op + 1] = offset & 0xff;
+    dst[op + 2] = offset >> 8;
+    op += 3;
+    if (m >= LZ_MATCH_CODE) {
+        m -= LZ_MATCH_CODE;
+        while (m >= 255) {
+            dst[op++] = 255;
+            m -= 255;
+        }
+        dst[op++] = (uint8_t)m;
+    }
+    return op;
+}
+
+int lz_compress(const uint8_t *src, int src_len, uint8_t *dst, int dst_cap, int *consumed) {
+    // Desplazamiento de este bloque (al dar la vuelta se limpia la tabla)
+    if (hash_base > UINT32_MAX - 2 * LZ_MAX_BLOCK) {
+        memset(hash_table, 0, sizeof(hash_table));
+        hash_base = 0;
+    }
+    uint32_t base = hash_base + 1;
+    hash_base += LZ_MAX_BLOCK + 1;
+    
+    int ip = 0;                     // Posición actual en src
+    int anchor = 0;                 // Inicio de los literales pendientes
+    int op = 0;                     // Largo de la salida
+    int limit = src_len - LZ_MIN_MATCH;
+    int misses = 0;
+    int full = 0;                   // 1 si la salida se llenó antes del final
+    
+    while (ip <= limit) {
+        // Los literales pendientes ya llenan la salida
+        if (op + literal_cost(ip - anchor) >= dst_cap) {
+            full = 1;
+            break;
+        }
+        
+        uint32_t sequence = read32(src + ip);
+        uint32_t h = hash32(sequence);
+        uint32_t entry = hash_table[h];
+        hash_table[h] = base + ip;
+        
+        int candidate = (int)(entry - base);
+        if (entry < base || ip - candidate > LZ_MAX_OFFSET || read32(src + candidate) != sequence) {
+            ip += 1 + (misses++ >> LZ_SKIP_SHIFT);
+            continue;
+        }
+        
+        // Extender la coincidencia: de a 8 bytes y después de a uno
+        int len = LZ_MIN_MATCH;
+        while (ip + len + 8 <= src_len && read64(src + candidate + len) == read64(src + ip + len)) {
+            len += 8;
+        }
+        while (ip + len < src_len && src[candidate + len] == src[ip + len]) {
+            len++;
+        }
+        
+        if (op + literal_cost(ip - anchor) + match_cost(len) > dst_cap) {
+            full = 1;
+            break;
+        }
+        
+        int emitted;
+        op = emit_literals(dst, op, dst_cap, src + anchor, ip - anchor, &emitted);
+        op = emit_match(dst, op, ip - candidate, len);
+        ip += len;
+        anchor = ip;
+        misses = 0;
+        
+        // Posición dentro de la copia: mejora las coincidencias siguientes
+        if (ip - 2 <= limit) {
+            hash_table[hash32(read32(src + ip - 2))] = base + ip - 2;
+        }
+    }
+    
+    // Literales finales (o los que entren si la salida se llenó)
+    int end = full ? ip : src_len;
+    int emitted;
+    op = emit_literals(dst, op, dst_cap, src + anchor, end - anchor, &emitted);
+    *consumed = anchor + emitted;
+    return op;
+}
+
+int lz_decompress(const uint8_t *src, int src_len, uint8_t *dst, int dst_cap) {
+    int ip = 0;
+    int op = 0;
+    
+    while (ip < src_len) {
+        int token = src[ip++];
+        
+        if (token < 0x80) {
+            int run = token + 1;
+            if (run > src_len - ip || run > dst_cap - op) {
+                return -1;
+            }
+            memcpy(dst + op, src + ip, run);
+            ip += run;
+            op += run;
+            continue;
+        }
+        
+        if (src_len - ip < 2) {
+            return -1;
+        }
+        int offset = src[ip] | (src[ip + 1] << 8);
+        int len = token & 0x7f;
+        ip += 2;
+        if (len == LZ_MATCH_CODE) {
+            int extra;
+            do {
+                if (ip >= src_len) {
+                    return -1;
+                }
+                extra = src[ip++];
+                len += extra;
+            } while (extra == 255 && len <= dst_cap);
+        }
+        len += LZ_MIN_MATCH;
+        
+        if (offset == 0 || offset > op || len > dst_cap - op) {
+            return -1;
+        }
+        
+        // Copia solapada (offset < len): el patrón se repite cada offset
+        // bytes, así que se copia en tramos que duplican la distancia
+        int distance = offset;
+        while (len > 0) {
+            int n = len < distance ? len : distance;
+            memcpy(dst + op, dst + op - distance, n);
+            op += n;
+            len -= n;
+            distance *= 2;
+        }
+    }
+    return op;
+}
@@ -0,0 +1,226 @@
+#include <float.h>
+#include "../include/protocol.h"
+#include "../include/congestion.h"
+
+// Control de congestión y pacing
+
+// Recalcula la tasa de pacing: cwnd por RTT, con margen según la fase
+static void cc_update_pacing(CongestionControl *cc) {
+    if (cc->cwnd > cc->max_cwnd) {
+        cc->max_cwnd = cc->cwnd;
+    }
+    
+    if (cc->srtt_us == 0) {
+        cc->pacing_rate = 0;
+        return;
+    }
+    
+    double gain = cc->cwnd < cc->ssthresh ? CC_PACING_GAIN_SS : CC_PACING_GAIN_CA;
+    cc->pacing_rate = gain * cc->cwnd * 1000000.0 / cc->srtt_us;
+}
+
+// Piso de cwnd / ssthresh tras una reducción
+static double cc_min_window(const CongestionControl *cc) {
+    return (double)CC_MIN_WINDOW * cc->mss;
+}
+
+// NewReno: slow start hasta ssthresh y luego +1 MSS por RTT
+static void newreno_on_ack(CongestionControl *cc, int acked_bytes, uint64_t rtt_us) {
+    (void)rtt_us;
+    
+    if (cc->cwnd < cc->ssthresh) {
+        cc->cwnd += acked_bytes;
+    } else {
+        cc->cwnd += (double)cc->mss * acked_bytes / cc->cwnd;
+    }
+}
+
+// NewReno: cwnd a la mitad
+static void newreno_on_loss(CongestionControl *cc) {
+    cc->ssthresh = cc->cwnd / 2;
+    if (cc->ssthresh < cc_min_window(cc)) {
+        cc->ssthresh = cc_min_window(cc);
+    }
+    cc->cwnd = cc->ssthresh;
+}
+
+// Vegas: una vez por RTT estima los chunks encolados en la red como
+// cwnd * (RTT - RTT base) / RTT y mueve cwnd 1 MSS para dejarlos entre
+// alpha y beta; sale de slow start apenas aparece cola
+static void vegas_on_ack(CongestionControl *cc, int acked_bytes, uint64_t rtt_us) {
+    uint64_t now = now_us();
+    
+    if (rtt_us > 0) {
+        if (cc->base_rtt_us == 0 || rtt_us < cc->base_rtt_us) {
+            cc->base_rtt_us = rtt_us;
+        }
+        if (cc->round_min_rtt_us == 0 || rtt_us < cc->round_min_rtt_us) {
+            cc->round_min_rtt_us = rtt_us;
+        }
+    }
+    
+    if (cc->cwnd < cc->ssthresh) {
+        cc->cwnd += acked_bytes;
+    }
+    
+    // Fin de ronda: pasó un SRTT desde la anterior y hubo muestras
+    if (cc->round_min_rtt_us == 0 || now - cc->round_start_us < cc->srtt_us) {
+        return;
+    }
+    
+    double rtt = (double)cc->round_min_rtt_us;
+    double queued = cc->cwnd / cc->mss * (rtt - cc->base_rtt_us) / rtt;
+    
+    if (cc->cwnd < cc->ssthresh) {
+        if (queued > CC_VEGAS_GAMMA) {
+            // Hay cola: bajar a lo que entra sin ella y pasar a evitar congestión
+            cc->cwnd = cc->cwnd * cc->base_rtt_us / rtt + cc->mss;
+            cc->ssthresh = cc->cwnd;
+        }
+    } else if (queued < CC_VEGAS_ALPHA) {
+        cc->cwnd += cc->mss;
+    } else if (queued > CC_VEGAS_BETA) {
+        cc->cwnd -= cc->mss;
+    }
+    
+    if (cc->cwnd < cc_min_window(cc)) {
+        cc->cwnd = cc_min_window(cc);
+    }
+    
+    cc->round_min_rtt_us = 0;
+    cc->round_start_us = now;
+}
+
+static const CongestionOps newreno_ops = { "newreno", newreno_on_ack, newreno_on_loss };
+static const CongestionOps vegas_ops = { "vegas", vegas_on_ack, newreno_on_loss };
+
+// Algoritmos seleccionables por nombre
+static const CongestionOps *cc_algorithms[] = { &newreno_ops, &vegas_ops };
+
+// Inicializa el control con cwnd inicial y sin ssthresh
+int cc_init(CongestionControl *cc, const char *name, int mss, int window,
+            uint64_t srtt_us) {
+    memset(cc, 0, sizeof(CongestionControl));
+    cc->mss = mss;
+    cc->cwnd_limit = (double)window * mss;
+    cc->cwnd = (double)CC_INITIAL_WINDOW * mss;
+    if (cc->cwnd > cc->cwnd_limit) {
+        cc->cwnd = cc->cwnd_limit;
+    }
+    cc->ssthresh = DBL_MAX;
+    cc->srtt_us = srtt_us;
+    cc->round_start_us = now_us();
+    
+    if (strcmp(name, "none") == 0) {
+        return 0;
+    }
+    
+    for (size_t i = 0; i < sizeof(cc_algorithms) / sizeof(cc_algorithms[0]); i++) {
+        if (strcmp(name, cc_algorithms[i]->name) == 0) {
+            cc->ops = cc_algorithms[i];
+            cc_update_pacing(cc);
+            return 0;
+        }
+    }
+    
+    return -1;
+}
+
+// Nombre del algoritmo activo
+const char* cc_name(const CongestionControl *cc) {
+    return cc->ops ? cc->ops->name : "none";
+}
+
+// Sin nada en vuelo siempre se puede enviar un chunk (aunque cwnd < MSS)
+int cc_can_send(const CongestionControl *cc, long in_flight, int len) {
+    if (!cc->ops || in_flight == 0) {
+        return 1;
+    }
+    return in_flight + len <= cc->cwnd;
+}
+
+// Tiempo hasta la próxima salida; el crédito de un período sin envíos se
+// limita a CC_PACING_SLACK_US para no habilitar una ráfaga
+uint64_t cc_pacing_delay_us(CongestionControl *cc, uint64_t now) {
+    if (!cc->ops || cc->pacing_rate <= 0) {
+        return 0;
+    }
+    
+    if (cc->next_send_us + CC_PACING_SLACK_US < now) {
+        cc->next_send_us = now - CC_PACING_SLACK_US;
+    }
+    return cc->next_send_us > now ? cc->next_send_us - now : 0;
+}
+
+// Avanza el reloj de pacing lo que tardan len bytes a la tasa actual
+void cc_on_send(CongestionControl *cc, int len, uint64_t now) {
+    if (!cc->ops || cc->pacing_rate <= 0) {
+        return;
+    }
+    
+    if (cc->next_send_us + CC_PACING_SLACK_US < now) {
+        cc->next_send_us = now - CC_PACING_SLACK_US;
+    }
+    cc->next_send_us += (uint64_t)(len * 1000000.0 / cc->pacing_rate);
+}
+
+// ACK de un chunk nuevo: termina la recuperación cuando base pasa recover;
+// durante la recuperación cwnd no crece
+void cc_on_ack(CongestionControl *cc, int acked_bytes, uint64_t rtt_us,
+               uint64_t srtt_us, uint32_t base) {
+    if (!cc->ops) {
+        return;
+    }
+    
+    cc->srtt_us = srtt_us;
+    
+    if (cc->in_recovery && (int32_t)(base - cc->recover) >= 0) {
+        cc->in_recovery = 0;
+    }
+    if (!cc->in_recovery) {
+        cc->ops->on_ack(cc, acked_bytes, rtt_us);
+    }
+    
+    // Más allá de la ventana negociada cwnd no limita nada: no dejarla crecer
+    if (cc->cwnd > cc->cwnd_limit) {
+        cc->cwnd = cc->cwnd_limit;
+    }
+    
+    cc_update_pacing(cc);
+}
+
+// Pérdida detectada por ACKs posteriores: una reducción por ventana
+void cc_on_loss(CongestionControl *cc, uint32_t seq, uint32_t next) {
+    cc->losses++;
+    if (!cc->ops) {
+        return;
+    }
+    
+    // Chunk enviado antes de la última reducción: ya se contó
+    if ((int32_t)(seq - cc->recover) < 0) {
+        return;
+    }
+    
+    cc->in_recovery = 1;
+    cc->recover = next;
+    cc->recoveries++;
+    cc->ops->on_loss(cc);
+    cc_update_pacing(cc);
+}
+
+// Timeout: la red perdió todo lo que estaba en vuelo, slow start desde 1 MSS
+void cc_on_timeout(CongestionControl *cc, long in_flight, uint32_t next) {
+    cc->timeouts++;
+    if (!cc->ops) {
+        return;
+    }
+    
+    cc->ssthresh = in_flight / 2.0;
+    if (cc->ssthresh < cc_min_window(cc)) {
+        cc->ssthresh = cc_min_window(cc);
+    }
+    cc->cwnd = cc->mss;
+    cc->in_recovery = 0;
+    cc->recover = next;
+    cc_update_pacing(cc);
+}
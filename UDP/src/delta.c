@@ -0,0 +1,479 @@
+#include <endian.h>
+#include "../include/protocol.h"
+#include "../include/checksum.h"
+#include "../include/delta.h"
+
+// Transferencia delta: firmas, generador y aplicación del stream (formato en delta.h)
+
+// Hash fuerte: estructura de XXH64 (4 acumuladores de 8 bytes, mezcla final)
+#define PRIME64_1 0x9E3779B185EBCA87ULL
+#define PRIME64_2 0xC2B2AE3D27D4EB4FULL
+#define PRIME64_3 0x165667B19E3779F9ULL
+#define PRIME64_4 0x85EBCA77C2B2AE63ULL
+#define PRIME64_5 0x27D4EB2F165667C5ULL
+
+// Lecturas little endian: cliente y servidor tienen que obtener el mismo
+// hash aunque sean de distinta arquitectura
+static inline uint64_t read64(const uint8_t *p) {
+    uint64_t value;
+    memcpy(&value, p, sizeof(value));
+    return le64toh(value);
+}
+
+static inline uint32_t read32(const uint8_t *p) {
+    uint32_t value;
+    memcpy(&value, p, sizeof(value));
+    return le32toh(value);
+}
+
+static inline uint64_t rotl64(uint64_t x, int r) {
+    return (x << r) | (x >> (64 - r));
+}
+
+static inline uint64_t strong_round(uint64_t acc, uint64_t input) {
+    acc += input * PRIME64_2;
+    return rotl64(acc, 31) * PRIME64_1;
+}
+
+static inline uint64_t strong_merge(uint64_t acc, uint64_t value) {
+    acc ^= strong_round(0, value);
+    return acc * PRIME64_1 + PRIME64_4;
+}
+
+// Tamaño de bloque para la copia anterior
+int delta_block_size(uint64_t size) {
+    int block = DELTA_MIN_BLOCK;
+    while (block < DELTA_MAX_BLOCK && (uint64_t)block * block < size) {
+        block *= 2;
+    }
+    return block;
+}
+
+// Hash débil: a = suma de los bytes, b = suma ponderada por la distancia al
+// final; 16 bits de cada uno
+uint32_t delta_weak(const uint8_t *data, size_t len) {
+    uint32_t a = 0;
+    uint32_t b = 0;
+    for (size_t i = 0; i < len; i++) {
+        a += data[i];
+        b += (uint32_t)(len - i) * data[i];
+    }
+    return (a & 0xffff) | (b << 16);
+}
+
+// Hash fuerte de 64 bits
+uint64_t delta_strong(const uint8_t *data, size_t len) {
+    const uint8_t *p = data;
+    const uint8_t *end = data + len;
+    uint64_t h;
+    
+    if (len >= 32) {
+        uint64_t v1 = PRIME64_1 + PRIME64_2;
+        uint64_t v2 = PRIME64_2;
+        uint64_t v3 = 0;
+        uint64_t v4 = -PRIME64_1;
+        do {
+            v1 = strong_round(v1, read64(p));
+            v2 = strong_round(v2, read64(p + 8));
+            v3 = strong_round(v3, read64(p + 16));
+            v4 = strong_round(v4, read64(p + 24));
+            p += 32;
+        } while (end - p >= 32);
+        h = rotl64(v1, 1) + rotl64(v2, 7) + rotl64(v3, 12) + rotl64(v4, 18);
+        h = strong_merge(h, v1);
+        h = strong_merge(h, v2);
+        h = strong_merge(h, v3);
+        h = strong_merge(h, v4);
+    } else {
+        h = PRIME64_5;
+    }
+    
+    h += len;
+    while (end - p >= 8) {
+        h ^= strong_round(0, read64(p));
+        h = rotl64(h, 27) * PRIME64_1 + PRIME64_4;
+        p += 8;
+    }
+    if (end - p >= 4) {
+        h ^= (uint64_t)read32(p) * PRIME64_1;
+        h = rotl64(h, 23) * PRIME64_2 + PRIME64_3;
+        p += 4;
+    }
+    while (p < end) {
+        h ^= *p++ * PRIME64_5;
+        h = rotl64(h, 11) * PRIME64_1;
+    }
+    
+    h ^= h >> 33;
+    h *= PRIME64_2;
+    h ^= h >> 29;
+    h *= PRIME64_3;
+    h ^= h >> 32;
+    return h;
+}
+
+// Bucket de la tabla de firmas para un hash débil
+static inline uint32_t sig_bucket(const DeltaEncoder *enc, uint32_t weak) {
+    uint32_t h = weak * 2654435761U;
+    return (h ^ (h >> 16)) & enc->mask;
+}
+
+// Prepara el generador
+int delta_encoder_init(DeltaEncoder *enc, const DeltaSig *sigs, uint32_t blocks,
+                       int block_size, int fd, const uint8_t *map, uint64_t size) {
+    memset(enc, 0, sizeof(DeltaEncoder));
+    enc->sigs = sigs;
+    enc->blocks = blocks;
+    enc->block_size = block_size;
+    enc->fd = fd;
+    enc->map = map;
+    enc->size = size;
+    enc->match_pos = UINT64_MAX;
+    enc->crc = CRC32C_INIT;
+    
+    uint32_t table_size = 1024;
+    while (table_size < 2 * blocks) {
+        table_size *= 2;
+    }
+    enc->mask = table_size - 1;
+    enc->heads = calloc(table_size, sizeof(uint32_t));
+    enc->chain = malloc(((size_t)blocks + 1) * sizeof(uint32_t));
+    
+    // Sin mapeo: el literal más largo más una ventana, dos veces para no
+    // mover los datos en cada lectura
+    if (!map) {
+        enc->buf_size = 2 * ((size_t)DELTA_MAX_LITERAL + block_size + 1);
+        enc->buf = malloc(enc->buf_size);
+    }
+    
+    if (!enc->heads || !enc->chain || (!map && !enc->buf)) {
+        delta_encoder_free(enc);
+        return -1;
+    }
+    
+    // En orden inverso: en cada cadena queda primero el bloque de menor índice
+    for (uint32_t i = blocks; i-- > 0;) {
+        uint32_t h = sig_bucket(enc, sigs[i].weak);
+        enc->chain[i] = enc->heads[h];
+        enc->heads[h] = i + 1;
+    }
+    return 0;
+}
+
+void delta_encoder_free(DeltaEncoder *enc) {
+    free(enc->heads);
+    free(enc->chain);
+    free(enc->buf);
+    enc->heads = NULL;
+    enc->chain = NULL;
+    enc->buf = NULL;
+}
+
+// Bytes [off, off + len) del archivo nuevo
+// Sin mapeo se conserva en el buffer desde el literal pendiente
+// Retorna NULL si falla la lectura o el archivo se achicó
+static const uint8_t* encoder_window(DeltaEncoder *enc, uint64_t off, size_t len) {
+    if (enc->map) {
+        return enc->map + off;
+    }
+    
+    if (off + len > enc->buf_off + enc->buf_len) {
+        size_t keep_from = enc->lit - enc->buf_off;
+        memmove(enc->buf, enc->buf + keep_from, enc->buf_len - keep_from);
+        enc->buf_len -= keep_from;
+        enc->buf_off = enc->lit;
+        
+        while (enc->buf_len < enc->buf_size) {
+            ssize_t got = pread(enc->fd, enc->buf + enc->buf_len, enc->buf_size - enc->buf_len,
+                                (off_t)(enc->buf_off + enc->buf_len));
+            if (got < 0) {
+                if (errno == EINTR) continue;
+                return NULL;
+            }
+            if (got == 0) {
+                break;
+            }
+            enc->buf_len += got;
+        }
+        if (off + len > enc->buf_off + enc->buf_len) {
+            errno = EIO;
+            return NULL;
+        }
+    }
+    return enc->buf + (off - enc->buf_off);
+}
+
+// Bloque de la copia anterior igual a la ventana en pos, o -1
+static long encoder_lookup(DeltaEncoder *enc, const uint8_t *window) {
+    if (enc->match_pos == enc->pos) {
+        return enc->match_block;
+    }
+    
+    uint32_t weak = (enc->a & 0xffff) | (enc->b << 16);
+    uint64_t strong = 0;
+    int have_strong = 0;
+    long match = -1;
+    
+    // Primero el bloque que sigue a la corrida: mantiene las copias juntas
+    // aunque la copia anterior tenga bloques repetidos
+    if (enc->copy_count > 0 && enc->lit == enc->pos) {
+        uint32_t next = enc->copy_block + enc->copy_count;
+        if (next < enc->blocks && enc->sigs[next].weak == weak) {
+            strong = delta_strong(window, enc->block_size);
+            have_strong = 1;
+            if (enc->sigs[next].strong == strong) {
+                match = next;
+            }
+        }
+    }
+    
+    for (uint32_t i = enc->heads[sig_bucket(enc, weak)]; match < 0 && i; i = enc->chain[i - 1]) {
+        const DeltaSig *sig = &enc->sigs[i - 1];
+        if (sig->weak != weak) {
+            continue;
+        }
+        if (!have_strong) {
+            strong = delta_strong(window, enc->block_size);
+            have_strong = 1;
+        }
+        if (sig->strong == strong) {
+            match = i - 1;
+        }
+    }
+    
+    if (match >= 0) {
+        enc->match_pos = enc->pos;
+        enc->match_block = (uint32_t)match;
+    }
+    return match;
+}
+
+// Deja lista la corrida de copias pendiente
+static void emit_copy(DeltaEncoder *enc) {
+    enc->op[0] = DELTA_OP_COPY;
+    put_be32(enc->op + 1, enc->copy_block);
+    put_be32(enc->op + 5, enc->copy_count);
+    enc->op_len = DELTA_COPY_SIZE;
+    enc->copied_bytes += (uint64_t)enc->copy_count * enc->block_size;
+    enc->copy_count = 0;
+}
+
+// Deja listo el literal pendiente hasta end (a lo sumo DELTA_MAX_LITERAL)
+static int emit_literal(DeltaEncoder *enc, uint64_t end) {
+    size_t len = end - enc->lit;
+    if (len > DELTA_MAX_LITERAL) {
+        len = DELTA_MAX_LITERAL;
+    }
+    
+    const uint8_t *data = encoder_window(enc, enc->lit, len);
+    if (!data) {
+        return -1;
+    }
+    
+    enc->op[0] = DELTA_OP_LITERAL;
+    put_be32(enc->op + 1, (uint32_t)len);
+    enc->op_len = DELTA_LITERAL_HDR;
+    enc->lit_data = data;
+    enc->lit_left = len;
+    enc->crc = crc32c_update(enc->crc, data, len);
+    enc->literal_bytes += len;
+    enc->lit += len;
+    return 0;
+}
+
+// Recorre el archivo hasta dejar lista la próxima instrucción (o terminar)
+// Retorna 0 si OK, -1 si error de lectura
+static int encoder_step(DeltaEncoder *enc) {
+    uint64_t block = enc->block_size;
+    
+    for (;;) {
+        // Sin bloques completos por delante: corrida, cola literal y fin
+        if (enc->blocks == 0 || enc->pos + block > enc->size) {
+            if (enc->copy_count > 0) {
+                emit_copy(enc);
+                return 0;
+            }
+            if (enc->lit < enc->size) {
+                return emit_literal(enc, enc->size);
+            }
+            enc->done = 1;
+            return 0;
+        }
+        
+        // La ventana más el byte que entra al correrla
+        int has_next = enc->pos + block < enc->size;
+        const uint8_t *window = encoder_window(enc, enc->pos, block + has_next);
+        if (!window) {
+            return -1;
+        }
+        if (!enc->rolling) {
+            uint32_t weak = delta_weak(window, block);
+            enc->a = weak & 0xffff;
+            enc->b = weak >> 16;
+            enc->rolling = 1;
+        }
+        
+        long match = encoder_lookup(enc, window);
+        if (match >= 0) {
+            // Lo anterior sale primero: la corrida y después el literal
+            int extends = enc->copy_count > 0 && enc->lit == enc->pos &&
+                          (uint32_t)match == enc->copy_block + enc->copy_count;
+            if (!extends && enc->copy_count > 0) {
+                emit_copy(enc);
+                return 0;
+            }
+            if (enc->lit < enc->pos) {
+                return emit_literal(enc, enc->pos);
+            }
+            
+            if (!extends) {
+                enc->copy_block = (uint32_t)match;
+            }
+            enc->copy_count++;
+            enc->crc = crc32c_update(enc->crc, window, block);
+            enc->pos += block;
+            enc->lit = enc->pos;
+            enc->rolling = 0;
+            continue;
+        }
+        
+        // Literal largo: se entrega antes de seguir (acota la ventana de lectura)
+        if (enc->pos - enc->lit >= DELTA_MAX_LITERAL) {
+            if (enc->copy_count > 0) {
+                emit_copy(enc);
+                return 0;
+            }
+            return emit_literal(enc, enc->pos);
+        }
+        
+        // Correr la ventana un byte
+        if (has_next) {
+            uint32_t out = window[0];
+            enc->a += window[block] - out;
+            enc->b += enc->a - (uint32_t)block * out;
+        }
+        enc->pos++;
+    }
+}
+
+// Entrega el stream de instrucciones
+int delta_encoder_read(void *encoder, uint8_t *buf, size_t len) {
+    DeltaEncoder *enc = encoder;
+    size_t n = 0;
+    
+    while (n < len) {
+        if (enc->op_pos < enc->op_len) {
+            size_t chunk = enc->op_len - enc->op_pos;
+            if (chunk > len - n) {
+                chunk = len - n;
+            }
+            memcpy(buf + n, enc->op + enc->op_pos, chunk);
+            enc->op_pos += chunk;
+            n += chunk;
+            continue;
+        }
+        if (enc->lit_left > 0) {
+            size_t chunk = enc->lit_left < len - n ? enc->lit_left : len - n;
+            memcpy(buf + n, enc->lit_data, chunk);
+            enc->lit_data += chunk;
+            enc->lit_left -= chunk;
+            n += chunk;
+            continue;
+        }
+        if (enc->done) {
+            break;
+        }
+        
+        enc->op_len = 0;
+        enc->op_pos = 0;
+        if (encoder_step(enc) < 0) {
+            return -1;
+        }
+    }
+    return (int)n;
+}
+
+// Copia count bloques de la copia anterior desde block
+static int decode_copy(DeltaDecoder *dec, uint32_t block, uint32_t count,
+                       uint8_t *scratch, size_t scratch_size, DeltaOutput output, void *ctx) {
+    uint64_t offset = (uint64_t)block * dec->block_size;
+    uint64_t left = (uint64_t)count * dec->block_size;
+    
+    while (left > 0) {
+        size_t len = left < scratch_size ? left : scratch_size;
+        ssize_t got = pread(dec->basis_fd, scratch, len, (off_t)offset);
+        if (got < 0 && errno == EINTR) {
+            continue;
+        }
+        if (got <= 0) {
+            return -1;
+        }
+        if (output(ctx, scratch, got) < 0) {
+            return -1;
+        }
+        offset += got;
+        left -= got;
+    }
+    
+    dec->output_bytes += (uint64_t)count * dec->block_size;
+    dec->copied_bytes += (uint64_t)count * dec->block_size;
+    return 0;
+}
+
+// Aplica una parte del stream
+int delta_decode(DeltaDecoder *dec, const uint8_t *data, size_t len,
+                 uint8_t *scratch, size_t scratch_size, DeltaOutput output, void *ctx) {
+    while (len > 0) {
+        // Resto de un literal
+        if (dec->literal_left > 0) {
+            size_t chunk = dec->literal_left < len ? dec->literal_left : len;
+            if (output(ctx, data, chunk) < 0) {
+                return -1;
+            }
+            dec->output_bytes += chunk;
+            dec->literal_left -= chunk;
+            data += chunk;
+            len -= chunk;
+            continue;
+        }
+        
+        // Instrucción, que puede venir cortada entre dos DATA
+        uint8_t op = dec->op_len > 0 ? dec->op[0] : data[0];
+        if (op != DELTA_OP_LITERAL && op != DELTA_OP_COPY) {
+            return -1;
+        }
+        int need = op == DELTA_OP_LITERAL ? DELTA_LITERAL_HDR : DELTA_COPY_SIZE;
+        size_t chunk = need - dec->op_len;
+        if (chunk > len) {
+            chunk = len;
+        }
+        memcpy(dec->op + dec->op_len, data, chunk);
+        dec->op_len += chunk;
+        data += chunk;
+        len -= chunk;
+        if (dec->op_len < need) {
+            break;
+        }
+        dec->op_len = 0;
+        
+        if (op == DELTA_OP_LITERAL) {
+            dec->literal_left = get_be32(dec->op + 1);
+            if (dec->literal_left == 0 || dec->literal_left > DELTA_MAX_LITERAL) {
+                return -1;
+            }
+            continue;
+        }
+        
+        uint32_t block = get_be32(dec->op + 1);
+        uint32_t count = get_be32(dec->op + 5);
+        if (count == 0 || (uint64_t)block + count > dec->blocks ||
+            decode_copy(dec, block, count, scratch, scratch_size, output, ctx) < 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+int delta_decode_complete(const DeltaDecoder *dec) {
+    return dec->op_len == 0 && dec->literal_left == 0;
+}
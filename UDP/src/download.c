@@ -0,0 +1,251 @@
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "../include/protocol.h"
+#include "../include/download.h"
+#include "../include/checksum.h"
+
+// Envío de archivos al cliente (formato en protocol.h)
+
+int download_open(Download *dl, const char *path, int blksize, int window, int checksum) {
+    struct stat st;
+    
+    memset(dl, 0, sizeof(Download));
+    dl->fd = open(path, O_RDONLY);
+    if (dl->fd < 0) {
+        return -1;
+    }
+    
+    // Compartido con otras descargas; una subida en curso lo tiene exclusivo
+    if (flock(dl->fd, LOCK_SH | LOCK_NB) < 0 || fstat(dl->fd, &st) < 0) {
+        int saved_errno = errno == EWOULDBLOCK ? EBUSY : errno;
+        close(dl->fd);
+        errno = saved_errno;
+        return -1;
+    }
+    
+    dl->size = (uint64_t)st.st_size;
+    uint64_t chunks = (dl->size + blksize - 1) / blksize;
+    if (!S_ISREG(st.st_mode) || chunks > UINT32_MAX) {
+        close(dl->fd);
+        errno = S_ISREG(st.st_mode) ? EFBIG : EINVAL;
+        return -1;
+    }
+    
+    if (dl->size > 0) {
+        void *map = mmap(NULL, dl->size, PROT_READ, MAP_SHARED, dl->fd, 0);
+        if (map == MAP_FAILED) {
+            int saved_errno = errno;
+            close(dl->fd);
+            errno = saved_errno;
+            return -1;
+        }
+        madvise(map, dl->size, MADV_SEQUENTIAL);
+        dl->map = map;
+    }
+    
+    dl->slots = calloc(window, sizeof(DownloadSlot));
+    if (!dl->slots) {
+        download_close(dl);
+        errno = ENOMEM;
+        return -1;
+    }
+    
+    dl->blksize = blksize;
+    dl->window = window;
+    dl->checksum = checksum;
+    dl->chunks = (uint32_t)chunks;
+    rtt_init(&dl->rtt);
+    cc_init(&dl->cc, CC_DEFAULT, blksize, window, 0);
+    return 0;
+}
+
+void download_close(Download *dl) {
+    if (dl->map) {
+        munmap((void*)dl->map, dl->size);
+        dl->map = NULL;
+    }
+    if (dl->fd >= 0) {
+        close(dl->fd);
+        dl->fd = -1;
+    }
+    free(dl->slots);
+    dl->slots = NULL;
+}
+
+int download_complete(const Download *dl) {
+    return dl->base == dl->chunks;
+}
+
+// Bytes del chunk seq (el último puede ser menor)
+static int chunk_len(const Download *dl, uint32_t seq) {
+    uint64_t offset = (uint64_t)seq * dl->blksize;
+    return dl->size - offset < (uint64_t)dl->blksize ? (int)(dl->size - offset) : dl->blksize;
+}
+
+// Envía (o reenvía) el chunk seq y arma su timer con el RTO actual
+static int send_chunk(Download *dl, uint32_t seq, DownloadSendFn send, void *ctx) {
+    uint8_t hdr[2 + EXT_SEQ_SIZE + EXT_CRC_SIZE];
+    const uint8_t *data = dl->map + (uint64_t)seq * dl->blksize;
+    int len = chunk_len(dl, seq);
+    int hdr_len = 2 + EXT_SEQ_SIZE;
+    
+    hdr[0] = TYPE_DATA;
+    hdr[1] = 0;
+    put_be32(hdr + 2, seq);
+    
+    // CRC del seq y del payload, como en las subidas
+    if (dl->checksum) {
+        uint32_t crc = crc32c_update(CRC32C_INIT, hdr + 2, EXT_SEQ_SIZE);
+        hdr[1] |= DATA_FLAG_CRC;
+        put_be32(hdr + hdr_len,
+                 crc32c_combine(crc, crc32c_update(CRC32C_INIT, data, len), len));
+        hdr_len += EXT_CRC_SIZE;
+    }
+    
+    DownloadSlot *slot = &dl->slots[seq % dl->window];
+    slot->sent_us = now_us();
+    slot->deadline = slot->sent_us / 1000 + rtt_timeout_ms(&dl->rtt);
+    cc_on_send(&dl->cc, len, slot->sent_us);
+    return send(ctx, hdr, hdr_len, data, len);
+}
+
+uint64_t download_on_ack(Download *dl, const uint8_t *data, int len, uint8_t flags) {
+    uint32_t acked[WINDOW_MAX];
+    int count = 0;
+    
+    if (len < EXT_SEQ_SIZE) {
+        return 0;
+    }
+    
+    // Chunks que el ACK reconoce por primera vez: con SACK todo lo anterior
+    // a Cum y lo marcado en el bitmap, si no el seq del ACK
+    uint32_t seq = get_be32(data);
+    if (flags & ACK_FLAG_SACK) {
+        for (uint32_t s = dl->base; seq - dl->base <= dl->next - dl->base && s != seq; s++) {
+            if (!dl->slots[s % dl->window].acked) {
+                acked[count++] = s;
+            }
+        }
+        const uint8_t *bitmap = data + EXT_SEQ_SIZE;
+        int bitmap_len = len - EXT_SEQ_SIZE;
+        for (int i = 0; i < bitmap_len * 8 && seq + 1 + i - dl->base < dl->next - dl->base; i++) {
+            uint32_t s = seq + 1 + i;
+            if ((bitmap[i / 8] & (1 << (i % 8))) && !dl->slots[s % dl->window].acked) {
+                acked[count++] = s;
+            }
+        }
+    } else if (seq - dl->base < dl->next - dl->base && !dl->slots[seq % dl->window].acked) {
+        acked[count++] = seq;
+    }
+    
+    if (count == 0) {
+        return 0;
+    }
+    
+    // Muestra de RTT del último enviado entre los no retransmitidos (Karn)
+    DownloadSlot *newest = NULL;
+    uint64_t acked_bytes = 0;
+    uint64_t rtt_us = 0;
+    for (int i = 0; i < count; i++) {
+        DownloadSlot *slot = &dl->slots[acked[i] % dl->window];
+        int bytes = chunk_len(dl, acked[i]);
+        slot->acked = 1;
+        acked_bytes += bytes;
+        if (!slot->lost) {
+            dl->in_flight -= bytes;
+        }
+        if (slot->retries == 0 && (!newest || slot->sent_us > newest->sent_us)) {
+            newest = slot;
+        }
+    }
+    if (newest) {
+        rtt_us = now_us() - newest->sent_us;
+        rtt_sample(&dl->rtt, rtt_us);
+    }
+    
+    // Chunks anteriores enviados antes que uno reconocido: con
+    // CC_DUPACK_THRESHOLD se dan por perdidos
+    for (int i = 0; i < count; i++) {
+        DownloadSlot *slot = &dl->slots[acked[i] % dl->window];
+        for (uint32_t prev = dl->base; prev != acked[i]; prev++) {
+            DownloadSlot *older = &dl->slots[prev % dl->window];
+            if (older->acked || older->lost || older->sent_us >= slot->sent_us) {
+                continue;
+            }
+            if (++older->dupacks >= CC_DUPACK_THRESHOLD) {
+                older->lost = 1;
+                dl->in_flight -= chunk_len(dl, prev);
+                cc_on_loss(&dl->cc, prev, dl->next);
+            }
+        }
+    }
+    
+    // Deslizar la ventana
+    while (dl->base != dl->next && dl->slots[dl->base % dl->window].acked) {
+        dl->base++;
+    }
+    cc_on_ack(&dl->cc, (int)acked_bytes, rtt_us, dl->rtt.srtt_us, dl->base);
+    return acked_bytes;
+}
+
+int download_poll(Download *dl, DownloadSendFn send, void *ctx) {
+    uint64_t now = now_ms();
+    int sent = 0;
+    
+    // Timers vencidos: el RTO se duplica una vez por ronda, no por chunk
+    int backed_off = 0;
+    for (uint32_t seq = dl->base; seq != dl->next; seq++) {
+        DownloadSlot *slot = &dl->slots[seq % dl->window];
+        if (slot->acked || slot->lost || slot->deadline > now) {
+            continue;
+        }
+        if (slot->retries >= MAX_RETRIES) {
+            return -1;
+        }
+        if (!backed_off) {
+            rtt_backoff(&dl->rtt);
+            cc_on_timeout(&dl->cc, dl->in_flight, dl->next);
+            backed_off = 1;
+        }
+        slot->lost = 1;
+        dl->in_flight -= chunk_len(dl, seq);
+    }
+    
+    // Retransmisiones primero, también dentro de cwnd
+    for (uint32_t seq = dl->base; seq != dl->next; seq++) {
+        DownloadSlot *slot = &dl->slots[seq % dl->window];
+        int len = chunk_len(dl, seq);
+        if (slot->acked || !slot->lost) {
+            continue;
+        }
+        if (!cc_can_send(&dl->cc, dl->in_flight, len)) {
+            return sent;
+        }
+        slot->retries++;
+        dl->retransmits++;
+        if (send_chunk(dl, seq, send, ctx) < 0) {
+            return sent;
+        }
+        slot->lost = 0;
+        slot->dupacks = 0;
+        dl->in_flight += len;
+        sent++;
+    }
+    
+    // Chunks nuevos mientras la ventana, cwnd y el pacing lo permitan
+    while (dl->next != dl->chunks && dl->next - dl->base < (uint32_t)dl->window &&
+           cc_can_send(&dl->cc, dl->in_flight, dl->blksize) &&
+           cc_pacing_delay_us(&dl->cc, now_us()) == 0) {
+        DownloadSlot *slot = &dl->slots[dl->next % dl->window];
+        memset(slot, 0, sizeof(DownloadSlot));
+        if (send_chunk(dl, dl->next, send, ctx) < 0) {
+            break;
+        }
+        dl->in_flight += chunk_len(dl, dl->next);
+        dl->next++;
+        sent++;
+    }
+    return sent;
+}
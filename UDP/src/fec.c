@@ -0,0 +1,67 @@
+#include <string.h>
+#include "../include/fec.h"
+
+// Paridad XOR por grupos de DATA (formato en fec.h y protocol.h)
+
+void fec_xor(uint8_t *dst, const uint8_t *src, size_t len) {
+    size_t i = 0;
+    
+    // De a 8 bytes (memcpy: sin suponer alineación) y después de a uno
+    for (; i + 8 <= len; i += 8) {
+        uint64_t a, b;
+        memcpy(&a, dst + i, sizeof(a));
+        memcpy(&b, src + i, sizeof(b));
+        a ^= b;
+        memcpy(dst + i, &a, sizeof(a));
+    }
+    for (; i < len; i++) {
+        dst[i] ^= src[i];
+    }
+}
+
+void fec_group_reset(FecGroup *group, uint32_t first) {
+    memset(group->xor, 0, group->max_len);
+    group->first = first;
+    group->members = 0;
+    group->count = 0;
+    group->len_xor = 0;
+    group->flags_xor = 0;
+    group->max_len = 0;
+}
+
+// XOR de len bytes sobre el acumulador (lo que pasa de max_len ya está en cero)
+static void accumulate(FecGroup *group, const uint8_t *data, int len) {
+    fec_xor(group->xor, data, len);
+    if (len > group->max_len) {
+        group->max_len = len;
+    }
+}
+
+void fec_group_add(FecGroup *group, int index, const uint8_t *data, int len, uint8_t flags) {
+    accumulate(group, data, len);
+    group->members |= 1u << index;
+    group->len_xor ^= (uint16_t)len;
+    group->flags_xor ^= flags;
+}
+
+void fec_group_add_parity(FecGroup *group, int count, uint16_t len_xor, uint8_t flags,
+                          const uint8_t *data, int len) {
+    accumulate(group, data, len);
+    group->count = count;
+    group->len_xor ^= len_xor;
+    group->flags_xor ^= flags;
+}
+
+int fec_group_missing(const FecGroup *group) {
+    if (group->count == 0) {
+        return -1;
+    }
+    uint32_t all = group->count == FEC_MAX_K ? UINT32_MAX : (1u << group->count) - 1;
+    uint32_t missing = all & ~group->members;
+    
+    // Exactamente un bit en cero (y ningún DATA fuera del grupo)
+    if (missing == 0 || (missing & (missing - 1)) != 0 || (group->members & ~all) != 0) {
+        return -1;
+    }
+    return __builtin_ctz(missing);
+}
@@ -0,0 +1,407 @@
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include "../include/protocol.h"
+#include "../include/file_sink.h"
+#include "../include/checksum.h"
+
+// Escritura diferida de archivos recibidos
+
+// Escribe todo el buffer con write(2), reintentando escrituras parciales
+static int write_all(int fd, const uint8_t *data, size_t len) {
+    while (len > 0) {
+        ssize_t written = write(fd, data, len);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        data += written;
+        len -= written;
+    }
+    return 0;
+}
+
+// Escribe todo el buffer con pwrite(2) a partir de offset
+static int pwrite_all(int fd, const uint8_t *data, size_t len, uint64_t offset) {
+    while (len > 0) {
+        ssize_t written = pwrite(fd, data, len, (off_t)offset);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        data += written;
+        len -= written;
+        offset += written;
+    }
+    return 0;
+}
+
+// Lee un checkpoint "<offset> <crc32c>"
+// Retorna 0 si es válido, -1 si no existe o está corrupto
+static int read_checkpoint(const char *path, uint64_t *offset, uint32_t *crc) {
+    FILE *file = fopen(path, "r");
+    if (!file) {
+        return -1;
+    }
+    
+    unsigned long long value;
+    unsigned int sum;
+    int ok = fscanf(file, "%llu %x", &value, &sum) == 2;
+    fclose(file);
+    if (!ok) {
+        return -1;
+    }
+    
+    *offset = value;
+    *crc = sum;
+    return 0;
+}
+
+// Registra el prefijo escrito; en modo durable antes lo lleva a disco para
+// que el checkpoint nunca adelante a los datos
+static int sink_checkpoint(FileSink *sink) {
+    if (sink->ckpt_fd < 0) {
+        return 0;
+    }
+    if (sink->durable && fdatasync(sink->fd) < 0) {
+        return -1;
+    }
+    
+    // Ancho fijo: se sobrescribe en el lugar sin truncar
+    char line[32];
+    int len = snprintf(line, sizeof(line), "%020llu %08x\n",
+                       (unsigned long long)sink->committed, sink->crc);
+    if (pwrite_all(sink->ckpt_fd, (const uint8_t*)line, len, 0) < 0) {
+        return -1;
+    }
+    
+    sink->last_ckpt = sink->committed;
+    return 0;
+}
+
+// Suma datos recién escritos al prefijo (y hace checkpoint si toca)
+// Con known = 1 data_crc ya es el CRC32C de los datos
+static int sink_commit(FileSink *sink, const uint8_t *data, size_t len,
+                       int known, uint32_t data_crc) {
+    if (sink->ckpt_fd < 0) {
+        return 0;
+    }
+    
+    sink->crc = known ? crc32c_combine(sink->crc, data_crc, len)
+                      : crc32c_update(sink->crc, data, len);
+    sink->committed += len;
+    if (sink->committed - sink->last_ckpt >= SINK_CHECKPOINT_BYTES) {
+        return sink_checkpoint(sink);
+    }
+    return 0;
+}
+
+// Prefijo que se puede retomar
+uint64_t sink_resumable(const char *path, int durable) {
+    char file_path[260];
+    char ckpt_path[264];
+    uint64_t offset;
+    uint32_t crc;
+    struct stat st;
+    
+    snprintf(file_path, sizeof(file_path), durable ? "%s.tmp" : "%s", path);
+    snprintf(ckpt_path, sizeof(ckpt_path), "%s.ckpt", path);
+    if (read_checkpoint(ckpt_path, &offset, &crc) < 0 || stat(file_path, &st) < 0 ||
+        (uint64_t)st.st_size < offset) {
+        return 0;
+    }
+    return offset;
+}
+
+// Abre el checkpoint con un flock exclusivo: mientras un sink (o un archivo
+// multi-stream) lo tiene, ningún otro (de cualquier worker) trunca ni
+// escribe el mismo archivo
+// Retorna el descriptor o -1 si error (errno = EBUSY si está tomado)
+static int lock_checkpoint(const char *ckpt_path) {
+    struct stat st, path_st;
+    
+    while (1) {
+        int fd = open(ckpt_path, O_WRONLY | O_CREAT, 0644);
+        if (fd < 0) {
+            return -1;
+        }
+        if (flock(fd, LOCK_EX | LOCK_NB) < 0) {
+            int saved_errno = errno == EWOULDBLOCK ? EBUSY : errno;
+            close(fd);
+            errno = saved_errno;
+            return -1;
+        }
+        
+        // El dueño anterior pudo borrarlo (subida completa) entre el open y
+        // el flock: el lock tiene que ser del checkpoint que está en path
+        if (fstat(fd, &st) == 0 && stat(ckpt_path, &path_st) == 0 &&
+            st.st_dev == path_st.st_dev && st.st_ino == path_st.st_ino) {
+            return fd;
+        }
+        close(fd);
+    }
+}
+
+// Lock del checkpoint antes de abrir el sink
+int sink_lock(const char *path) {
+    char ckpt_path[264];
+    snprintf(ckpt_path, sizeof(ckpt_path), "%s.ckpt", path);
+    return lock_checkpoint(ckpt_path);
+}
+
+// Abre el archivo destino (o retoma uno parcial)
+int sink_open(FileSink *sink, const char *path, size_t buf_size, int durable, int resume,
+              int lock_fd) {
+    memset(sink, 0, sizeof(FileSink));
+    sink->ckpt_fd = -1;
+    
+    if (buf_size < SINK_BUFFER_MIN) {
+        buf_size = SINK_BUFFER_MIN;
+    }
+    
+    snprintf(sink->path, sizeof(sink->path), "%s", path);
+    snprintf(sink->tmp_path, sizeof(sink->tmp_path), "%s.tmp", path);
+    snprintf(sink->ckpt_path, sizeof(sink->ckpt_path), "%s.ckpt", path);
+    sink->durable = durable;
+    
+    sink->buf = malloc(buf_size);
+    if (!sink->buf) {
+        if (lock_fd >= 0) {
+            close(lock_fd);
+        }
+        return -1;
+    }
+    sink->buf_size = buf_size;
+    
+    sink->ckpt_fd = lock_fd >= 0 ? lock_fd : lock_checkpoint(sink->ckpt_path);
+    if (sink->ckpt_fd < 0) {
+        int saved_errno = errno;
+        free(sink->buf);
+        sink->buf = NULL;
+        errno = saved_errno;
+        return -1;
+    }
+    
+    // Retomar: el parcial tiene que tener al menos el prefijo registrado;
+    // lo que haya después (escrito sin checkpoint) se descarta
+    const char *open_path = durable ? sink->tmp_path : sink->path;
+    uint64_t offset;
+    uint32_t crc;
+    struct stat st;
+    sink->fd = -1;
+    if (resume && read_checkpoint(sink->ckpt_path, &offset, &crc) == 0 &&
+        stat(open_path, &st) == 0 && (uint64_t)st.st_size >= offset) {
+        sink->fd = open(open_path, O_WRONLY);
+        if (sink->fd >= 0 && (ftruncate(sink->fd, (off_t)offset) < 0 ||
+                              lseek(sink->fd, 0, SEEK_END) < 0)) {
+            close(sink->fd);
+            sink->fd = -1;
+        }
+        if (sink->fd >= 0) {
+            sink->committed = offset;
+            sink->crc = crc;
+            sink->last_ckpt = offset;
+        }
+    }
+    
+    if (sink->fd < 0) {
+        sink->fd = open(open_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    }
+    
+    // Un archivo nuevo pisa el checkpoint que hubiera
+    if (sink->fd < 0 || (sink->committed == 0 && sink_checkpoint(sink) < 0)) {
+        int saved_errno = errno;
+        if (sink->fd >= 0) {
+            close(sink->fd);
+        }
+        close(sink->ckpt_fd);
+        free(sink->buf);
+        sink->buf = NULL;
+        errno = saved_errno;
+        return -1;
+    }
+    
+    sink->open = 1;
+    return 0;
+}
+
+// Escritura por offset sobre un descriptor ajeno
+int sink_attach(FileSink *sink, int fd, const char *path, size_t buf_size) {
+    memset(sink, 0, sizeof(FileSink));
+    
+    if (buf_size < SINK_BUFFER_MIN) {
+        buf_size = SINK_BUFFER_MIN;
+    }
+    
+    snprintf(sink->path, sizeof(sink->path), "%s", path);
+    sink->buf = malloc(buf_size);
+    if (!sink->buf) {
+        return -1;
+    }
+    sink->buf_size = buf_size;
+    sink->fd = fd;
+    sink->ckpt_fd = -1;
+    sink->attached = 1;
+    sink->open = 1;
+    return 0;
+}
+
+// Agrega datos al buffer (known = 1 si crc es su CRC32C)
+static int sink_append(FileSink *sink, const void *data, size_t len,
+                       int known, uint32_t crc) {
+    // Si no entra, vaciar primero
+    if (sink->buf_len + len > sink->buf_size && sink_flush(sink) < 0) {
+        return -1;
+    }
+    
+    // Bloques más grandes que el buffer van directo a disco
+    if (len > sink->buf_size) {
+        if (write_all(sink->fd, data, len) < 0 || sink_commit(sink, data, len, known, crc) < 0) {
+            return -1;
+        }
+        sink->writes++;
+    } else {
+        if (sink->buf_len == 0) {
+            sink->buf_crc = CRC32C_INIT;
+            sink->buf_crc_known = 1;
+        }
+        if (known && sink->buf_crc_known) {
+            sink->buf_crc = crc32c_combine(sink->buf_crc, crc, len);
+        } else {
+            sink->buf_crc_known = 0;
+        }
+        memcpy(sink->buf + sink->buf_len, data, len);
+        sink->buf_len += len;
+    }
+    
+    sink->bytes += len;
+    sink->last_write_ms = now_ms();
+    return 0;
+}
+
+int sink_write(FileSink *sink, const void *data, size_t len) {
+    return sink_append(sink, data, len, 0, 0);
+}
+
+int sink_write_crc(FileSink *sink, const void *data, size_t len, uint32_t crc) {
+    return sink_append(sink, data, len, 1, crc);
+}
+
+// Agrega datos en un offset: extiende la corrida del buffer si es contigua
+int sink_write_at(FileSink *sink, const void *data, size_t len, uint64_t offset) {
+    int contiguous = offset == sink->buf_offset + sink->buf_len;
+    
+    if ((!contiguous || sink->buf_len + len > sink->buf_size) && sink_flush(sink) < 0) {
+        return -1;
+    }
+    
+    if (len > sink->buf_size) {
+        if (pwrite_all(sink->fd, data, len, offset) < 0) {
+            return -1;
+        }
+        sink->writes++;
+    } else {
+        if (sink->buf_len == 0) {
+            sink->buf_offset = offset;
+        }
+        memcpy(sink->buf + sink->buf_len, data, len);
+        sink->buf_len += len;
+    }
+    
+    sink->bytes += len;
+    sink->last_write_ms = now_ms();
+    return 0;
+}
+
+// Escribe lo pendiente
+int sink_flush(FileSink *sink) {
+    if (sink->buf_len == 0) {
+        return 0;
+    }
+    
+    int result = sink->attached
+        ? pwrite_all(sink->fd, sink->buf, sink->buf_len, sink->buf_offset)
+        : write_all(sink->fd, sink->buf, sink->buf_len);
+    if (result < 0 || sink_commit(sink, sink->buf, sink->buf_len,
+                                  sink->buf_crc_known, sink->buf_crc) < 0) {
+        return -1;
+    }
+    
+    sink->writes++;
+    sink->buf_len = 0;
+    return 0;
+}
+
+// Vacía el buffer de una sesión inactiva
+int sink_flush_if_idle(FileSink *sink, uint64_t now) {
+    if (!sink->open || sink->buf_len == 0 || 
+        now - sink->last_write_ms < SINK_IDLE_FLUSH_MS) {
+        return 0;
+    }
+    
+    // Una sesión quieta puede ser un cliente caído: dejar el checkpoint al día
+    if (sink_flush(sink) < 0) {
+        return -1;
+    }
+    return sink->committed != sink->last_ckpt ? sink_checkpoint(sink) : 0;
+}
+
+// Cierra el archivo
+int sink_close(FileSink *sink, int commit) {
+    if (!sink->open) {
+        return 0;
+    }
+    
+    int result = 0;
+    
+    // Una transferencia abortada también conserva lo recibido
+    if (sink_flush(sink) < 0) {
+        perror("[ERROR] Error escribiendo archivo");
+        result = -1;
+    }
+    
+    // fd ajeno: fsync, close y rename los hace el dueño
+    if (sink->attached) {
+        free(sink->buf);
+        sink->buf = NULL;
+        sink->open = 0;
+        sink->fd = -1;
+        return result;
+    }
+    
+    if (commit && sink->durable && result == 0 && fsync(sink->fd) < 0) {
+        perror("[ERROR] Error en fsync");
+        result = -1;
+    }
+    
+    // Abortada: checkpoint del prefijo escrito para retomarla
+    if (!commit && result == 0 && sink_checkpoint(sink) < 0) {
+        perror("[ERROR] Error escribiendo checkpoint");
+        result = -1;
+    }
+    
+    if (close(sink->fd) < 0) {
+        result = -1;
+    }
+    
+    // Completo: nombre final y sin checkpoint. Si algo falló queda el
+    // parcial con el último checkpoint válido. El flock se suelta al
+    // final, con el checkpoint ya borrado
+    if (commit && result == 0) {
+        if (sink->durable && rename(sink->tmp_path, sink->path) < 0) {
+            perror("[ERROR] Error renombrando archivo temporal");
+            result = -1;
+        } else {
+            unlink(sink->ckpt_path);
+        }
+    }
+    close(sink->ckpt_fd);
+    
+    free(sink->buf);
+    sink->buf = NULL;
+    sink->open = 0;
+    sink->fd = -1;
+    sink->ckpt_fd = -1;
+    
+    return result;
+}
@@ -0,0 +1,221 @@
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "../include/protocol.h"
+#include "../include/file_source.h"
+
+// Lectura del archivo a enviar: mmap o streaming
+
+// RAM física del equipo (0 si no se puede obtener)
+static uint64_t physical_memory(void) {
+    long pages = sysconf(_SC_PHYS_PAGES);
+    long page_size = sysconf(_SC_PAGESIZE);
+    if (pages <= 0 || page_size <= 0) {
+        return 0;
+    }
+    return (uint64_t)pages * (uint64_t)page_size;
+}
+
+// Abre el archivo
+int source_open(FileSource *source, const char *path) {
+    memset(source, 0, sizeof(FileSource));
+    source->size = -1;
+    source->end = UINT64_MAX;
+    
+    // "-" es la entrada estándar (un pipe: streaming sin tamaño conocido)
+    source->fd = strcmp(path, "-") == 0 ? dup(STDIN_FILENO) : open(path, O_RDONLY);
+    if (source->fd < 0) {
+        return -1;
+    }
+    
+    struct stat st;
+    if (fstat(source->fd, &st) < 0) {
+        int saved_errno = errno;
+        close(source->fd);
+        errno = saved_errno;
+        return -1;
+    }
+    
+    if (!S_ISREG(st.st_mode)) {
+        return 0;                   // Pipe, dispositivo, etc: streaming
+    }
+    
+    source->size = st.st_size;
+    
+    // Archivos vacíos o más grandes que la fracción de RAM: streaming
+    uint64_t ram = physical_memory();
+    if (st.st_size == 0 || (ram > 0 && (uint64_t)st.st_size > ram / SOURCE_MMAP_RAM_FRACTION)) {
+        return 0;
+    }
+    
+    void *map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, source->fd, 0);
+    if (map == MAP_FAILED) {
+        return 0;                   // Sin mmap: streaming
+    }
+    
+    madvise(map, st.st_size, MADV_SEQUENTIAL);
+    source->map = map;
+    source->map_len = st.st_size;
+    
+    return 0;
+}
+
+// Vista de un rango del archivo
+void source_range(const FileSource *source, FileSource *range,
+                  uint64_t offset, uint64_t length) {
+    *range = *source;
+    range->pos = offset;
+    range->end = offset + length;
+    range->is_range = 1;
+}
+
+// Generador en lugar de archivo
+void source_reader(FileSource *source, int (*read)(void *ctx, uint8_t *buf, size_t len),
+                   void *ctx) {
+    memset(source, 0, sizeof(FileSource));
+    source->fd = -1;
+    source->size = -1;
+    source->end = UINT64_MAX;
+    source->reader = read;
+    source->reader_ctx = ctx;
+}
+
+// Completa buf (que ya tiene len bytes, los de pos en adelante) hasta
+// max_len bytes salvo en EOF: los pipes entregan de a poco. Un rango lee
+// por posición porque el offset del descriptor es compartido
+// Retorna los bytes en buf o -1 si error
+static int read_full(FileSource *source, uint8_t *buf, size_t len, size_t max_len) {
+    while (len < max_len) {
+        ssize_t got = source->reader
+            ? source->reader(source->reader_ctx, buf + len, max_len - len)
+            : source->is_range
+            ? pread(source->fd, buf + len, max_len - len, (off_t)(source->pos + len))
+            : read(source->fd, buf + len, max_len - len);
+        if (got < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        if (got == 0) {
+            break;
+        }
+        len += got;
+    }
+    return (int)len;
+}
+
+// Próximo chunk
+int source_next(FileSource *source, size_t max_len, const uint8_t **data, uint8_t *scratch) {
+    if (source->pos >= source->end) {
+        return 0;
+    }
+    if (max_len > source->end - source->pos) {
+        max_len = source->end - source->pos;
+    }
+    
+    if (source->map) {
+        if (source->pos >= source->map_len) {
+            return 0;
+        }
+        
+        size_t len = source->map_len - source->pos;
+        if (len > max_len) {
+            len = max_len;
+        }
+        
+        *data = source->map + source->pos;
+        source->pos += len;
+        return (int)len;
+    }
+    
+    int len = read_full(source, scratch, 0, max_len);
+    if (len < 0) {
+        return -1;
+    }
+    
+    *data = scratch;
+    source->pos += len;
+    return len;
+}
+
+// Próximos bytes sin consumirlos
+int source_peek(FileSource *source, size_t max_len, const uint8_t **data,
+                uint8_t *scratch, size_t scratch_size) {
+    if (source->pos >= source->end) {
+        return 0;
+    }
+    if (max_len > source->end - source->pos) {
+        max_len = source->end - source->pos;
+    }
+    
+    if (source->map) {
+        if (source->pos >= source->map_len) {
+            return 0;
+        }
+        
+        size_t len = source->map_len - source->pos;
+        *data = source->map + source->pos;
+        return (int)(len < max_len ? len : max_len);
+    }
+    
+    // Lo pendiente se mueve al inicio solo cuando no queda lugar detrás
+    if (source->peek_start + max_len > scratch_size) {
+        memmove(scratch, scratch + source->peek_start, source->peek_len);
+        source->peek_start = 0;
+    }
+    
+    uint8_t *buf = scratch + source->peek_start;
+    if (source->peek_len < max_len) {
+        int len = read_full(source, buf, source->peek_len, max_len);
+        if (len < 0) {
+            return -1;
+        }
+        source->peek_len = len;
+    }
+    
+    *data = buf;
+    return (int)(source->peek_len < max_len ? source->peek_len : max_len);
+}
+
+// Consume bytes ya vistos con source_peek
+void source_skip(FileSource *source, size_t len) {
+    source->pos += len;
+    if (!source->map) {
+        source->peek_start += len;
+        source->peek_len -= len;
+    }
+}
+
+// Salta a un offset del archivo
+int source_seek(FileSource *source, uint64_t offset) {
+    if (source->size < 0 || offset > (uint64_t)source->size) {
+        errno = EINVAL;
+        return -1;
+    }
+    if (!source->map && !source->is_range && lseek(source->fd, (off_t)offset, SEEK_SET) < 0) {
+        return -1;
+    }
+    source->pos = offset;
+    source->peek_start = 0;
+    source->peek_len = 0;
+    return 0;
+}
+
+// 1 si se lee del mapeo
+int source_is_mapped(const FileSource *source) {
+    return source->map != NULL;
+}
+
+// Libera recursos
+void source_close(FileSource *source) {
+    if (source->is_range) {
+        return;
+    }
+    if (source->map) {
+        munmap((void*)source->map, source->map_len);
+        source->map = NULL;
+    }
+    if (source->fd >= 0) {
+        close(source->fd);
+        source->fd = -1;
+    }
+}
@@ -0,0 +1,163 @@
+#include "../include/protocol.h"
+#include "../include/impair.h"
+
+// Modelo de red degradada (pérdida, demora, cola) del proxy
+
+// Presets medidos en las capturas de capturas_wireshark/ (DATA -> ACK):
+// LAN ~5 ms de RTT (1-21 ms), internacional ~189 ms y lunar ~2569 ms, con
+// pocos ms de variación; los datagramas de más de 1472 bytes no pasaban
+// (MTU 1500). La demora es de un sentido: el RTT es el doble.
+typedef struct {
+    const char *name;
+    uint64_t delay_us;
+    uint64_t jitter_us;
+    int mtu;
+} ImpairPreset;
+
+static const ImpairPreset presets[] = {
+    { "lan",           2500,    2000, 1472 },
+    { "internacional", 94000,   2000, 1472 },
+    { "lunar",         1284000, 2000, 1472 },
+};
+
+#define NUM_PRESETS (int)(sizeof(presets) / sizeof(presets[0]))
+
+// Números por datagrama: Gilbert-Elliott, pérdida, duplicado, reorden y
+// jitter de cada copia (siempre los mismos, se usen o no)
+#define DRAWS_PER_DATAGRAM 6
+
+void impair_defaults(ImpairConfig *config) {
+    memset(config, 0, sizeof(ImpairConfig));
+    config->name = "custom";
+    config->ge_loss_bad = 1.0;
+    config->reorder_gap_us = IMPAIR_REORDER_GAP_MS * 1000ULL;
+    config->queue_bytes = IMPAIR_QUEUE_DEFAULT;
+}
+
+int impair_preset(ImpairConfig *config, const char *name) {
+    for (int i = 0; i < NUM_PRESETS; i++) {
+        if (strcmp(presets[i].name, name) == 0) {
+            config->name = presets[i].name;
+            config->delay_us = presets[i].delay_us;
+            config->jitter_us = presets[i].jitter_us;
+            config->mtu = presets[i].mtu;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+const char* impair_preset_names(void) {
+    return "lan, internacional, lunar";
+}
+
+// splitmix64: deriva estados independientes de la semilla
+static uint64_t splitmix64(uint64_t x) {
+    x += 0x9E3779B97F4A7C15ULL;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    return x ^ (x >> 31);
+}
+
+// xorshift64*: uniforme en [0, 1)
+static double next_uniform(ImpairLink *link) {
+    link->rng ^= link->rng >> 12;
+    link->rng ^= link->rng << 25;
+    link->rng ^= link->rng >> 27;
+    return ((link->rng * 0x2545F4914F6CDD1DULL) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+void impair_link_init(ImpairLink *link, const ImpairConfig *config,
+                      uint64_t seed, int link_id) {
+    memset(link, 0, sizeof(ImpairLink));
+    link->config = config;
+    link->rng = splitmix64(seed * 2 + (uint64_t)link_id);
+    if (link->rng == 0) {
+        link->rng = 1;
+    }
+}
+
+// Demora de una copia: demora fija más jitter uniforme (nunca negativa)
+static uint64_t copy_delay(const ImpairConfig *config, double u) {
+    int64_t delay = (int64_t)config->delay_us;
+    if (config->jitter_us > 0) {
+        delay += (int64_t)((2.0 * u - 1.0) * (double)config->jitter_us);
+    }
+    return delay > 0 ? (uint64_t)delay : 0;
+}
+
+int impair_process(ImpairLink *link, int len, uint64_t now_us, uint64_t deliver_us[2]) {
+    const ImpairConfig *config = link->config;
+    double u[DRAWS_PER_DATAGRAM];
+    
+    for (int i = 0; i < DRAWS_PER_DATAGRAM; i++) {
+        u[i] = next_uniform(link);
+    }
+    link->stats.received++;
+    
+    // Más grande que el MTU del camino: no pasa
+    if (config->mtu > 0 && len > config->mtu) {
+        link->stats.dropped_mtu++;
+        return 0;
+    }
+    
+    // Gilbert-Elliott: transición de estado y pérdida según el estado,
+    // combinada con la pérdida Bernoulli independiente
+    double ge_loss = 0;
+    if (config->ge_p > 0) {
+        if (link->ge_bad) {
+            link->ge_bad = u[0] >= config->ge_r;
+        } else {
+            link->ge_bad = u[0] < config->ge_p;
+        }
+        ge_loss = link->ge_bad ? config->ge_loss_bad : config->ge_loss_good;
+    }
+    if (u[1] < 1.0 - (1.0 - config->loss) * (1.0 - ge_loss)) {
+        link->stats.dropped_loss++;
+        return 0;
+    }
+    
+    int copies = u[2] < config->duplicate ? 2 : 1;
+    int sent = 0;
+    
+    for (int c = 0; c < copies; c++) {
+        uint64_t start = now_us;
+        
+        // Enlace con ancho de banda limitado: la copia espera en la cola a
+        // que termine la anterior; con la cola llena se descarta
+        if (config->rate_mbps > 0) {
+            if (link->link_free_us > now_us) {
+                uint64_t backlog = (uint64_t)((link->link_free_us - now_us) * config->rate_mbps / 8);
+                if (backlog + (uint64_t)len > config->queue_bytes) {
+                    link->stats.dropped_queue++;
+                    continue;
+                }
+                start = link->link_free_us;
+            }
+            link->link_free_us = start + (uint64_t)(len * 8 / config->rate_mbps);
+            start = link->link_free_us;
+        }
+        
+        uint64_t deliver = start + copy_delay(config, u[4 + c]);
+        
+        // El reordenado se demora sin frenar a los siguientes; el resto sale
+        // en orden aunque el jitter lo adelante
+        if (c == 0 && u[3] < config->reorder) {
+            deliver += config->reorder_gap_us;
+            link->stats.reordered++;
+        } else {
+            if (deliver < link->last_deliver_us) {
+                deliver = link->last_deliver_us;
+            }
+            link->last_deliver_us = deliver;
+        }
+        
+        deliver_us[sent++] = deliver;
+    }
+    
+    if (sent == 2) {
+        link->stats.duplicated++;
+    }
+    link->stats.forwarded += sent;
+    return sent;
+}
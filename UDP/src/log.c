@@ -0,0 +1,494 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#include <sys/types.h>
+#include "../include/log.h"
+
+// Logging asíncrono: ring MPSC de registros y thread de fondo
+
+#define LOG_RING_MASK (LOG_RING_SIZE - 1)
+#define LOG_STAR -2                 // Ancho o precisión '*' en el formato
+#define LOG_SPEC_SIZE 32
+
+// Modificadores de largo
+enum { LEN_NONE, LEN_HH, LEN_H, LEN_L, LEN_LL, LEN_Z, LEN_J, LEN_T, LEN_BIG_L };
+
+// Clases de argumento
+enum { ARG_NONE, ARG_SIGNED, ARG_UNSIGNED, ARG_CHAR, ARG_DOUBLE, ARG_STRING, ARG_POINTER };
+
+typedef union {
+    long long i;
+    unsigned long long u;           // Para ARG_STRING: offset en strings
+    double d;
+    const void *p;
+} LogArg;
+
+typedef struct {
+    atomic_size_t seq;              // pos = libre para pos, pos + 1 = listo
+    const char *fmt;
+    int nargs;
+    int str_len;
+    LogArg args[LOG_MAX_ARGS];
+    char strings[LOG_STRING_SPACE];
+} LogRecord;
+
+// Una conversión del formato
+typedef struct {
+    const char *end;                // Primer caracter después de la conversión
+    char flags[8];
+    int width;                      // -1 = sin ancho, LOG_STAR = '*'
+    int precision;                  // -1 = sin precisión, LOG_STAR = '*'
+    int length;
+    char conv;                      // '%' para "%%"
+} LogSpec;
+
+int log_level = LOG_LEVEL_INFO;
+
+static LogRecord ring[LOG_RING_SIZE];
+static atomic_size_t enqueue_pos;
+static size_t dequeue_pos;          // Solo lo usa el consumidor
+static atomic_int log_running;
+static atomic_int log_stopping;
+static atomic_ullong log_dropped;
+static pthread_t log_thread;
+static int log_atexit_done = 0;
+
+void log_set_level(int level) {
+    if (level < LOG_LEVEL_ERROR) level = LOG_LEVEL_ERROR;
+    if (level > LOG_LEVEL_TRACE) level = LOG_LEVEL_TRACE;
+    log_level = level;
+}
+
+const char* log_level_name(int level) {
+    switch (level) {
+        case LOG_LEVEL_ERROR: return "error";
+        case LOG_LEVEL_WARN:  return "warning";
+        case LOG_LEVEL_INFO:  return "info";
+        case LOG_LEVEL_DEBUG: return "debug";
+        case LOG_LEVEL_TRACE: return "trace";
+        default:              return "?";
+    }
+}
+
+// Busca la próxima conversión a partir de p
+// Retorna el '%' donde empieza (spec completo) o NULL si no hay más
+static const char* next_spec(const char *p, LogSpec *spec) {
+    p = strchr(p, '%');
+    if (!p) {
+        return NULL;
+    }
+    const char *start = p++;
+    
+    int nflags = 0;
+    while (*p && strchr("-+ #0'", *p)) {
+        if (nflags < (int)sizeof(spec->flags) - 1) {
+            spec->flags[nflags++] = *p;
+        }
+        p++;
+    }
+    spec->flags[nflags] = '\0';
+    
+    spec->width = -1;
+    if (*p == '*') {
+        spec->width = LOG_STAR;
+        p++;
+    } else if (*p >= '0' && *p <= '9') {
+        spec->width = (int)strtol(p, (char**)&p, 10);
+    }
+    
+    spec->precision = -1;
+    if (*p == '.') {
+        p++;
+        if (*p == '*') {
+            spec->precision = LOG_STAR;
+            p++;
+        } else {
+            spec->precision = (int)strtol(p, (char**)&p, 10);
+        }
+    }
+    
+    spec->length = LEN_NONE;
+    switch (*p) {
+        case 'h': spec->length = (p[1] == 'h') ? LEN_HH : LEN_H; break;
+        case 'l': spec->length = (p[1] == 'l') ? LEN_LL : LEN_L; break;
+        case 'z': spec->length = LEN_Z; break;
+        case 'j': spec->length = LEN_J; break;
+        case 't': spec->length = LEN_T; break;
+        case 'L': spec->length = LEN_BIG_L; break;
+    }
+    if (spec->length == LEN_HH || spec->length == LEN_LL) {
+        p += 2;
+    } else if (spec->length != LEN_NONE) {
+        p++;
+    }
+    
+    spec->conv = *p;
+    spec->end = *p ? p + 1 : p;
+    return start;
+}
+
+static int spec_class(const LogSpec *spec) {
+    switch (spec->conv) {
+        case 'd': case 'i':
+            return ARG_SIGNED;
+        case 'u': case 'o': case 'x': case 'X':
+            return ARG_UNSIGNED;
+        case 'c':
+            return ARG_CHAR;
+        case 'e': case 'E': case 'f': case 'F': case 'g': case 'G': case 'a': case 'A':
+            return ARG_DOUBLE;
+        case 's':
+            return ARG_STRING;
+        case 'p': case 'n':
+            return ARG_POINTER;
+        default:
+            return ARG_NONE;
+    }
+}
+
+// Copia un %s al espacio de strings del registro y retorna su offset
+static unsigned long long capture_string(LogRecord *rec, const char *str, int precision) {
+    if (!str) {
+        str = "(null)";
+    }
+    
+    int avail = LOG_STRING_SPACE - 1 - rec->str_len;
+    int len = strnlen(str, avail > 0 ? avail : 0);
+    if (precision >= 0 && len > precision) {
+        len = precision;
+    }
+    
+    int offset = rec->str_len;
+    memcpy(rec->strings + offset, str, len);
+    rec->strings[offset + len] = '\0';
+    rec->str_len = offset + len + 1;
+    if (rec->str_len > LOG_STRING_SPACE - 1) {
+        rec->str_len = LOG_STRING_SPACE - 1;
+    }
+    return offset;
+}
+
+// Guarda en el registro los argumentos que pide el formato
+static void capture(LogRecord *rec, const char *fmt, va_list ap) {
+    LogSpec spec;
+    const char *p = fmt;
+    
+    rec->fmt = fmt;
+    rec->nargs = 0;
+    rec->str_len = 0;
+    rec->strings[LOG_STRING_SPACE - 1] = '\0';
+    
+    while (next_spec(p, &spec) != NULL) {
+        p = spec.end;
+        if (spec.conv == '%') {
+            continue;
+        }
+        
+        int needed = (spec.width == LOG_STAR) + (spec.precision == LOG_STAR) +
+                     (spec_class(&spec) != ARG_NONE);
+        if (rec->nargs + needed > LOG_MAX_ARGS) {
+            break;                      // El resto sale sin formatear
+        }
+        
+        int precision = spec.precision;
+        if (spec.width == LOG_STAR) {
+            rec->args[rec->nargs++].i = va_arg(ap, int);
+        }
+        if (spec.precision == LOG_STAR) {
+            precision = va_arg(ap, int);
+            rec->args[rec->nargs++].i = precision;
+        }
+        
+        LogArg *arg = &rec->args[rec->nargs];
+        switch (spec_class(&spec)) {
+            case ARG_SIGNED:
+                switch (spec.length) {
+                    case LEN_HH: arg->i = (signed char)va_arg(ap, int); break;
+                    case LEN_H:  arg->i = (short)va_arg(ap, int); break;
+                    case LEN_L:  arg->i = va_arg(ap, long); break;
+                    case LEN_LL: arg->i = va_arg(ap, long long); break;
+                    case LEN_Z:  arg->i = va_arg(ap, ssize_t); break;
+                    case LEN_J:  arg->i = va_arg(ap, intmax_t); break;
+                    case LEN_T:  arg->i = va_arg(ap, ptrdiff_t); break;
+                    default:     arg->i = va_arg(ap, int); break;
+                }
+                break;
+            case ARG_UNSIGNED:
+                switch (spec.length) {
+                    case LEN_HH: arg->u = (unsigned char)va_arg(ap, unsigned); break;
+                    case LEN_H:  arg->u = (unsigned short)va_arg(ap, unsigned); break;
+                    case LEN_L:  arg->u = va_arg(ap, unsigned long); break;
+                    case LEN_LL: arg->u = va_arg(ap, unsigned long long); break;
+                    case LEN_Z:  arg->u = va_arg(ap, size_t); break;
+                    case LEN_J:  arg->u = va_arg(ap, uintmax_t); break;
+                    case LEN_T:  arg->u = (unsigned long long)va_arg(ap, ptrdiff_t); break;
+                    default:     arg->u = va_arg(ap, unsigned); break;
+                }
+                break;
+            case ARG_CHAR:
+                arg->i = va_arg(ap, int);
+                break;
+            case ARG_DOUBLE:
+                if (spec.length == LEN_BIG_L) {
+                    arg->d = (double)va_arg(ap, long double);
+                } else {
+                    arg->d = va_arg(ap, double);
+                }
+                break;
+            case ARG_STRING:
+                arg->u = capture_string(rec, va_arg(ap, const char*), precision);
+                break;
+            case ARG_POINTER:
+                arg->p = va_arg(ap, const void*);
+                break;
+            default:
+                continue;
+        }
+        rec->nargs++;
+    }
+}
+
+// Agrega texto al buffer de salida (se trunca al llenarse)
+static int append(char *out, int len, int size, const char *text, int text_len) {
+    if (len + text_len > size - 1) {
+        text_len = size - 1 - len;
+    }
+    if (text_len > 0) {
+        memcpy(out + len, text, text_len);
+        len += text_len;
+    }
+    out[len] = '\0';
+    return len;
+}
+
+// Formatea un registro en out (terminado en '\0'); retorna el largo
+static int format_record(const LogRecord *rec, char *out, int size) {
+    LogSpec spec;
+    const char *p = rec->fmt;
+    const char *start;
+    int len = 0;
+    int arg = 0;
+    
+    out[0] = '\0';
+    while ((start = next_spec(p, &spec)) != NULL) {
+        len = append(out, len, size, p, start - p);
+        p = spec.end;
+        
+        if (spec.conv == '%') {
+            len = append(out, len, size, "%", 1);
+            continue;
+        }
+        
+        int class = spec_class(&spec);
+        int needed = (spec.width == LOG_STAR) + (spec.precision == LOG_STAR) +
+                     (class != ARG_NONE);
+        if (class == ARG_NONE || arg + needed > rec->nargs) {
+            len = append(out, len, size, start, spec.end - start);
+            continue;
+        }
+        
+        // Reconstruir la conversión con ancho y precisión numéricos y el
+        // largo del valor guardado
+        char conv[LOG_SPEC_SIZE];
+        int width = spec.width == LOG_STAR ? (int)rec->args[arg++].i : spec.width;
+        int precision = spec.precision == LOG_STAR ? (int)rec->args[arg++].i : spec.precision;
+        int n = snprintf(conv, sizeof(conv), "%%%s", spec.flags);
+        if (width >= 0) {
+            n += snprintf(conv + n, sizeof(conv) - n, "%d", width);
+        }
+        if (precision >= 0) {
+            n += snprintf(conv + n, sizeof(conv) - n, ".%d", precision);
+        }
+        if (class == ARG_SIGNED || class == ARG_UNSIGNED) {
+            n += snprintf(conv + n, sizeof(conv) - n, "ll");
+        }
+        snprintf(conv + n, sizeof(conv) - n, "%c", spec.conv);
+        
+        const LogArg *value = &rec->args[arg++];
+        int written = 0;
+        switch (class) {
+            case ARG_SIGNED:
+                written = snprintf(out + len, size - len, conv, value->i);
+                break;
+            case ARG_UNSIGNED:
+                written = snprintf(out + len, size - len, conv, value->u);
+                break;
+            case ARG_CHAR:
+                written = snprintf(out + len, size - len, conv, (int)value->i);
+                break;
+            case ARG_DOUBLE:
+                written = snprintf(out + len, size - len, conv, value->d);
+                break;
+            case ARG_STRING:
+                written = snprintf(out + len, size - len, conv, rec->strings + value->u);
+                break;
+            case ARG_POINTER:
+                if (spec.conv == 'p') {
+                    written = snprintf(out + len, size - len, conv, value->p);
+                }
+                break;
+        }
+        len += written;
+        if (len > size - 1) {
+            len = size - 1;
+        }
+    }
+    
+    return append(out, len, size, p, strlen(p));
+}
+
+// Formatea y escribe los registros listos; retorna cuántos escribió
+static int log_drain(void) {
+    char line[LOG_LINE_SIZE];
+    int count = 0;
+    
+    while (1) {
+        LogRecord *rec = &ring[dequeue_pos & LOG_RING_MASK];
+        size_t seq = atomic_load_explicit(&rec->seq, memory_order_acquire);
+        if (seq != dequeue_pos + 1) {
+            break;
+        }
+        
+        int len = format_record(rec, line, sizeof(line));
+        fwrite(line, 1, len, stdout);
+        
+        atomic_store_explicit(&rec->seq, dequeue_pos + LOG_RING_SIZE, memory_order_release);
+        dequeue_pos++;
+        count++;
+    }
+    
+    unsigned long long dropped = atomic_exchange(&log_dropped, 0);
+    if (dropped > 0) {
+        printf("[LOG] %llu mensajes descartados (ring lleno)\n", dropped);
+    }
+    
+    return count;
+}
+
+static void* log_thread_main(void *arg) {
+    (void)arg;
+    struct timespec idle = { 0, LOG_IDLE_SLEEP_US * 1000L };
+    
+    while (1) {
+        int stopping = atomic_load(&log_stopping);
+        if (log_drain() == 0) {
+            fflush(stdout);
+            if (stopping) {
+                break;
+            }
+            nanosleep(&idle, NULL);
+        }
+    }
+    
+    return NULL;
+}
+
+// Reserva el próximo registro del ring
+// Retorna NULL si está lleno y el mensaje se puede descartar
+static LogRecord* ring_reserve(int level, size_t *out_pos) {
+    size_t pos = atomic_load_explicit(&enqueue_pos, memory_order_relaxed);
+    
+    while (1) {
+        LogRecord *rec = &ring[pos & LOG_RING_MASK];
+        size_t seq = atomic_load_explicit(&rec->seq, memory_order_acquire);
+        ptrdiff_t diff = (ptrdiff_t)seq - (ptrdiff_t)pos;
+        
+        if (diff == 0) {
+            if (atomic_compare_exchange_weak_explicit(&enqueue_pos, &pos, pos + 1,
+                                                      memory_order_relaxed,
+                                                      memory_order_relaxed)) {
+                *out_pos = pos;
+                return rec;
+            }
+        } else if (diff < 0) {
+            // Lleno: errores y warnings esperan al consumidor
+            if (level > LOG_LEVEL_WARN) {
+                return NULL;
+            }
+            sched_yield();
+            pos = atomic_load_explicit(&enqueue_pos, memory_order_relaxed);
+        } else {
+            pos = atomic_load_explicit(&enqueue_pos, memory_order_relaxed);
+        }
+    }
+}
+
+void log_write(int level, const char *fmt, ...) {
+    va_list ap;
+    va_start(ap, fmt);
+    
+    // Sin thread de fondo: formatear y escribir en el momento
+    if (!atomic_load_explicit(&log_running, memory_order_acquire)) {
+        static LogRecord sync_rec;
+        static pthread_mutex_t sync_lock = PTHREAD_MUTEX_INITIALIZER;
+        char line[LOG_LINE_SIZE];
+        
+        pthread_mutex_lock(&sync_lock);
+        capture(&sync_rec, fmt, ap);
+        int len = format_record(&sync_rec, line, sizeof(line));
+        fwrite(line, 1, len, stdout);
+        pthread_mutex_unlock(&sync_lock);
+        va_end(ap);
+        return;
+    }
+    
+    size_t pos;
+    LogRecord *rec = ring_reserve(level, &pos);
+    if (!rec) {
+        atomic_fetch_add_explicit(&log_dropped, 1, memory_order_relaxed);
+        va_end(ap);
+        return;
+    }
+    
+    capture(rec, fmt, ap);
+    atomic_store_explicit(&rec->seq, pos + 1, memory_order_release);
+    va_end(ap);
+}
+
+int log_start(void) {
+    if (atomic_load(&log_running)) {
+        return 0;
+    }
+    
+    for (size_t i = 0; i < LOG_RING_SIZE; i++) {
+        atomic_init(&ring[i].seq, i);
+    }
+    atomic_store(&enqueue_pos, 0);
+    dequeue_pos = 0;
+    atomic_store(&log_stopping, 0);
+    
+    // Lo escrito en el momento sale antes que lo encolado
+    fflush(stdout);
+    
+    int err = pthread_create(&log_thread, NULL, log_thread_main, NULL);
+    if (err != 0) {
+        return -1;
+    }
+    atomic_store_explicit(&log_running, 1, memory_order_release);
+    
+    if (!log_atexit_done) {
+        atexit(log_stop);
+        log_atexit_done = 1;
+    }
+    return 0;
+}
+
+void log_stop(void) {
+    if (!atomic_load(&log_running)) {
+        return;
+    }
+    
+    // El thread vacía el ring antes de salir; lo que se encoló mientras
+    // terminaba se escribe acá
+    atomic_store(&log_stopping, 1);
+    pthread_join(log_thread, NULL);
+    atomic_store_explicit(&log_running, 0, memory_order_release);
+    log_drain();
+    fflush(stdout);
+}
@@ -0,0 +1,392 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <time.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include "../include/metrics.h"
+
+// Métricas: bloques por thread y exportación desde un thread propio
+
+static const char *counter_names[METRIC_COUNTERS] = {
+    "rx_packets", "rx_bytes", "tx_packets", "tx_bytes", "data_bytes",
+    "data_duplicate", "data_out_of_order", "checksum_errors", "retransmits", "timeouts",
+    "fec_recovered", "acks_coalesced", "sessions_opened", "sessions_closed", "sessions_reaped",
+    "sessions_active", "files_completed"
+};
+
+static const char *counter_help[METRIC_COUNTERS] = {
+    "Datagramas recibidos", "Bytes recibidos (payload UDP)",
+    "Datagramas enviados", "Bytes enviados (payload UDP)",
+    "Bytes de archivo aceptados (servidor) o reconocidos (cliente)",
+    "DATA repetidos", "DATA descartados por seq fuera de ventana o de secuencia",
+    "DATA y FIN con CRC32C que no coincide",
+    "DATA retransmitidos", "Rondas de timeout de retransmision",
+    "DATA reconstruidos con FEC (servidor) o reconocidos asi (cliente)",
+    "DATA reconocidos sin un ACK propio (ACKs coalescidos con SACK)",
+    "Sesiones abiertas", "Sesiones cerradas", "Sesiones cerradas por inactividad",
+    "Sesiones activas", "Archivos completados"
+};
+
+static const char *histogram_names[METRIC_HISTOGRAMS] = {
+    "ack_rtt_us", "handler_latency_ns", "session_goodput_kbps"
+};
+
+static const char *histogram_help[METRIC_HISTOGRAMS] = {
+    "RTT de los ACKs de DATA no retransmitidos (us)",
+    "Tiempo de procesamiento de cada PDU (ns)",
+    "Goodput de cada sesion terminada (kB/s)"
+};
+
+static Metrics *blocks[METRICS_MAX_BLOCKS];
+static atomic_int block_count;
+
+static pthread_t metrics_thread;
+static int metrics_running = 0;
+static int stop_pipe[2] = { -1, -1 };
+static int listen_fd = -1;
+static const char *metrics_role;
+static const char *snapshot_path;
+static const char *socket_path;
+static uint64_t start_ms;
+static char snapshot[METRICS_SNAPSHOT_SIZE];    // Solo lo usa el thread de métricas
+
+static uint64_t monotonic_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000ULL + (uint64_t)ts.tv_nsec / 1000000ULL;
+}
+
+void metrics_init(Metrics *metrics) {
+    for (int i = 0; i < METRIC_COUNTERS; i++) {
+        atomic_init(&metrics->counters[i], 0);
+    }
+    for (int h = 0; h < METRIC_HISTOGRAMS; h++) {
+        MetricHistogram *hist = &metrics->histograms[h];
+        for (int i = 0; i < METRICS_BUCKETS; i++) {
+            atomic_init(&hist->buckets[i], 0);
+        }
+        atomic_init(&hist->count, 0);
+        atomic_init(&hist->sum, 0);
+        atomic_init(&hist->max, 0);
+    }
+}
+
+// Un solo escritor por bloque: leer y escribir sin read-modify-write atómico
+static void bump(_Atomic uint64_t *value, uint64_t delta) {
+    atomic_store_explicit(value, atomic_load_explicit(value, memory_order_relaxed) + delta,
+                          memory_order_relaxed);
+}
+
+void metric_add(Metrics *metrics, int counter, uint64_t value) {
+    bump(&metrics->counters[counter], value);
+}
+
+void metric_set(Metrics *metrics, int counter, uint64_t value) {
+    atomic_store_explicit(&metrics->counters[counter], value, memory_order_relaxed);
+}
+
+void metric_observe(Metrics *metrics, int histogram, uint64_t value) {
+    MetricHistogram *hist = &metrics->histograms[histogram];
+    
+    // Bucket i: [2^(i-1), 2^i - 1]; los valores más grandes van al último
+    int bucket = value == 0 ? 0 : 64 - __builtin_clzll(value);
+    if (bucket >= METRICS_BUCKETS) {
+        bucket = METRICS_BUCKETS - 1;
+    }
+    
+    bump(&hist->buckets[bucket], 1);
+    bump(&hist->count, 1);
+    bump(&hist->sum, value);
+    if (value > atomic_load_explicit(&hist->max, memory_order_relaxed)) {
+        atomic_store_explicit(&hist->max, value, memory_order_relaxed);
+    }
+}
+
+int metrics_register(Metrics *metrics) {
+    int count = atomic_load(&block_count);
+    if (count >= METRICS_MAX_BLOCKS) {
+        return -1;
+    }
+    blocks[count] = metrics;
+    atomic_store_explicit(&block_count, count + 1, memory_order_release);
+    return 0;
+}
+
+// Mayor valor del bucket i (el último no tiene tope)
+static uint64_t bucket_bound(int i) {
+    return i == 0 ? 0 : (1ULL << i) - 1;
+}
+
+// Cota superior del percentil p (0-1) según los buckets
+static uint64_t histogram_percentile(const uint64_t *buckets, uint64_t count, double p) {
+    uint64_t target = (uint64_t)(p * count + 0.5);
+    uint64_t seen = 0;
+    
+    if (target == 0) {
+        target = 1;
+    }
+    for (int i = 0; i < METRICS_BUCKETS; i++) {
+        seen += buckets[i];
+        if (seen >= target) {
+            return bucket_bound(i);
+        }
+    }
+    return bucket_bound(METRICS_BUCKETS - 1);
+}
+
+// Arma el snapshot sumando todos los bloques; retorna el largo
+static int build_snapshot(void) {
+    int blocks_now = atomic_load_explicit(&block_count, memory_order_acquire);
+    size_t size = sizeof(snapshot);
+    int len = 0;
+
+#define SNAP(...) \
+    do { \
+        if ((size_t)len < size) { \
+            int n = snprintf(snapshot + len, size - len, __VA_ARGS__); \
+            len = (size_t)(len + n) < size ? len + n : (int)size - 1; \
+        } \
+    } while (0)
+    
+    SNAP("# Metricas del %s (uptime %.1f s, %d bloques)\n", metrics_role,
+         (monotonic_ms() - start_ms) / 1000.0, blocks_now);
+    
+    for (int c = 0; c < METRIC_COUNTERS; c++) {
+        uint64_t total = 0;
+        for (int b = 0; b < blocks_now; b++) {
+            total += atomic_load_explicit(&blocks[b]->counters[c], memory_order_relaxed);
+        }
+        SNAP("# HELP %s %s\n# TYPE %s %s\n%s %llu\n", counter_names[c], counter_help[c],
+             counter_names[c], c == METRIC_SESSIONS_ACTIVE ? "gauge" : "counter",
+             counter_names[c], (unsigned long long)total);
+    }
+    
+    for (int h = 0; h < METRIC_HISTOGRAMS; h++) {
+        uint64_t buckets[METRICS_BUCKETS] = { 0 };
+        uint64_t count = 0, sum = 0, max = 0;
+        int last = 0;
+        
+        for (int b = 0; b < blocks_now; b++) {
+            MetricHistogram *hist = &blocks[b]->histograms[h];
+            for (int i = 0; i < METRICS_BUCKETS; i++) {
+                buckets[i] += atomic_load_explicit(&hist->buckets[i], memory_order_relaxed);
+            }
+            count += atomic_load_explicit(&hist->count, memory_order_relaxed);
+            sum += atomic_load_explicit(&hist->sum, memory_order_relaxed);
+            uint64_t block_max = atomic_load_explicit(&hist->max, memory_order_relaxed);
+            if (block_max > max) {
+                max = block_max;
+            }
+        }
+        for (int i = 0; i < METRICS_BUCKETS - 1; i++) {
+            if (buckets[i] > 0) {
+                last = i;
+            }
+        }
+        
+        const char *name = histogram_names[h];
+        SNAP("# HELP %s %s\n# TYPE %s histogram\n", name, histogram_help[h], name);
+        if (count > 0) {
+            SNAP("# %s: p50<=%llu p90<=%llu p99<=%llu max=%llu media=%.1f\n", name,
+                 (unsigned long long)histogram_percentile(buckets, count, 0.50),
+                 (unsigned long long)histogram_percentile(buckets, count, 0.90),
+                 (unsigned long long)histogram_percentile(buckets, count, 0.99),
+                 (unsigned long long)max, (double)sum / count);
+        }
+        
+        // Buckets acumulados hasta el último con muestras
+        uint64_t cumulative = 0;
+        for (int i = 0; i <= last; i++) {
+            cumulative += buckets[i];
+            SNAP("%s_bucket{le=\"%llu\"} %llu\n", name,
+                 (unsigned long long)bucket_bound(i), (unsigned long long)cumulative);
+        }
+        SNAP("%s_bucket{le=\"+Inf\"} %llu\n%s_sum %llu\n%s_count %llu\n", name,
+             (unsigned long long)count, name, (unsigned long long)sum, name,
+             (unsigned long long)count);
+    }
+
+#undef SNAP
+    return len;
+}
+
+// Escribe todo el buffer (reintenta escrituras parciales)
+static int write_all(int fd, const char *buf, int len) {
+    while (len > 0) {
+        ssize_t written = write(fd, buf, len);
+        if (written < 0 && errno == EINTR) {
+            continue;
+        }
+        if (written <= 0) {
+            return -1;
+        }
+        buf += written;
+        len -= written;
+    }
+    return 0;
+}
+
+// Reescribe el archivo de snapshot (temporal + rename)
+static void write_snapshot_file(void) {
+    char tmp_path[512];
+    int len = build_snapshot();
+    
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", snapshot_path);
+    int fd = open(tmp_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        return;
+    }
+    int result = write_all(fd, snapshot, len);
+    close(fd);
+    
+    if (result < 0 || rename(tmp_path, snapshot_path) < 0) {
+        unlink(tmp_path);
+    }
+}
+
+// Responde una consulta del socket UNIX con el snapshot actual
+static void serve_query(void) {
+    int fd = accept(listen_fd, NULL, NULL);
+    if (fd < 0) {
+        return;
+    }
+    
+    // Un cliente que no lee no puede trabar el thread
+    struct timeval tv = { 1, 0 };
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+    
+    int len = build_snapshot();
+    write_all(fd, snapshot, len);
+    close(fd);
+}
+
+static void* metrics_thread_main(void *arg) {
+    (void)arg;
+    uint64_t next = monotonic_ms() + METRICS_INTERVAL_MS;
+    
+    while (1) {
+        struct pollfd fds[2];
+        int nfds = 1;
+        fds[0].fd = stop_pipe[0];
+        fds[0].events = POLLIN;
+        if (listen_fd >= 0) {
+            fds[1].fd = listen_fd;
+            fds[1].events = POLLIN;
+            nfds = 2;
+        }
+        
+        int timeout = -1;
+        if (snapshot_path) {
+            uint64_t now = monotonic_ms();
+            timeout = next > now ? (int)(next - now) : 0;
+        }
+        
+        int ready = poll(fds, nfds, timeout);
+        if (ready < 0 && errno != EINTR) {
+            break;
+        }
+        if (ready > 0 && (fds[0].revents & POLLIN)) {
+            break;
+        }
+        if (ready > 0 && nfds == 2 && (fds[1].revents & POLLIN)) {
+            serve_query();
+        }
+        if (snapshot_path && monotonic_ms() >= next) {
+            write_snapshot_file();
+            next += METRICS_INTERVAL_MS;
+        }
+    }
+    
+    return NULL;
+}
+
+// Socket UNIX de consultas (se reemplaza uno viejo en la misma ruta)
+static int open_query_socket(const char *path) {
+    struct sockaddr_un addr;
+    
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        fprintf(stderr, "Ruta de socket de metricas muy larga: %s\n", path);
+        return -1;
+    }
+    
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        perror("Error creando socket de metricas");
+        return -1;
+    }
+    
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, path);
+    unlink(path);
+    
+    if (bind(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0 || listen(fd, 8) < 0) {
+        perror("Error en socket de metricas");
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+int metrics_start(const char *role, const char *snapshot_file, const char *socket_file) {
+    if (metrics_running || (!snapshot_file && !socket_file)) {
+        return 0;
+    }
+    
+    metrics_role = role;
+    snapshot_path = snapshot_file;
+    socket_path = socket_file;
+    start_ms = monotonic_ms();
+    
+    if (socket_path) {
+        listen_fd = open_query_socket(socket_path);
+        if (listen_fd < 0) {
+            return -1;
+        }
+    }
+    
+    if (pipe(stop_pipe) < 0 ||
+        pthread_create(&metrics_thread, NULL, metrics_thread_main, NULL) != 0) {
+        perror("Error creando thread de metricas");
+        if (listen_fd >= 0) {
+            close(listen_fd);
+            unlink(socket_path);
+            listen_fd = -1;
+        }
+        return -1;
+    }
+    
+    metrics_running = 1;
+    atexit(metrics_stop);
+    return 0;
+}
+
+void metrics_stop(void) {
+    if (!metrics_running) {
+        return;
+    }
+    metrics_running = 0;
+    
+    if (write(stop_pipe[1], "x", 1) < 0) {
+        perror("Error deteniendo metricas");
+    }
+    pthread_join(metrics_thread, NULL);
+    close(stop_pipe[0]);
+    close(stop_pipe[1]);
+    
+    if (snapshot_path) {
+        write_snapshot_file();
+    }
+    if (listen_fd >= 0) {
+        close(listen_fd);
+        unlink(socket_path);
+        listen_fd = -1;
+    }
+}
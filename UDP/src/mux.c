@@ -0,0 +1,123 @@
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "../include/mux.h"
+
+// Reparto de respuestas por lane (formato en protocol.h)
+
+// Hilo receptor: todo lo que llega al socket va a la cola de su lane
+static void* mux_thread(void *arg) {
+    Mux *mux = arg;
+    PDU pdu;
+    struct sockaddr_in from;
+    
+    while (mux->running) {
+        int recv_len = recv_pdu_with_timeout(mux->sockfd, &pdu, &from, MUX_POLL_MS);
+        if (recv_len == 0) {
+            continue;
+        }
+        
+        pthread_mutex_lock(&mux->lock);
+        if (recv_len < 0) {
+            // Los lanes ven el error en su próximo mux_recv
+            mux->error = 1;
+            for (int lane = 0; lane <= MAX_LANES; lane++) {
+                pthread_cond_broadcast(&mux->queues[lane].ready);
+            }
+            pthread_mutex_unlock(&mux->lock);
+            break;
+        }
+        
+        int lane = PDU_LANE(pdu.type);
+        MuxQueue *queue = &mux->queues[lane];
+        if (queue->count < MUX_QUEUE) {
+            MuxEntry *entry = &queue->entries[(queue->head + queue->count) % MUX_QUEUE];
+            pdu.type = PDU_TYPE(pdu.type);
+            memcpy(&entry->pdu, &pdu, recv_len);
+            entry->len = recv_len;
+            entry->from = from;
+            queue->count++;
+            pthread_cond_signal(&queue->ready);
+        }
+        pthread_mutex_unlock(&mux->lock);
+    }
+    return NULL;
+}
+
+// Colas vacías con sus condiciones
+static void init_queues(Mux *mux) {
+    // Las esperas se miden con el reloj monotónico (como el resto de los timers)
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    for (int lane = 0; lane <= MAX_LANES; lane++) {
+        pthread_cond_init(&mux->queues[lane].ready, &attr);
+    }
+    pthread_condattr_destroy(&attr);
+    pthread_mutex_init(&mux->lock, NULL);
+}
+
+static void destroy_queues(Mux *mux) {
+    for (int lane = 0; lane <= MAX_LANES; lane++) {
+        pthread_cond_destroy(&mux->queues[lane].ready);
+    }
+    pthread_mutex_destroy(&mux->lock);
+}
+
+Mux* mux_create(int sockfd) {
+    Mux *mux = calloc(1, sizeof(Mux));
+    if (!mux) {
+        return NULL;
+    }
+    
+    mux->sockfd = sockfd;
+    mux->running = 1;
+    init_queues(mux);
+    
+    if (pthread_create(&mux->thread, NULL, mux_thread, mux) != 0) {
+        destroy_queues(mux);
+        free(mux);
+        return NULL;
+    }
+    return mux;
+}
+
+void mux_destroy(Mux *mux) {
+    mux->running = 0;
+    pthread_join(mux->thread, NULL);
+    destroy_queues(mux);
+    free(mux);
+}
+
+int mux_recv(Mux *mux, int lane, PDU *pdu, struct sockaddr_in *from_addr, int timeout_ms) {
+    MuxQueue *queue = &mux->queues[lane];
+    struct timespec deadline;
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+    deadline.tv_sec += timeout_ms / 1000;
+    deadline.tv_nsec += (long)(timeout_ms % 1000) * 1000000L;
+    if (deadline.tv_nsec >= 1000000000L) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000L;
+    }
+    
+    pthread_mutex_lock(&mux->lock);
+    while (queue->count == 0 && !mux->error) {
+        if (pthread_cond_timedwait(&queue->ready, &mux->lock, &deadline) != 0) {
+            break;
+        }
+    }
+    
+    int recv_len = 0;
+    if (queue->count > 0) {
+        MuxEntry *entry = &queue->entries[queue->head];
+        memcpy(pdu, &entry->pdu, entry->len);
+        *from_addr = entry->from;
+        recv_len = entry->len;
+        queue->head = (queue->head + 1) % MUX_QUEUE;
+        queue->count--;
+    } else if (mux->error) {
+        recv_len = -1;
+    }
+    pthread_mutex_unlock(&mux->lock);
+    return recv_len;
+}
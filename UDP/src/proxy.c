@@ -0,0 +1,406 @@
+#define _GNU_SOURCE                 // ppoll
+#include <poll.h>
+#include <signal.h>
+#include <errno.h>
+#include "../include/protocol.h"
+#include "../include/impair.h"
+
+// Proxy UDP con red degradada entre bin/client y bin/server
+// Recibe a los clientes en listen_port y reenvía cada datagrama al servidor
+// desde un socket propio por cliente (el servidor ve una dirección por
+// cliente, igual que sin proxy). Cada sentido pasa por un ImpairLink y los
+// datagramas esperan su entrega en un heap ordenado por instante.
+// Corre en el espacio de usuario: no necesita root ni netem.
+
+#define PROXY_MAX_FLOWS 1024            // Clientes (o streams) distintos
+#define PROXY_MAX_PENDING 65536         // Datagramas en vuelo dentro del proxy
+#define PROXY_SOCKET_BUFFER (8 * 1024 * 1024)
+
+#define DIR_TO_SERVER 0
+#define DIR_TO_CLIENT 1
+
+typedef struct {
+    struct sockaddr_in client;      // Dirección del cliente
+    int sockfd;                     // Socket conectado al servidor
+} Flow;
+
+typedef struct {
+    uint64_t deliver_us;
+    uint64_t order;                 // Desempate: orden de llegada
+    int flow;
+    int dir;
+    int len;
+    uint8_t *data;
+} Pending;
+
+static Flow flows[PROXY_MAX_FLOWS];
+static int num_flows = 0;
+static Pending heap[PROXY_MAX_PENDING];
+static int heap_len = 0;
+static uint64_t next_order = 0;
+static volatile sig_atomic_t running = 1;
+
+static void on_signal(int sig) {
+    (void)sig;
+    running = 0;
+}
+
+static int pending_before(const Pending *a, const Pending *b) {
+    if (a->deliver_us != b->deliver_us) {
+        return a->deliver_us < b->deliver_us;
+    }
+    return a->order < b->order;
+}
+
+static void heap_push(const Pending *item) {
+    int i = heap_len++;
+    heap[i] = *item;
+    while (i > 0) {
+        int parent = (i - 1) / 2;
+        if (!pending_before(&heap[i], &heap[parent])) {
+            break;
+        }
+        Pending tmp = heap[i];
+        heap[i] = heap[parent];
+        heap[parent] = tmp;
+        i = parent;
+    }
+}
+
+static void heap_pop(void) {
+    heap[0] = heap[--heap_len];
+    int i = 0;
+    while (1) {
+        int left = 2 * i + 1;
+        int right = left + 1;
+        int smallest = i;
+        if (left < heap_len && pending_before(&heap[left], &heap[smallest])) {
+            smallest = left;
+        }
+        if (right < heap_len && pending_before(&heap[right], &heap[smallest])) {
+            smallest = right;
+        }
+        if (smallest == i) {
+            break;
+        }
+        Pending tmp = heap[i];
+        heap[i] = heap[smallest];
+        heap[smallest] = tmp;
+        i = smallest;
+    }
+}
+
+// Socket UDP con buffers grandes: una ráfaga no debe perderse en el kernel
+// (esas pérdidas no serían reproducibles)
+static int open_socket(void) {
+    int sockfd = create_udp_socket();
+    if (sockfd < 0) {
+        return -1;
+    }
+    int size = PROXY_SOCKET_BUFFER;
+    setsockopt(sockfd, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size));
+    setsockopt(sockfd, SOL_SOCKET, SO_SNDBUF, &size, sizeof(size));
+    return sockfd;
+}
+
+// Flow de un cliente; lo crea (con su socket hacia el servidor) si es nuevo
+// Retorna el índice o -1 si no hay lugar
+static int find_flow(struct sockaddr_in *client, struct sockaddr_in *server_addr) {
+    for (int i = 0; i < num_flows; i++) {
+        if (flows[i].client.sin_addr.s_addr == client->sin_addr.s_addr &&
+            flows[i].client.sin_port == client->sin_port) {
+            return i;
+        }
+    }
+    
+    if (num_flows == PROXY_MAX_FLOWS) {
+        LOG_WARN("[WARNING] Sin lugar para el cliente " LOG_ADDR_FMT ", descartando\n",
+                 LOG_ADDR_ARGS(client));
+        return -1;
+    }
+    
+    int sockfd = open_socket();
+    if (sockfd < 0) {
+        return -1;
+    }
+    if (connect(sockfd, (struct sockaddr*)server_addr, sizeof(*server_addr)) < 0) {
+        perror("Error conectando al servidor");
+        close(sockfd);
+        return -1;
+    }
+    
+    flows[num_flows].client = *client;
+    flows[num_flows].sockfd = sockfd;
+    LOG_INFO("[FLOW %d] Cliente " LOG_ADDR_FMT "\n", num_flows, LOG_ADDR_ARGS(client));
+    return num_flows++;
+}
+
+// Pasa un datagrama recibido por el enlace de su sentido y encola las copias
+static void schedule(ImpairLink *link, int flow, int dir, const uint8_t *data, int len) {
+    uint64_t deliver_us[2];
+    int copies = impair_process(link, len, now_us(), deliver_us);
+    
+    if (copies == 0) {
+        LOG_TRACE("[%s] flow %d: %d bytes descartados\n",
+                  dir == DIR_TO_SERVER ? "C->S" : "S->C", flow, len);
+    }
+    
+    for (int c = 0; c < copies; c++) {
+        Pending item;
+        if (heap_len == PROXY_MAX_PENDING || !(item.data = malloc(len))) {
+            link->stats.dropped_queue++;
+            link->stats.forwarded--;
+            continue;
+        }
+        memcpy(item.data, data, len);
+        item.deliver_us = deliver_us[c];
+        item.order = next_order++;
+        item.flow = flow;
+        item.dir = dir;
+        item.len = len;
+        heap_push(&item);
+    }
+}
+
+// Entrega los datagramas cuyo instante ya llegó
+// Retorna los microsegundos hasta la próxima entrega (-1 si no hay)
+static int64_t deliver_due(int front_fd) {
+    while (heap_len > 0) {
+        uint64_t now = now_us();
+        Pending *item = &heap[0];
+        if (item->deliver_us > now) {
+            return (int64_t)(item->deliver_us - now);
+        }
+        
+        Flow *flow = &flows[item->flow];
+        if (item->dir == DIR_TO_SERVER) {
+            send(flow->sockfd, item->data, item->len, 0);
+        } else {
+            sendto(front_fd, item->data, item->len, 0,
+                   (struct sockaddr*)&flow->client, sizeof(flow->client));
+        }
+        free(item->data);
+        heap_pop();
+    }
+    return -1;
+}
+
+static void print_link_stats(const char *name, const ImpairStats *stats) {
+    LOG_INFO("%s: %llu recibidos, %llu reenviados, descartados %llu por MTU, %llu por perdida y %llu por cola, %llu duplicados, %llu reordenados\n",
+             name, (unsigned long long)stats->received, (unsigned long long)stats->forwarded,
+             (unsigned long long)stats->dropped_mtu, (unsigned long long)stats->dropped_loss,
+             (unsigned long long)stats->dropped_queue, (unsigned long long)stats->duplicated,
+             (unsigned long long)stats->reordered);
+}
+
+static void print_usage(const char *prog) {
+    printf("Uso: %s [-l puerto] [-s ip[:puerto]] [-p preset] [-d ms] [-j ms] [-L prob] [-G p,r[,malo[,bueno]]] [-D prob] [-r prob[,ms]] [-b Mbit/s] [-Q bytes] [-M bytes] [-S semilla] [-v] [-q]\n", prog);
+    printf("  -l N  Puerto donde escuchar a los clientes (default %d)\n", SERVER_PORT + 1);
+    printf("  -s A  Servidor (default 127.0.0.1:%d)\n", SERVER_PORT);
+    printf("  -p P  Preset de las capturas: %s\n", impair_preset_names());
+    printf("        (las opciones que siguen lo modifican)\n");
+    printf("  -d N  Demora de cada sentido en ms (el RTT es el doble)\n");
+    printf("  -j N  Jitter uniforme de +-N ms (sin reordenar)\n");
+    printf("  -L P  Perdida Bernoulli (0-1)\n");
+    printf("  -G    Perdida Gilbert-Elliott: P(bueno->malo), P(malo->bueno) y\n");
+    printf("        perdida en cada estado (default 1 y 0)\n");
+    printf("  -D P  Probabilidad de duplicar un datagrama\n");
+    printf("  -r P  Probabilidad de reordenar: se demora N ms extra (default %d)\n",
+           IMPAIR_REORDER_GAP_MS);
+    printf("  -b N  Ancho de banda de cada sentido en Mbit/s (default sin limite)\n");
+    printf("  -Q N  Cola antes del enlace limitado en bytes (default %d)\n", IMPAIR_QUEUE_DEFAULT);
+    printf("  -M N  Descartar datagramas de mas de N bytes (MTU del camino)\n");
+    printf("  -S N  Semilla: misma semilla y trafico, mismas perdidas (default 1)\n");
+    printf("  -v    Mostrar cada descarte\n");
+    printf("  -q    Solo errores y warnings\n");
+    printf("Ejemplo: %s -p lunar -L 0.01 & ./bin/client -P %d 127.0.0.1 g14-978e archivo archivo\n",
+           prog, SERVER_PORT + 1);
+}
+
+// Programa principal del proxy
+int main(int argc, char *argv[]) {
+    ImpairConfig config;
+    int listen_port = SERVER_PORT + 1;
+    const char *server = "127.0.0.1";
+    int server_port = SERVER_PORT;
+    uint64_t seed = 1;
+    char server_ip[64];
+    
+    impair_defaults(&config);
+    
+    // Parseo de argumentos (en orden: un preset se puede ajustar después)
+    for (int i = 1; i < argc; i++) {
+        int ok = 1;
+        if (strcmp(argv[i], "-l") == 0 && i + 1 < argc) {
+            listen_port = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc) {
+            server = argv[++i];
+        } else if (strcmp(argv[i], "-p") == 0 && i + 1 < argc) {
+            ok = impair_preset(&config, argv[++i]) == 0;
+        } else if (strcmp(argv[i], "-d") == 0 && i + 1 < argc) {
+            config.delay_us = (uint64_t)(atof(argv[++i]) * 1000);
+        } else if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+            config.jitter_us = (uint64_t)(atof(argv[++i]) * 1000);
+        } else if (strcmp(argv[i], "-L") == 0 && i + 1 < argc) {
+            config.loss = atof(argv[++i]);
+        } else if (strcmp(argv[i], "-G") == 0 && i + 1 < argc) {
+            ok = sscanf(argv[++i], "%lf,%lf,%lf,%lf", &config.ge_p, &config.ge_r,
+                        &config.ge_loss_bad, &config.ge_loss_good) >= 2;
+        } else if (strcmp(argv[i], "-D") == 0 && i + 1 < argc) {
+            config.duplicate = atof(argv[++i]);
+        } else if (strcmp(argv[i], "-r") == 0 && i + 1 < argc) {
+            double gap_ms = IMPAIR_REORDER_GAP_MS;
+            ok = sscanf(argv[++i], "%lf,%lf", &config.reorder, &gap_ms) >= 1;
+            config.reorder_gap_us = (uint64_t)(gap_ms * 1000);
+        } else if (strcmp(argv[i], "-b") == 0 && i + 1 < argc) {
+            config.rate_mbps = atof(argv[++i]);
+        } else if (strcmp(argv[i], "-Q") == 0 && i + 1 < argc) {
+            config.queue_bytes = strtoull(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "-M") == 0 && i + 1 < argc) {
+            config.mtu = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-S") == 0 && i + 1 < argc) {
+            seed = strtoull(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "-v") == 0) {
+            log_set_level(LOG_LEVEL_TRACE);
+        } else if (strcmp(argv[i], "-q") == 0) {
+            log_set_level(LOG_LEVEL_WARN);
+        } else {
+            ok = 0;
+        }
+        
+        if (!ok) {
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+    
+    // Servidor: ip o ip:puerto
+    snprintf(server_ip, sizeof(server_ip), "%s", server);
+    char *colon = strchr(server_ip, ':');
+    if (colon) {
+        *colon = '\0';
+        server_port = atoi(colon + 1);
+    }
+    
+    struct sockaddr_in server_addr;
+    memset(&server_addr, 0, sizeof(server_addr));
+    server_addr.sin_family = AF_INET;
+    server_addr.sin_port = htons(server_port);
+    if (inet_pton(AF_INET, server_ip, &server_addr.sin_addr) <= 0) {
+        printf("[ERROR] Direccion del servidor invalida: %s\n", server);
+        return 1;
+    }
+    
+    int front_fd = open_socket();
+    if (front_fd < 0) {
+        return 1;
+    }
+    
+    struct sockaddr_in listen_addr;
+    memset(&listen_addr, 0, sizeof(listen_addr));
+    listen_addr.sin_family = AF_INET;
+    listen_addr.sin_addr.s_addr = INADDR_ANY;
+    listen_addr.sin_port = htons(listen_port);
+    if (bind(front_fd, (struct sockaddr*)&listen_addr, sizeof(listen_addr)) < 0) {
+        perror("Error en bind");
+        close(front_fd);
+        return 1;
+    }
+    
+    // Un enlace por sentido, con generadores distintos
+    ImpairLink links[2];
+    impair_link_init(&links[DIR_TO_SERVER], &config, seed, DIR_TO_SERVER);
+    impair_link_init(&links[DIR_TO_CLIENT], &config, seed, DIR_TO_CLIENT);
+    
+    printf("========================================\n");
+    printf("  PROXY UDP (RED DEGRADADA)\n");
+    printf("========================================\n");
+    printf("Escucha: %d -> servidor %s:%d\n", listen_port, server_ip, server_port);
+    printf("Preset: %s\n", config.name);
+    printf("Demora: %.1f ms +- %.1f ms por sentido\n",
+           config.delay_us / 1000.0, config.jitter_us / 1000.0);
+    printf("Perdida: %.4f", config.loss);
+    if (config.ge_p > 0) {
+        printf(" + Gilbert-Elliott (p=%.4f, r=%.4f, malo=%.2f, bueno=%.4f)",
+               config.ge_p, config.ge_r, config.ge_loss_bad, config.ge_loss_good);
+    }
+    printf("\n");
+    printf("Duplicado: %.4f, reorden: %.4f (+%.1f ms)\n", config.duplicate, config.reorder,
+           config.reorder_gap_us / 1000.0);
+    if (config.rate_mbps > 0) {
+        printf("Ancho de banda: %.1f Mbit/s (cola %llu bytes)\n", config.rate_mbps,
+               (unsigned long long)config.queue_bytes);
+    } else {
+        printf("Ancho de banda: sin limite\n");
+    }
+    printf("MTU: %d\n", config.mtu);
+    printf("Semilla: %llu\n", (unsigned long long)seed);
+    printf("Reenviando...\n\n");
+    
+    signal(SIGINT, on_signal);
+    signal(SIGTERM, on_signal);
+    log_start();
+    
+    static uint8_t buf[MAX_DATAGRAM_SIZE];
+    struct pollfd fds[1 + PROXY_MAX_FLOWS];
+    
+    while (running) {
+        int64_t wait_us = deliver_due(front_fd);
+        
+        int polled = num_flows;
+        fds[0].fd = front_fd;
+        fds[0].events = POLLIN;
+        for (int i = 0; i < polled; i++) {
+            fds[1 + i].fd = flows[i].sockfd;
+            fds[1 + i].events = POLLIN;
+        }
+        
+        struct timespec timeout;
+        timeout.tv_sec = wait_us / 1000000;
+        timeout.tv_nsec = (wait_us % 1000000) * 1000;
+        int ready = ppoll(fds, 1 + polled, wait_us >= 0 ? &timeout : NULL, NULL);
+        if (ready < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            perror("Error en poll");
+            break;
+        }
+        
+        // Clientes -> servidor (se vacía el socket antes de volver a poll)
+        if (fds[0].revents & POLLIN) {
+            struct sockaddr_in from;
+            socklen_t from_len = sizeof(from);
+            int len;
+            while ((len = recvfrom(front_fd, buf, sizeof(buf), MSG_DONTWAIT,
+                                   (struct sockaddr*)&from, &from_len)) >= 0) {
+                int flow = find_flow(&from, &server_addr);
+                if (flow >= 0) {
+                    schedule(&links[DIR_TO_SERVER], flow, DIR_TO_SERVER, buf, len);
+                }
+                from_len = sizeof(from);
+            }
+        }
+        
+        // Servidor -> clientes (los flows nuevos de esta vuelta no están en fds)
+        for (int i = 0; i < polled; i++) {
+            if (!(fds[1 + i].revents & POLLIN)) {
+                continue;
+            }
+            int len;
+            while ((len = recv(flows[i].sockfd, buf, sizeof(buf), MSG_DONTWAIT)) >= 0) {
+                schedule(&links[DIR_TO_CLIENT], i, DIR_TO_CLIENT, buf, len);
+            }
+        }
+    }
+    
+    LOG_INFO("\n");
+    print_link_stats("Cliente -> servidor", &links[DIR_TO_SERVER].stats);
+    print_link_stats("Servidor -> cliente", &links[DIR_TO_CLIENT].stats);
+    
+    for (int i = 0; i < num_flows; i++) {
+        close(flows[i].sockfd);
+    }
+    close(front_fd);
+    return 0;
+}
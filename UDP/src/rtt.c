@@ -0,0 +1,61 @@
+#include "../include/protocol.h"
+#include "../include/rtt.h"
+
+// Estimador de RTT / RTO (RFC 6298)
+
+// Recalcula el RTO a partir de SRTT y RTTVAR
+// El margen sobre SRTT es al menos RTO_MIN_MS (como Linux): en un enlace
+// estable RTTVAR tiende a 0 y un RTO pegado al RTT dispara timeouts
+// espurios apenas se forma cola (por ejemplo por el pacing)
+static void rtt_update_rto(RttEstimator *rtt) {
+    uint64_t var_term = 4 * rtt->rttvar_us;
+    if (var_term < RTO_MIN_MS * 1000) {
+        var_term = RTO_MIN_MS * 1000;
+    }
+    
+    uint64_t rto_ms = (rtt->srtt_us + var_term + 999) / 1000;
+    
+    if (rto_ms < RTO_MIN_MS) rto_ms = RTO_MIN_MS;
+    if (rto_ms > RTO_MAX_MS) rto_ms = RTO_MAX_MS;
+    
+    rtt->rto_ms = (int)rto_ms;
+}
+
+// Inicializa el estimador sin muestras
+void rtt_init(RttEstimator *rtt) {
+    memset(rtt, 0, sizeof(RttEstimator));
+    rtt->rto_ms = TIMEOUT_MS;
+}
+
+// Incorpora una muestra de RTT
+void rtt_sample(RttEstimator *rtt, uint64_t rtt_us) {
+    if (!rtt->has_sample) {
+        // Primera muestra: SRTT = R, RTTVAR = R/2
+        rtt->srtt_us = rtt_us;
+        rtt->rttvar_us = rtt_us / 2;
+        rtt->has_sample = 1;
+    } else {
+        uint64_t delta = rtt->srtt_us > rtt_us ? rtt->srtt_us - rtt_us 
+                                               : rtt_us - rtt->srtt_us;
+        rtt->rttvar_us = (3 * rtt->rttvar_us + delta) / 4;
+        rtt->srtt_us = (7 * rtt->srtt_us + rtt_us) / 8;
+    }
+    
+    rtt->last_rtt_us = rtt_us;
+    rtt->backoffs = 0;
+    rtt_update_rto(rtt);
+}
+
+// Backoff exponencial tras un timeout
+void rtt_backoff(RttEstimator *rtt) {
+    rtt->rto_ms *= 2;
+    if (rtt->rto_ms > RTO_MAX_MS) {
+        rtt->rto_ms = RTO_MAX_MS;
+    }
+    rtt->backoffs++;
+}
+
+// Timeout para la próxima espera
+int rtt_timeout_ms(const RttEstimator *rtt) {
+    return rtt->rto_ms;
+}
@@ -1,67 +1,292 @@
+#define _GNU_SOURCE                 // pthread_setaffinity_np / CPU_SET
+#include <pthread.h>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <netinet/udp.h>
 #include "../include/protocol.h"
+#include "../include/batch.h"
+#include "../include/session_table.h"
+#include "../include/shared_file.h"
+#include "../include/checksum.h"
+#include "../include/compress.h"
 
 // Funciones del servidor UDP
 
-// Compara dos direcciones sockaddr_in
-// Retorna 1 si son iguales, 0 si no
-int addr_equal(struct sockaddr_in *addr1, struct sockaddr_in *addr2) {
-    return (addr1->sin_addr.s_addr == addr2->sin_addr.s_addr &&
-            addr1->sin_port == addr2->sin_port);
+// Busca una sesión de cliente existente por su dirección y lane (O(1) en la tabla hash)
+// Retorna: puntero a la sesión o NULL si no existe
+ClientSession* find_session(ServerState *state, struct sockaddr_in *client_addr, int lane) {
+    return session_table_find(state->sessions, client_addr, lane);
 }
 
+// Crea una nueva sesión de cliente (o un lane de una) con un registro del pool
+// Retorna: puntero a la nueva sesión o NULL si se alcanzó el límite
+ClientSession* create_session(ServerState *state, struct sockaddr_in *client_addr, int lane) {
+    ClientSession *session = session_table_insert(state->sessions, client_addr, lane);
+    if (!session) {
+        LOG_ERROR("[ERROR] No hay lugar para nuevo cliente (%u sesiones, max %d)\n",
+                  state->sessions->count, MAX_SESSIONS);
+        return NULL;
+    }
+    
+    // Inicializar sesión
+    session->active = 1;
+    session->parent = NULL;
+    session->lanes_open = 0;
+    session->phase = PHASE_NONE;
+    session->expected_seq = 0;
+    session->window = 1;
+    session->rx_buf = NULL;
+    session->rx_len = NULL;
+    session->rx_crc = NULL;
+    session->rx_lz = NULL;
+    session->fec = 0;
+    session->fec_group = NULL;
+    session->fec_buf = NULL;
+    session->fec_recovered = 0;
+    session->sack = 0;
+    session->ack_unsent = 0;
+    session->ack_now = 0;
+    session->sink.open = 0;
+    session->offsets = 0;
+    session->shared = NULL;
+    session->resume = 0;
+    session->checksum = 0;
+    session->compress = 0;
+    session->early = 0;
+    session->ticket = 0;
+    session->delta = 0;
+    session->delta_dec.basis_fd = -1;
+    session->download = NULL;
+    session->last_activity = time(NULL);
+    session->data_bytes = 0;
+    session->first_data_us = 0;
+    session->last_data_us = 0;
+    timer_init(&session->idle_timer);
+    wheel_add(&state->idle_timers, &session->idle_timer,
+              (uint64_t)state->config->idle_timeout * 1000);
+    
+    metric_add(&state->metrics, METRIC_SESSIONS_OPENED, 1);
+    metric_set(&state->metrics, METRIC_SESSIONS_ACTIVE, state->sessions->count);
+    
+    if (lane == 0) {
+        LOG_INFO("\n[NUEVA SESION] Cliente " LOG_ADDR_FMT " (worker %d, %u sesiones activas)\n",
+                 LOG_ADDR_ARGS(client_addr), state->worker_id, state->sessions->count);
+    }
+    
+    return session;
+}
 
-// Busca una sesión de cliente existente por su dirección
-// Retorna: puntero a la sesión o NULL si no existe
-ClientSession* find_session(ServerState *state, struct sockaddr_in *client_addr) {
-    for (int i = 0; i < MAX_CLIENTS; i++) {
-        if (state->clients[i].active && 
-            addr_equal(&state->clients[i].addr, client_addr)) {
-            return &state->clients[i];
-        }
+// Agrega la sesión a la lista de archivos abiertos (para el flush por inactividad)
+void track_open_file(ServerState *state, ClientSession *session) {
+    session->prev_open = NULL;
+    session->next_open = state->open_files;
+    if (state->open_files) {
+        state->open_files->prev_open = session;
     }
-    return NULL;
+    state->open_files = session;
 }
 
-// Crea una nueva sesión de cliente
-// Retorna: puntero a la nueva sesión o NULL si no hay slots disponibles
-ClientSession* create_session(ServerState *state, struct sockaddr_in *client_addr) {
-    // Buscar slot libre
-    for (int i = 0; i < MAX_CLIENTS; i++) {
-        if (!state->clients[i].active) {
-            // Inicializar sesión
-            memset(&state->clients[i], 0, sizeof(ClientSession));
-            memcpy(&state->clients[i].addr, client_addr, sizeof(struct sockaddr_in));
-            state->clients[i].active = 1;
-            state->clients[i].phase = PHASE_NONE;
-            state->clients[i].expected_seq = 0;
-            state->clients[i].file = NULL;
-            state->clients[i].last_activity = time(NULL);
-            
-            printf("\n[NUEVA SESION] Cliente ");
-            print_address(client_addr);
-            printf(" (slot %d)\n", i);
-            
-            return &state->clients[i];
+// Cierra el archivo de la sesión y la quita de la lista de archivos abiertos
+// commit = 1 al terminar la transferencia, 0 si se abandona
+int close_session_file(ServerState *state, ClientSession *session, int commit) {
+    if (!session->sink.open) {
+        return 0;
+    }
+    
+    if (session->prev_open) {
+        session->prev_open->next_open = session->next_open;
+    } else {
+        state->open_files = session->next_open;
+    }
+    if (session->next_open) {
+        session->next_open->prev_open = session->prev_open;
+    }
+    
+    int result = sink_close(&session->sink, commit);
+    
+    // Stream de un archivo multi-stream: el cierre del archivo lo decide
+    // el registro cuando terminan todos
+    if (session->shared) {
+        int status = shared_file_release(session->shared, commit && result == 0);
+        session->shared = NULL;
+        
+        LOG_INFO("[ARCHIVO] %s: stream de %llu bytes en %llu escrituras (%s)\n", session->sink.path,
+                 (unsigned long long)session->sink.bytes, (unsigned long long)session->sink.writes,
+                 status == 1 ? "archivo completo" : status == 0 ? "faltan streams" : "archivo descartado");
+        
+        return status < 0 ? -1 : result;
+    }
+    
+    if (commit && result == 0) {
+        LOG_INFO("[ARCHIVO] %s: %llu bytes en %llu escrituras%s\n", session->sink.path,
+                 (unsigned long long)session->sink.bytes, (unsigned long long)session->sink.writes,
+                 session->sink.durable ? " (fsync + rename)" : "");
+    } else {
+        LOG_INFO("[ARCHIVO] %s: %llu bytes en %llu escrituras (parcial, checkpoint en el byte %llu)\n",
+                 session->sink.path, (unsigned long long)session->sink.bytes,
+                 (unsigned long long)session->sink.writes,
+                 (unsigned long long)session->sink.last_ckpt);
+    }
+    
+    return result;
+}
+
+// Quita la sesión de la lista de ACKs pendientes (si estaba)
+void unlink_pending_ack(ServerState *state, ClientSession *session) {
+    if (session->ack_unsent == 0 && !session->ack_now) {
+        return;
+    }
+    if (session->prev_ack) {
+        session->prev_ack->next_ack = session->next_ack;
+    } else {
+        state->pending_acks = session->next_ack;
+    }
+    if (session->next_ack) {
+        session->next_ack->prev_ack = session->prev_ack;
+    }
+    session->ack_unsent = 0;
+    session->ack_now = 0;
+}
+
+// Vacía los buffers de las sesiones que dejaron de recibir datos
+void flush_idle_files(ServerState *state) {
+    uint64_t now = now_ms();
+    
+    if (now - state->last_idle_flush < SINK_IDLE_FLUSH_MS) {
+        return;
+    }
+    state->last_idle_flush = now;
+    
+    for (ClientSession *s = state->open_files; s; s = s->next_open) {
+        if (sink_flush_if_idle(&s->sink, now) < 0) {
+            perror("[ERROR] Error escribiendo archivo");
         }
     }
+}
+
+// Quita la sesión de la lista de descargas y cierra su archivo
+// Los DATA encolados apuntan al mapeo: se envían antes de liberarlo
+static void close_download(ServerState *state, ClientSession *session) {
+    if (!session->download) {
+        return;
+    }
     
-    printf("[ERROR] No hay slots disponibles para nuevo cliente\n");
-    return NULL;
+    if (session->prev_dl) {
+        session->prev_dl->next_dl = session->next_dl;
+    } else {
+        state->downloads = session->next_dl;
+    }
+    if (session->next_dl) {
+        session->next_dl->prev_dl = session->prev_dl;
+    }
+    
+    batch_flush(state->sockfd, state->batch);
+    download_close(session->download);
+    free(session->download);
+    session->download = NULL;
 }
 
-// Libera una sesión de cliente
-void free_session(ClientSession *session) {
-    if (session->file) {
-        fclose(session->file);
-        session->file = NULL;
+// Suelta lo que tiene la sesión de la transferencia en curso: el archivo
+// (queda parcial con su checkpoint), los buffers del modo ventana, la copia
+// anterior de una subida delta y el archivo de una descarga
+void release_transfer(ServerState *state, ClientSession *session) {
+    close_session_file(state, session, 0);
+    unlink_pending_ack(state, session);
+    close_download(state, session);
+    
+    // Liberar buffer de recepción del modo ventana
+    free(session->rx_buf);
+    free(session->rx_len);
+    free(session->rx_crc);
+    free(session->rx_lz);
+    free(session->fec_group);
+    free(session->fec_buf);
+    session->rx_buf = NULL;
+    session->rx_len = NULL;
+    session->rx_crc = NULL;
+    session->rx_lz = NULL;
+    session->fec_group = NULL;
+    session->fec_buf = NULL;
+    session->fec = 0;
+    
+    // Copia anterior de una subida delta
+    if (session->delta_dec.basis_fd >= 0) {
+        close(session->delta_dec.basis_fd);
+        session->delta_dec.basis_fd = -1;
+    }
+    session->delta = 0;
+}
+
+// Libera una sesión de cliente y devuelve su registro al pool
+// La sesión de un lane 0 se lleva sus lanes abiertos
+void free_session(ServerState *state, ClientSession *session) {
+    for (int lane = 1; session->lanes_open > 0 && lane <= MAX_LANES; lane++) {
+        ClientSession *child = find_session(state, &session->addr, lane);
+        if (child) {
+            free_session(state, child);
+        }
+    }
+    if (session->parent) {
+        session->parent->lanes_open--;
+        session->parent = NULL;
+    }
+    
+    release_transfer(state, session);
+    wheel_remove(&state->idle_timers, &session->idle_timer);
+    
+    // Goodput de la sesión: bytes de archivo entre el primer y el último DATA
+    uint64_t elapsed_us = session->last_data_us - session->first_data_us;
+    uint64_t goodput_kbps = elapsed_us > 0 ? session->data_bytes * 1000000ULL / elapsed_us / 1024 : 0;
+    if (session->data_bytes > 0) {
+        metric_observe(&state->metrics, METRIC_GOODPUT_KBPS, goodput_kbps);
     }
     
-    printf("\n[SESION CERRADA] Cliente ");
-    print_address(&session->addr);
-    printf(" (fase: %s)\n", phase_to_string(session->phase));
+    LOG_INFO("\n[%s] Cliente " LOG_ADDR_FMT " (lane %d, fase: %s, %llu bytes, %llu kB/s)\n",
+             session->lane > 0 ? "LANE CERRADO" : "SESION CERRADA", LOG_ADDR_ARGS(&session->addr),
+             session->lane, phase_to_string(session->phase),
+             (unsigned long long)session->data_bytes, (unsigned long long)goodput_kbps);
     
-    session->active = 0;
     session->phase = PHASE_NONE;
+    session_table_remove(state->sessions, session);
+    metric_add(&state->metrics, METRIC_SESSIONS_CLOSED, 1);
+    metric_set(&state->metrics, METRIC_SESSIONS_ACTIVE, state->sessions->count);
+}
+
+// Timer de inactividad vencido
+// Los handlers solo actualizan last_activity (nada por PDU en la rueda):
+// si hubo actividad desde que se programó, se reprograma por lo que falta
+void expire_idle_session(TimerNode *node, void *arg) {
+    ServerState *state = (ServerState*)arg;
+    ClientSession *session = (ClientSession*)((char*)node - offsetof(ClientSession, idle_timer));
+    time_t idle = time(NULL) - session->last_activity;
+    
+    if (idle < state->config->idle_timeout) {
+        wheel_add(&state->idle_timers, node,
+                  (uint64_t)(state->config->idle_timeout - idle) * 1000);
+        return;
+    }
+    
+    state->reaped++;
+    metric_add(&state->metrics, METRIC_SESSIONS_REAPED, 1);
+    LOG_INFO("\n[INACTIVA] Cliente " LOG_ADDR_FMT " sin actividad hace %lds (fase: %s), "
+             "cerrando (%llu sesiones cerradas por inactividad)\n",
+             LOG_ADDR_ARGS(&session->addr), (long)idle, phase_to_string(session->phase),
+             (unsigned long long)state->reaped);
+    free_session(state, session);
+}
+
+// Envía una PDU al cliente: se encola en el lote de respuestas, que se
+// envía con una sola syscall al terminar de procesar el lote recibido
+int server_send_pdu(ServerState *state, struct sockaddr_in *client_addr,
+                    PDU *pdu, int data_len) {
+    pdu->type = LANE_TYPE(pdu->type, state->lane);
+    int queued = batch_queue_send(state->sockfd, state->batch, client_addr, pdu, data_len);
+    if (queued > 0) {
+        metric_add(&state->metrics, METRIC_TX_PACKETS, 1);
+        metric_add(&state->metrics, METRIC_TX_BYTES, queued);
+    }
+    return queued;
 }
 
 // Envía un ACK al cliente, opcionalmente con mensaje de error
@@ -77,159 +302,1348 @@ int send_ack(ServerState *state, struct sockaddr_in *client_addr,
         build_pdu(&ack, TYPE_ACK, seq_num, NULL, 0);
     }
     
-    return send_pdu(state->sockfd, client_addr, &ack, data_len);
+    return server_send_pdu(state, client_addr, &ack, data_len);
+}
+
+// Envía un ACK en modo ventana (seq extendido de 32 bits) con flags
+// (ACK_FLAG_FEC si el DATA se reconstruyó)
+int send_ack_ext_flags(ServerState *state, struct sockaddr_in *client_addr, uint32_t seq,
+                       uint8_t flags) {
+    PDU ack;
+    
+    build_pdu(&ack, TYPE_ACK, flags, NULL, 0);
+    pdu_set_seq32(&ack, seq);
+    
+    return server_send_pdu(state, client_addr, &ack, EXT_SEQ_SIZE);
+}
+
+// Envía un ACK en modo ventana
+int send_ack_ext(ServerState *state, struct sockaddr_in *client_addr, uint32_t seq) {
+    return send_ack_ext_flags(state, client_addr, seq, 0);
+}
+
+// Envía un ACK en modo ventana con mensaje de error después del seq
+int send_ack_ext_error(ServerState *state, struct sockaddr_in *client_addr,
+                       uint32_t seq, const char *error_msg) {
+    PDU ack;
+    int msg_len = strlen(error_msg);
+    
+    if (msg_len > MAX_DATA_SIZE - EXT_SEQ_SIZE) {
+        msg_len = MAX_DATA_SIZE - EXT_SEQ_SIZE;
+    }
+    build_pdu(&ack, TYPE_ACK, 0, NULL, 0);
+    pdu_set_seq32(&ack, seq);
+    memcpy(ack.data + EXT_SEQ_SIZE, error_msg, msg_len);
+    
+    return server_send_pdu(state, client_addr, &ack, EXT_SEQ_SIZE + msg_len);
+}
+
+// Envía el ACK acumulativo con SACK de la sesión: Cum = rcv_base y el
+// bitmap de lo que llegó después (hasta rcv_high, el resto está en cero)
+int send_sack(ServerState *state, ClientSession *session) {
+    PDU ack;
+    state->lane = session->lane;
+    uint8_t *bitmap = ack.data + EXT_SEQ_SIZE;
+    int bitmap_len = 0;
+    
+    build_pdu(&ack, TYPE_ACK, ACK_FLAG_SACK, NULL, 0);
+    pdu_set_seq32(&ack, session->rcv_base);
+    
+    uint32_t span = session->rcv_high - session->rcv_base;
+    if (span > (uint32_t)session->window) {
+        span = 0;
+    }
+    for (uint32_t i = 0; i + 1 < span; i++) {
+        if (i % 8 == 0) {
+            bitmap[i / 8] = 0;
+        }
+        if (session->rx_len[(session->rcv_base + 1 + i) % session->window] >= 0) {
+            bitmap[i / 8] |= 1 << (i % 8);
+            bitmap_len = i / 8 + 1;
+        }
+    }
+    
+    LOG_TRACE("  TX: ACK cum=%u (%d bytes de SACK, %d DATA)\n",
+              session->rcv_base, bitmap_len, session->ack_unsent);
+    return server_send_pdu(state, &session->addr, &ack, EXT_SEQ_SIZE + bitmap_len);
+}
+
+// Anota que la sesión debe un ACK por un DATA (nuevo o no); sale en
+// flush_pending_acks al terminar el lote. urgent = 1 si no se puede demorar
+void schedule_ack(ServerState *state, ClientSession *session, int is_new, int urgent) {
+    if (session->ack_unsent == 0 && !session->ack_now) {
+        session->prev_ack = NULL;
+        session->next_ack = state->pending_acks;
+        if (state->pending_acks) {
+            state->pending_acks->prev_ack = session;
+        }
+        state->pending_acks = session;
+        session->ack_deadline = now_ms() + SACK_DELAY_MS;
+    }
+    if (is_new) {
+        session->ack_unsent++;
+    }
+    if (urgent) {
+        session->ack_now = 1;
+    }
+}
+
+// Envía un ACK por cada sesión que completó ack_every DATA, tiene un hueco
+// o venció su demora; las demás siguen esperando
+void flush_pending_acks(ServerState *state) {
+    uint64_t now = now_ms();
+    ClientSession *session = state->pending_acks;
+    
+    while (session) {
+        ClientSession *next = session->next_ack;
+        if (session->ack_now || session->ack_unsent >= session->ack_every ||
+            now >= session->ack_deadline) {
+            if (session->ack_unsent > 1) {
+                metric_add(&state->metrics, METRIC_ACKS_COALESCED, session->ack_unsent - 1);
+            }
+            send_sack(state, session);
+            unlink_pending_ack(state, session);
+        }
+        session = next;
+    }
+}
+
+// Responde a un WRQ aceptado: OACK si se negoció ventana, blksize,
+// retomar, checksum, compresión o delta, ACK común si no
+int send_wrq_reply(ServerState *state, ClientSession *session,
+                   struct sockaddr_in *client_addr) {
+    int custom_blksize = session->blksize != default_blksize(session->window);
+    
+    if (session->window <= 1 && !custom_blksize && !session->resume && !session->checksum &&
+        !session->compress && !session->fec && !session->ticket) {
+        LOG_TRACE("  TX: ACK seq=1\n");
+        return send_ack(state, client_addr, 1, NULL);
+    }
+    
+    uint8_t options[MAX_OPTIONS_SIZE];
+    char value[16];
+    int opt_len = 0;
+    if (session->shared) {
+        snprintf(value, sizeof(value), "%d", session->shared->streams);
+        opt_len = append_option(options, opt_len, sizeof(options), OPT_STREAMS, value);
+    }
+    if (session->window > 1) {
+        snprintf(value, sizeof(value), "%d", session->window);
+        opt_len = append_option(options, opt_len, sizeof(options), OPT_WINDOW, value);
+    }
+    if (custom_blksize) {
+        snprintf(value, sizeof(value), "%d", session->blksize);
+        opt_len = append_option(options, opt_len, sizeof(options), OPT_BLKSIZE, value);
+    }
+    if (session->resume) {
+        char crc[16];
+        snprintf(value, sizeof(value), "%llu", (unsigned long long)session->sink.committed);
+        snprintf(crc, sizeof(crc), "%08x", session->sink.crc);
+        opt_len = append_option(options, opt_len, sizeof(options), OPT_RESUME, value);
+        opt_len = append_option(options, opt_len, sizeof(options), OPT_PREFIX_CRC, crc);
+    }
+    if (session->checksum) {
+        opt_len = append_option(options, opt_len, sizeof(options), OPT_CHECKSUM, CHECKSUM_CRC32C);
+    }
+    if (session->compress) {
+        opt_len = append_option(options, opt_len, sizeof(options), OPT_COMPRESS, COMPRESS_LZ);
+    }
+    if (session->fec) {
+        snprintf(value, sizeof(value), "%d", session->fec);
+        opt_len = append_option(options, opt_len, sizeof(options), OPT_FEC, value);
+    }
+    if (session->sack) {
+        opt_len = append_option(options, opt_len, sizeof(options), OPT_SACK, "1");
+    }
+    if (session->delta) {
+        snprintf(value, sizeof(value), "%d", session->delta_dec.block_size);
+        opt_len = append_option(options, opt_len, sizeof(options), OPT_DELTA, value);
+        snprintf(value, sizeof(value), "%u", session->delta_dec.blocks);
+        opt_len = append_option(options, opt_len, sizeof(options), OPT_DBLOCKS, value);
+    }
+    if (session->early) {
+        opt_len = append_option(options, opt_len, sizeof(options), OPT_EARLY, "1");
+    }
+    if (session->ticket) {
+        char ticket[TICKET_HEX_LEN + 1];
+        ticket_issue(ticket, client_addr->sin_addr.s_addr, state->credentials, time(NULL));
+        opt_len = append_option(options, opt_len, sizeof(options), OPT_TICKET, ticket);
+    }
+    if (opt_len < 0) {
+        LOG_ERROR("[ERROR] Opciones del OACK de mas de %d bytes\n", MAX_OPTIONS_SIZE);
+        return send_ack(state, client_addr, 1, "Error armando OACK");
+    }
+    
+    PDU oack;
+    build_pdu(&oack, TYPE_OACK, 1, options, opt_len);
+    LOG_TRACE("  TX: OACK seq=1 (window=%d, blksize=%d, checksum=%s, compress=%s)\n",
+              session->window, session->blksize, session->checksum ? CHECKSUM_CRC32C : "no",
+              session->compress ? COMPRESS_LZ : "no");
+    
+    return server_send_pdu(state, client_addr, &oack, opt_len);
+}
+
+// Reserva el buffer de recepción fuera de orden para el modo ventana
+// (window slots de session->blksize bytes). Con DATA por offset cada chunk
+// se escribe al llegar y solo hace falta saber qué slots llegaron.
+// Con checksum se guarda además el CRC32C de cada slot para el digest,
+// con compresión si el slot quedó comprimido y con FEC un acumulador por
+// cada grupo que puede cruzar la ventana.
+// Retorna 0 si OK, -1 si no hay memoria
+int alloc_rx_window(ClientSession *session, int window) {
+    if (!session->offsets) {
+        session->rx_buf = malloc((size_t)window * session->blksize);
+    }
+    session->rx_len = malloc((size_t)window * sizeof(int));
+    if (session->checksum) {
+        session->rx_crc = malloc((size_t)window * sizeof(uint32_t));
+    }
+    if (session->compress) {
+        session->rx_lz = malloc((size_t)window);
+    }
+    if (session->fec) {
+        session->fec_groups = window / session->fec + 2;
+        session->fec_group = calloc(session->fec_groups, sizeof(FecGroup));
+        session->fec_buf = calloc(session->fec_groups, session->blksize);
+    }
+    
+    if ((!session->offsets && !session->rx_buf) || !session->rx_len ||
+        (session->checksum && !session->rx_crc) || (session->compress && !session->rx_lz) ||
+        (session->fec && (!session->fec_group || !session->fec_buf))) {
+        free(session->rx_buf);
+        free(session->rx_len);
+        free(session->rx_crc);
+        free(session->rx_lz);
+        free(session->fec_group);
+        free(session->fec_buf);
+        session->rx_buf = NULL;
+        session->rx_len = NULL;
+        session->rx_crc = NULL;
+        session->rx_lz = NULL;
+        session->fec_group = NULL;
+        session->fec_buf = NULL;
+        return -1;
+    }
+    
+    for (int i = 0; i < window; i++) {
+        session->rx_len[i] = -1;
+    }
+    
+    // Acumuladores vacíos (en cero valen para el grupo 0)
+    for (int i = 0; i < session->fec_groups && session->fec; i++) {
+        session->fec_group[i].xor = session->fec_buf + (size_t)i * session->blksize;
+    }
+    
+    session->window = window;
+    session->rcv_base = 0;
+    session->rcv_high = 0;
+    return 0;
+}
+
+// Verifica las credenciales de un HELLO (o de un WRQ 0-RTT)
+// Retorna NULL si son válidas o el mensaje de error para el cliente
+static const char* check_credentials(ServerState *state, const uint8_t *data, int len) {
+    // Validar longitud máxima 
+    if (len > MAX_CREDENTIALS_LEN) {
+        LOG_WARN("[ERROR] Credenciales muy largas (%d caracteres, max %d)\n",
+                 len, MAX_CREDENTIALS_LEN);
+        return "Credencial invalida (max 10 chars)";
+    }
+    
+    // Validar que solo tenga caracteres ASCII imprimibles
+    for (int i = 0; i < len; i++) {
+        if (data[i] < 32 || data[i] > 126) {
+            LOG_WARN("[ERROR] Credenciales con caracteres no-ASCII\n");
+            return "Credencial invalida (solo ASCII)";
+        }
+    }
+    
+    // Extraer credenciales
+    char credentials[MAX_CREDENTIALS_SIZE];
+    memset(credentials, 0, sizeof(credentials));
+    memcpy(credentials, data, len);
+    
+    if (strcmp(credentials, state->credentials) != 0) {
+        LOG_WARN("[ERROR] Credenciales invalidas: '%s'\n", credentials);
+        return "Credenciales invalidas";
+    }
+    
+    LOG_INFO("[OK] Credenciales validas: '%s'\n", credentials);
+    return NULL;
 }
 
 // Handler para HELLO (Fase 1: Autenticación)
 void handle_hello(ServerState *state, ClientSession *session, 
-                  PDU *pdu, struct sockaddr_in *client_addr, int data_len) {
-    printf("[HELLO] Cliente ");
-    print_address(client_addr);
-    printf(" - Fase actual: %s\n", phase_to_string(session->phase));
+                  const PduView *pdu, struct sockaddr_in *client_addr, int data_len) {
+    LOG_INFO("[HELLO] Cliente " LOG_ADDR_FMT " - Fase actual: %s\n",
+             LOG_ADDR_ARGS(client_addr), phase_to_string(session->phase));
     
     // Verificar que sea seq_num = 0
     if (pdu->seq_num != 0) {
-        printf("[ERROR] HELLO con seq_num incorrecto (%d), descartando\n", pdu->seq_num);
+        LOG_WARN("[ERROR] HELLO con seq_num incorrecto (%d), descartando\n", pdu->seq_num);
         return;
     }
     
-    // Validar longitud máxima 
-    if (data_len > MAX_CREDENTIALS_LEN) {
-        printf("[ERROR] Credenciales muy largas (%d caracteres, max %d)\n", 
-               data_len, MAX_CREDENTIALS_LEN);
-        send_ack(state, client_addr, 0, "Credencial invalida (max 10 chars)");
+    // Verificar credenciales
+    const char *error = check_credentials(state, pdu->data, data_len);
+    if (error) {
+        send_ack(state, client_addr, 0, error);
         return;
     }
     
-    // Validar que solo tenga caracteres ASCII imprimibles
-    for (int i = 0; i < data_len; i++) {
-        if (pdu->data[i] < 32 || pdu->data[i] > 126) {
-            printf("[ERROR] Credenciales con caracteres no-ASCII\n");
-            send_ack(state, client_addr, 0, "Credencial invalida (solo ASCII)");
+    // Actualizar estado
+    session->phase = PHASE_AUTHENTICATED;
+    session->expected_seq = 1; // Próximo será WRQ con seq=1
+    session->last_activity = time(NULL);
+    
+    // Enviar ACK
+    send_ack(state, client_addr, 0, NULL);
+    LOG_TRACE("  TX: ACK seq=0\n");
+}
+
+// Abre la copia anterior de filepath como base de una subida delta
+// Sin modo durable el archivo nuevo se escribe en el mismo nombre: la copia
+// se desvincula y se sigue leyendo por el descriptor
+// Retorna 0 si OK, -1 si no hay una copia utilizable
+static int open_delta_basis(ServerState *state, ClientSession *session, const char *filepath) {
+    DeltaDecoder *dec = &session->delta_dec;
+    struct stat st;
+    
+    int fd = open(filepath, O_RDONLY);
+    if (fd < 0) {
+        return -1;
+    }
+    if (fstat(fd, &st) < 0 || !S_ISREG(st.st_mode) || st.st_size < DELTA_MIN_BLOCK ||
+        (!state->config->durable && unlink(filepath) < 0)) {
+        close(fd);
+        return -1;
+    }
+    
+    memset(dec, 0, sizeof(DeltaDecoder));
+    dec->basis_fd = fd;
+    dec->block_size = delta_block_size(st.st_size);
+    uint64_t blocks = st.st_size / dec->block_size;
+    dec->blocks = blocks > DELTA_MAX_BLOCKS ? DELTA_MAX_BLOCKS : (uint32_t)blocks;
+    return 0;
+}
+
+// Sin modo durable una subida trunca el archivo en su lugar, y una descarga
+// que lo tiene mapeado recibiría SIGBUS: se pide el flock exclusivo mientras
+// se abre (las descargas tienen uno compartido, download.h)
+// Retorna el descriptor con el lock (-1 si no hace falta) o -2 si hay una
+// descarga del archivo en curso
+static int lock_upload_target(ServerState *state, const char *filepath) {
+    if (state->config->durable) {
+        return -1;
+    }
+    int fd = open(filepath, O_RDONLY);
+    if (fd < 0) {
+        return -1;
+    }
+    if (flock(fd, LOCK_EX | LOCK_NB) < 0) {
+        close(fd);
+        return errno == EWOULDBLOCK ? -2 : -1;
+    }
+    return fd;
+}
+
+// Handler para WRQ (Fase 2: Parametrización)
+void handle_wrq(ServerState *state, ClientSession *session, 
+                const PduView *pdu, struct sockaddr_in *client_addr, int data_len) {
+    LOG_INFO("[WRQ] Cliente " LOG_ADDR_FMT " - Fase actual: %s\n",
+             LOG_ADDR_ARGS(client_addr), phase_to_string(session->phase));
+    
+    // Verificar seq_num = 1
+    if (pdu->seq_num != 1) {
+        LOG_WARN("[ERROR] WRQ con seq_num incorrecto (%d), descartando\n", pdu->seq_num);
+        return;
+    }
+    
+    // Extraer filename (null-terminated, sin desbordar el buffer)
+    char filename[MAX_FILENAME_LEN + 1];
+    memset(filename, 0, sizeof(filename));
+    int name_len = strnlen((const char*)pdu->data, data_len);
+    memcpy(filename, pdu->data, name_len < MAX_FILENAME_LEN ? name_len : MAX_FILENAME_LEN);
+    
+    // Opciones después del filename: ventana, blksize, multi-stream,
+    // retomar, checksum, compresión, delta, FEC, SACK y 0-RTT
+    int opt_offset = name_len + 1;
+    const char *window_opt = NULL;
+    const char *blksize_opt = NULL;
+    const char *streams_opt = NULL;
+    const char *tsize_opt = NULL;
+    const char *resume_opt = NULL;
+    const char *checksum_opt = NULL;
+    const char *compress_opt = NULL;
+    const char *delta_opt = NULL;
+    const char *fec_opt = NULL;
+    const char *sack_opt = NULL;
+    const char *ticket_opt = NULL;
+    const char *auth_opt = NULL;
+    const char *early_opt = NULL;
+    if (opt_offset < data_len) {
+        const uint8_t *options = pdu->data + opt_offset;
+        int options_len = data_len - opt_offset;
+        window_opt = find_option(options, options_len, OPT_WINDOW);
+        blksize_opt = find_option(options, options_len, OPT_BLKSIZE);
+        streams_opt = find_option(options, options_len, OPT_STREAMS);
+        tsize_opt = find_option(options, options_len, OPT_TSIZE);
+        resume_opt = find_option(options, options_len, OPT_RESUME);
+        checksum_opt = find_option(options, options_len, OPT_CHECKSUM);
+        compress_opt = find_option(options, options_len, OPT_COMPRESS);
+        delta_opt = find_option(options, options_len, OPT_DELTA);
+        fec_opt = find_option(options, options_len, OPT_FEC);
+        sack_opt = find_option(options, options_len, OPT_SACK);
+        ticket_opt = find_option(options, options_len, OPT_TICKET);
+        auth_opt = find_option(options, options_len, OPT_AUTH);
+        early_opt = find_option(options, options_len, OPT_EARLY);
+    }
+    
+    // WRQ retransmitido (se perdió nuestra respuesta): reenviarla. Con 0-RTT
+    // puede llegar cuando ya empezaron los DATA
+    int resume_requested = resume_opt && atoi(resume_opt) == 1;
+    if ((session->phase == PHASE_WRQ_OK || session->phase == PHASE_TRANSFERRING) &&
+        strcmp(filename, session->filename) == 0 && session->resume == resume_requested) {
+        LOG_INFO("[INFO] WRQ duplicado, reenviando respuesta\n");
+        send_wrq_reply(state, session, client_addr);
+        return;
+    }
+    
+    // Otro WRQ antes del primer DATA (el cliente descartó la respuesta: un
+    // parcial que no coincide con su archivo) o el próximo archivo de un
+    // lane: se empieza de nuevo sobre el mismo registro
+    if (session->phase == PHASE_WRQ_OK || session->phase == PHASE_COMPLETED) {
+        if (session->phase == PHASE_WRQ_OK) {
+            LOG_INFO("[INFO] WRQ nuevo antes del primer DATA, descartando el anterior\n");
+        }
+        release_transfer(state, session);
+        session->offsets = 0;
+        session->resume = 0;
+        session->window = 1;
+        session->phase = PHASE_AUTHENTICATED;
+    }
+    
+    // 0-RTT: WRQ sin HELLO previo, autenticado con un ticket o las credenciales
+    if (session->phase == PHASE_NONE && (auth_opt || (ticket_opt && strcmp(ticket_opt, "1") != 0))) {
+        const char *error = NULL;
+        if (auth_opt) {
+            error = check_credentials(state, (const uint8_t*)auth_opt, strlen(auth_opt));
+        } else if (!ticket_check(ticket_opt, client_addr->sin_addr.s_addr, state->credentials,
+                                 time(NULL))) {
+            LOG_WARN("[ERROR] Ticket invalido o vencido\n");
+            error = "Ticket invalido";
+        } else {
+            LOG_INFO("[OK] Ticket valido\n");
+        }
+        if (error) {
+            send_ack(state, client_addr, 1, error);
+            free_session(state, session);
             return;
         }
+        session->phase = PHASE_AUTHENTICATED;
     }
     
-    // Extraer credenciales
-    char credentials[MAX_CREDENTIALS_SIZE];
-    memset(credentials, 0, sizeof(credentials));
-    memcpy(credentials, pdu->data, data_len);
+    // Verificar que esté autenticado (un WRQ sin sesión no la abre)
+    if (session->phase != PHASE_AUTHENTICATED) {
+        LOG_WARN("[ERROR] WRQ sin autenticacion previa, descartando\n");
+        if (session->phase == PHASE_NONE) {
+            free_session(state, session);
+        }
+        return;
+    }
     
-    // Verificar credenciales
-    if (strcmp(credentials, state->credentials) != 0) {
-        printf("[ERROR] Credenciales invalidas: '%s'\n", credentials);
-        send_ack(state, client_addr, 0, "Credenciales invalidas");
+    LOG_INFO("[INFO] Filename solicitado: '%s'\n", filename);
+    
+    // Rechazar filenames más largos que el máximo (no entran en el buffer)
+    if (name_len > MAX_FILENAME_LEN) {
+        send_ack(state, client_addr, 1, "Filename invalido (4-10 caracteres ASCII)");
+        return;
+    }
+    
+    // Validar filename
+    if (!validate_filename(filename)) {
+        send_ack(state, client_addr, 1, "Filename invalido (4-10 caracteres ASCII)");
+        return;
+    }
+    
+    int window = 1;
+    if (window_opt) {
+        window = atoi(window_opt);
+        if (window > WINDOW_MAX) {
+            window = WINDOW_MAX;
+        }
+        if (window < 1) {
+            window = 1;
+        }
+    }
+    
+    // Multi-stream: solo en modo ventana (el FIN cuenta chunks por seq)
+    int streams = streams_opt ? atoi(streams_opt) : 1;
+    if (streams_opt && (streams < 1 || streams > MAX_STREAMS || window < 2)) {
+        send_ack(state, client_addr, 1, "Multi-stream invalido (requiere ventana, max 16 streams)");
         return;
     }
     
-    printf("[OK] Credenciales validas: '%s'\n", credentials);
+    // Crear path completo para el archivo
+    char filepath[256];
+    snprintf(filepath, sizeof(filepath), "test_files/%s.received", filename);
+    
+    // Intentar abrir archivo para escritura: propio, o compartido con los
+    // demás streams del mismo archivo (escritura por offset)
+    if (streams_opt) {
+        int64_t size = tsize_opt ? atoll(tsize_opt) : -1;
+        int lock_fd = lock_upload_target(state, filepath);
+        if (lock_fd == -2) {
+            send_ack(state, client_addr, 1, "Archivo en descarga");
+            return;
+        }
+        session->shared = shared_file_open(filepath, size, streams, state->config->durable);
+        int open_errno = errno;
+        if (lock_fd >= 0) {
+            close(lock_fd);
+        }
+        if (!session->shared && open_errno == EBUSY) {
+            LOG_WARN("[WARNING] %s abierto por otra sesion, rechazando WRQ\n", filepath);
+            send_ack(state, client_addr, 1, "Archivo en uso por otra sesion");
+            return;
+        }
+        if (!session->shared) {
+            LOG_ERROR("[ERROR] No se pudo abrir %s para %d streams\n", filepath, streams);
+            send_ack(state, client_addr, 1, "Error abriendo archivo multi-stream");
+            return;
+        }
+        if (sink_attach(&session->sink, session->shared->fd, filepath, 
+                        state->config->write_buffer) < 0) {
+            shared_file_release(session->shared, 0);
+            session->shared = NULL;
+            send_ack(state, client_addr, 1, "Error creando archivo en servidor");
+            return;
+        }
+        session->offsets = 1;
+    } else {
+        // Otra sesión de este worker con el mismo archivo abierto se cierra
+        // (dejando su checkpoint al día, para retomar el archivo) solo si es
+        // una subida abandonada: del mismo cliente (volvió con otro puerto
+        // tras caerse) o sin actividad durante más que el RTO máximo, en el
+        // que un emisor vivo ya habría retransmitido. Si no, el WRQ se
+        // rechaza; si la tiene otro worker lo rechaza el flock del
+        // checkpoint hasta que la cierre su timer de inactividad
+        ClientSession *previous = state->open_files;
+        while (previous && (previous == session || previous->shared ||
+                            strcmp(previous->sink.path, filepath) != 0)) {
+            previous = previous->next_open;
+        }
+        
+        // Salvo que sea de otro lane de la misma sesión: ésa sigue en curso
+        ClientSession *owner = session->parent ? session->parent : session;
+        if (previous && (previous == owner || previous->parent == owner)) {
+            send_ack(state, client_addr, 1, "Archivo en uso en otro lane de la sesion");
+            return;
+        }
+        if (previous && previous->addr.sin_addr.s_addr != client_addr->sin_addr.s_addr &&
+            time(NULL) - previous->last_activity < RTO_MAX_MS / 1000) {
+            LOG_WARN("[WARNING] %s abierto por otra sesion, rechazando WRQ\n", filepath);
+            send_ack(state, client_addr, 1, "Archivo en uso por otra sesion");
+            return;
+        }
+        if (previous) {
+            LOG_INFO("[INFO] Sesion anterior con %s abierto, cerrandola\n", filepath);
+            free_session(state, previous);
+        }
+        
+        // Los dos locks se toman antes de abrir la base delta, que sin modo
+        // durable desvincula el archivo: un WRQ rechazado no lo toca
+        int ckpt_fd = sink_lock(filepath);
+        if (ckpt_fd < 0 && errno == EBUSY) {
+            LOG_WARN("[WARNING] %s abierto por otra sesion, rechazando WRQ\n", filepath);
+            send_ack(state, client_addr, 1, "Archivo en uso por otra sesion");
+            return;
+        }
+        if (ckpt_fd < 0) {
+            perror("[ERROR] No se pudo crear el checkpoint");
+            send_ack(state, client_addr, 1, "Error creando archivo en servidor");
+            return;
+        }
+        int lock_fd = lock_upload_target(state, filepath);
+        if (lock_fd == -2) {
+            close(ckpt_fd);
+            send_ack(state, client_addr, 1, "Archivo en descarga");
+            return;
+        }
+        
+        session->resume = resume_requested;
+        
+        // Delta (requiere ventana y checksum): la base es la copia anterior,
+        // salvo que haya un parcial para retomar
+        int delta_ok = delta_opt && atoi(delta_opt) == 1 && window > 1 && checksum_opt &&
+                       strcmp(checksum_opt, CHECKSUM_CRC32C) == 0;
+        if (delta_ok && !(session->resume && sink_resumable(filepath, state->config->durable) > 0) &&
+            open_delta_basis(state, session, filepath) == 0) {
+            LOG_INFO("[INFO] Copia anterior de %s como base delta (%u bloques de %d bytes)\n",
+                     filepath, session->delta_dec.blocks, session->delta_dec.block_size);
+        }
+        
+        int opened = sink_open(&session->sink, filepath, state->config->write_buffer,
+                               state->config->durable, session->resume, ckpt_fd);
+        if (lock_fd >= 0) {
+            close(lock_fd);
+        }
+        if (opened < 0) {
+            perror("[ERROR] No se pudo crear archivo");
+            send_ack(state, client_addr, 1, "Error creando archivo en servidor");
+            return;
+        }
+    }
+    track_open_file(state, session);
+    
+    if (session->shared) {
+        LOG_INFO("[OK] Archivo abierto: %s (stream %d/%d, %lld bytes)\n", filepath,
+                 session->shared->refs + session->shared->completed, streams,
+                 (long long)session->shared->size);
+    } else if (session->sink.committed > 0) {
+        LOG_INFO("[OK] Archivo retomado: %s desde el byte %llu (CRC32C %08x)\n", filepath,
+                 (unsigned long long)session->sink.committed, session->sink.crc);
+    } else {
+        LOG_INFO("[OK] Archivo abierto: %s\n", filepath);
+    }
+    
+    // Checksum y compresión: solo en modo ventana (se confirman si la ventana queda)
+    session->checksum = window > 1 && checksum_opt && strcmp(checksum_opt, CHECKSUM_CRC32C) == 0;
+    session->compress = window > 1 && compress_opt && strcmp(compress_opt, COMPRESS_LZ) == 0;
+    
+    // FEC: modo ventana con un stream; k fuera de rango se recorta
+    session->fec = 0;
+    if (window > 1 && !session->offsets && fec_opt && atoi(fec_opt) >= FEC_MIN_K) {
+        session->fec = atoi(fec_opt) < FEC_MAX_K ? atoi(fec_opt) : FEC_MAX_K;
+    }
+    
+    // Un blksize menor al mínimo se ignora; uno mayor se recorta al máximo
+    // (el offset de 8 bytes, el CRC y el largo extra de los FEC salen del
+    // mismo datagrama)
+    int ext_size = (session->offsets ? EXT_OFFSET_SIZE : 0) +
+                   (session->checksum ? EXT_CRC_SIZE : 0) +
+                   (session->fec ? FEC_EXT_SIZE : 0);
+    int max_blksize = state->config->max_blksize;
+    if (max_blksize > MAX_BLKSIZE - ext_size) {
+        max_blksize = MAX_BLKSIZE - ext_size;
+    }
+    int blksize = default_blksize(window) - ext_size;
+    if (blksize_opt && atoi(blksize_opt) >= MIN_BLKSIZE) {
+        blksize = atoi(blksize_opt);
+        if (blksize > max_blksize) {
+            blksize = max_blksize;
+        }
+    }
+    session->blksize = blksize;
+    
+    // Acotar la ventana para que window * blksize entre en el buffer fuera
+    // de orden y en la mitad del buffer del socket (el kernel cuenta el
+    // overhead de cada datagrama); nunca por debajo de 2
+    session->window = 1;
+    if (window > 1) {
+        long max_bytes = state->rcvbuf / 2;
+        if (max_bytes > RX_WINDOW_MAX_BYTES) {
+            max_bytes = RX_WINDOW_MAX_BYTES;
+        }
+        if ((long)window * blksize > max_bytes) {
+            window = max_bytes / blksize;
+            if (window < 2) {
+                window = 2;
+            }
+        }
+        
+        // Un grupo FEC no puede ser más grande que la ventana (el último
+        // DATA no saldría mientras falte uno anterior)
+        if (session->fec > window) {
+            session->fec = window;
+        }
+        
+        if (window > 1 && alloc_rx_window(session, window) < 0) {
+            // Los DATA por offset no se pueden recibir en Stop & Wait
+            if (session->offsets) {
+                close_session_file(state, session, 0);
+                send_ack(state, client_addr, 1, "Sin memoria para la ventana");
+                return;
+            }
+            LOG_ERROR("[ERROR] Sin memoria para ventana de %d, usando Stop & Wait\n", window);
+            session->checksum = 0;
+            session->compress = 0;
+            session->fec = 0;
+        }
+    }
+    
+    // SACK: solo si quedó la ventana; con una ventana chica se reconoce
+    // más seguido para que el cliente no se quede sin lugar esperando la demora
+    session->sack = session->window > 1 && sack_opt && atoi(sack_opt) == 1;
+    session->ack_every = state->config->ack_every;
+    if (session->ack_every > session->window / 2) {
+        session->ack_every = session->window / 2 > 1 ? session->window / 2 : 1;
+    }
+    
+    // Delta solo si quedaron la ventana y el checksum
+    session->delta = session->delta_dec.basis_fd >= 0 && session->window > 1 && session->checksum;
+    if (!session->delta && session->delta_dec.basis_fd >= 0) {
+        close(session->delta_dec.basis_fd);
+        session->delta_dec.basis_fd = -1;
+    }
+    
+    // 0-RTT: los DATA que vinieron atrás del WRQ valen si su formato es el
+    // negociado y empiezan donde empieza el archivo (no hay parcial)
+    int checksum_asked = checksum_opt && strcmp(checksum_opt, CHECKSUM_CRC32C) == 0;
+    int compress_asked = compress_opt && strcmp(compress_opt, COMPRESS_LZ) == 0;
+    session->early = early_opt && atoi(early_opt) == 1 && session->window > 1 &&
+                     !session->offsets && !session->fec && !session->delta &&
+                     (!blksize_opt || atoi(blksize_opt) == session->blksize) &&
+                     session->checksum == checksum_asked && session->compress == compress_asked &&
+                     session->sink.committed == 0;
+    if (early_opt && !session->early) {
+        LOG_INFO("[INFO] DATA del 0-RTT descartados: se renegoció su formato o hay un parcial\n");
+    }
+    
+    // Ticket nuevo para el próximo 0-RTT (solo la sesión, no sus lanes)
+    session->ticket = ticket_opt && session->lane == 0;
+    
+    // El digest sigue al prefijo que ya estaba escrito (subida retomada)
+    session->digest = session->offsets ? CRC32C_INIT : session->sink.crc;
+    session->file_base = session->offsets ? 0 : session->sink.committed;
+    
+    LOG_INFO("[INFO] Modo: %s (window=%d, blksize=%d, checksum: %s, compresion: %s, delta: %s, fec: %d, sack: %s, 0-RTT: %s)\n",
+             session->window > 1 ? "Selective Repeat" : "Stop & Wait", session->window,
+             session->blksize, session->checksum ? CHECKSUM_CRC32C : "no",
+             session->compress ? COMPRESS_LZ : "no", session->delta ? "si" : "no", session->fec,
+             session->sack ? "si" : "no", session->early ? "si" : "no");
+    
+    // Guardar filename y actualizar estado
+    snprintf(session->filename, sizeof(session->filename), "%s", filename);
+    session->phase = PHASE_WRQ_OK;
+    session->expected_seq = 0; // Próximo DATA será seq=0
+    session->last_activity = time(NULL);
+    
+    // Enviar ACK u OACK
+    send_wrq_reply(state, session, client_addr);
+}
+
+// Responde a un RRQ aceptado: OACK con lo negociado y el tamaño del archivo
+int send_rrq_reply(ServerState *state, ClientSession *session,
+                   struct sockaddr_in *client_addr) {
+    Download *dl = session->download;
+    uint8_t options[MAX_OPTIONS_SIZE];
+    char value[24];
+    int opt_len = 0;
+    
+    snprintf(value, sizeof(value), "%d", dl->window);
+    opt_len = append_option(options, opt_len, sizeof(options), OPT_WINDOW, value);
+    snprintf(value, sizeof(value), "%d", dl->blksize);
+    opt_len = append_option(options, opt_len, sizeof(options), OPT_BLKSIZE, value);
+    snprintf(value, sizeof(value), "%llu", (unsigned long long)dl->size);
+    opt_len = append_option(options, opt_len, sizeof(options), OPT_TSIZE, value);
+    if (dl->checksum) {
+        opt_len = append_option(options, opt_len, sizeof(options), OPT_CHECKSUM, CHECKSUM_CRC32C);
+    }
+    if (opt_len < 0) {
+        LOG_ERROR("[ERROR] Opciones del OACK de mas de %d bytes\n", MAX_OPTIONS_SIZE);
+        return send_ack(state, client_addr, 1, "Error armando OACK");
+    }
+    
+    PDU oack;
+    build_pdu(&oack, TYPE_OACK, 1, options, opt_len);
+    LOG_TRACE("  TX: OACK seq=1 (window=%d, blksize=%d, tsize=%llu)\n",
+              dl->window, dl->blksize, (unsigned long long)dl->size);
+    
+    return server_send_pdu(state, client_addr, &oack, opt_len);
+}
+
+// Handler para RRQ (descarga de un archivo recibido)
+void handle_rrq(ServerState *state, ClientSession *session,
+                const PduView *pdu, struct sockaddr_in *client_addr, int data_len) {
+    LOG_INFO("[RRQ] Cliente " LOG_ADDR_FMT " - Fase actual: %s\n",
+             LOG_ADDR_ARGS(client_addr), phase_to_string(session->phase));
+    
+    // Verificar seq_num = 1
+    if (pdu->seq_num != 1) {
+        LOG_WARN("[ERROR] RRQ con seq_num incorrecto (%d), descartando\n", pdu->seq_num);
+        return;
+    }
+    
+    // Extraer filename (null-terminated, sin desbordar el buffer)
+    char filename[MAX_FILENAME_LEN + 1];
+    memset(filename, 0, sizeof(filename));
+    int name_len = strnlen((const char*)pdu->data, data_len);
+    memcpy(filename, pdu->data, name_len < MAX_FILENAME_LEN ? name_len : MAX_FILENAME_LEN);
+    
+    // Opciones después del filename: ventana, blksize y checksum
+    int opt_offset = name_len + 1;
+    const char *window_opt = NULL;
+    const char *blksize_opt = NULL;
+    const char *checksum_opt = NULL;
+    if (opt_offset < data_len) {
+        const uint8_t *options = pdu->data + opt_offset;
+        int options_len = data_len - opt_offset;
+        window_opt = find_option(options, options_len, OPT_WINDOW);
+        blksize_opt = find_option(options, options_len, OPT_BLKSIZE);
+        checksum_opt = find_option(options, options_len, OPT_CHECKSUM);
+    }
+    
+    // RRQ retransmitido (se perdió el OACK): reenviarlo
+    if (session->download && strcmp(filename, session->filename) == 0) {
+        LOG_INFO("[INFO] RRQ duplicado, reenviando respuesta\n");
+        send_rrq_reply(state, session, client_addr);
+        return;
+    }
+    
+    // Las descargas van por la sesión autenticada (los lanes son de subidas)
+    if (session->lane > 0 || session->phase != PHASE_AUTHENTICATED) {
+        LOG_WARN("[ERROR] RRQ sin autenticacion previa o en un lane, descartando\n");
+        return;
+    }
+    
+    LOG_INFO("[INFO] Filename solicitado: '%s'\n", filename);
+    
+    if (name_len > MAX_FILENAME_LEN || !validate_filename(filename)) {
+        send_ack(state, client_addr, 1, "Filename invalido (4-10 caracteres ASCII)");
+        return;
+    }
+    
+    char filepath[256];
+    snprintf(filepath, sizeof(filepath), "test_files/%s.received", filename);
+    
+    // Un archivo que este worker está recibiendo no está completo
+    ClientSession *upload = state->open_files;
+    while (upload && strcmp(upload->sink.path, filepath) != 0) {
+        upload = upload->next_open;
+    }
+    if (upload) {
+        send_ack(state, client_addr, 1, "Archivo en uso");
+        return;
+    }
+    
+    int window = window_opt ? atoi(window_opt) : WINDOW_DEFAULT;
+    if (window > WINDOW_MAX) {
+        window = WINDOW_MAX;
+    }
+    if (window < 1) {
+        window = 1;
+    }
+    
+    // Mismo blksize que en las subidas: el default del modo ventana y el
+    // máximo configurado, menos el CRC si va
+    int checksum = checksum_opt && strcmp(checksum_opt, CHECKSUM_CRC32C) == 0;
+    int ext_size = checksum ? EXT_CRC_SIZE : 0;
+    int max_blksize = state->config->max_blksize;
+    if (max_blksize > MAX_BLKSIZE - ext_size) {
+        max_blksize = MAX_BLKSIZE - ext_size;
+    }
+    int blksize = default_blksize(2) - ext_size;
+    if (blksize_opt && atoi(blksize_opt) >= MIN_BLKSIZE) {
+        blksize = atoi(blksize_opt) < max_blksize ? atoi(blksize_opt) : max_blksize;
+    }
+    
+    Download *dl = malloc(sizeof(Download));
+    if (!dl || download_open(dl, filepath, blksize, window, checksum) < 0) {
+        const char *error = !dl ? "Sin memoria para la descarga"
+                          : errno == ENOENT ? "Archivo no encontrado"
+                          : errno == EBUSY ? "Archivo en uso"
+                          : "Error leyendo archivo";
+        LOG_WARN("[ERROR] No se pudo abrir %s para descarga: %s\n", filepath, error);
+        free(dl);
+        send_ack(state, client_addr, 1, error);
+        return;
+    }
+    
+    // Agregar a la lista de descargas: el loop las mueve
+    session->download = dl;
+    session->prev_dl = NULL;
+    session->next_dl = state->downloads;
+    if (state->downloads) {
+        state->downloads->prev_dl = session;
+    }
+    state->downloads = session;
+    
+    LOG_INFO("[OK] Descarga de %s: %llu bytes en %u DATA (window=%d, blksize=%d, checksum: %s)\n",
+             filepath, (unsigned long long)dl->size, dl->chunks, window, blksize,
+             checksum ? CHECKSUM_CRC32C : "no");
+    
+    snprintf(session->filename, sizeof(session->filename), "%s", filename);
+    session->phase = PHASE_TRANSFERRING;
+    session->window = window;
+    session->blksize = blksize;
+    session->first_data_us = now_us();
+    session->last_data_us = session->first_data_us;
+    session->last_activity = time(NULL);
+    
+    send_rrq_reply(state, session, client_addr);
+}
+
+// Procesa un ACK de una descarga (Seq o Cum + bitmap con ACK_FLAG_SACK)
+void handle_ack(ServerState *state, ClientSession *session, const PduView *pdu, int data_len) {
+    if (!session->download) {
+        LOG_DEBUG("[ERROR] ACK sin descarga en curso, descartando\n");
+        return;
+    }
+    
+    uint64_t acked = download_on_ack(session->download, pdu->data, data_len, pdu->seq_num);
+    if (acked > 0) {
+        session->data_bytes += acked;
+        session->last_data_us = state->rx_time_us;
+    }
+    session->last_activity = time(NULL);
+}
+
+// Cuenta los bytes de un DATA nuevo para las métricas y el goodput de la sesión
+static void count_data(ServerState *state, ClientSession *session, int len) {
+    metric_add(&state->metrics, METRIC_DATA_BYTES, len);
+    if (session->data_bytes == 0) {
+        session->first_data_us = state->rx_time_us;
+    }
+    session->data_bytes += len;
+    session->last_data_us = state->rx_time_us;
+}
+
+// Descomprime un payload con DATA_FLAG_LZ (RawLen + bloque) en state->lz_buf
+// Retorna el largo descomprimido o -1 si el bloque es inválido
+static int lz_unpack(ServerState *state, const uint8_t *payload, int len) {
+    if (len < LZ_RAW_LEN_SIZE) {
+        return -1;
+    }
+    uint32_t raw_len = get_be32(payload);
+    if (raw_len == 0 || raw_len > LZ_MAX_BLOCK) {
+        return -1;
+    }
+    int got = lz_decompress(payload + LZ_RAW_LEN_SIZE, len - LZ_RAW_LEN_SIZE,
+                            state->lz_buf, raw_len);
+    return got == (int)raw_len ? got : -1;
+}
+
+// Escribe datos reconstruidos de un stream delta: el digest es el del
+// archivo y no el de las instrucciones
+static int write_delta_output(void *ctx, const uint8_t *data, size_t len) {
+    ClientSession *session = ctx;
+    uint32_t crc = crc32c_update(CRC32C_INIT, data, len);
+    session->digest = crc32c_combine(session->digest, crc, len);
+    return sink_write_crc(&session->sink, data, len, crc);
+}
+
+// Verifica el CRC32C de un DATA o FEC con checksum: cubre los campos que
+// siguen a Type/Flags hasta el CRC y el payload. Se verifica antes de
+// cualquier ACK para que el cliente retransmita una PDU corrupta.
+// Avanza *chunk / *chunk_len detrás del CRC y deja en *chunk_crc el del
+// payload. Retorna 0 si coincide, -1 si falta o no coincide
+static int check_crc(ServerState *state, const PduView *pdu, const uint8_t **chunk, int *chunk_len,
+                     uint32_t *chunk_crc) {
+    if (!(pdu->seq_num & DATA_FLAG_CRC) || *chunk_len < EXT_CRC_SIZE) {
+        LOG_DEBUG("[ERROR] %s seq=%u sin CRC, descartando\n",
+                  pdu_type_to_string(pdu->type), get_be32(pdu->data));
+        return -1;
+    }
+    uint32_t expected = get_be32(*chunk);
+    uint32_t fields_crc = crc32c_update(CRC32C_INIT, pdu->data, *chunk - pdu->data);
+    *chunk += EXT_CRC_SIZE;
+    *chunk_len -= EXT_CRC_SIZE;
+    *chunk_crc = crc32c_update(CRC32C_INIT, *chunk, *chunk_len);
+    if (crc32c_combine(fields_crc, *chunk_crc, *chunk_len) != expected) {
+        LOG_DEBUG("[ERROR] %s seq=%u con CRC32C incorrecto, descartando\n",
+                  pdu_type_to_string(pdu->type), get_be32(pdu->data));
+        metric_add(&state->metrics, METRIC_CHECKSUM_ERRORS, 1);
+        return -1;
+    }
+    return 0;
+}
+
+// Guarda un chunk nuevo del modo ventana (recibido o reconstruido con FEC)
+// chunk es el payload tal como viajó y chunk_crc su CRC32C (con checksum).
+// Comprimido, se descomprime antes del ACK (un bloque inválido se descarta
+// como un DATA corrupto) y los bytes del archivo quedan en state->lz_buf.
+// Retorna los bytes de archivo que representa o -1 si se descarta
+static int store_chunk(ServerState *state, ClientSession *session, uint32_t seq,
+                       const uint8_t *chunk, int chunk_len, uint32_t chunk_crc,
+                       int compressed, uint64_t file_offset) {
+    int slot = seq % session->window;
+    const uint8_t *raw = chunk;
+    int raw_len = chunk_len;
+    uint32_t raw_crc = chunk_crc;
+    
+    if (compressed) {
+        raw_len = session->compress ? lz_unpack(state, chunk, chunk_len) : -1;
+        if (raw_len < 0) {
+            LOG_DEBUG("[ERROR] DATA seq=%u comprimido invalido, descartando\n", seq);
+            return -1;
+        }
+        raw = state->lz_buf;
+        if (session->checksum) {
+            raw_crc = crc32c_update(CRC32C_INIT, raw, raw_len);
+        }
+    }
+    
+    if (session->offsets) {
+        // Con offset el chunk se escribe al llegar, sin esperar el orden
+        int64_t size = session->shared->size;
+        if (size >= 0 && file_offset + raw_len > (uint64_t)size) {
+            LOG_DEBUG("[ERROR] DATA seq=%u fuera del archivo (offset %llu), descartando\n",
+                      seq, (unsigned long long)file_offset);
+            return -1;
+        }
+        if (sink_write_at(&session->sink, raw, raw_len, file_offset) < 0) {
+            perror("[ERROR] Error escribiendo en archivo");
+            return -1;
+        }
+        session->rx_len[slot] = raw_len;
+        LOG_TRACE("[DATA] seq=%u, %d bytes en offset %llu - escrito\n", seq, raw_len,
+                  (unsigned long long)file_offset);
+    } else {
+        // Se guarda tal como llegó (comprimido o no) hasta completar el orden
+        memcpy(session->rx_buf + (size_t)slot * session->blksize, chunk, chunk_len);
+        session->rx_len[slot] = chunk_len;
+        if (session->compress) {
+            session->rx_lz[slot] = compressed;
+        }
+        LOG_TRACE("[DATA] seq=%u, %d bytes%s - en buffer\n", seq, raw_len,
+                  compressed ? " (comprimido)" : "");
+    }
+    if (session->checksum) {
+        session->rx_crc[slot] = raw_crc;
+    }
+    if ((int32_t)(seq + 1 - session->rcv_high) > 0) {
+        session->rcv_high = seq + 1;
+    }
+    count_data(state, session, raw_len);
+    return raw_len;
+}
+
+// Acumulador FEC del grupo que empieza en first: si su lugar lo ocupa
+// otro grupo (ya escrito entero, ver alloc_rx_window) se vacía
+static FecGroup* fec_group_of(ClientSession *session, uint32_t first) {
+    FecGroup *group = &session->fec_group[(first / session->fec) % session->fec_groups];
+    if (group->first != first) {
+        fec_group_reset(group, first);
+    }
+    return group;
+}
+
+// Reconstruye el único DATA que le falta a un grupo, si ya están el FEC y
+// todos los demás: se guarda como uno recibido y se reconoce con
+// ACK_FLAG_FEC, sin esperar la retransmisión
+// Retorna el largo de archivo del DATA reconstruido (en *seq su seq) o -1
+// si todavía no se puede
+static int fec_recover(ServerState *state, ClientSession *session, FecGroup *group,
+                       struct sockaddr_in *client_addr, uint32_t *seq) {
+    int index = fec_group_missing(group);
+    if (index < 0) {
+        return -1;
+    }
+    
+    *seq = group->first + index;
+    int len = group->len_xor;
+    int compressed = (group->flags_xor & DATA_FLAG_LZ) != 0;
+    group->members |= 1u << index;
+    if (len == 0 || len > session->blksize ||
+        *seq - session->rcv_base >= (uint32_t)session->window ||
+        session->rx_len[*seq % session->window] >= 0) {
+        LOG_DEBUG("[ERROR] FEC del grupo %u inconsistente (seq=%u, %d bytes)\n",
+                  group->first, *seq, len);
+        return -1;
+    }
+    
+    uint32_t crc = session->checksum ? crc32c_update(CRC32C_INIT, group->xor, len) : 0;
+    int raw_len = store_chunk(state, session, *seq, group->xor, len, crc, compressed, 0);
+    if (raw_len < 0) {
+        return -1;
+    }
+    
+    session->fec_recovered++;
+    metric_add(&state->metrics, METRIC_FEC_RECOVERED, 1);
+    LOG_DEBUG("[FEC] seq=%u reconstruido (grupo %u)\n", *seq, group->first);
+    send_ack_ext_flags(state, client_addr, *seq, ACK_FLAG_FEC);
+    return raw_len;
+}
+
+// Escribe el prefijo contiguo de la ventana de recepción (ya escrito si hay
+// offset) y la avanza; con checksum el CRC de cada chunk se suma al digest
+// y al checkpoint sin volver a recorrer los datos. lz_buf tiene ya
+// descomprimido el chunk lz_seq (lz_len bytes, -1 = ninguno).
+// Retorna 0 si OK, -1 si hubo un error (sin ACK; la sesión puede haberse
+// cerrado)
+static int write_in_order(ServerState *state, ClientSession *session,
+                          struct sockaddr_in *client_addr, uint32_t seq,
+                          uint32_t lz_seq, int lz_len) {
+    while (session->rx_len[session->rcv_base % session->window] >= 0) {
+        int base_slot = session->rcv_base % session->window;
+        size_t len = session->rx_len[base_slot];
+        
+        if (!session->offsets) {
+            const uint8_t *data = session->rx_buf + (size_t)base_slot * session->blksize;
+            
+            // Comprimido (ya validado): el último guardado ya está en lz_buf
+            if (session->compress && session->rx_lz[base_slot]) {
+                len = session->rcv_base == lz_seq && lz_len >= 0
+                    ? (size_t)lz_len : (size_t)lz_unpack(state, data, len);
+                data = state->lz_buf;
+            }
+            
+            // Delta: se aplican las instrucciones sobre la copia anterior; un
+            // stream inválido no se puede recuperar y cierra la sesión
+            if (session->delta) {
+                if (delta_decode(&session->delta_dec, data, len, state->delta_buf,
+                                 DELTA_MAX_BLOCK, write_delta_output, session) < 0) {
+                    LOG_ERROR("[ERROR] Stream delta invalido o error de E/S en %s (seq=%u)\n",
+                              session->filename, session->rcv_base);
+                    send_ack_ext_error(state, client_addr, seq, "Stream delta invalido");
+                    free_session(state, session);
+                    return -1;
+                }
+            } else {
+                int result = session->checksum
+                    ? sink_write_crc(&session->sink, data, len, session->rx_crc[base_slot])
+                    : sink_write(&session->sink, data, len);
+                if (result < 0) {
+                    perror("[ERROR] Error escribiendo en archivo");
+                    return -1;
+                }
+            }
+        }
+        if (session->checksum && !session->delta) {
+            session->digest = crc32c_combine(session->digest, session->rx_crc[base_slot], len);
+        }
+        
+        session->rx_len[base_slot] = -1;
+        session->rcv_base++;
+    }
+    return 0;
+}
+
+// Handler para DATA en modo ventana (Selective Repeat)
+// Acepta cualquier seq dentro de [rcv_base, rcv_base + window), guarda los
+// fuera de orden y escribe en el archivo a medida que se completa el prefijo
+void handle_data_window(ServerState *state, ClientSession *session, 
+                        const PduView *pdu, struct sockaddr_in *client_addr, int data_len) {
+    if (data_len < EXT_SEQ_SIZE) {
+        LOG_DEBUG("[ERROR] DATA sin seq extendido (%d bytes), descartando\n", data_len);
+        return;
+    }
+    
+    uint32_t seq = get_be32(pdu->data);
+    const uint8_t *chunk = pdu->data + EXT_SEQ_SIZE;
+    int chunk_len = data_len - EXT_SEQ_SIZE;
+    uint64_t file_offset = 0;
+    
+    // DATA del 0-RTT que el servidor no aceptó: el cliente los vuelve a
+    // mandar sin el flag, con lo negociado
+    if ((pdu->seq_num & DATA_FLAG_EARLY) && !session->early) {
+        LOG_DEBUG("[DATA] seq=%u del 0-RTT no aceptado, descartando\n", seq);
+        return;
+    }
+    
+    // Stream de un multi-stream: el offset en el archivo sigue al seq
+    // (en modo ventana el byte de seq_num lleva los flags)
+    if (session->offsets) {
+        if (!(pdu->seq_num & DATA_FLAG_OFFSET) || chunk_len < EXT_OFFSET_SIZE) {
+            LOG_DEBUG("[ERROR] DATA seq=%u sin offset, descartando\n", seq);
+            return;
+        }
+        file_offset = get_be64(chunk);
+        chunk += EXT_OFFSET_SIZE;
+        chunk_len -= EXT_OFFSET_SIZE;
+    }
+    
+    // Checksum: el CRC cubre seq, offset y payload
+    uint32_t chunk_crc = 0;
+    if (session->checksum && check_crc(state, pdu, &chunk, &chunk_len, &chunk_crc) < 0) {
+        return;
+    }
+    
+    uint32_t offset = seq - session->rcv_base;  // Aritmética módulo 2^32
+    
+    // Ya escrito: el ACK se perdió, reconocer de nuevo sin escribir
+    if (offset >= (uint32_t)session->window && 
+        session->rcv_base - seq <= (uint32_t)session->window) {
+        LOG_DEBUG("[DATA] seq=%u duplicado, reenviando ACK\n", seq);
+        metric_add(&state->metrics, METRIC_DATA_DUPLICATE, 1);
+        if (session->sack) {
+            schedule_ack(state, session, 0, 1);
+        } else {
+            send_ack_ext(state, client_addr, seq);
+        }
+        return;
+    }
+    
+    // Fuera de la ventana de recepción
+    if (offset >= (uint32_t)session->window) {
+        LOG_DEBUG("[ERROR] DATA seq=%u fuera de ventana [%u, %u), descartando\n",
+                  seq, session->rcv_base, session->rcv_base + session->window);
+        metric_add(&state->metrics, METRIC_DATA_OUT_OF_ORDER, 1);
+        return;
+    }
+    
+    // No entra en el slot: más grande que el blksize negociado
+    if (chunk_len > session->blksize) {
+        LOG_DEBUG("[ERROR] DATA seq=%u de %d bytes (blksize=%d), descartando\n",
+                  seq, chunk_len, session->blksize);
+        return;
+    }
+    
+    int compressed = (pdu->seq_num & DATA_FLAG_LZ) != 0;
+    uint32_t lz_seq = seq;
+    int lz_len = -1;
+    uint32_t old_base = session->rcv_base;
+    int is_new = session->rx_len[seq % session->window] < 0;
+    
+    if (is_new) {
+        int raw_len = store_chunk(state, session, seq, chunk, chunk_len, chunk_crc,
+                                  compressed, file_offset);
+        if (raw_len < 0) {
+            return;
+        }
+        lz_len = compressed ? raw_len : -1;
+        
+        // FEC: el DATA se suma a su grupo; si era el último que faltaba
+        // para reconstruir otro, se reconstruye
+        if (session->fec) {
+            uint32_t first = seq - seq % session->fec;
+            FecGroup *group = fec_group_of(session, first);
+            uint32_t recovered;
+            fec_group_add(group, seq - first, chunk, chunk_len, pdu->seq_num & DATA_FLAG_LZ);
+            int recovered_len = fec_recover(state, session, group, client_addr, &recovered);
+            if (recovered_len >= 0 && (group->flags_xor & DATA_FLAG_LZ)) {
+                lz_seq = recovered;
+                lz_len = recovered_len;
+            }
+        }
+    } else {
+        LOG_DEBUG("[DATA] seq=%u duplicado (en buffer)\n", seq);
+        metric_add(&state->metrics, METRIC_DATA_DUPLICATE, 1);
+    }
+    
+    if (write_in_order(state, session, client_addr, seq, lz_seq, lz_len) < 0) {
+        return;
+    }
     
     // Actualizar estado
-    session->phase = PHASE_AUTHENTICATED;
-    session->expected_seq = 1; // Próximo será WRQ con seq=1
+    session->phase = PHASE_TRANSFERRING;
     session->last_activity = time(NULL);
     
-    // Enviar ACK
-    send_ack(state, client_addr, 0, NULL);
-    printf("  TX: ACK seq=0\n");
+    // SACK: un DATA nuevo en orden y sin nada pendiente detrás se reconoce
+    // junto con los siguientes; un hueco (o el DATA que llena uno) se
+    // avisa sin demora para que el cliente retransmita solo lo que falta
+    if (session->sack) {
+        int in_order = is_new && seq == old_base && session->rcv_base == session->rcv_high;
+        schedule_ack(state, session, is_new, !in_order);
+        return;
+    }
+    
+    // ACK selectivo del seq recibido
+    send_ack_ext(state, client_addr, seq);
+    LOG_TRACE("  TX: ACK seq=%u (base=%u)\n", seq, session->rcv_base);
 }
 
-// Handler para WRQ (Fase 2: Parametrización)
-void handle_wrq(ServerState *state, ClientSession *session, 
-                PDU *pdu, struct sockaddr_in *client_addr, int data_len) {
-    printf("[WRQ] Cliente ");
-    print_address(client_addr);
-    printf(" - Fase actual: %s\n", phase_to_string(session->phase));
-    
-    // Verificar que esté autenticado
-    if (session->phase != PHASE_AUTHENTICATED) {
-        printf("[ERROR] WRQ sin autenticacion previa, descartando\n");
+// Handler para FEC (paridad de un grupo de DATA, modo ventana)
+// No se reconoce: si con él se puede reconstruir el DATA que le falta al
+// grupo, se reconoce ese
+void handle_fec(ServerState *state, ClientSession *session,
+                const PduView *pdu, struct sockaddr_in *client_addr, int data_len) {
+    if ((session->phase != PHASE_WRQ_OK && session->phase != PHASE_TRANSFERRING) ||
+        !session->fec || data_len < EXT_SEQ_SIZE) {
+        LOG_DEBUG("[ERROR] FEC fuera de una subida con FEC, descartando\n");
         return;
     }
     
-    // Verificar seq_num = 1
-    if (pdu->seq_num != 1) {
-        printf("[ERROR] WRQ con seq_num incorrecto (%d), descartando\n", pdu->seq_num);
+    uint32_t first = get_be32(pdu->data);
+    const uint8_t *chunk = pdu->data + EXT_SEQ_SIZE;
+    int chunk_len = data_len - EXT_SEQ_SIZE;
+    uint32_t chunk_crc = 0;
+    if (session->checksum && check_crc(state, pdu, &chunk, &chunk_len, &chunk_crc) < 0) {
         return;
     }
-    
-    // Extraer filename (null-terminated)
-    char filename[MAX_FILENAME_LEN + 1];
-    memset(filename, 0, sizeof(filename));
-    memcpy(filename, pdu->data, data_len);
-    
-    printf("[INFO] Filename solicitado: '%s'\n", filename);
-    
-    // Validar filename
-    if (!validate_filename(filename)) {
-        send_ack(state, client_addr, 1, "Filename invalido (4-10 caracteres ASCII)");
+    if (chunk_len < FEC_EXT_SIZE) {
+        LOG_DEBUG("[ERROR] FEC del grupo %u incompleto, descartando\n", first);
         return;
     }
     
-    // Crear directorio test_files si no existe
-    static int dir_created = 0;
-    if (!dir_created) {
-        system("mkdir -p test_files");
-        dir_created = 1;
+    int count = chunk[0];
+    uint16_t len_xor = (uint16_t)(chunk[1] << 8 | chunk[2]);
+    chunk += FEC_EXT_SIZE;
+    chunk_len -= FEC_EXT_SIZE;
+    if (first % session->fec != 0 || count < 1 || count > session->fec ||
+        chunk_len > session->blksize) {
+        LOG_DEBUG("[ERROR] FEC del grupo %u invalido (%d DATA, %d bytes), descartando\n",
+                  first, count, chunk_len);
+        return;
     }
     
-    // Crear path completo para el archivo
-    char filepath[256];
-    snprintf(filepath, sizeof(filepath), "test_files/%s.received", filename);
-    
-    // Intentar abrir archivo para escritura
-    session->file = fopen(filepath, "wb");
-    if (!session->file) {
-        perror("[ERROR] No se pudo crear archivo");
-        send_ack(state, client_addr, 1, "Error creando archivo en servidor");
+    // Grupo ya escrito entero o todavía fuera de la ventana
+    if ((int32_t)(first + count - session->rcv_base) <= 0 ||
+        (int32_t)(first - session->rcv_base) >= session->window) {
+        LOG_DEBUG("[FEC] grupo %u fuera de la ventana (base=%u), descartando\n",
+                  first, session->rcv_base);
         return;
     }
     
-    printf("[OK] Archivo abierto: %s\n", filepath);
+    FecGroup *group = fec_group_of(session, first);
+    if (group->count != 0) {
+        LOG_DEBUG("[FEC] grupo %u duplicado\n", first);
+        return;
+    }
+    fec_group_add_parity(group, count, len_xor, pdu->seq_num & DATA_FLAG_LZ, chunk, chunk_len);
     
-    // Guardar filename y actualizar estado
-    strncpy(session->filename, filename, MAX_FILENAME_LEN);
-    session->phase = PHASE_WRQ_OK;
-    session->expected_seq = 0; // Próximo DATA será seq=0
     session->last_activity = time(NULL);
+    uint32_t recovered;
+    int recovered_len = fec_recover(state, session, group, client_addr, &recovered);
+    if (recovered_len < 0) {
+        return;
+    }
     
-    // Enviar ACK
-    send_ack(state, client_addr, 1, NULL);
-    printf("  TX: ACK seq=1\n");
+    session->phase = PHASE_TRANSFERRING;
+    write_in_order(state, session, client_addr, first, recovered,
+                   (group->flags_xor & DATA_FLAG_LZ) ? recovered_len : -1);
 }
 
 // Handler para DATA (Fase 3: Transferencia de Datos)
 void handle_data(ServerState *state, ClientSession *session, 
-                 PDU *pdu, struct sockaddr_in *client_addr, int data_len) {
+                 const PduView *pdu, struct sockaddr_in *client_addr, int data_len) {
     
     // Verificar que esté en fase correcta
     if (session->phase != PHASE_WRQ_OK && session->phase != PHASE_TRANSFERRING) {
-        printf("[ERROR] DATA sin WRQ previo, descartando\n");
+        LOG_DEBUG("[ERROR] DATA sin WRQ previo, descartando\n");
+        return;
+    }
+    
+    if (!session->sink.open) {
+        LOG_ERROR("[ERROR] Archivo no abierto\n");
+        return;
+    }
+    
+    if (session->window > 1) {
+        handle_data_window(state, session, pdu, client_addr, data_len);
+        return;
+    }
+    
+    // DATA repetido (se perdió el ACK): reconocer de nuevo sin escribir
+    if (session->phase == PHASE_TRANSFERRING && pdu->seq_num == 1 - session->expected_seq) {
+        LOG_DEBUG("[DATA] seq=%d duplicado, reenviando ACK\n", pdu->seq_num);
+        metric_add(&state->metrics, METRIC_DATA_DUPLICATE, 1);
+        send_ack(state, client_addr, pdu->seq_num, NULL);
         return;
     }
     
     // Verificar seq_num correcto
     if (pdu->seq_num != session->expected_seq) {
-        printf("[ERROR] DATA con seq_num incorrecto (esperado=%d, recibido=%d), descartando\n",
-               session->expected_seq, pdu->seq_num);
+        LOG_DEBUG("[ERROR] DATA con seq_num incorrecto (esperado=%d, recibido=%d), descartando\n",
+                  session->expected_seq, pdu->seq_num);
+        metric_add(&state->metrics, METRIC_DATA_OUT_OF_ORDER, 1);
         return;
     }
     
-    printf("[DATA] seq=%d, %d bytes - ", pdu->seq_num, data_len);
+    if (data_len > session->blksize) {
+        LOG_DEBUG("[ERROR] DATA de %d bytes (blksize=%d), descartando\n",
+                  data_len, session->blksize);
+        return;
+    }
     
-    // Escribir datos al archivo
-    if (session->file) {
-        size_t written = fwrite(pdu->data, 1, data_len, session->file);
-        if (written != (size_t)data_len) {
-            printf("[ERROR] Error escribiendo en archivo\n");
-            return;
-        }
-        fflush(session->file);
-        printf("escrito OK\n");
-    } else {
-        printf("[ERROR] Archivo no abierto\n");
+    // Escribir datos al archivo (buffer write-behind)
+    if (sink_write(&session->sink, pdu->data, data_len) < 0) {
+        perror("[ERROR] Error escribiendo en archivo");
         return;
     }
+    count_data(state, session, data_len);
+    LOG_TRACE("[DATA] seq=%d, %d bytes - escrito OK\n", pdu->seq_num, data_len);
     
     // Actualizar estado
     session->phase = PHASE_TRANSFERRING;
@@ -237,80 +1651,319 @@ void handle_data(ServerState *state, ClientSession *session,
     
     // Enviar ACK con el mismo seq_num
     send_ack(state, client_addr, pdu->seq_num, NULL);
-    printf("  TX: ACK seq=%d\n", pdu->seq_num);
+    LOG_TRACE("  TX: ACK seq=%d\n", pdu->seq_num);
     
     // Alternar expected_seq: 0 -> 1, 1 -> 0
     session->expected_seq = 1 - session->expected_seq;
 }
 
+// Handler para PROBE (sondeo de MTU entre el OACK y el primer DATA)
+// El cliente manda datagramas de distintos tamaños con DF; se responde otro
+// PROBE con el largo recibido (seq extendido) para que sepa cuáles pasaron
+void handle_probe(ServerState *state, ClientSession *session, 
+                  struct sockaddr_in *client_addr, int recv_len) {
+    if (session->phase != PHASE_WRQ_OK) {
+        LOG_WARN("[ERROR] PROBE fuera de la fase WRQ_OK, descartando\n");
+        return;
+    }
+    
+    LOG_DEBUG("[PROBE] %d bytes recibidos\n", recv_len);
+    session->last_activity = time(NULL);
+    
+    PDU reply;
+    build_pdu(&reply, TYPE_PROBE, 0, NULL, 0);
+    pdu_set_seq32(&reply, (uint32_t)recv_len);
+    server_send_pdu(state, client_addr, &reply, EXT_SEQ_SIZE);
+}
+
+// Handler para SIG (firmas de la copia anterior, entre el OACK y el primer DATA)
+// Se calculan al pedirlas, de a una página: no se guarda nada por sesión y
+// una página repetida (se perdió la respuesta) se vuelve a calcular
+void handle_sig(ServerState *state, ClientSession *session,
+                const PduView *pdu, struct sockaddr_in *client_addr, int data_len) {
+    if (session->phase != PHASE_WRQ_OK || !session->delta || data_len < EXT_SEQ_SIZE) {
+        LOG_DEBUG("[ERROR] SIG fuera de una subida delta, descartando\n");
+        return;
+    }
+    
+    DeltaDecoder *dec = &session->delta_dec;
+    uint32_t page = get_be32(pdu->data);
+    uint64_t first = (uint64_t)page * DELTA_SIGS_PER_PAGE;
+    if (first >= dec->blocks) {
+        LOG_DEBUG("[ERROR] SIG de la pagina %u (hay %u bloques), descartando\n", page, dec->blocks);
+        return;
+    }
+    int count = dec->blocks - first < DELTA_SIGS_PER_PAGE ? (int)(dec->blocks - first)
+                                                          : DELTA_SIGS_PER_PAGE;
+    
+    PDU reply;
+    build_pdu(&reply, TYPE_SIG, 0, NULL, 0);
+    pdu_set_seq32(&reply, page);
+    uint8_t *entry = reply.data + EXT_SEQ_SIZE;
+    for (int i = 0; i < count; i++) {
+        uint64_t offset = (first + i) * dec->block_size;
+        if (pread(dec->basis_fd, state->delta_buf, dec->block_size, (off_t)offset) !=
+            dec->block_size) {
+            perror("[ERROR] Error leyendo la copia anterior");
+            return;
+        }
+        put_be32(entry, delta_weak(state->delta_buf, dec->block_size));
+        put_be64(entry + 4, delta_strong(state->delta_buf, dec->block_size));
+        entry += DELTA_SIG_SIZE;
+    }
+    
+    session->last_activity = time(NULL);
+    server_send_pdu(state, client_addr, &reply, EXT_SEQ_SIZE + count * DELTA_SIG_SIZE);
+    LOG_TRACE("  TX: SIG pagina %u (%d bloques)\n", page, count);
+}
+
 // Handler para FIN (Fase 4: Finalización)
 void handle_fin(ServerState *state, ClientSession *session, 
-                PDU *pdu, struct sockaddr_in *client_addr, int data_len) {
-    printf("[FIN] Cliente ");
-    print_address(client_addr);
-    printf(" - Fase actual: %s\n", phase_to_string(session->phase));
+                const PduView *pdu, struct sockaddr_in *client_addr, int data_len) {
+    LOG_INFO("[FIN] Cliente " LOG_ADDR_FMT " - Fase actual: %s\n",
+             LOG_ADDR_ARGS(client_addr), phase_to_string(session->phase));
+    
+    // FIN en el lane 0 de una sesión sin subida en curso: el cliente
+    // terminó de usar los lanes y cierra la sesión
+    if (session->lane == 0 && session->phase == PHASE_AUTHENTICATED) {
+        LOG_INFO("[OK] Cliente cierra la sesion (%d lanes abiertos)\n", session->lanes_open);
+        if (data_len >= EXT_SEQ_SIZE) {
+            send_ack_ext(state, client_addr, get_be32(pdu->data));
+        } else {
+            send_ack(state, client_addr, pdu->seq_num, NULL);
+        }
+        free_session(state, session);
+        return;
+    }
+    
+    // Descarga: el cliente recibió todo y lo confirma con el total de DATA
+    if (session->download) {
+        Download *dl = session->download;
+        if (data_len < EXT_SEQ_SIZE || get_be32(pdu->data) != dl->chunks) {
+            LOG_WARN("[ERROR] FIN de descarga con un total de DATA incorrecto, descartando\n");
+            return;
+        }
+        LOG_INFO("[OK] Descarga completada: %s (%llu bytes, %llu retransmisiones)\n",
+                 session->filename, (unsigned long long)dl->size,
+                 (unsigned long long)dl->retransmits);
+        metric_add(&state->metrics, METRIC_FILES_COMPLETED, 1);
+        send_ack_ext(state, client_addr, dl->chunks);
+        free_session(state, session);
+        return;
+    }
     
-    // Verificar que esté en transferencia
-    if (session->phase != PHASE_TRANSFERRING) {
-        printf("[ERROR] FIN sin transferencia previa, descartando\n");
+    // FIN retransmitido en un lane que ya completó su archivo (se perdió
+    // el ACK final): reconocerlo otra vez
+    if (session->phase == PHASE_COMPLETED) {
+        if (session->window > 1 && data_len >= EXT_SEQ_SIZE &&
+            get_be32(pdu->data) == session->rcv_base) {
+            send_ack_ext(state, client_addr, session->rcv_base);
+        } else if (session->window == 1) {
+            send_ack(state, client_addr, pdu->seq_num, NULL);
+        }
+        return;
+    }
+    
+    // Verificar que esté en transferencia (un archivo vacío, o ya completo
+    // al retomar, no tiene DATA: el FIN llega tras el WRQ)
+    if (session->phase != PHASE_TRANSFERRING && session->phase != PHASE_WRQ_OK) {
+        LOG_WARN("[ERROR] FIN sin transferencia previa, descartando\n");
         return;
     }
     
-    if (data_len > 0) {
-        printf("[WARNING] FIN con payload no vacío (%d bytes), ignorando payload\n", data_len);
+    // En modo ventana el FIN lleva el total de chunks: verificar que llegaron todos
+    if (session->window > 1) {
+        if (data_len < EXT_SEQ_SIZE) {
+            LOG_WARN("[ERROR] FIN sin seq extendido, descartando\n");
+            return;
+        }
+        
+        uint32_t total_chunks = get_be32(pdu->data);
+        if (total_chunks != session->rcv_base) {
+            LOG_WARN("[ERROR] FIN con %u chunks pero se escribieron %u, descartando\n",
+                     total_chunks, session->rcv_base);
+            return;
+        }
+        
+        // Digest de todo lo recibido: si no coincide el archivo no se da por
+        // completo (queda el parcial, y en multi-stream el archivo falla)
+        if (session->checksum) {
+            if (data_len < EXT_SEQ_SIZE + EXT_CRC_SIZE) {
+                LOG_WARN("[ERROR] FIN sin digest, descartando\n");
+                return;
+            }
+            uint32_t digest = get_be32(pdu->data + EXT_SEQ_SIZE);
+            if (digest != session->digest) {
+                LOG_ERROR("[ERROR] Digest de %s incorrecto (cliente %08x, servidor %08x)\n",
+                          session->filename, digest, session->digest);
+                metric_add(&state->metrics, METRIC_CHECKSUM_ERRORS, 1);
+                send_ack_ext_error(state, client_addr, total_chunks,
+                                   "Digest CRC32C del archivo incorrecto");
+                free_session(state, session);
+                return;
+            }
+            LOG_INFO("[OK] Digest CRC32C verificado: %08x\n", session->digest);
+        }
+        
+        if (session->delta) {
+            if (!delta_decode_complete(&session->delta_dec)) {
+                LOG_WARN("[ERROR] FIN con una instruccion delta incompleta, descartando\n");
+                return;
+            }
+            LOG_INFO("[OK] Delta: %llu bytes reconstruidos, %llu copiados de la copia anterior\n",
+                     (unsigned long long)session->delta_dec.output_bytes,
+                     (unsigned long long)session->delta_dec.copied_bytes);
+        }
+        if (session->fec) {
+            LOG_INFO("[OK] FEC: %llu DATA reconstruidos sin retransmision (grupos de %d)\n",
+                     (unsigned long long)session->fec_recovered, session->fec);
+        }
+    } else if (data_len > 0 && data_len != EXT_LENGTH_SIZE) {
+        LOG_WARN("[WARNING] FIN con payload no vacío (%d bytes), ignorando payload\n", data_len);
     }
     
-    printf("[OK] Transferencia completada para archivo: %s\n", session->filename);
+    // Largo final (si el cliente lo manda): lo escrito tiene que ser todo
+    // el archivo, o el rango del stream
+    int length_at = session->window > 1 ? EXT_SEQ_SIZE + (session->checksum ? EXT_CRC_SIZE : 0) : 0;
+    if (data_len == length_at + EXT_LENGTH_SIZE) {
+        uint64_t length = get_be64(pdu->data + length_at);
+        uint64_t written = session->file_base + session->sink.bytes;
+        if (length != written) {
+            LOG_ERROR("[ERROR] Largo de %s incorrecto (cliente %llu bytes, servidor %llu)\n",
+                      session->filename, (unsigned long long)length, (unsigned long long)written);
+            if (session->window > 1) {
+                send_ack_ext_error(state, client_addr, get_be32(pdu->data),
+                                   "Largo del archivo incorrecto");
+            } else {
+                send_ack(state, client_addr, pdu->seq_num, "Largo del archivo incorrecto");
+            }
+            free_session(state, session);
+            return;
+        }
+        LOG_INFO("[OK] Largo verificado: %llu bytes\n", (unsigned long long)length);
+    }
     
-    // Cerrar archivo
-    if (session->file) {
-        fclose(session->file);
-        session->file = NULL;
+    // Cerrar archivo: vaciar el buffer (y fsync + rename en modo durable)
+    if (close_session_file(state, session, 1) < 0) {
+        LOG_ERROR("[ERROR] No se pudo completar el archivo %s\n", session->filename);
+        free_session(state, session);
+        return;
     }
     
+    LOG_INFO("[OK] Transferencia completada para archivo: %s\n", session->filename);
+    metric_add(&state->metrics, METRIC_FILES_COMPLETED, 1);
+    
     // Actualizar estado
     session->phase = PHASE_COMPLETED;
     session->last_activity = time(NULL);
     
-    // Enviar ACK final con el seq_num de la PDU FIN recibida
-    send_ack(state, client_addr, pdu->seq_num, NULL);
-    printf("  TX: ACK seq=%d\n", pdu->seq_num);
+    // Enviar ACK final con el seq de la PDU FIN recibida
+    if (session->window > 1) {
+        send_ack_ext(state, client_addr, get_be32(pdu->data));
+        LOG_TRACE("  TX: ACK seq=%u\n", get_be32(pdu->data));
+    } else {
+        send_ack(state, client_addr, pdu->seq_num, NULL);
+        LOG_TRACE("  TX: ACK seq=%d\n", pdu->seq_num);
+    }
     
-    // Liberar sesión
-    free_session(session);
+    // Liberar sesión; un lane queda completado hasta su próximo WRQ (o el
+    // cierre de la sesión) para poder reconocer un FIN retransmitido
+    if (session->parent) {
+        release_transfer(state, session);
+    } else {
+        free_session(state, session);
+    }
+    batch_print_stats(state->batch);
 }
 
-// Procesa un mensaje recibido
-void handle_message(ServerState *state, PDU *pdu, struct sockaddr_in *client_addr, 
-                   int recv_len) {
+// Abre el lane de una sesión autenticada con el primer WRQ que llega por él
+// Retorna: el registro del lane o NULL si no hay sesión o no hay lugar
+static ClientSession* open_lane(ServerState *state, struct sockaddr_in *client_addr, int lane) {
+    ClientSession *parent = find_session(state, client_addr, 0);
+    if (!parent || parent->phase == PHASE_NONE) {
+        LOG_DEBUG("[ERROR] WRQ en el lane %d sin sesion autenticada, descartando\n", lane);
+        return NULL;
+    }
+    
+    ClientSession *session = create_session(state, client_addr, lane);
+    if (!session) {
+        return NULL;
+    }
+    session->parent = parent;
+    session->phase = PHASE_AUTHENTICATED;
+    parent->lanes_open++;
+    
+    LOG_INFO("[LANE] Cliente " LOG_ADDR_FMT " abre el lane %d (%d abiertos)\n",
+             LOG_ADDR_ARGS(client_addr), lane, parent->lanes_open);
+    return session;
+}
+
+// Procesa una PDU recibida
+void handle_pdu(ServerState *state, const uint8_t *buf, struct sockaddr_in *client_addr, 
+                int recv_len) {
+    metric_add(&state->metrics, METRIC_RX_PACKETS, 1);
+    metric_add(&state->metrics, METRIC_RX_BYTES, recv_len);
+    
+    if (recv_len < 2) {
+        LOG_WARN("[ERROR] PDU demasiado pequeña (%d bytes), descartando\n", recv_len);
+        return;
+    }
+    
     // Calcular tamaño de datos 
     int data_len = recv_len - 2;
     
-    printf("\n----------------------------------------\n");
-    printf("RX: ");
-    print_pdu(pdu, data_len, "");
-    printf("De: ");
-    print_address(client_addr);
-    printf("\n");
+    // Separar el lane del tipo: las respuestas salen por el mismo lane
+    int lane = PDU_LANE(buf[0]);
+    PduView view = pdu_view(buf);
+    const PduView *pdu = &view;
+    state->lane = lane;
+    
+    LOG_TRACE("\n----------------------------------------\n"
+              "RX:  PDU [Type=%s(%d), Lane=%d, SeqNum=%d, DataLen=%d]\n"
+              "De: " LOG_ADDR_FMT "\n",
+              pdu_type_to_string(pdu->type), pdu->type, lane, pdu->seq_num, data_len,
+              LOG_ADDR_ARGS(client_addr));
+    
+    // La autenticación es de la sesión: solo por el lane 0
+    if (lane > 0 && pdu->type == TYPE_HELLO) {
+        LOG_DEBUG("[ERROR] HELLO en el lane %d, descartando\n", lane);
+        return;
+    }
     
     // Buscar o crear sesión
-    ClientSession *session = find_session(state, client_addr);
+    ClientSession *session = find_session(state, client_addr, lane);
     
     if (!session) {
-        // Solo crear sesión nueva si es HELLO
+        // Solo crear sesión nueva si es HELLO o WRQ (0-RTT, o el primero de un lane)
         if (pdu->type == TYPE_HELLO) {
-            session = create_session(state, client_addr);
+            session = create_session(state, client_addr, 0);
+            if (!session) {
+                LOG_ERROR("[ERROR] No se pudo crear sesion\n");
+                return;
+            }
+        } else if (lane > 0 && pdu->type == TYPE_WRQ) {
+            session = open_lane(state, client_addr, lane);
+            if (!session) {
+                return;
+            }
+        } else if (pdu->type == TYPE_WRQ) {
+            // 0-RTT: el WRQ trae la autenticación (handle_wrq la verifica)
+            session = create_session(state, client_addr, 0);
             if (!session) {
-                printf("[ERROR] No se pudo crear sesion\n");
                 return;
             }
         } else {
-            printf("[ERROR] Cliente sin sesion enviando %s, descartando\n",
-                   pdu_type_to_string(pdu->type));
+            LOG_DEBUG("[ERROR] Cliente sin sesion enviando %s, descartando\n",
+                      pdu_type_to_string(pdu->type));
             return;
         }
     }
     
+    // La actividad de un lane mantiene viva la sesión
+    if (session->parent) {
+        session->parent->last_activity = time(NULL);
+    }
+    
     // Procesar según tipo de PDU
     switch (pdu->type) {
         case TYPE_HELLO:
@@ -325,21 +1978,71 @@ void handle_message(ServerState *state, PDU *pdu, struct sockaddr_in *client_add
         case TYPE_FIN:
             handle_fin(state, session, pdu, client_addr, data_len);
             break;
+        case TYPE_PROBE:
+            handle_probe(state, session, client_addr, recv_len);
+            break;
+        case TYPE_SIG:
+            handle_sig(state, session, pdu, client_addr, data_len);
+            break;
+        case TYPE_FEC:
+            handle_fec(state, session, pdu, client_addr, data_len);
+            break;
+        case TYPE_RRQ:
+            handle_rrq(state, session, pdu, client_addr, data_len);
+            break;
+        case TYPE_ACK:
+            handle_ack(state, session, pdu, data_len);
+            break;
         default:
-            printf("[ERROR] Tipo de PDU desconocido (%d), descartando\n", pdu->type);
+            LOG_WARN("[ERROR] Tipo de PDU desconocido (%d), descartando\n", pdu->type);
+    }
+}
+
+// Procesa un mensaje recibido
+// Con UDP_GRO el buffer puede traer varios datagramas del mismo cliente
+// coalescidos: se separan cada seg_size bytes (el último puede ser menor)
+void handle_message(ServerState *state, uint8_t *buf, struct sockaddr_in *client_addr,
+                    int recv_len, int seg_size) {
+    if (seg_size <= 0 || recv_len <= seg_size) {
+        seg_size = recv_len;
+    }
+    
+    for (int offset = 0; offset < recv_len; offset += seg_size) {
+        int len = recv_len - offset < seg_size ? recv_len - offset : seg_size;
+        uint64_t start_ns = now_ns();
+        state->rx_time_us = start_ns / 1000;
+        handle_pdu(state, buf + offset, client_addr, len);
+        metric_observe(&state->metrics, METRIC_HANDLER_NS, now_ns() - start_ns);
     }
 }
 
-// Inicializa el estado del servidor
-int init_server(ServerState *state, const char *credentials) {
+// Cambia el timeout de recepción del socket (SO_RCVTIMEO)
+void set_rx_timeout(ServerState *state, int timeout_ms) {
+    struct timeval tv = { timeout_ms / 1000, (timeout_ms % 1000) * 1000 };
+    setsockopt(state->sockfd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    state->rx_timeout_ms = timeout_ms;
+}
+
+// Inicializa el estado del servidor (uno por worker)
+// Con reuseport varios sockets comparten SERVER_PORT y el kernel reparte
+// los clientes entre ellos por hash de (IP, puerto) de origen
+int init_server(ServerState *state, const char *credentials, 
+                const ServerConfig *config, int worker_id) {
     // Validar credenciales del servidor
     if (!validate_credentials(credentials)) {
-        printf("[ERROR] Credenciales del servidor invalidas\n");
+        LOG_ERROR("[ERROR] Credenciales del servidor invalidas\n");
         return -1;
     }
     
     // Copiar credenciales
+    memset(state, 0, sizeof(ServerState));
     strncpy(state->credentials, credentials, MAX_CREDENTIALS_SIZE - 1);
+    state->worker_id = worker_id;
+    state->config = config;
+    
+    // Bloque de métricas propio del worker (el estado no se mueve después)
+    metrics_init(&state->metrics);
+    metrics_register(&state->metrics);
     
     // Crear socket
     state->sockfd = create_udp_socket();
@@ -347,6 +2050,67 @@ int init_server(ServerState *state, const char *credentials) {
         return -1;
     }
     
+    // Recepción coalescida (GRO): si el kernel no la soporta se sigue sin ella
+    int gro = 0;
+    if (config->gro) {
+#ifdef UDP_GRO
+        int one = 1;
+        if (setsockopt(state->sockfd, SOL_UDP, UDP_GRO, &one, sizeof(one)) == 0) {
+            gro = 1;
+        } else {
+            perror("[WARNING] UDP_GRO no disponible, recibiendo sin coalescer");
+        }
+#else
+        LOG_WARN("[WARNING] UDP_GRO no soportado en este sistema\n");
+#endif
+    }
+    
+    // Lotes de recepción / envío
+    state->batch = batch_create(config->batch_size,
+                                2 + EXT_SEQ_SIZE + EXT_OFFSET_SIZE + EXT_CRC_SIZE +
+                                config->max_blksize, gro);
+    if (!state->batch) {
+        close(state->sockfd);
+        return -1;
+    }
+    
+    // Destino de los DATA comprimidos y lecturas de las copias anteriores
+    // de las subidas delta (uno por vez por worker)
+    state->lz_buf = malloc(LZ_MAX_BLOCK);
+    state->delta_buf = malloc(DELTA_MAX_BLOCK);
+    if (!state->lz_buf || !state->delta_buf) {
+        perror("Error reservando buffers de descompresion");
+        free(state->lz_buf);
+        free(state->delta_buf);
+        batch_destroy(state->batch);
+        close(state->sockfd);
+        return -1;
+    }
+    
+    if (config->num_workers > 1) {
+        int one = 1;
+        if (setsockopt(state->sockfd, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one)) < 0) {
+            perror("Error en SO_REUSEPORT");
+            close(state->sockfd);
+            return -1;
+        }
+    }
+    
+    // Buffer de recepción grande: una ventana de bloques de 64 kB no entra en
+    // el default; el kernel lo acota a rmem_max y se guarda el efectivo
+    int rcvbuf = RX_SOCKET_BUFFER;
+    socklen_t optlen = sizeof(rcvbuf);
+    setsockopt(state->sockfd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+    if (getsockopt(state->sockfd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, &optlen) < 0) {
+        rcvbuf = RX_SOCKET_BUFFER;
+    }
+    state->rcvbuf = rcvbuf;
+    
+    // Timeout de recepción: el loop se despierta aunque no lleguen PDUs
+    // para vaciar los buffers de las sesiones inactivas y avanzar la
+    // rueda de timers (una vez por tick)
+    set_rx_timeout(state, WHEEL_TICK_MS);
+    
     // Configurar dirección del servidor
     struct sockaddr_in server_addr;
     memset(&server_addr, 0, sizeof(server_addr));
@@ -361,65 +2125,322 @@ int init_server(ServerState *state, const char *credentials) {
         return -1;
     }
     
-    // Inicializar array de clientes
-    for (int i = 0; i < MAX_CLIENTS; i++) {
-        state->clients[i].active = 0;
+    // Inicializar tabla de sesiones
+    state->sessions = malloc(sizeof(SessionTable));
+    if (!state->sessions || session_table_init(state->sessions, MAX_SESSIONS) < 0) {
+        close(state->sockfd);
+        return -1;
     }
     
-    printf("========================================\n");
-    printf("  SERVIDOR UDP FILE TRANSFER\n");
-    printf("========================================\n");
-    printf("Puerto: %d\n", SERVER_PORT);
-    printf("Credenciales: %s\n", credentials);
-    printf("Max clientes: %d\n", MAX_CLIENTS);
-    printf("Escuchando...\n\n");
+    wheel_init(&state->idle_timers, now_ms());
     
     return 0;
 }
 
+// Destino de los DATA de una descarga
+typedef struct {
+    ServerState *state;
+    ClientSession *session;
+} DownloadTarget;
+
+// Encola un DATA de una descarga en el lote de respuestas (payload sin copiar)
+static int queue_download_data(void *ctx, uint8_t *hdr, int hdr_len,
+                               const uint8_t *data, int len) {
+    DownloadTarget *target = (DownloadTarget*)ctx;
+    ServerState *state = target->state;
+    
+    hdr[0] = LANE_TYPE(hdr[0], target->session->lane);
+    int queued = batch_queue_send_iov(state->sockfd, state->batch, &target->session->addr,
+                                      hdr, hdr_len, data, len);
+    if (queued > 0) {
+        metric_add(&state->metrics, METRIC_TX_PACKETS, 1);
+        metric_add(&state->metrics, METRIC_TX_BYTES, queued);
+    }
+    return queued;
+}
+
+// Envía lo que admita cada descarga (retransmisiones y chunks nuevos)
+void service_downloads(ServerState *state) {
+    ClientSession *session = state->downloads;
+    
+    while (session) {
+        ClientSession *next = session->next_dl;
+        DownloadTarget target = { state, session };
+        if (download_poll(session->download, queue_download_data, &target) < 0) {
+            LOG_ERROR("[ERROR] Descarga de %s sin respuesta del cliente " LOG_ADDR_FMT
+                      ", cerrando\n", session->filename, LOG_ADDR_ARGS(&session->addr));
+            free_session(state, session);
+        }
+        session = next;
+    }
+}
+
+// Loop principal: recibir un lote, procesarlo y enviar las respuestas juntas
+void server_loop(ServerState *state) {
+    BatchIO *batch = state->batch;
+    
+    while (1) {
+        int count = batch_recv(state->sockfd, batch);
+        
+        // Error del socket (no un timeout): se avisa una vez y se espera un
+        // tick de la rueda antes de reintentar, en vez de girar sobre el
+        // recv; los timers de las sesiones siguen corriendo
+        if (count < 0) {
+            if (!state->rx_failing) {
+                LOG_ERROR("[ERROR] Error recibiendo del socket: %s (reintentando cada %d ms)\n",
+                          strerror(errno), WHEEL_TICK_MS);
+                state->rx_failing = 1;
+            }
+            struct timespec backoff = { 0, WHEEL_TICK_MS * 1000000L };
+            nanosleep(&backoff, NULL);
+            count = 0;
+        } else if (state->rx_failing) {
+            LOG_INFO("[INFO] Recepcion del socket restablecida\n");
+            state->rx_failing = 0;
+        }
+        
+        for (int i = 0; i < count; i++) {
+            // Procesar mensaje
+            handle_message(state, batch_rx_buf(batch, i), &batch->rx_addrs[i],
+                           batch->rx_lens[i], batch->rx_seg_sizes[i]);
+        }
+        
+        service_downloads(state);
+        flush_pending_acks(state);
+        batch_flush(state->sockfd, batch);
+        flush_idle_files(state);
+        wheel_advance(&state->idle_timers, now_ms(), expire_idle_session, state);
+        
+        // Con ACKs demorados el loop tiene que despertarse a tiempo para
+        // mandarlos, y con descargas para sus timers y el pacing; se vuelve
+        // al tick de la rueda recién cuando una espera vence sin nada
+        // pendiente (no un setsockopt por lote)
+        int timeout_ms = state->rx_timeout_ms;
+        if (state->downloads) {
+            timeout_ms = DOWNLOAD_POLL_MS;
+        } else if (state->pending_acks) {
+            timeout_ms = SACK_DELAY_MS;
+        } else if (count == 0) {
+            timeout_ms = WHEEL_TICK_MS;
+        }
+        if (timeout_ms != state->rx_timeout_ms) {
+            set_rx_timeout(state, timeout_ms);
+        }
+    }
+}
+
+// Worker del pool: un thread con su propio socket y tabla de sesiones
+typedef struct {
+    ServerState state;              // Estado privado (sin locks en el hot path)
+    pthread_t thread;               // Thread del worker
+    int cpu;                        // CPU asignada (-1 = sin pinning)
+} Worker;
+
+// Fija el thread actual a una CPU
+void pin_to_cpu(int cpu) {
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    
+    int err = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    if (err != 0) {
+        LOG_WARN("[WARNING] No se pudo fijar el worker a la CPU %d: %s\n", cpu, strerror(err));
+    }
+#else
+    LOG_WARN("[WARNING] Pinning de CPU no soportado en este sistema (CPU %d)\n", cpu);
+#endif
+}
+
+// Punto de entrada de cada worker
+void* worker_main(void *arg) {
+    Worker *worker = (Worker*)arg;
+    
+    if (worker->cpu >= 0) {
+        pin_to_cpu(worker->cpu);
+    }
+    
+    server_loop(&worker->state);
+    return NULL;
+}
+
 // Programa principal del servidor UDP
 int main(int argc, char *argv[]) {
-    ServerState state;
-    
     // Credencial hardcodeada para tests
     const char *credentials = "TEST";
+    ServerConfig config;
+    
+    config.batch_size = BATCH_DEFAULT;
+    config.num_workers = 1;
+    config.pin_cpus = 0;
+    config.write_buffer = SINK_BUFFER_DEFAULT;
+    config.durable = 0;
+    config.gro = 0;
+    config.max_blksize = MAX_BLKSIZE;
+    config.idle_timeout = SESSION_IDLE_TIMEOUT_S;
+    config.ack_every = SACK_ACK_EVERY;
+    config.metrics_file = NULL;
+    config.metrics_socket = NULL;
+    
+    // Parseo de argumentos: opciones y credencial opcional
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-b") == 0 && i + 1 < argc) {
+            config.batch_size = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-t") == 0 && i + 1 < argc) {
+            config.num_workers = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-p") == 0) {
+            config.pin_cpus = 1;
+        } else if (strcmp(argv[i], "-W") == 0 && i + 1 < argc) {
+            config.write_buffer = strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "-D") == 0) {
+            config.durable = 1;
+        } else if (strcmp(argv[i], "-g") == 0) {
+            config.gro = 1;
+        } else if (strcmp(argv[i], "-M") == 0 && i + 1 < argc) {
+            config.max_blksize = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-I") == 0 && i + 1 < argc) {
+            config.idle_timeout = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-A") == 0 && i + 1 < argc) {
+            config.ack_every = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-m") == 0 && i + 1 < argc) {
+            config.metrics_file = argv[++i];
+        } else if (strcmp(argv[i], "-u") == 0 && i + 1 < argc) {
+            config.metrics_socket = argv[++i];
+        } else if (strcmp(argv[i], "-v") == 0) {
+            log_set_level(log_level + 1);
+        } else if (strcmp(argv[i], "-q") == 0) {
+            log_set_level(LOG_LEVEL_WARN);
+        } else if (argv[i][0] == '-') {
+            printf("Uso: %s [-b lote] [-t workers] [-p] [-W bytes] [-D] [-g] [-M bytes] [-I segundos] [-A n] [-m archivo] [-u socket] [-v] [-q] [credenciales]\n", argv[0]);
+            printf("  -b N  PDUs por syscall recvmmsg/sendmmsg (1-%d, default %d)\n",
+                   BATCH_MAX, BATCH_DEFAULT);
+            printf("  -t N  Workers con socket SO_REUSEPORT propio (1-%d, default 1)\n",
+                   MAX_WORKERS);
+            printf("  -p    Fijar cada worker a una CPU\n");
+            printf("  -W N  Buffer de escritura por sesion en bytes (default %d)\n",
+                   SINK_BUFFER_DEFAULT);
+            printf("  -D    Modo durable: fsync y rename atomico al recibir el FIN\n");
+            printf("  -g    Recepcion coalescida UDP_GRO (Linux)\n");
+            printf("  -M N  Blksize maximo aceptado (%d-%d, default %d)\n",
+                   MIN_BLKSIZE, MAX_BLKSIZE, MAX_BLKSIZE);
+            printf("  -I N  Cerrar sesiones sin actividad durante N segundos (default %d)\n",
+                   SESSION_IDLE_TIMEOUT_S);
+            printf("  -A N  Con SACK, un ACK cada N DATA en orden (1-%d, default %d)\n",
+                   WINDOW_MAX / 2, SACK_ACK_EVERY);
+            printf("  -m F  Snapshot de metricas en el archivo F (cada %dms y al terminar)\n",
+                   METRICS_INTERVAL_MS);
+            printf("  -u F  Servir las metricas en el socket UNIX F\n");
+            printf("  -v    Mas detalle: descartes de PDUs (-v) y cada PDU recibida y enviada (-v -v)\n");
+            printf("  -q    Solo errores y warnings\n");
+            return 1;
+        } else {
+            credentials = argv[i];
+        }
+    }
     
-    // Si se pasa argumento, usarlo 
-    if (argc == 2) {
-        credentials = argv[1];
+    if (config.max_blksize < MIN_BLKSIZE || config.max_blksize > MAX_BLKSIZE) {
+        printf("[ERROR] Blksize maximo invalido (%d, rango %d-%d)\n",
+               config.max_blksize, MIN_BLKSIZE, MAX_BLKSIZE);
+        return 1;
     }
     
-    // Inicializar servidor
-    if (init_server(&state, credentials) < 0) {
+    if (config.idle_timeout < 1) {
+        printf("[ERROR] Timeout de inactividad invalido (%d)\n", config.idle_timeout);
         return 1;
     }
     
-    // Loop principal
-    PDU pdu;
-    struct sockaddr_in client_addr;
-    socklen_t addr_len;
+    if (config.ack_every < 1 || config.ack_every > WINDOW_MAX / 2) {
+        printf("[ERROR] DATA por ACK invalido (%d, rango 1-%d)\n", config.ack_every, WINDOW_MAX / 2);
+        return 1;
+    }
     
-    while (1) {
-        addr_len = sizeof(client_addr);
-        
-        // Recibir mensaje
-        int recv_len = recvfrom(state.sockfd, &pdu, sizeof(PDU), 0,
-                               (struct sockaddr*)&client_addr, &addr_len);
-        
-        if (recv_len < 0) {
-            perror("Error en recvfrom");
-            continue;
+    int num_workers = config.num_workers;
+    if (num_workers < 1 || num_workers > MAX_WORKERS) {
+        printf("[ERROR] Cantidad de workers invalida (%d, max %d)\n", num_workers, MAX_WORKERS);
+        return 1;
+    }
+    
+    // Clave de los tickets del 0-RTT (la comparten todos los workers)
+    if (ticket_init() < 0) {
+        perror("Error generando la clave de tickets");
+        return 1;
+    }
+    
+    // Crear directorio test_files si no existe (antes de lanzar los workers)
+    mkdir("test_files", 0755);
+    
+    Worker *workers = calloc(num_workers, sizeof(Worker));
+    if (!workers) {
+        perror("Error reservando workers");
+        return 1;
+    }
+    
+    long num_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    if (num_cpus < 1) num_cpus = 1;
+    
+    // Inicializar un estado por worker; con más de uno se usa SO_REUSEPORT
+    for (int i = 0; i < num_workers; i++) {
+        if (init_server(&workers[i].state, credentials, &config, i) < 0) {
+            return 1;
         }
-        
-        if (recv_len < 2) {
-            printf("[ERROR] PDU demasiado pequeña (%d bytes), descartando\n", recv_len);
-            continue;
+        workers[i].cpu = config.pin_cpus ? (int)(i % num_cpus) : -1;
+    }
+    
+    printf("========================================\n");
+    printf("  SERVIDOR UDP FILE TRANSFER\n");
+    printf("========================================\n");
+    printf("Puerto: %d\n", SERVER_PORT);
+    printf("Credenciales: %s\n", credentials);
+    printf("Max sesiones: %d por worker\n", MAX_SESSIONS);
+    printf("Lote RX/TX: %d PDUs por syscall\n", workers[0].state.batch->size);
+    printf("Workers: %d%s\n", num_workers, config.pin_cpus ? " (fijados a CPU)" : "");
+    printf("Buffer de escritura: %zu bytes por sesion%s\n", config.write_buffer,
+           config.durable ? " (modo durable)" : "");
+    printf("UDP_GRO: %s\n", workers[0].state.batch->rx_gro ? "activo" : "no");
+    printf("Blksize maximo: %d bytes (SO_RCVBUF %d bytes)\n", config.max_blksize,
+           workers[0].state.rcvbuf);
+    printf("Timeout de inactividad: %ds\n", config.idle_timeout);
+    printf("CRC32C: %s\n", crc32c_impl());
+    printf("Log: %s\n", log_level_name(log_level));
+    printf("Metricas: %s (socket: %s)\n", config.metrics_file ? config.metrics_file : "no",
+           config.metrics_socket ? config.metrics_socket : "no");
+    printf("Escuchando...\n\n");
+    
+    // Desde acá los mensajes se formatean y escriben en el thread de log
+    log_start();
+    
+    if (metrics_start("servidor", config.metrics_file, config.metrics_socket) < 0) {
+        return 1;
+    }
+    
+    // Un solo worker corre en el thread principal
+    if (num_workers == 1) {
+        if (config.pin_cpus) {
+            pin_to_cpu(0);
+        }
+        server_loop(&workers[0].state);
+    }
+    
+    for (int i = 0; i < num_workers; i++) {
+        int err = pthread_create(&workers[i].thread, NULL, worker_main, &workers[i]);
+        if (err != 0) {
+            LOG_ERROR("[ERROR] No se pudo crear el worker %d: %s\n", i, strerror(err));
+            return 1;
         }
-        
-        // Procesar mensaje
-        handle_message(&state, &pdu, &client_addr, recv_len);
     }
     
-    close(state.sockfd);
+    for (int i = 0; i < num_workers; i++) {
+        pthread_join(workers[i].thread, NULL);
+    }
+    
+    for (int i = 0; i < num_workers; i++) {
+        close(workers[i].state.sockfd);
+        batch_destroy(workers[i].state.batch);
+        free(workers[i].state.lz_buf);
+        free(workers[i].state.delta_buf);
+        session_table_destroy(workers[i].state.sessions);
+        free(workers[i].state.sessions);
+    }
+    free(workers);
     return 0;
-}
\ No newline at end of file
+}
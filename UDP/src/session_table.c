@@ -0,0 +1,187 @@
+#include "../include/protocol.h"
+#include "../include/session_table.h"
+
+// Tabla hash de sesiones con pool de registros
+
+// Clave de 64 bits a partir de lane, IP y puerto
+static uint64_t addr_key(const struct sockaddr_in *addr, int lane) {
+    return ((uint64_t)lane << 48) | ((uint64_t)addr->sin_addr.s_addr << 16) | addr->sin_port;
+}
+
+// Mezcla de bits (finalizador de splitmix64) con la semilla de la tabla
+static uint32_t hash_key(const SessionTable *table, uint64_t key) {
+    uint64_t h = key ^ table->seed;
+    h ^= h >> 30;
+    h *= 0xbf58476d1ce4e5b9ULL;
+    h ^= h >> 27;
+    h *= 0x94d049bb133111ebULL;
+    h ^= h >> 31;
+    return (uint32_t)h;
+}
+
+// Agrega un bloque de registros al pool
+static int pool_grow(SessionTable *table) {
+    ClientSession *block = calloc(SESSION_POOL_BLOCK, sizeof(ClientSession));
+    ClientSession **blocks = realloc(table->blocks, 
+                                     (table->num_blocks + 1) * sizeof(ClientSession*));
+    if (!block || !blocks) {
+        free(block);
+        if (blocks) table->blocks = blocks;
+        return -1;
+    }
+    
+    table->blocks = blocks;
+    table->blocks[table->num_blocks++] = block;
+    
+    for (int i = SESSION_POOL_BLOCK - 1; i >= 0; i--) {
+        block[i].next_free = table->free_list;
+        table->free_list = &block[i];
+    }
+    
+    return 0;
+}
+
+// Inserta una entrada sin verificar carga (la clave no debe existir)
+static void insert_entry(SessionTable *table, uint64_t key, ClientSession *session) {
+    uint32_t mask = table->capacity - 1;
+    uint32_t i = hash_key(table, key) & mask;
+    
+    while (table->entries[i].session) {
+        i = (i + 1) & mask;
+    }
+    
+    table->entries[i].key = key;
+    table->entries[i].session = session;
+}
+
+// Duplica la capacidad de la tabla y reubica las entradas
+static int table_grow(SessionTable *table) {
+    SessionEntry *old_entries = table->entries;
+    uint32_t old_capacity = table->capacity;
+    
+    SessionEntry *entries = calloc((size_t)old_capacity * 2, sizeof(SessionEntry));
+    if (!entries) {
+        return -1;
+    }
+    
+    table->entries = entries;
+    table->capacity = old_capacity * 2;
+    
+    for (uint32_t i = 0; i < old_capacity; i++) {
+        if (old_entries[i].session) {
+            insert_entry(table, old_entries[i].key, old_entries[i].session);
+        }
+    }
+    
+    free(old_entries);
+    return 0;
+}
+
+// Inicializa la tabla
+int session_table_init(SessionTable *table, uint32_t max_sessions) {
+    memset(table, 0, sizeof(SessionTable));
+    table->capacity = SESSION_TABLE_INITIAL;
+    table->max_sessions = max_sessions;
+    table->seed = ((uint64_t)getpid() << 32) ^ now_us() ^ (uintptr_t)table;
+    
+    table->entries = calloc(table->capacity, sizeof(SessionEntry));
+    if (!table->entries || pool_grow(table) < 0) {
+        perror("Error reservando tabla de sesiones");
+        session_table_destroy(table);
+        return -1;
+    }
+    
+    return 0;
+}
+
+// Libera la tabla y los bloques del pool
+void session_table_destroy(SessionTable *table) {
+    for (int i = 0; i < table->num_blocks; i++) {
+        free(table->blocks[i]);
+    }
+    free(table->blocks);
+    free(table->entries);
+    memset(table, 0, sizeof(SessionTable));
+}
+
+// Busca una sesión por dirección y lane
+ClientSession* session_table_find(SessionTable *table, const struct sockaddr_in *addr, int lane) {
+    uint64_t key = addr_key(addr, lane);
+    uint32_t mask = table->capacity - 1;
+    uint32_t i = hash_key(table, key) & mask;
+    
+    while (table->entries[i].session) {
+        if (table->entries[i].key == key) {
+            return table->entries[i].session;
+        }
+        i = (i + 1) & mask;
+    }
+    
+    return NULL;
+}
+
+// Crea una sesión nueva tomando un registro del pool
+ClientSession* session_table_insert(SessionTable *table, const struct sockaddr_in *addr,
+                                    int lane) {
+    if (table->count >= table->max_sessions) {
+        return NULL;
+    }
+    
+    // Mantener el factor de carga <= 1/2
+    if ((table->count + 1) * 2 > table->capacity && table_grow(table) < 0) {
+        return NULL;
+    }
+    
+    if (!table->free_list && pool_grow(table) < 0) {
+        return NULL;
+    }
+    
+    ClientSession *session = table->free_list;
+    table->free_list = session->next_free;
+    
+    memset(session, 0, sizeof(ClientSession));
+    memcpy(&session->addr, addr, sizeof(struct sockaddr_in));
+    session->lane = lane;
+    
+    insert_entry(table, addr_key(addr, lane), session);
+    table->count++;
+    
+    return session;
+}
+
+// Quita una sesión y devuelve su registro al pool
+void session_table_remove(SessionTable *table, ClientSession *session) {
+    uint64_t key = addr_key(&session->addr, session->lane);
+    uint32_t mask = table->capacity - 1;
+    uint32_t i = hash_key(table, key) & mask;
+    
+    while (table->entries[i].session && table->entries[i].session != session) {
+        i = (i + 1) & mask;
+    }
+    
+    if (!table->entries[i].session) {
+        return;
+    }
+    
+    // Backward-shift: correr hacia atrás las entradas del mismo cluster
+    // que quedarían inalcanzables con el hueco
+    uint32_t hole = i;
+    uint32_t j = (i + 1) & mask;
+    while (table->entries[j].session) {
+        uint32_t home = hash_key(table, table->entries[j].key) & mask;
+        
+        // Mover si la posición ideal de j no está en (hole, j]
+        if (((j - home) & mask) >= ((j - hole) & mask)) {
+            table->entries[hole] = table->entries[j];
+            hole = j;
+        }
+        j = (j + 1) & mask;
+    }
+    table->entries[hole].session = NULL;
+    table->entries[hole].key = 0;
+    
+    table->count--;
+    session->active = 0;
+    session->next_free = table->free_list;
+    table->free_list = session;
+}
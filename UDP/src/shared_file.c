@@ -0,0 +1,169 @@
+#include <fcntl.h>
+#include <pthread.h>
+#include "../include/protocol.h"
+#include "../include/file_sink.h"
+#include "../include/shared_file.h"
+
+// Registro global de archivos multi-stream en curso
+
+static SharedFile *shared_files = NULL;
+static pthread_mutex_t shared_files_lock = PTHREAD_MUTEX_INITIALIZER;
+
+// Quita un archivo del registro (con el lock tomado) y lo libera
+static void shared_file_remove(SharedFile *file) {
+    for (SharedFile **link = &shared_files; *link; link = &(*link)->next) {
+        if (*link == file) {
+            *link = file->next;
+            break;
+        }
+    }
+    free(file);
+}
+
+// Suelta el flock: primero se borra el checkpoint (un multi-stream no se
+// retoma), así nadie toma el lock de un archivo que ya no está en path
+static void shared_file_unlock(SharedFile *file) {
+    unlink(file->ckpt_path);
+    close(file->ckpt_fd);
+}
+
+// Cierra un archivo completo: fsync y rename en modo durable
+// Retorna 0 si OK, -1 si error
+static int shared_file_commit(SharedFile *file) {
+    int result = 0;
+    
+    if (file->durable && fsync(file->fd) < 0) {
+        perror("[ERROR] Error en fsync");
+        result = -1;
+    }
+    if (close(file->fd) < 0) {
+        result = -1;
+    }
+    
+    if (file->durable) {
+        if (result == 0 && rename(file->tmp_path, file->path) < 0) {
+            perror("[ERROR] Error renombrando archivo temporal");
+            result = -1;
+        }
+        if (result < 0) {
+            unlink(file->tmp_path);
+        }
+    }
+    
+    shared_file_unlock(file);
+    return result;
+}
+
+// Abre o se une a un archivo multi-stream
+SharedFile* shared_file_open(const char *path, int64_t size, int streams, int durable) {
+    pthread_mutex_lock(&shared_files_lock);
+    
+    SharedFile *file;
+    for (file = shared_files; file; file = file->next) {
+        if (strcmp(file->path, path) == 0) {
+            break;
+        }
+    }
+    
+    // Stream de un archivo en curso: debe coincidir lo anunciado
+    if (file) {
+        if (file->failed || file->size != size || file->streams != streams ||
+            file->refs + file->completed >= streams) {
+            pthread_mutex_unlock(&shared_files_lock);
+            errno = EINVAL;
+            return NULL;
+        }
+        file->refs++;
+        pthread_mutex_unlock(&shared_files_lock);
+        return file;
+    }
+    
+    // Primer stream: crear el archivo y preasignar el tamaño total
+    file = calloc(1, sizeof(SharedFile));
+    if (!file) {
+        pthread_mutex_unlock(&shared_files_lock);
+        return NULL;
+    }
+    
+    snprintf(file->path, sizeof(file->path), "%s", path);
+    snprintf(file->tmp_path, sizeof(file->tmp_path), "%s.tmp", path);
+    snprintf(file->ckpt_path, sizeof(file->ckpt_path), "%s.ckpt", path);
+    file->durable = durable;
+    file->size = size;
+    file->streams = streams;
+    file->refs = 1;
+    
+    // El lock antes de truncar: un sink propio en curso (EBUSY) no se toca.
+    // Un checkpoint anterior queda vacío: el archivo se reescribe entero
+    file->ckpt_fd = sink_lock(path);
+    if (file->ckpt_fd < 0 || ftruncate(file->ckpt_fd, 0) < 0) {
+        int saved_errno = errno;
+        if (file->ckpt_fd >= 0) {
+            close(file->ckpt_fd);
+        }
+        free(file);
+        pthread_mutex_unlock(&shared_files_lock);
+        errno = saved_errno;
+        return NULL;
+    }
+    
+    file->fd = open(durable ? file->tmp_path : file->path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (file->fd < 0) {
+        shared_file_unlock(file);
+        free(file);
+        pthread_mutex_unlock(&shared_files_lock);
+        return NULL;
+    }
+    
+    // Sin posix_fallocate (por ejemplo tmpfs viejo) alcanza con el tamaño
+    if (size > 0 && posix_fallocate(file->fd, 0, size) != 0 &&
+        ftruncate(file->fd, size) < 0) {
+        close(file->fd);
+        unlink(durable ? file->tmp_path : file->path);
+        shared_file_unlock(file);
+        free(file);
+        pthread_mutex_unlock(&shared_files_lock);
+        return NULL;
+    }
+    
+    file->next = shared_files;
+    shared_files = file;
+    
+    pthread_mutex_unlock(&shared_files_lock);
+    return file;
+}
+
+// Suelta el archivo de una sesión
+int shared_file_release(SharedFile *file, int completed) {
+    int result;
+    
+    pthread_mutex_lock(&shared_files_lock);
+    file->refs--;
+    
+    if (completed && !file->failed) {
+        file->completed++;
+        result = 0;
+        
+        // Último rango: el archivo está completo
+        if (file->completed == file->streams) {
+            result = shared_file_commit(file) == 0 ? 1 : -1;
+            shared_file_remove(file);
+        }
+    } else {
+        // Stream abandonado: nadie más puede completar el archivo
+        file->failed = 1;
+        result = -1;
+        
+        if (file->refs == 0) {
+            close(file->fd);
+            if (file->durable) {
+                unlink(file->tmp_path);
+            }
+            shared_file_unlock(file);
+            shared_file_remove(file);
+        }
+    }
+    
+    pthread_mutex_unlock(&shared_files_lock);
+    return result;
+}
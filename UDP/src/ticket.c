@@ -0,0 +1,115 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/random.h>
+#include "../include/ticket.h"
+
+// Tickets de reanudación (formato en ticket.h)
+
+#define TICKET_MAX_INPUT 64             // Expiry + IP + credenciales (max 10 chars)
+
+static uint64_t ticket_key[2];
+
+#define ROTL(x, b) (((x) << (b)) | ((x) >> (64 - (b))))
+
+#define SIPROUND(v0, v1, v2, v3) do {                                   \
+        v0 += v1; v1 = ROTL(v1, 13); v1 ^= v0; v0 = ROTL(v0, 32);       \
+        v2 += v3; v3 = ROTL(v3, 16); v3 ^= v2;                          \
+        v0 += v3; v3 = ROTL(v3, 21); v3 ^= v0;                          \
+        v2 += v1; v1 = ROTL(v1, 17); v1 ^= v2; v2 = ROTL(v2, 32);       \
+    } while (0)
+
+// SipHash-2-4 de data con la clave del servidor
+static uint64_t siphash(const uint8_t *data, size_t len) {
+    uint64_t v0 = 0x736f6d6570736575ULL ^ ticket_key[0];
+    uint64_t v1 = 0x646f72616e646f6dULL ^ ticket_key[1];
+    uint64_t v2 = 0x6c7967656e657261ULL ^ ticket_key[0];
+    uint64_t v3 = 0x7465646279746573ULL ^ ticket_key[1];
+    size_t i = 0;
+    
+    // Bloques de 8 bytes (little endian) y el último con el largo
+    for (; i + 8 <= len; i += 8) {
+        uint64_t m = 0;
+        for (int b = 7; b >= 0; b--) {
+            m = m << 8 | data[i + b];
+        }
+        v3 ^= m;
+        SIPROUND(v0, v1, v2, v3);
+        SIPROUND(v0, v1, v2, v3);
+        v0 ^= m;
+    }
+    uint64_t last = (uint64_t)(len & 0xff) << 56;
+    for (int b = 0; i + b < len; b++) {
+        last |= (uint64_t)data[i + b] << (8 * b);
+    }
+    v3 ^= last;
+    SIPROUND(v0, v1, v2, v3);
+    SIPROUND(v0, v1, v2, v3);
+    v0 ^= last;
+    
+    v2 ^= 0xff;
+    for (int r = 0; r < 4; r++) {
+        SIPROUND(v0, v1, v2, v3);
+    }
+    return v0 ^ v1 ^ v2 ^ v3;
+}
+
+int ticket_init(void) {
+    uint8_t key[16];
+    size_t got = 0;
+    
+    while (got < sizeof(key)) {
+        ssize_t n = getrandom(key + got, sizeof(key) - got, 0);
+        if (n <= 0) {
+            return -1;
+        }
+        got += n;
+    }
+    memcpy(ticket_key, key, sizeof(key));
+    return 0;
+}
+
+// Mac del ticket con vencimiento expiry
+static uint64_t ticket_mac(uint32_t expiry, uint32_t ip, const char *credentials) {
+    uint8_t input[TICKET_MAX_INPUT];
+    size_t cred_len = strnlen(credentials, sizeof(input) - 8);
+    
+    for (int b = 0; b < 4; b++) {
+        input[b] = expiry >> (24 - 8 * b);
+    }
+    memcpy(input + 4, &ip, 4);
+    memcpy(input + 8, credentials, cred_len);
+    return siphash(input, 8 + cred_len);
+}
+
+void ticket_issue(char *out, uint32_t ip, const char *credentials, time_t now) {
+    uint32_t expiry = (uint32_t)(now + TICKET_LIFETIME);
+    snprintf(out, TICKET_HEX_LEN + 1, "%08x%016llx", expiry,
+             (unsigned long long)ticket_mac(expiry, ip, credentials));
+}
+
+int ticket_check(const char *ticket, uint32_t ip, const char *credentials, time_t now) {
+    char expiry_hex[9];
+    char mac_hex[17];
+    uint8_t diff = 0;
+    
+    if (strlen(ticket) != TICKET_HEX_LEN || strspn(ticket, "0123456789abcdef") != TICKET_HEX_LEN) {
+        return 0;
+    }
+    memcpy(expiry_hex, ticket, 8);
+    expiry_hex[8] = '\0';
+    uint32_t expiry = (uint32_t)strtoul(expiry_hex, NULL, 16);
+    
+    if ((int64_t)expiry < (int64_t)now) {
+        return 0;
+    }
+    
+    // El Mac se compara en hexadecimal con el recalculado, byte a byte y
+    // sin cortar en la primera diferencia (tiempo constante)
+    snprintf(mac_hex, sizeof(mac_hex), "%016llx",
+             (unsigned long long)ticket_mac(expiry, ip, credentials));
+    for (int i = 0; i < 16; i++) {
+        diff |= (uint8_t)(ticket[8 + i] ^ mac_hex[i]);
+    }
+    return diff == 0;
+}
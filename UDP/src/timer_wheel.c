@@ -0,0 +1,156 @@
+#include <stddef.h>
+#include "../include/timer_wheel.h"
+
+// Rueda de timers jerárquica
+
+// Agrega un nodo al final de una lista circular
+static void list_append(TimerNode *head, TimerNode *node) {
+    node->prev = head->prev;
+    node->next = head;
+    head->prev->next = node;
+    head->prev = node;
+}
+
+// Saca un nodo de su lista
+static void list_unlink(TimerNode *node) {
+    node->prev->next = node->next;
+    node->next->prev = node->prev;
+    node->next = NULL;
+    node->prev = NULL;
+}
+
+// Pasa todos los nodos de head a la lista local list (head queda vacía)
+static void list_move(TimerNode *head, TimerNode *list) {
+    if (head->next == head) {
+        list->next = list;
+        list->prev = list;
+        return;
+    }
+    list->next = head->next;
+    list->prev = head->prev;
+    list->next->prev = list;
+    list->prev->next = list;
+    head->next = head;
+    head->prev = head;
+}
+
+// Ubica un timer en el nivel más bajo que alcanza su vencimiento
+static void wheel_place(TimerWheel *wheel, TimerNode *node) {
+    uint64_t max_delta = (1ULL << (WHEEL_BITS * WHEEL_LEVELS)) - 1;
+    
+    // Ya vencido: sale en el próximo tick; demasiado lejos: se acota
+    if (node->expires < wheel->tick) {
+        node->expires = wheel->tick;
+    }
+    if (node->expires - wheel->tick > max_delta) {
+        node->expires = wheel->tick + max_delta;
+    }
+    
+    uint64_t delta = node->expires - wheel->tick;
+    int level = 0;
+    while (level < WHEEL_LEVELS - 1 && delta >= (1ULL << (WHEEL_BITS * (level + 1)))) {
+        level++;
+    }
+    
+    int slot = (node->expires >> (WHEEL_BITS * level)) & WHEEL_MASK;
+    list_append(&wheel->slots[level][slot], node);
+}
+
+// Baja los timers de un slot de un nivel superior a los que correspondan
+static void wheel_cascade(TimerWheel *wheel, int level, int index) {
+    TimerNode list;
+    list_move(&wheel->slots[level][index], &list);
+    
+    while (list.next != &list) {
+        TimerNode *node = list.next;
+        list_unlink(node);
+        wheel_place(wheel, node);
+    }
+}
+
+// Inicializa la rueda
+void wheel_init(TimerWheel *wheel, uint64_t now_ms) {
+    for (int level = 0; level < WHEEL_LEVELS; level++) {
+        for (int slot = 0; slot < WHEEL_SLOTS; slot++) {
+            wheel->slots[level][slot].next = &wheel->slots[level][slot];
+            wheel->slots[level][slot].prev = &wheel->slots[level][slot];
+        }
+    }
+    wheel->start_ms = now_ms;
+    wheel->tick = 0;
+    wheel->count = 0;
+}
+
+void timer_init(TimerNode *node) {
+    node->next = NULL;
+    node->prev = NULL;
+    node->expires = 0;
+}
+
+int timer_pending(const TimerNode *node) {
+    return node->next != NULL;
+}
+
+// Programa un timer
+void wheel_add(TimerWheel *wheel, TimerNode *node, uint64_t delay_ms) {
+    wheel_remove(wheel, node);
+    
+    node->expires = wheel->tick + delay_ms / WHEEL_TICK_MS;
+    wheel_place(wheel, node);
+    wheel->count++;
+}
+
+// Saca un timer de la rueda
+void wheel_remove(TimerWheel *wheel, TimerNode *node) {
+    if (!timer_pending(node)) {
+        return;
+    }
+    list_unlink(node);
+    wheel->count--;
+}
+
+// Procesa los ticks vencidos
+int wheel_advance(TimerWheel *wheel, uint64_t now_ms, TimerExpireFn expire, void *arg) {
+    if (now_ms < wheel->start_ms) {
+        return 0;
+    }
+    
+    uint64_t target = (now_ms - wheel->start_ms) / WHEEL_TICK_MS;
+    int expired = 0;
+    
+    // Rueda vacía: no hay nada que recorrer
+    if (wheel->count == 0) {
+        if (target >= wheel->tick) {
+            wheel->tick = target + 1;
+        }
+        return 0;
+    }
+    
+    while (wheel->tick <= target) {
+        int index = wheel->tick & WHEEL_MASK;
+        
+        // El nivel 0 dio la vuelta: bajar el slot actual del nivel 1, y
+        // si ese también dio la vuelta, el del nivel 2, etc.
+        int cascade_index = index;
+        for (int level = 1; cascade_index == 0 && level < WHEEL_LEVELS; level++) {
+            cascade_index = (wheel->tick >> (WHEEL_BITS * level)) & WHEEL_MASK;
+            wheel_cascade(wheel, level, cascade_index);
+        }
+        
+        wheel->tick++;
+        
+        // Vencer el slot del tick; el callback puede reprogramar el timer
+        // o sacar otros de la rueda
+        TimerNode list;
+        list_move(&wheel->slots[0][index], &list);
+        while (list.next != &list) {
+            TimerNode *node = list.next;
+            list_unlink(node);
+            wheel->count--;
+            expire(node, arg);
+            expired++;
+        }
+    }
+    
+    return expired;
+}
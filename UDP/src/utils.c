@@ -1,15 +1,22 @@
+#include <netinet/udp.h>
+#include <sys/stat.h>
 #include "../include/protocol.h"
 
 // Funciones de utilidad
 
 // Convierte el tipo de PDU a string para logging
 const char* pdu_type_to_string(uint8_t type) {
-    switch(type) {
+    switch (PDU_TYPE(type)) {
         case TYPE_HELLO: return "HELLO";
         case TYPE_WRQ:   return "WRQ";
         case TYPE_DATA:  return "DATA";
         case TYPE_ACK:   return "ACK";
         case TYPE_FIN:   return "FIN";
+        case TYPE_OACK:  return "OACK";
+        case TYPE_PROBE: return "PROBE";
+        case TYPE_SIG:   return "SIG";
+        case TYPE_FEC:   return "FEC";
+        case TYPE_RRQ:   return "RRQ";
         default:         return "UNKNOWN";
     }
 }
@@ -26,21 +33,15 @@ const char* phase_to_string(int phase) {
     }
 }
 
-// Imprime el contenido de una PDU para logging
+// Registra el contenido de una PDU (nivel trace)
 void print_pdu(PDU *pdu, int data_len, const char *prefix) {
-    printf("%s PDU [Type=%s(%d), SeqNum=%d, DataLen=%d]\n",
-           prefix,
-           pdu_type_to_string(pdu->type),
-           pdu->type,
-           pdu->seq_num,
-           data_len);
-}
-
-// Imprime una dirección IP:port
-void print_address(struct sockaddr_in *addr) {
-    char ip[INET_ADDRSTRLEN];
-    inet_ntop(AF_INET, &(addr->sin_addr), ip, INET_ADDRSTRLEN);
-    printf("%s:%d", ip, ntohs(addr->sin_port));
+    LOG_TRACE("%s PDU [Type=%s(%d), Lane=%d, SeqNum=%d, DataLen=%d]\n",
+              prefix,
+              pdu_type_to_string(pdu->type),
+              PDU_TYPE(pdu->type),
+              PDU_LANE(pdu->type),
+              pdu->seq_num,
+              data_len);
 }
 
 // Crea un socket UDP
@@ -85,6 +86,85 @@ int send_pdu(int sockfd, struct sockaddr_in *dest_addr,
     return sent;
 }
 
+// Envía una PDU armada a partir de un header y un payload separados
+// (scatter-gather con sendmsg: el payload no se copia a una PDU)
+int send_pdu_iov(int sockfd, struct sockaddr_in *dest_addr,
+                 const void *header, int header_len,
+                 const void *data, int data_len) {
+    struct iovec iov[2];
+    struct msghdr msg;
+    
+    iov[0].iov_base = (void*)header;
+    iov[0].iov_len = header_len;
+    iov[1].iov_base = (void*)data;
+    iov[1].iov_len = data_len;
+    
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_name = dest_addr;
+    msg.msg_namelen = sizeof(*dest_addr);
+    msg.msg_iov = iov;
+    msg.msg_iovlen = data_len > 0 ? 2 : 1;
+    
+    int sent = sendmsg(sockfd, &msg, 0);
+    if (sent < 0) {
+        perror("Error en sendmsg");
+        return -1;
+    }
+    
+    return sent;
+}
+
+// Envía una ráfaga de PDUs con UDP_SEGMENT (segmentación en el kernel)
+int send_gso(int sockfd, struct sockaddr_in *dest_addr,
+             struct iovec *iov, int iovcnt, int seg_size) {
+#ifdef UDP_SEGMENT
+    struct msghdr msg;
+    union {
+        char buf[CMSG_SPACE(sizeof(uint16_t))];
+        struct cmsghdr align;
+    } ctrl;
+    
+    memset(&msg, 0, sizeof(msg));
+    memset(&ctrl, 0, sizeof(ctrl));
+    msg.msg_name = dest_addr;
+    msg.msg_namelen = sizeof(*dest_addr);
+    msg.msg_iov = iov;
+    msg.msg_iovlen = iovcnt;
+    msg.msg_control = ctrl.buf;
+    msg.msg_controllen = sizeof(ctrl.buf);
+    
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_UDP;
+    cmsg->cmsg_type = UDP_SEGMENT;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+    uint16_t gso_size = seg_size;
+    memcpy(CMSG_DATA(cmsg), &gso_size, sizeof(gso_size));
+    
+    return sendmsg(sockfd, &msg, 0);
+#else
+    (void)sockfd; (void)dest_addr; (void)iov; (void)iovcnt; (void)seg_size;
+    errno = ENOTSUP;
+    return -1;
+#endif
+}
+
+// Prueba si el kernel acepta UDP_SEGMENT en el socket
+int gso_supported(int sockfd) {
+#ifdef UDP_SEGMENT
+    int gso_size = 0;
+    return setsockopt(sockfd, SOL_UDP, UDP_SEGMENT, &gso_size, sizeof(gso_size)) == 0;
+#else
+    (void)sockfd;
+    return 0;
+#endif
+}
+
+// Blksize por defecto (sin opción): el de la PDU original menos el seq
+// extendido en modo ventana
+int default_blksize(int window) {
+    return window > 1 ? MAX_EXT_DATA_SIZE : MAX_DATA_SIZE;
+}
+
 // Recibe una PDU con timeout usando select()
 // Retorna: número de bytes recibidos, 0 si timeout, -1 si error
 int recv_pdu_with_timeout(int sockfd, PDU *pdu, struct sockaddr_in *src_addr,
@@ -134,15 +214,15 @@ int validate_filename(const char *filename) {
     
     // Verificar longitud
     if (len < MIN_FILENAME_LEN || len > MAX_FILENAME_LEN) {
-        printf("Error: filename debe tener entre %d y %d caracteres (tiene %d)\n",
-               MIN_FILENAME_LEN, MAX_FILENAME_LEN, len);
+        LOG_WARN("Error: filename debe tener entre %d y %d caracteres (tiene %d)\n",
+                 MIN_FILENAME_LEN, MAX_FILENAME_LEN, len);
         return 0;
     }
     
     // Verificar que solo tenga caracteres ASCII imprimibles
     for (int i = 0; i < len; i++) {
         if (filename[i] < 32 || filename[i] > 126) {
-            printf("Error: filename contiene caracteres no-ASCII\n");
+            LOG_WARN("Error: filename contiene caracteres no-ASCII\n");
             return 0;
         }
     }
@@ -153,7 +233,7 @@ int validate_filename(const char *filename) {
 // Valida las credenciales (misma lógica que en el servidor)
 int validate_credentials(const char *credentials) {
     if (!credentials) {
-        printf("Error: credenciales nulas\n");
+        LOG_WARN("Error: credenciales nulas\n");
         return 0;
     }
     
@@ -161,21 +241,21 @@ int validate_credentials(const char *credentials) {
     
     // Verificar longitud máxima 
     if (len > MAX_CREDENTIALS_LEN) {
-        printf("Error: credenciales muy largas (max %d caracteres, tiene %d)\n",
-               MAX_CREDENTIALS_LEN, len);
+        LOG_WARN("Error: credenciales muy largas (max %d caracteres, tiene %d)\n",
+                 MAX_CREDENTIALS_LEN, len);
         return 0;
     }
     
     // Verificar longitud mínima
     if (len == 0) {
-        printf("Error: credenciales vacías\n");
+        LOG_WARN("Error: credenciales vacías\n");
         return 0;
     }
     
     // Verificar que solo tenga caracteres ASCII imprimibles
     for (int i = 0; i < len; i++) {
         if (credentials[i] < 32 || credentials[i] > 126) {
-            printf("Error: credenciales contienen caracteres no-ASCII\n");
+            LOG_WARN("Error: credenciales contienen caracteres no-ASCII\n");
             return 0;
         }
     }
@@ -183,16 +263,121 @@ int validate_credentials(const char *credentials) {
     return 1;
 }
 
-// Obtiene el tamaño de un archivo
-long get_file_size(const char *filepath) {
-    FILE *file = fopen(filepath, "rb");
-    if (!file) {
+// Obtiene el tamaño de un archivo (stat: 64 bits aunque long sea de 32)
+int64_t get_file_size(const char *filepath) {
+    struct stat st;
+    if (stat(filepath, &st) < 0 || !S_ISREG(st.st_mode)) {
+        return -1;
+    }
+    
+    return (int64_t)st.st_size;
+}
+
+// Tiempo monotónico en milisegundos
+uint64_t now_ms(void) {
+    return now_us() / 1000ULL;
+}
+
+// Tiempo monotónico en microsegundos
+uint64_t now_us(void) {
+    return now_ns() / 1000ULL;
+}
+
+// Tiempo monotónico en nanosegundos
+uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+// Lee el seq extendido (uint32 en network order) al inicio de data
+uint32_t pdu_get_seq32(const PDU *pdu) {
+    uint32_t seq;
+    memcpy(&seq, pdu->data, EXT_SEQ_SIZE);
+    return ntohl(seq);
+}
+
+// Escribe el seq extendido al inicio de data
+void pdu_set_seq32(PDU *pdu, uint32_t seq) {
+    uint32_t net_seq = htonl(seq);
+    memcpy(pdu->data, &net_seq, EXT_SEQ_SIZE);
+}
+
+// Vista de un datagrama recibido: Type sin el lane y el payload en buf
+PduView pdu_view(const uint8_t *buf) {
+    PduView view = { PDU_TYPE(buf[0]), buf[1], buf + 2 };
+    return view;
+}
+
+// Lee un uint32 en network order
+uint32_t get_be32(const uint8_t *buf) {
+    uint32_t value;
+    memcpy(&value, buf, sizeof(value));
+    return ntohl(value);
+}
+
+// Escribe un uint32 en network order
+void put_be32(uint8_t *buf, uint32_t value) {
+    uint32_t net_value = htonl(value);
+    memcpy(buf, &net_value, sizeof(net_value));
+}
+
+// Lee un uint64 en network order
+uint64_t get_be64(const uint8_t *buf) {
+    uint64_t value = 0;
+    for (int i = 0; i < 8; i++) {
+        value = (value << 8) | buf[i];
+    }
+    return value;
+}
+
+// Escribe un uint64 en network order
+void put_be64(uint8_t *buf, uint64_t value) {
+    for (int i = 7; i >= 0; i--) {
+        buf[i] = value & 0xff;
+        value >>= 8;
+    }
+}
+
+// Agrega una opción "nombre\0valor\0" al final de buf
+// Retorna el nuevo largo o -1 si no entra (o si len ya era -1, así una
+// cadena de llamadas se verifica una sola vez al final)
+int append_option(uint8_t *buf, int len, int max_len,
+                  const char *name, const char *value) {
+    int name_len = strlen(name) + 1;
+    int value_len = strlen(value) + 1;
+    
+    if (len < 0 || len + name_len + value_len > max_len) {
         return -1;
     }
     
-    fseek(file, 0, SEEK_END);
-    long size = ftell(file);
-    fclose(file);
+    memcpy(buf + len, name, name_len);
+    memcpy(buf + len + name_len, value, value_len);
     
-    return size;
-}
\ No newline at end of file
+    return len + name_len + value_len;
+}
+
+// Busca una opción en una lista "nombre\0valor\0..."
+// Retorna el valor o NULL si no existe o la lista está mal formada
+const char* find_option(const uint8_t *buf, int len, const char *name) {
+    int pos = 0;
+    
+    while (pos < len) {
+        const char *opt_name = (const char*)buf + pos;
+        const uint8_t *name_end = memchr(buf + pos, '\0', len - pos);
+        if (!name_end) return NULL;
+        pos = (name_end - buf) + 1;
+        
+        if (pos >= len) return NULL;
+        const char *opt_value = (const char*)buf + pos;
+        const uint8_t *value_end = memchr(buf + pos, '\0', len - pos);
+        if (!value_end) return NULL;
+        pos = (value_end - buf) + 1;
+        
+        if (strcmp(opt_name, name) == 0) {
+            return opt_value;
+        }
+    }
+    
+    return NULL;
+}
@@ -0,0 +1,27 @@
+#ifndef CHECK_H
+#define CHECK_H
+
+#include <stdio.h>
+
+// Mínimo de soporte para las pruebas unitarias (make test)
+// Cada prueba es un ejecutable: CHECK registra una falla sin cortar la
+// ejecución y check_result imprime el resumen y da el código de salida.
+
+static int checks_run = 0;
+static int checks_failed = 0;
+
+#define CHECK(cond) do { \
+    checks_run++; \
+    if (!(cond)) { \
+        checks_failed++; \
+        fprintf(stderr, "FALLA %s:%d: %s\n", __FILE__, __LINE__, #cond); \
+    } \
+} while (0)
+
+// Retorna 0 si pasaron todos los CHECK, 1 si no
+static inline int check_result(const char *module) {
+    printf("%-14s %d/%d chequeos OK\n", module, checks_run - checks_failed, checks_run);
+    return checks_failed ? 1 : 0;
+}
+
+#endif
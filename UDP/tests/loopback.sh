@@ -0,0 +1,103 @@
+#!/bin/bash
+# Transferencias de punta a punta por bin/proxy (demora, pérdida y ancho de
+# banda limitado), una por modo, comparando con cmp lo que escribió el
+# servidor o lo que se descargó
+# Uso: tests/loopback.sh (con los binarios compilados; lo corre make test)
+# El servidor usa su puerto fijo (20252): no tiene que haber otro levantado
+
+set -u
+
+ROOT=$(cd "$(dirname "$0")/.." && pwd)
+CLIENT=$ROOT/bin/client
+SERVER=$ROOT/bin/server
+PROXY=$ROOT/bin/proxy
+CREDS=g14-978e
+PROXY_PORT=${PROXY_PORT:-20263}
+
+WORK=$(mktemp -d)
+SERVER_PID=
+PROXY_PID=
+failed=0
+
+cleanup() {
+    [ -n "$PROXY_PID" ] && kill "$PROXY_PID" 2>/dev/null
+    [ -n "$SERVER_PID" ] && kill "$SERVER_PID" 2>/dev/null
+    wait 2>/dev/null
+    rm -rf "$WORK"
+}
+trap cleanup EXIT
+
+# Resultado de un modo: compara el original con lo transferido
+# Uso: check <modo> <original> <transferido> [texto que debe estar en el log]
+check() {
+    local mode=$1 expected=$2 got=$3 pattern=${4:-}
+    if ! cmp -s "$expected" "$got"; then
+        printf '  %-8s FALLA (el archivo no coincide)\n' "$mode"
+    elif [ -n "$pattern" ] && ! grep -q "$pattern" "$mode.log"; then
+        printf '  %-8s FALLA (falta "%s" en la salida del cliente)\n' "$mode" "$pattern"
+    else
+        printf '  %-8s OK\n' "$mode"
+        return
+    fi
+    failed=1
+    tail -n 5 "$mode.log" | sed 's/^/    /'
+}
+
+# Sube un archivo por el proxy
+# Uso: upload <modo> <archivo> <nombre> [opciones del cliente]
+upload() {
+    local mode=$1 file=$2 name=$3
+    shift 3
+    timeout 60 "$CLIENT" -P "$PROXY_PORT" "$@" 127.0.0.1 "$CREDS" "$file" "$name" >> "$mode.log" 2>&1
+}
+
+cd "$WORK" || exit 1
+mkdir test_files
+
+"$SERVER" -q "$CREDS" > server.log 2>&1 &
+SERVER_PID=$!
+"$PROXY" -l "$PROXY_PORT" -d 2 -L 0.01 -b 50 -S 7 -q > proxy.log 2>&1 &
+PROXY_PID=$!
+sleep 0.3
+if ! kill -0 "$SERVER_PID" 2>/dev/null || ! kill -0 "$PROXY_PID" 2>/dev/null; then
+    echo "No se pudo levantar el servidor o el proxy (¿puertos en uso?)"
+    cat server.log proxy.log
+    exit 1
+fi
+
+head -c 65536 /dev/urandom > small.data
+head -c 4194304 /dev/urandom > medium.data
+head -c 16777216 /dev/urandom > large.data
+
+echo "Transferencias por bin/proxy (2 ms, 1% de pérdida, 50 Mbit/s):"
+
+# Stop & Wait con el WRQ original
+upload sw small.data swfile -q -s
+check sw small.data test_files/swfile.received
+
+# Ventana con un ACK por DATA (sin SACK)
+upload window medium.data winfile -q -a
+check window medium.data test_files/winfile.received
+
+# Ventana con ACKs acumulativos y SACK (default)
+upload sack medium.data sackfile -q
+check sack medium.data test_files/sackfile.received
+
+# Subida cortada a mitad de camino y retomada desde el checkpoint
+{ timeout -s KILL 1 "$CLIENT" -q -P "$PROXY_PORT" 127.0.0.1 "$CREDS" large.data resfile > resume.log 2>&1; } 2>/dev/null
+upload resume large.data resfile
+check resume large.data test_files/resfile.received "Retomando subida"
+
+# Delta contra la copia anterior: un tramo cambiado y una cola nueva
+cp medium.data delta.data
+head -c 4096 /dev/urandom | dd of=delta.data bs=1 seek=1000000 conv=notrunc 2>/dev/null
+head -c 20000 /dev/urandom >> delta.data
+upload delta medium.data deltafile -q
+upload delta delta.data deltafile -d
+check delta delta.data test_files/deltafile.received "copiados de la copia del servidor"
+
+# Descarga (RRQ) del archivo subido en modo SACK
+upload rrq download.data sackfile -q -r
+check rrq medium.data download.data
+
+exit $failed
@@ -0,0 +1,87 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../include/checksum.h"
+#include "check.h"
+
+// CRC32C: vectores conocidos (RFC 3720 B.4), encadenado, combine y los
+// carriles de hardware contra una implementación bit a bit
+
+// Referencia bit a bit, sin tabla ni hardware
+static uint32_t crc32c_bitwise(uint32_t crc, const uint8_t *data, size_t len) {
+    crc = ~crc;
+    for (size_t i = 0; i < len; i++) {
+        crc ^= data[i];
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc >> 1) ^ (0x82f63b78 & (0 - (crc & 1)));
+        }
+    }
+    return ~crc;
+}
+
+static void test_vectors(void) {
+    uint8_t buf[32];
+    
+    CHECK(crc32c_update(CRC32C_INIT, "123456789", 9) == 0xe3069283);
+    CHECK(crc32c_update(CRC32C_INIT, buf, 0) == 0);
+    
+    memset(buf, 0, sizeof(buf));
+    CHECK(crc32c_update(CRC32C_INIT, buf, sizeof(buf)) == 0x8a9136aa);
+    memset(buf, 0xff, sizeof(buf));
+    CHECK(crc32c_update(CRC32C_INIT, buf, sizeof(buf)) == 0x62a8ab43);
+    for (int i = 0; i < 32; i++) {
+        buf[i] = i;
+    }
+    CHECK(crc32c_update(CRC32C_INIT, buf, sizeof(buf)) == 0x46dd794e);
+    for (int i = 0; i < 32; i++) {
+        buf[i] = 31 - i;
+    }
+    CHECK(crc32c_update(CRC32C_INIT, buf, sizeof(buf)) == 0x113fdb5c);
+}
+
+// Largos alrededor del corte de los tres carriles (3 x 8192) y desalineados
+static void test_against_bitwise(const uint8_t *data) {
+    static const size_t lens[] = { 1, 7, 8, 9, 63, 4096, 24575, 24576, 24577, 65536, 100003 };
+    
+    for (size_t i = 0; i < sizeof(lens) / sizeof(lens[0]); i++) {
+        for (size_t misalign = 0; misalign < 3; misalign++) {
+            CHECK(crc32c_update(CRC32C_INIT, data + misalign, lens[i]) ==
+                  crc32c_bitwise(0, data + misalign, lens[i]));
+        }
+    }
+}
+
+static void test_chaining(const uint8_t *data, size_t len) {
+    uint32_t whole = crc32c_update(CRC32C_INIT, data, len);
+    static const size_t splits[] = { 0, 1, 5, 8191, 8192, 30000, 100000 };
+    
+    for (size_t i = 0; i < sizeof(splits) / sizeof(splits[0]); i++) {
+        size_t split = splits[i];
+        uint32_t a = crc32c_update(CRC32C_INIT, data, split);
+        uint32_t b = crc32c_update(CRC32C_INIT, data + split, len - split);
+        CHECK(crc32c_update(a, data + split, len - split) == whole);
+        CHECK(crc32c_combine(a, b, len - split) == whole);
+    }
+    
+    // b vacío: combine no cambia el CRC
+    CHECK(crc32c_combine(whole, 0, 0) == whole);
+}
+
+int main(void) {
+    size_t len = 100006;
+    uint8_t *data = malloc(len);
+    if (!data) {
+        return 1;
+    }
+    srand(1);
+    for (size_t i = 0; i < len; i++) {
+        data[i] = rand() & 0xff;
+    }
+    
+    test_vectors();
+    test_against_bitwise(data);
+    test_chaining(data, 100000);
+    
+    free(data);
+    return check_result("checksum");
+}
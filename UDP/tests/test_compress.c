@@ -0,0 +1,139 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../include/compress.h"
+#include "check.h"
+
+// LZ: ida y vuelta con datos de distinta compresibilidad, salida acotada
+// (prefijo) y streams inválidos
+
+static uint8_t src[LZ_MAX_BLOCK];
+static uint8_t packed[LZ_MAX_BLOCK + LZ_MAX_BLOCK / 64];
+static uint8_t unpacked[LZ_MAX_BLOCK];
+
+// Comprime n bytes de src en cap bytes y verifica que el prefijo
+// consumido vuelva igual
+// Retorna los bytes consumidos (-1 si algo falló)
+static int round_trip(int n, int cap, int *packed_len) {
+    int consumed = -1;
+    int len = lz_compress(src, n, packed, cap, &consumed);
+    CHECK(len >= 0 && len <= cap);
+    CHECK(consumed >= 0 && consumed <= n);
+    if (len < 0 || len > cap || consumed < 0 || consumed > n) {
+        return -1;
+    }
+    
+    int out = lz_decompress(packed, len, unpacked, LZ_MAX_BLOCK);
+    CHECK(out == consumed);
+    CHECK(out >= 0 && memcmp(unpacked, src, out) == 0);
+    if (packed_len) {
+        *packed_len = len;
+    }
+    return out == consumed ? consumed : -1;
+}
+
+// Peor caso: todo literal, un byte de token cada 128
+static int worst_case(int n) {
+    return n + (n + 127) / 128;
+}
+
+static void fill_random(int n) {
+    for (int i = 0; i < n; i++) {
+        src[i] = rand() & 0xff;
+    }
+}
+
+static void fill_text(int n) {
+    static const char *words[] = { "paquete ", "ventana ", "servidor ", "ACK ", "DATA ", "\n" };
+    int i = 0;
+    while (i < n) {
+        const char *word = words[rand() % 6];
+        for (int j = 0; word[j] && i < n; j++) {
+            src[i++] = word[j];
+        }
+    }
+}
+
+static void test_full_blocks(void) {
+    int len;
+    
+    fill_random(LZ_MAX_BLOCK);
+    CHECK(round_trip(LZ_MAX_BLOCK, worst_case(LZ_MAX_BLOCK), &len) == LZ_MAX_BLOCK);
+    
+    // Ceros: copias largas con bytes de extensión (M = 127)
+    memset(src, 0, LZ_MAX_BLOCK);
+    CHECK(round_trip(LZ_MAX_BLOCK, worst_case(LZ_MAX_BLOCK), &len) == LZ_MAX_BLOCK);
+    CHECK(len < LZ_MAX_BLOCK / 200);
+    
+    fill_text(LZ_MAX_BLOCK);
+    CHECK(round_trip(LZ_MAX_BLOCK, worst_case(LZ_MAX_BLOCK), &len) == LZ_MAX_BLOCK);
+    CHECK(len < LZ_MAX_BLOCK / 2);
+    
+    // Patrón corto repetido: copias solapadas (Off < largo)
+    for (int i = 0; i < 65536; i++) {
+        src[i] = "xyz"[i % 3];
+    }
+    CHECK(round_trip(65536, worst_case(65536), &len) == 65536);
+    
+    // Bloques cortos, menores que una coincidencia mínima
+    for (int n = 0; n <= LZ_MIN_MATCH + 1; n++) {
+        CHECK(round_trip(n, worst_case(n) + 1, NULL) == n);
+    }
+}
+
+// Con poco espacio se comprime el mayor prefijo que entra
+static void test_bounded_output(void) {
+    static const int caps[] = { 2, 3, 100, 1400, 8192 };
+    
+    for (int kind = 0; kind < 2; kind++) {
+        if (kind == 0) {
+            fill_random(65536);
+        } else {
+            fill_text(65536);
+        }
+        for (size_t i = 0; i < sizeof(caps) / sizeof(caps[0]); i++) {
+            int consumed = round_trip(65536, caps[i], NULL);
+            CHECK(consumed > 0 && consumed < 65536);
+            // Comprimible: al menos lo que entraría como literales
+            if (kind == 1) {
+                CHECK(consumed >= caps[i] - caps[i] / 64 - 1);
+            }
+        }
+    }
+}
+
+static void test_invalid(void) {
+    uint8_t out[64];
+    
+    // Literales y copia solapada armados a mano: "abc" + 20 bytes desde 3 atrás
+    const uint8_t overlap[] = { 0x02, 'a', 'b', 'c', 0x80 | 16, 3, 0 };
+    CHECK(lz_decompress(overlap, sizeof(overlap), out, sizeof(out)) == 23);
+    CHECK(memcmp(out, "abcabcabcabcabcabcabcab", 23) == 0);
+    CHECK(lz_decompress(overlap, sizeof(overlap), out, 22) == -1);
+    
+    const uint8_t before_start[] = { 0x80, 0x01, 0x00 };
+    CHECK(lz_decompress(before_start, sizeof(before_start), out, sizeof(out)) == -1);
+    
+    const uint8_t zero_offset[] = { 0x00, 'a', 0x80, 0x00, 0x00 };
+    CHECK(lz_decompress(zero_offset, sizeof(zero_offset), out, sizeof(out)) == -1);
+    
+    const uint8_t short_literal[] = { 0x05, 'a', 'b' };
+    CHECK(lz_decompress(short_literal, sizeof(short_literal), out, sizeof(out)) == -1);
+    
+    const uint8_t short_match[] = { 0x00, 'a', 0x80, 0x01 };
+    CHECK(lz_decompress(short_match, sizeof(short_match), out, sizeof(out)) == -1);
+    
+    const uint8_t short_extension[] = { 0x00, 'a', 0xff, 0x01, 0x00, 0xff };
+    CHECK(lz_decompress(short_extension, sizeof(short_extension), out, sizeof(out)) == -1);
+    
+    const uint8_t too_long[] = { 0x00, 'a', 0xff, 0x01, 0x00, 0x10 };
+    CHECK(lz_decompress(too_long, sizeof(too_long), out, sizeof(out)) == -1);
+}
+
+int main(void) {
+    srand(1);
+    test_full_blocks();
+    test_bounded_output();
+    test_invalid();
+    return check_result("compress");
+}
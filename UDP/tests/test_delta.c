@@ -0,0 +1,209 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "../include/protocol.h"
+#include "../include/checksum.h"
+#include "../include/delta.h"
+#include "check.h"
+
+// Delta: el stream del generador, aplicado sobre la copia anterior, tiene
+// que reconstruir el archivo nuevo (leyendo del mapeo y con pread), y el
+// decodificador rechaza streams inválidos
+
+#define BASIS_SIZE (2 * 1024 * 1024)
+
+typedef struct {
+    uint8_t *data;
+    size_t len;
+    size_t cap;
+} Output;
+
+static int collect(void *ctx, const uint8_t *data, size_t len) {
+    Output *out = ctx;
+    if (out->len + len > out->cap) {
+        return -1;
+    }
+    memcpy(out->data + out->len, data, len);
+    out->len += len;
+    return 0;
+}
+
+static void fill_random(uint8_t *buf, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        buf[i] = rand() & 0xff;
+    }
+}
+
+static int write_temp(const uint8_t *data, size_t len, char *path) {
+    strcpy(path, "/tmp/test_delta_XXXXXX");
+    int fd = mkstemp(path);
+    if (fd < 0) {
+        return -1;
+    }
+    if (write(fd, data, len) != (ssize_t)len) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// Versión nueva: inserción, un bloque modificado, un tramo borrado y una
+// cola agregada respecto de la copia anterior
+static size_t make_new_version(const uint8_t *basis, uint8_t *out) {
+    size_t len = 0;
+    
+    memcpy(out, basis, 300000);
+    len = 300000;
+    fill_random(out + len, 777);
+    len += 777;
+    memcpy(out + len, basis + 300000, 900000);
+    memset(out + len + 200000, 'M', 100);
+    len += 900000;
+    memcpy(out + len, basis + 1205000, BASIS_SIZE - 1205000);
+    len += BASIS_SIZE - 1205000;
+    fill_random(out + len, 3000);
+    len += 3000;
+    return len;
+}
+
+// Genera el stream contra la copia anterior de basis_fd y lo aplica de a
+// chunk bytes (cortando instrucciones entre llamadas)
+static void check_transfer(int basis_fd, const DeltaSig *sigs, uint32_t blocks, int block_size,
+                           const uint8_t *file, size_t size, int file_fd, size_t chunk,
+                           uint64_t min_copied) {
+    DeltaEncoder enc;
+    DeltaDecoder dec;
+    Output out = { malloc(size + 1), 0, size + 1 };
+    uint8_t *stream = malloc(chunk);
+    uint8_t *scratch = malloc(block_size);
+    
+    CHECK(delta_encoder_init(&enc, sigs, blocks, block_size, file_fd,
+                             file_fd < 0 ? file : NULL, size) == 0);
+    memset(&dec, 0, sizeof(dec));
+    dec.basis_fd = basis_fd;
+    dec.block_size = block_size;
+    dec.blocks = blocks;
+    
+    uint64_t stream_bytes = 0;
+    int ok = 1;
+    int got;
+    while (ok && (got = delta_encoder_read(&enc, stream, chunk)) > 0) {
+        stream_bytes += got;
+        ok = delta_decode(&dec, stream, got, scratch, block_size, collect, &out) == 0;
+    }
+    CHECK(ok && got == 0);
+    CHECK(delta_decode_complete(&dec));
+    CHECK(out.len == size && memcmp(out.data, file, size) == 0);
+    CHECK(dec.output_bytes == size);
+    CHECK(enc.crc == crc32c_update(CRC32C_INIT, file, size));
+    CHECK(enc.copied_bytes + enc.literal_bytes == size);
+    CHECK(dec.copied_bytes == enc.copied_bytes);
+    CHECK(enc.copied_bytes >= min_copied);
+    
+    // Lo copiado no viaja: el stream es poco más que los literales
+    CHECK(stream_bytes <= enc.literal_bytes + size / 100);
+    
+    delta_encoder_free(&enc);
+    free(out.data);
+    free(stream);
+    free(scratch);
+}
+
+static void test_invalid(int basis_fd, int block_size, uint32_t blocks) {
+    DeltaDecoder dec;
+    uint8_t scratch[DELTA_MAX_BLOCK];
+    Output out = { malloc(BASIS_SIZE), 0, BASIS_SIZE };
+    uint8_t op[DELTA_COPY_SIZE];
+    
+    memset(&dec, 0, sizeof(dec));
+    dec.basis_fd = basis_fd;
+    dec.block_size = block_size;
+    dec.blocks = blocks;
+    
+    // Op desconocido
+    op[0] = 0x07;
+    CHECK(delta_decode(&dec, op, 1, scratch, block_size, collect, &out) == -1);
+    
+    // Copia que se pasa de la copia anterior
+    op[0] = DELTA_OP_COPY;
+    put_be32(op + 1, blocks - 1);
+    put_be32(op + 5, 2);
+    CHECK(delta_decode(&dec, op, DELTA_COPY_SIZE, scratch, block_size, collect, &out) == -1);
+    
+    // Copia de cero bloques y literal vacío
+    dec.op_len = 0;
+    put_be32(op + 1, 0);
+    put_be32(op + 5, 0);
+    CHECK(delta_decode(&dec, op, DELTA_COPY_SIZE, scratch, block_size, collect, &out) == -1);
+    dec.op_len = 0;
+    op[0] = DELTA_OP_LITERAL;
+    put_be32(op + 1, 0);
+    CHECK(delta_decode(&dec, op, DELTA_LITERAL_HDR, scratch, block_size, collect, &out) == -1);
+    
+    // Stream cortado a mitad de una instrucción y de un literal
+    dec.op_len = 0;
+    dec.literal_left = 0;
+    put_be32(op + 1, 10);
+    CHECK(delta_decode(&dec, op, 3, scratch, block_size, collect, &out) == 0);
+    CHECK(!delta_decode_complete(&dec));
+    CHECK(delta_decode(&dec, op + 3, 2, scratch, block_size, collect, &out) == 0);
+    CHECK(!delta_decode_complete(&dec));
+    CHECK(delta_decode(&dec, (const uint8_t*)"0123456789", 10, scratch, block_size,
+                       collect, &out) == 0);
+    CHECK(delta_decode_complete(&dec));
+    CHECK(out.len == 10 && memcmp(out.data, "0123456789", 10) == 0);
+    
+    free(out.data);
+}
+
+int main(void) {
+    uint8_t *basis = malloc(BASIS_SIZE);
+    uint8_t *file = malloc(BASIS_SIZE + 4096);
+    char basis_path[32];
+    char file_path[32];
+    
+    srand(1);
+    fill_random(basis, BASIS_SIZE);
+    size_t size = make_new_version(basis, file);
+    
+    int basis_fd = write_temp(basis, BASIS_SIZE, basis_path);
+    int file_fd = write_temp(file, size, file_path);
+    CHECK(basis_fd >= 0 && file_fd >= 0);
+    if (basis_fd < 0 || file_fd < 0) {
+        return check_result("delta");
+    }
+    unlink(basis_path);
+    unlink(file_path);
+    
+    // Firmas de la copia anterior, como las arma el servidor
+    int block_size = delta_block_size(BASIS_SIZE);
+    uint32_t blocks = BASIS_SIZE / block_size;
+    CHECK(block_size >= DELTA_MIN_BLOCK && block_size <= DELTA_MAX_BLOCK);
+    CHECK(delta_block_size(0) == DELTA_MIN_BLOCK);
+    CHECK(delta_block_size(UINT64_MAX) == DELTA_MAX_BLOCK);
+    DeltaSig *sigs = malloc(blocks * sizeof(DeltaSig));
+    for (uint32_t i = 0; i < blocks; i++) {
+        sigs[i].weak = delta_weak(basis + (size_t)i * block_size, block_size);
+        sigs[i].strong = delta_strong(basis + (size_t)i * block_size, block_size);
+    }
+    
+    // Todo salvo los bloques tocados por los cambios viene de la copia
+    uint64_t min_copied = BASIS_SIZE - 5000 - 8 * (uint64_t)block_size;
+    check_transfer(basis_fd, sigs, blocks, block_size, file, size, -1, 1400, min_copied);
+    check_transfer(basis_fd, sigs, blocks, block_size, file, size, file_fd, 65497, min_copied);
+    check_transfer(basis_fd, sigs, blocks, block_size, file, size, -1, 7, min_copied);
+    
+    // Sin firmas todo es literal; un archivo vacío no genera instrucciones
+    check_transfer(basis_fd, sigs, 0, block_size, file, size, -1, 1400, 0);
+    check_transfer(basis_fd, sigs, blocks, block_size, file, 0, -1, 1400, 0);
+    
+    test_invalid(basis_fd, block_size, blocks);
+    
+    close(basis_fd);
+    close(file_fd);
+    free(sigs);
+    free(basis);
+    free(file);
+    return check_result("delta");
+}
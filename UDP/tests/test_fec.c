@@ -0,0 +1,149 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../include/fec.h"
+#include "check.h"
+
+// FEC: con la paridad y todos los DATA del grupo menos uno se reconstruye
+// el que falta (payload, largo y flags); con dos pérdidas o sin paridad no
+
+#define BLKSIZE 1400
+
+typedef struct {
+    uint8_t data[FEC_MAX_K][BLKSIZE];
+    int len[FEC_MAX_K];
+    uint8_t flags[FEC_MAX_K];
+    uint8_t parity[BLKSIZE];        // El FEC que manda el cliente
+    int parity_len;
+    uint16_t len_xor;
+    uint8_t flags_xor;
+} Group;
+
+static FecGroup new_group(void) {
+    FecGroup group;
+    memset(&group, 0, sizeof(group));
+    group.xor = calloc(1, BLKSIZE);
+    return group;
+}
+
+// Arma count DATA de largos y flags variados y su FEC como el cliente
+static void make_group(Group *g, int count) {
+    FecGroup sender = new_group();
+    
+    fec_group_reset(&sender, 0);
+    for (int i = 0; i < count; i++) {
+        g->len[i] = 1 + rand() % BLKSIZE;
+        g->flags[i] = rand() & 1;
+        for (int j = 0; j < g->len[i]; j++) {
+            g->data[i][j] = rand() & 0xff;
+        }
+        fec_group_add(&sender, i, g->data[i], g->len[i], g->flags[i]);
+    }
+    memcpy(g->parity, sender.xor, sender.max_len);
+    g->parity_len = sender.max_len;
+    g->len_xor = sender.len_xor;
+    g->flags_xor = sender.flags_xor;
+    free(sender.xor);
+}
+
+// Recibe el grupo sin los DATA de skip (bitmap), con la paridad antes o
+// después de los DATA, y verifica la reconstrucción si falta uno solo
+static void receive(FecGroup *group, const Group *g, int count, uint32_t skip, int parity_first) {
+    fec_group_reset(group, 64);
+    if (parity_first) {
+        fec_group_add_parity(group, count, g->len_xor, g->flags_xor, g->parity, g->parity_len);
+    }
+    for (int i = count - 1; i >= 0; i--) {
+        if (!(skip & (1u << i))) {
+            fec_group_add(group, i, g->data[i], g->len[i], g->flags[i]);
+        }
+    }
+    if (!parity_first) {
+        fec_group_add_parity(group, count, g->len_xor, g->flags_xor, g->parity, g->parity_len);
+    }
+}
+
+static void test_single_loss(int count) {
+    static Group g;
+    FecGroup group = new_group();
+    
+    make_group(&g, count);
+    for (int missing = 0; missing < count; missing++) {
+        receive(&group, &g, count, 1u << missing, missing & 1);
+        CHECK(fec_group_missing(&group) == missing);
+        CHECK(group.len_xor == g.len[missing]);
+        CHECK(group.flags_xor == g.flags[missing]);
+        CHECK(memcmp(group.xor, g.data[missing], g.len[missing]) == 0);
+        
+        // Después del largo reconstruido, el relleno en cero
+        int padding_zero = 1;
+        for (int j = g.len[missing]; j < group.max_len; j++) {
+            padding_zero &= group.xor[j] == 0;
+        }
+        CHECK(padding_zero);
+    }
+    free(group.xor);
+}
+
+static void test_not_recoverable(void) {
+    static Group g;
+    FecGroup group = new_group();
+    
+    make_group(&g, 8);
+    
+    // Dos pérdidas
+    receive(&group, &g, 8, 0x05, 0);
+    CHECK(fec_group_missing(&group) == -1);
+    
+    // Sin pérdidas no hay nada que reconstruir
+    receive(&group, &g, 8, 0, 1);
+    CHECK(fec_group_missing(&group) == -1);
+    
+    // Sin paridad
+    fec_group_reset(&group, 0);
+    for (int i = 1; i < 8; i++) {
+        fec_group_add(&group, i, g.data[i], g.len[i], g.flags[i]);
+    }
+    CHECK(fec_group_missing(&group) == -1);
+    
+    // Último grupo corto (menos de k DATA): la paridad declara cuántos, y
+    // un DATA fuera de ese rango invalida la reconstrucción
+    make_group(&g, 3);
+    receive(&group, &g, 3, 1u << 1, 0);
+    CHECK(fec_group_missing(&group) == 1);
+    CHECK(memcmp(group.xor, g.data[1], g.len[1]) == 0);
+    fec_group_add(&group, 5, g.data[0], g.len[0], g.flags[0]);
+    CHECK(fec_group_missing(&group) == -1);
+    
+    free(group.xor);
+}
+
+static void test_xor(void) {
+    uint8_t a[37], b[37], c[37];
+    
+    for (int i = 0; i < 37; i++) {
+        a[i] = rand() & 0xff;
+        b[i] = rand() & 0xff;
+        c[i] = a[i];
+    }
+    
+    // Desalineado y con cola de menos de 8 bytes
+    fec_xor(c + 1, b + 1, 35);
+    int ok = c[0] == a[0] && c[36] == a[36];
+    for (int i = 1; i < 36; i++) {
+        ok &= c[i] == (a[i] ^ b[i]);
+    }
+    CHECK(ok);
+    fec_xor(c + 1, b + 1, 35);
+    CHECK(memcmp(c, a, sizeof(a)) == 0);
+}
+
+int main(void) {
+    srand(1);
+    test_xor();
+    test_single_loss(FEC_MIN_K);
+    test_single_loss(4);
+    test_single_loss(FEC_MAX_K);
+    test_not_recoverable();
+    return check_result("fec");
+}
@@ -0,0 +1,88 @@
+#include <stdint.h>
+#include "../include/protocol.h"
+#include "../include/rtt.h"
+#include "check.h"
+
+// Estimador de RTT: los valores de RFC 6298 paso a paso, el margen mínimo
+// sobre SRTT, el backoff y sus cotas
+
+static void test_rfc6298(void) {
+    RttEstimator rtt;
+    
+    rtt_init(&rtt);
+    CHECK(rtt_timeout_ms(&rtt) == TIMEOUT_MS);
+    CHECK(!rtt.has_sample);
+    
+    // Primera muestra: SRTT = R, RTTVAR = R/2, RTO = SRTT + 4 RTTVAR
+    rtt_sample(&rtt, 100000);
+    CHECK(rtt.srtt_us == 100000);
+    CHECK(rtt.rttvar_us == 50000);
+    CHECK(rtt_timeout_ms(&rtt) == 300);
+    
+    // Segunda: RTTVAR con el SRTT anterior, después SRTT
+    //   RTTVAR = 3/4 50000 + 1/4 |100000 - 200000| = 62500
+    //   SRTT   = 7/8 100000 + 1/8 200000 = 112500
+    //   RTO    = 112500 + 4 * 62500 = 362500 us -> 363 ms (hacia arriba)
+    rtt_sample(&rtt, 200000);
+    CHECK(rtt.rttvar_us == 62500);
+    CHECK(rtt.srtt_us == 112500);
+    CHECK(rtt.last_rtt_us == 200000);
+    CHECK(rtt_timeout_ms(&rtt) == 363);
+}
+
+static void test_backoff(void) {
+    RttEstimator rtt;
+    
+    rtt_init(&rtt);
+    rtt_sample(&rtt, 100000);
+    
+    int expected = 300;
+    for (int i = 1; i <= 8; i++) {
+        rtt_backoff(&rtt);
+        expected = expected * 2 > RTO_MAX_MS ? RTO_MAX_MS : expected * 2;
+        CHECK(rtt_timeout_ms(&rtt) == expected);
+        CHECK(rtt.backoffs == i);
+    }
+    CHECK(rtt_timeout_ms(&rtt) == RTO_MAX_MS);
+    
+    // Una muestra nueva termina el backoff y vuelve al RTO calculado:
+    //   RTTVAR = 3/4 50000 + 1/4 0 = 37500, RTO = 100000 + 150000 us
+    rtt_sample(&rtt, 100000);
+    CHECK(rtt.backoffs == 0);
+    CHECK(rtt_timeout_ms(&rtt) == 250);
+    
+    // Sin muestras el backoff parte del RTO inicial
+    rtt_init(&rtt);
+    rtt_backoff(&rtt);
+    CHECK(rtt_timeout_ms(&rtt) == 2 * TIMEOUT_MS);
+}
+
+static void test_bounds(void) {
+    RttEstimator rtt;
+    
+    // Enlace estable: RTTVAR tiende a 0 y el margen queda en RTO_MIN_MS
+    rtt_init(&rtt);
+    for (int i = 0; i < 200; i++) {
+        rtt_sample(&rtt, 1000);
+    }
+    CHECK(rtt.srtt_us == 1000);
+    CHECK(rtt.rttvar_us == 0);
+    CHECK(rtt_timeout_ms(&rtt) == 1 + RTO_MIN_MS);
+    
+    // RTT de loopback: nunca por debajo de RTO_MIN_MS
+    rtt_init(&rtt);
+    rtt_sample(&rtt, 20);
+    CHECK(rtt_timeout_ms(&rtt) == RTO_MIN_MS + 1);
+    
+    // Muestra enorme: acotado a RTO_MAX_MS
+    rtt_init(&rtt);
+    rtt_sample(&rtt, 30000000);
+    CHECK(rtt_timeout_ms(&rtt) == RTO_MAX_MS);
+}
+
+int main(void) {
+    test_rfc6298();
+    test_backoff();
+    test_bounds();
+    return check_result("rtt");
+}
@@ -0,0 +1,159 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../include/protocol.h"
+#include "../include/session_table.h"
+#include "check.h"
+
+// Tabla de sesiones: alta, búsqueda y baja con crecimiento de la tabla y
+// del pool, backward-shift (ninguna clave queda inalcanzable tras borrar),
+// reuso de registros y límite de sesiones
+
+#define KEYS 5000
+
+static struct sockaddr_in addrs[KEYS];
+static int lanes[KEYS];
+static ClientSession *present[KEYS];   // Sesión esperada de cada clave (NULL = no está)
+
+static void make_keys(void) {
+    for (int i = 0; i < KEYS; i++) {
+        memset(&addrs[i], 0, sizeof(addrs[i]));
+        addrs[i].sin_family = AF_INET;
+        // Pocas IPs y puertos repetidos entre IPs: claves parecidas. Cada
+        // cuarta clave es otro lane de la anterior (misma dirección)
+        if (i % 4 == 3) {
+            addrs[i] = addrs[i - 1];
+            lanes[i] = 1 + i % 15;
+        } else {
+            addrs[i].sin_addr.s_addr = htonl(0x0a000000 + i % 97);
+            addrs[i].sin_port = htons(20000 + i / 97);
+            lanes[i] = 0;
+        }
+    }
+}
+
+// Todas las claves se encuentran (o no) según present
+static int table_matches(SessionTable *table) {
+    int ok = 1;
+    for (int i = 0; i < KEYS; i++) {
+        ok &= session_table_find(table, &addrs[i], lanes[i]) == present[i];
+    }
+    return ok;
+}
+
+static void test_insert_find(SessionTable *table) {
+    int fields_ok = 1;
+    
+    for (int i = 0; i < KEYS; i++) {
+        present[i] = session_table_insert(table, &addrs[i], lanes[i]);
+        if (!present[i]) {
+            CHECK(present[i] != NULL);
+            return;
+        }
+        fields_ok &= present[i]->lane == lanes[i] &&
+                     present[i]->addr.sin_addr.s_addr == addrs[i].sin_addr.s_addr &&
+                     present[i]->addr.sin_port == addrs[i].sin_port &&
+                     present[i]->phase == 0 && present[i]->active == 0;
+        present[i]->active = 1;
+    }
+    CHECK(fields_ok);
+    CHECK(table->count == KEYS);
+    CHECK(table->capacity >= 2 * KEYS);
+    CHECK(table->num_blocks == (KEYS + SESSION_POOL_BLOCK - 1) / SESSION_POOL_BLOCK);
+    CHECK(table_matches(table));
+    
+    // Registros distintos
+    int distinct = 1;
+    for (int i = 1; i < KEYS; i++) {
+        distinct &= present[i] != present[i - 1];
+    }
+    CHECK(distinct);
+    
+    // Otro lane de una dirección existente no está
+    CHECK(session_table_find(table, &addrs[0], 9) == NULL);
+}
+
+static void test_remove_reuse(SessionTable *table) {
+    // Borrar la mitad, alternando: cada baja deja huecos dentro de clusters
+    for (int i = 0; i < KEYS; i += 2) {
+        session_table_remove(table, present[i]);
+        present[i] = NULL;
+    }
+    CHECK(table->count == KEYS / 2);
+    CHECK(table_matches(table));
+    
+    // Las altas nuevas reusan los registros liberados (sin crecer el pool)
+    int blocks = table->num_blocks;
+    uint32_t capacity = table->capacity;
+    for (int i = 0; i < KEYS; i += 2) {
+        present[i] = session_table_insert(table, &addrs[i], lanes[i]);
+    }
+    CHECK(table->num_blocks == blocks);
+    CHECK(table->capacity == capacity);
+    CHECK(table->count == KEYS);
+    CHECK(table_matches(table));
+    
+    // Altas y bajas al azar
+    for (int round = 0; round < 20000; round++) {
+        int i = rand() % KEYS;
+        if (present[i]) {
+            session_table_remove(table, present[i]);
+            present[i] = NULL;
+        } else {
+            present[i] = session_table_insert(table, &addrs[i], lanes[i]);
+        }
+        if (round % 1000 == 0) {
+            CHECK(table_matches(table));
+        }
+    }
+    CHECK(table_matches(table));
+    CHECK(table->num_blocks == blocks);
+    
+    for (int i = 0; i < KEYS; i++) {
+        if (present[i]) {
+            session_table_remove(table, present[i]);
+            present[i] = NULL;
+        }
+    }
+    CHECK(table->count == 0);
+    CHECK(table_matches(table));
+}
+
+static void test_limit(void) {
+    SessionTable table;
+    ClientSession *sessions[10];
+    
+    CHECK(session_table_init(&table, 10) == 0);
+    int inserted = 1;
+    for (int i = 0; i < 10; i++) {
+        sessions[i] = session_table_insert(&table, &addrs[i], lanes[i]);
+        inserted &= sessions[i] != NULL;
+    }
+    CHECK(inserted);
+    CHECK(session_table_insert(&table, &addrs[10], lanes[10]) == NULL);
+    CHECK(table.count == 10);
+    
+    // El último registro liberado es el primero que se reusa
+    session_table_remove(&table, sessions[4]);
+    CHECK(session_table_find(&table, &addrs[4], lanes[4]) == NULL);
+    CHECK(session_table_insert(&table, &addrs[10], lanes[10]) == sessions[4]);
+    CHECK(session_table_find(&table, &addrs[10], lanes[10]) == sessions[4]);
+    session_table_destroy(&table);
+}
+
+int main(void) {
+    SessionTable table;
+    
+    srand(1);
+    make_keys();
+    CHECK(session_table_init(&table, KEYS) == 0);
+    CHECK(table.capacity == SESSION_TABLE_INITIAL && table.num_blocks == 1);
+    
+    test_insert_find(&table);
+    CHECK(session_table_insert(&table, &addrs[0], 14) == NULL);
+    test_remove_reuse(&table);
+    session_table_destroy(&table);
+    
+    test_limit();
+    return check_result("session_table");
+}
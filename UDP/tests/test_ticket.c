@@ -0,0 +1,79 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <arpa/inet.h>
+#include "../include/ticket.h"
+#include "check.h"
+
+// Tickets 0-RTT: válido solo para la IP, las credenciales y la clave con
+// que se emitió, hasta su vencimiento; cualquier cambio lo invalida
+
+int main(void) {
+    char ticket[TICKET_HEX_LEN + 1];
+    char other[TICKET_HEX_LEN + 2];
+    uint32_t ip = inet_addr("10.0.0.7");
+    time_t now = 1700000000;
+    
+    CHECK(ticket_init() == 0);
+    ticket_issue(ticket, ip, "g14-978e", now);
+    
+    CHECK(strlen(ticket) == TICKET_HEX_LEN);
+    CHECK(strspn(ticket, "0123456789abcdef") == TICKET_HEX_LEN);
+    char expiry[9];
+    memcpy(expiry, ticket, 8);
+    expiry[8] = '\0';
+    CHECK(strtoul(expiry, NULL, 16) == (unsigned long)(now + TICKET_LIFETIME));
+    
+    // Vigencia
+    CHECK(ticket_check(ticket, ip, "g14-978e", now) == 1);
+    CHECK(ticket_check(ticket, ip, "g14-978e", now + TICKET_LIFETIME) == 1);
+    CHECK(ticket_check(ticket, ip, "g14-978e", now + TICKET_LIFETIME + 1) == 0);
+    
+    // Ligado a la IP y a las credenciales
+    CHECK(ticket_check(ticket, inet_addr("10.0.0.8"), "g14-978e", now) == 0);
+    CHECK(ticket_check(ticket, ip, "g14-978f", now) == 0);
+    CHECK(ticket_check(ticket, ip, "g14-978", now) == 0);
+    
+    // Cualquier dígito cambiado (del vencimiento o del Mac)
+    int tampered_rejected = 1;
+    for (int i = 0; i < TICKET_HEX_LEN; i++) {
+        strcpy(other, ticket);
+        other[i] = other[i] == '0' ? '1' : '0';
+        tampered_rejected &= ticket_check(other, ip, "g14-978e", now) == 0;
+    }
+    CHECK(tampered_rejected);
+    
+    // Forma: mayúsculas, largo distinto, vacío
+    strcpy(other, ticket);
+    int letters = 0;
+    for (int i = 0; i < TICKET_HEX_LEN; i++) {
+        if (isalpha((unsigned char)other[i])) {
+            other[i] = toupper((unsigned char)other[i]);
+            letters++;
+        }
+    }
+    if (letters > 0) {
+        CHECK(ticket_check(other, ip, "g14-978e", now) == 0);
+    }
+    strcpy(other, ticket);
+    other[TICKET_HEX_LEN - 1] = '\0';
+    CHECK(ticket_check(other, ip, "g14-978e", now) == 0);
+    strcpy(other, ticket);
+    strcat(other, "0");
+    CHECK(ticket_check(other, ip, "g14-978e", now) == 0);
+    CHECK(ticket_check("", ip, "g14-978e", now) == 0);
+    
+    // El mismo pedido da el mismo ticket; otro instante, otro vencimiento
+    ticket_issue(other, ip, "g14-978e", now);
+    CHECK(strcmp(other, ticket) == 0);
+    ticket_issue(other, ip, "g14-978e", now + 1);
+    CHECK(strcmp(other, ticket) != 0);
+    CHECK(ticket_check(other, ip, "g14-978e", now) == 1);
+    
+    // Un servidor reiniciado (clave nueva) no acepta los tickets anteriores
+    CHECK(ticket_init() == 0);
+    CHECK(ticket_check(ticket, ip, "g14-978e", now) == 0);
+    
+    return check_result("ticket");
+}
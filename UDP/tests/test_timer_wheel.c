@@ -0,0 +1,182 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include "../include/timer_wheel.h"
+#include "check.h"
+
+// Rueda de timers: cada timer vence en el tick que le corresponde (ni
+// antes ni después, también los que bajan en cascada desde niveles
+// superiores), en orden, y los quitados o reprogramados no vencen de más
+
+#define TIMERS 3000
+
+typedef struct {
+    TimerNode node;
+    uint64_t due;                   // Tick en que tiene que vencer
+    int fired;
+    int periodic;                   // Se reprograma al vencer (delay en ms)
+} Item;
+
+typedef struct {
+    TimerWheel *wheel;
+    uint64_t first;                 // Ticks que procesa este wheel_advance: [first, to]
+    uint64_t to;
+    uint64_t last_due;              // Orden de vencimiento
+    int early_or_late;
+    int out_of_order;
+} Run;
+
+static Item items[TIMERS];
+
+static void on_expire(TimerNode *node, void *arg) {
+    Item *item = (Item*)((char*)node - offsetof(Item, node));
+    Run *run = arg;
+    
+    if (item->due < run->first || item->due > run->to) {
+        run->early_or_late++;
+    }
+    if (item->due < run->last_due) {
+        run->out_of_order++;
+    }
+    run->last_due = item->due;
+    item->fired++;
+    
+    if (item->periodic) {
+        item->due = run->wheel->tick + item->periodic / WHEEL_TICK_MS;
+        wheel_add(run->wheel, node, item->periodic);
+    }
+}
+
+static void schedule(TimerWheel *wheel, Item *item, uint64_t delay_ms) {
+    item->due = wheel->tick + delay_ms / WHEEL_TICK_MS;
+    wheel_add(wheel, &item->node, delay_ms);
+}
+
+// Avanza la rueda hasta now_ms verificando los vencimientos
+static int advance(TimerWheel *wheel, uint64_t now_ms, Run *run) {
+    run->wheel = wheel;
+    run->first = wheel->tick;
+    run->to = (now_ms - wheel->start_ms) / WHEEL_TICK_MS;
+    run->last_due = 0;
+    return wheel_advance(wheel, now_ms, on_expire, run);
+}
+
+// Un timer por nivel y en los bordes entre niveles, de a un tick
+static void test_levels(void) {
+    static const uint64_t delays[] = {
+        0, 50, 100, 6300, 6400, 6500, 10000, 100000, 409500, 409600, 3600000
+    };
+    int n = sizeof(delays) / sizeof(delays[0]);
+    TimerWheel wheel;
+    Run run = { 0 };
+    
+    wheel_init(&wheel, 1000);
+    for (int i = 0; i < n; i++) {
+        timer_init(&items[i].node);
+        items[i].fired = 0;
+        items[i].periodic = 0;
+        schedule(&wheel, &items[i], delays[i]);
+    }
+    CHECK(wheel.count == (uint32_t)n);
+    
+    int expired = 0;
+    for (uint64_t now = 1000; now <= 1000 + 3600000; now += WHEEL_TICK_MS) {
+        expired += advance(&wheel, now, &run);
+    }
+    CHECK(expired == n);
+    CHECK(run.early_or_late == 0);
+    CHECK(wheel.count == 0);
+    for (int i = 0; i < n; i++) {
+        CHECK(items[i].fired == 1 && !timer_pending(&items[i].node));
+    }
+}
+
+// Muchos timers al azar, con bajas, reprogramaciones y periódicos,
+// avanzando la rueda a saltos de distinto largo
+static void test_random(void) {
+    TimerWheel wheel;
+    Run run = { 0 };
+    uint64_t now = 5000000;
+    
+    wheel_init(&wheel, now);
+    
+    // Rueda vacía: avanzar no recorre ticks y los timers nuevos cuentan
+    // desde el tick actual
+    now += 123456;
+    CHECK(advance(&wheel, now, &run) == 0);
+    
+    for (int i = 0; i < TIMERS; i++) {
+        timer_init(&items[i].node);
+        items[i].fired = 0;
+        items[i].periodic = i % 100 == 0 ? 700 : 0;
+        uint64_t delay = (uint64_t)(rand() % 7200) * 1000 + rand() % 1000;
+        schedule(&wheel, &items[i], items[i].periodic ? (uint64_t)items[i].periodic : delay);
+    }
+    
+    int removed = 0;
+    for (int i = 1; i < TIMERS; i += 7) {
+        if (items[i].periodic) {
+            continue;
+        }
+        wheel_remove(&wheel, &items[i].node);
+        wheel_remove(&wheel, &items[i].node);
+        removed++;
+    }
+    for (int i = 3; i < TIMERS; i += 11) {
+        if (timer_pending(&items[i].node) && !items[i].periodic) {
+            schedule(&wheel, &items[i], rand() % 60000);
+        }
+    }
+    CHECK(wheel.count == (uint32_t)(TIMERS - removed));
+    
+    uint64_t end = now + 7300000;
+    while (now < end) {
+        now += WHEEL_TICK_MS * (1 + rand() % 300);
+        advance(&wheel, now, &run);
+    }
+    CHECK(run.early_or_late == 0);
+    CHECK(run.out_of_order == 0);
+    
+    int once = 1;
+    int periodic_ok = 1;
+    for (int i = 0; i < TIMERS; i++) {
+        // Reprogramado en el callback cuenta desde el tick siguiente al que
+        // venció (un vencimiento nunca se adelanta): período de 8 ticks
+        if (items[i].periodic) {
+            periodic_ok &= items[i].fired >= 7300000 / (700 + WHEEL_TICK_MS) - 1 &&
+                           timer_pending(&items[i].node);
+            wheel_remove(&wheel, &items[i].node);
+        } else {
+            once &= !timer_pending(&items[i].node) && items[i].fired == (i % 7 == 1 ? 0 : 1);
+        }
+    }
+    CHECK(once);
+    CHECK(periodic_ok);
+    CHECK(wheel.count == 0);
+}
+
+// Vencimientos más allá del último nivel se acotan a su rango
+static void test_clamp(void) {
+    TimerWheel wheel;
+    Run run = { 0 };
+    uint64_t max_ticks = (1ULL << (WHEEL_BITS * WHEEL_LEVELS)) - 1;
+    
+    wheel_init(&wheel, 0);
+    timer_init(&items[0].node);
+    items[0].fired = 0;
+    items[0].periodic = 0;
+    wheel_add(&wheel, &items[0].node, 30ULL * 24 * 3600 * 1000);
+    items[0].due = max_ticks;
+    
+    CHECK(advance(&wheel, (max_ticks - 1) * WHEEL_TICK_MS, &run) == 0);
+    CHECK(advance(&wheel, max_ticks * WHEEL_TICK_MS, &run) == 1);
+    CHECK(run.early_or_late == 0);
+}
+
+int main(void) {
+    srand(1);
+    test_levels();
+    test_random();
+    test_clamp();
+    return check_result("timer_wheel");
+}